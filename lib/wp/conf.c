@@ -252,55 +252,49 @@ open_and_load_sections (WpConf * self, const gchar *path, GError ** error)
   }
   else {
     g_auto (WpConfSection) section = { 0, };
-    g_autoptr (WpSpaJson) tmp = NULL, toplevel = NULL;
-    g_autoptr (WpSpaJsonParser) parser = wp_spa_json_parser_new_undefined (json);
+    WpSpaJsonCursor toplevel, object;
+    WpSpaJsonCursor *cursor = &toplevel;
+    gboolean has_next;
 
     /* get the very first token */
-    tmp = wp_spa_json_parser_get_json (parser);
+    wp_spa_json_cursor_init_undefined (&toplevel, json);
+    has_next = wp_spa_json_cursor_next (&toplevel);
 
     /* if the top-level token is an object, parse that instead */
-    if (tmp && wp_spa_json_is_object (tmp)) {
-      g_clear_pointer (&parser, wp_spa_json_parser_unref);
-      toplevel = g_steal_pointer (&tmp);
-      parser = wp_spa_json_parser_new_object (toplevel);
-      tmp = wp_spa_json_parser_get_json (parser);
+    if (has_next && wp_spa_json_cursor_is_object (&toplevel)) {
+      wp_spa_json_cursor_enter (&toplevel, &object);
+      cursor = &object;
+      has_next = wp_spa_json_cursor_next (cursor);
     }
 
-    while (TRUE) {
-      if (!tmp)
-        break;
-
+    for (; has_next; has_next = wp_spa_json_cursor_next (cursor)) {
       /* if !is_string, but we want to support strings without quotes */
-      if (wp_spa_json_is_container (tmp) ||
-          wp_spa_json_is_int (tmp) ||
-          wp_spa_json_is_float (tmp) ||
-          wp_spa_json_is_boolean (tmp) ||
-          wp_spa_json_is_null (tmp))
+      if (wp_spa_json_cursor_is_container (cursor) ||
+          wp_spa_json_cursor_is_int (cursor) ||
+          wp_spa_json_cursor_is_float (cursor) ||
+          wp_spa_json_cursor_is_boolean (cursor) ||
+          wp_spa_json_cursor_is_null (cursor))
       {
+        gsize size;
+        const gchar *data = wp_spa_json_cursor_get_data (cursor, &size);
         g_set_error (error, WP_DOMAIN_LIBRARY, WP_LIBRARY_ERROR_INVALID_ARGUMENT,
-            "invalid section name (not a string): %.*s",
-            (int) wp_spa_json_get_size (tmp), wp_spa_json_get_data (tmp));
+            "invalid section name (not a string): %.*s", (int) size, data);
         return FALSE;
       }
 
-      section.name = wp_spa_json_parse_string (tmp);
-      g_clear_pointer (&tmp, wp_spa_json_unref);
+      section.name = wp_spa_json_cursor_dup_string (cursor);
 
       /* parse the section contents */
-      tmp = wp_spa_json_parser_get_json (parser);
-      if (!tmp) {
+      if (!wp_spa_json_cursor_next (cursor)) {
         g_set_error (error, WP_DOMAIN_LIBRARY, WP_LIBRARY_ERROR_INVALID_ARGUMENT,
             "section '%s' has no value", section.name);
         return FALSE;
       }
 
-      section.value = g_steal_pointer (&tmp);
+      section.value = wp_spa_json_cursor_get_json (cursor);
       section.location = g_strdup (path);
       g_array_append_val (sections, section);
       memset (&section, 0, sizeof (section));
-
-      /* parse the next section name */
-      tmp = wp_spa_json_parser_get_json (parser);
     }
   }
 
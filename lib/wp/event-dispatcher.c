@@ -21,7 +21,9 @@ struct _EventData
   WpEvent *event;
   WpIterator *hooks_iter;
   WpEventHook *current_hook_in_async;
+  gint64 current_hook_start_time;
   gint64 seq;
+  gboolean dispatched; /* TRUE once "event-dispatched" has been emitted */
 };
 
 static inline EventData *
@@ -44,20 +46,108 @@ event_data_free (EventData * self)
   g_free (self);
 }
 
+typedef struct _HookTable HookTable;
+struct _HookTable
+{
+  GPtrArray *hooks; /* hooks that may run for an event type, in order */
+  gboolean sorted;  /* FALSE if the hooks must be sorted for every event */
+};
+
+static void
+hook_table_free (HookTable * self)
+{
+  g_clear_pointer (&self->hooks, g_ptr_array_unref);
+  g_free (self);
+}
+
 struct _WpEventDispatcher
 {
   GObject parent;
 
   GWeakRef core;
   GPtrArray *hooks; /* registered hooks */
+  GHashTable *hook_tables; /* event.type -> HookTable */
+  GHashTable *hook_stats; /* WpEventHook* -> WpEventHookStats */
   GSource *source;  /* the event loop source */
-  GList *events;    /* the events stack */
+  GPtrArray *events; /* the events stack, as a binary heap */
   struct spa_system *system;
   int eventfd;
 };
 
+enum {
+  SIGNAL_EVENT_DISPATCHED,
+  N_SIGNALS
+};
+
+static guint signals[N_SIGNALS] = { 0 };
+
 G_DEFINE_TYPE (WpEventDispatcher, wp_event_dispatcher, G_TYPE_OBJECT)
 
+static inline gboolean
+event_data_precedes (const EventData *a, const EventData *b)
+{
+  gint pa = wp_event_get_priority (a->event);
+  gint pb = wp_event_get_priority (b->event);
+  return (pa != pb) ? (pa > pb) : (a->seq < b->seq);
+}
+
+/* The events stack is a binary heap, ordered by priority (highest first)
+   and then by insertion order (first in, first out) */
+
+static inline EventData *
+events_heap_peek (GPtrArray * heap)
+{
+  return heap->len > 0 ? g_ptr_array_index (heap, 0) : NULL;
+}
+
+static void
+events_heap_push (GPtrArray * heap, EventData * event_data)
+{
+  guint i = heap->len;
+
+  g_ptr_array_add (heap, event_data);
+
+  /* sift up */
+  while (i > 0) {
+    guint parent = (i - 1) / 2;
+    if (!event_data_precedes (event_data, heap->pdata[parent]))
+      break;
+    heap->pdata[i] = heap->pdata[parent];
+    i = parent;
+  }
+  heap->pdata[i] = event_data;
+}
+
+static EventData *
+events_heap_pop (GPtrArray * heap)
+{
+  EventData *top, *last;
+  guint i = 0;
+
+  g_return_val_if_fail (heap->len > 0, NULL);
+
+  top = heap->pdata[0];
+  last = g_ptr_array_steal_index_fast (heap, heap->len - 1);
+  if (heap->len == 0)
+    return top;
+
+  /* sift down */
+  for (;;) {
+    guint child = 2 * i + 1;
+    if (child >= heap->len)
+      break;
+    if (child + 1 < heap->len &&
+        event_data_precedes (heap->pdata[child + 1], heap->pdata[child]))
+      child++;
+    if (!event_data_precedes (heap->pdata[child], last))
+      break;
+    heap->pdata[i] = heap->pdata[child];
+    i = child;
+  }
+  heap->pdata[i] = last;
+  return top;
+}
+
 #define WP_EVENT_SOURCE_DISPATCHER(x) \
     WP_EVENT_DISPATCHER (((WpEventSource *) x)->dispatcher)
 
@@ -72,8 +162,8 @@ static gboolean
 wp_event_source_check (GSource * s)
 {
   WpEventDispatcher *d = WP_EVENT_SOURCE_DISPATCHER (s);
-  return d && d->events &&
-      !((EventData *) g_list_first (d->events)->data)->current_hook_in_async;
+  EventData *event_data = d ? events_heap_peek (d->events) : NULL;
+  return event_data && !event_data->current_hook_in_async;
 }
 
 static void
@@ -89,6 +179,15 @@ on_event_hook_done (WpEventHook * hook, GAsyncResult * res, EventData * data)
       error->domain != G_IO_ERROR && error->code != G_IO_ERROR_CANCELLED)
     wp_notice_object (hook, "failed: %s", error->message);
 
+  /* account the time until completion, including any async steps */
+  WpEventHookStats *stats = g_hash_table_lookup (dispatcher->hook_stats, hook);
+  if (stats) {
+    gint64 elapsed = g_get_monotonic_time () - data->current_hook_start_time;
+    stats->n_runs++;
+    stats->total_time += elapsed;
+    stats->max_time = MAX (stats->max_time, elapsed);
+  }
+
   g_clear_object (&data->current_hook_in_async);
   spa_system_eventfd_write (dispatcher->system, dispatcher->eventfd, 1);
 }
@@ -103,9 +202,8 @@ wp_event_source_dispatch (GSource * s, GSourceFunc callback, gpointer user_data)
   spa_system_eventfd_read (d->system, d->eventfd, &count);
 
   /* get the highest priority event */
-  GList *levent = g_list_first (d->events);
-  while (levent) {
-    EventData *event_data = (EventData *) (levent->data);
+  EventData *event_data = events_heap_peek (d->events);
+  while (event_data) {
     WpEvent *event = event_data->event;
     GCancellable *cancellable = wp_event_get_cancellable (event);
     g_auto (GValue) value = G_VALUE_INIT;
@@ -115,6 +213,15 @@ wp_event_source_dispatch (GSource * s, GSourceFunc callback, gpointer user_data)
     if (event_data->current_hook_in_async)
       return G_SOURCE_CONTINUE;
 
+    /* announce that the event is no longer waiting; the handlers may push
+       new events, so look for the highest priority event again */
+    if (!event_data->dispatched) {
+      event_data->dispatched = TRUE;
+      g_signal_emit (d, signals[SIGNAL_EVENT_DISPATCHED], 0, event);
+      event_data = events_heap_peek (d->events);
+      continue;
+    }
+
     /* check if the event was cancelled */
     if (g_cancellable_is_cancelled (cancellable)) {
       wp_debug_object (d, "event(%p) cancelled remove it", event);
@@ -129,6 +236,7 @@ wp_event_source_dispatch (GSource * s, GSourceFunc callback, gpointer user_data)
       const gchar *name = wp_event_hook_get_name (hook);
 
       event_data->current_hook_in_async = g_object_ref (hook);
+      event_data->current_hook_start_time = g_get_monotonic_time ();
 
       wp_trace_object(d, "dispatching event (%s) running hook <%p>(%s)",
           wp_event_get_name(event), hook, name);
@@ -138,12 +246,12 @@ wp_event_source_dispatch (GSource * s, GSourceFunc callback, gpointer user_data)
           (GAsyncReadyCallback) on_event_hook_done, event_data);
     } else {
       /* clear the event after all hooks are done */
-      d->events = g_list_delete_link (d->events, g_steal_pointer (&levent));
+      events_heap_pop (d->events);
       g_clear_pointer (&event_data, event_data_free);
     }
 
     /* get the next event */
-    levent = g_list_first (d->events);
+    event_data = events_heap_peek (d->events);
   }
 
   return G_SOURCE_CONTINUE;
@@ -161,6 +269,10 @@ wp_event_dispatcher_init (WpEventDispatcher * self)
 {
   g_weak_ref_init (&self->core, NULL);
   self->hooks = g_ptr_array_new_with_free_func (g_object_unref);
+  self->events = g_ptr_array_new ();
+  self->hook_tables = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) hook_table_free);
+  self->hook_stats = g_hash_table_new_full (NULL, NULL, NULL, g_free);
 
   self->source = g_source_new (&source_funcs, sizeof (WpEventSource));
   ((WpEventSource *) self->source)->dispatcher = self;
@@ -175,8 +287,8 @@ wp_event_dispatcher_finalize (GObject * object)
 {
   WpEventDispatcher *self = WP_EVENT_DISPATCHER (object);
 
-  g_list_free_full (g_steal_pointer (&self->events),
-      (GDestroyNotify) event_data_free);
+  g_ptr_array_set_free_func (self->events, (GDestroyNotify) event_data_free);
+  g_clear_pointer (&self->events, g_ptr_array_unref);
 
   ((WpEventSource *) self->source)->dispatcher = NULL;
   g_source_destroy (self->source);
@@ -184,6 +296,8 @@ wp_event_dispatcher_finalize (GObject * object)
 
   close (self->eventfd);
 
+  g_clear_pointer (&self->hook_tables, g_hash_table_unref);
+  g_clear_pointer (&self->hook_stats, g_hash_table_unref);
   g_clear_pointer (&self->hooks, g_ptr_array_unref);
   g_weak_ref_clear (&self->core);
 
@@ -196,6 +310,11 @@ wp_event_dispatcher_class_init (WpEventDispatcherClass * klass)
   GObjectClass *object_class = (GObjectClass *) klass;
 
   object_class->finalize = wp_event_dispatcher_finalize;
+
+  signals[SIGNAL_EVENT_DISPATCHED] = g_signal_new (
+      "event-dispatched", G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_FIRST,
+      0, NULL, NULL, NULL, G_TYPE_NONE, 1,
+      WP_TYPE_EVENT | G_SIGNAL_TYPE_STATIC_SCOPE);
 }
 
 /*!
@@ -238,13 +357,6 @@ wp_event_dispatcher_get_instance (WpCore * core)
   return dispatcher;
 }
 
-static gint
-event_cmp_func (const EventData *a, const EventData *b)
-{
-  gint c = wp_event_get_priority (b->event) - wp_event_get_priority (a->event);
-  return (c != 0) ? c : (gint)(a->seq - b->seq);
-}
-
 /*!
  * \brief Pushes a new event onto the event stack for dispatching only if there
  * are any hooks are available for it.
@@ -262,8 +374,7 @@ wp_event_dispatcher_push_event (WpEventDispatcher * self, WpEvent * event)
   if (wp_event_collect_hooks (event, self)) {
     EventData *event_data = event_data_new (event);
 
-    self->events = g_list_insert_sorted (self->events, event_data,
-        (GCompareFunc) event_cmp_func);
+    events_heap_push (self->events, event_data);
     wp_debug_object (self, "pushed event (%s)", wp_event_get_name (event));
 
     /* wakeup the GSource */
@@ -293,6 +404,8 @@ wp_event_dispatcher_register_hook (WpEventDispatcher * self,
 
   wp_event_hook_set_dispatcher (hook, self);
   g_ptr_array_add (self->hooks, g_object_ref (hook));
+  g_hash_table_insert (self->hook_stats, hook, g_new0 (WpEventHookStats, 1));
+  wp_event_dispatcher_invalidate_hooks_cache (self);
 }
 
 /*!
@@ -314,7 +427,62 @@ wp_event_dispatcher_unregister_hook (WpEventDispatcher * self,
   g_return_if_fail (already_registered_dispatcher == self);
 
   wp_event_hook_set_dispatcher (hook, NULL);
+  g_hash_table_remove (self->hook_stats, hook);
   g_ptr_array_remove_fast (self->hooks, hook);
+  wp_event_dispatcher_invalidate_hooks_cache (self);
+}
+
+/*!
+ * \brief Gets the execution statistics of a registered hook
+ *
+ * The dispatcher counts how many times each hook has run and how long it
+ * took, from the moment it was started until it reported completion. For
+ * async hooks, this includes the time spent waiting for their steps to
+ * complete. It also counts how many times wp_event_hook_runs_for_event()
+ * returned FALSE while collecting hooks for events of a type that the hook
+ * is interested in.
+ *
+ * \ingroup wpeventdispatcher
+ * \param self the event dispatcher
+ * \param hook (transfer none): a hook that is registered on \a self
+ * \param stats (out caller-allocates): the location to store the statistics
+ * \return TRUE if \a stats was filled in, FALSE if \a hook is not registered
+ */
+gboolean
+wp_event_dispatcher_get_hook_stats (WpEventDispatcher * self,
+    WpEventHook * hook, WpEventHookStats * stats)
+{
+  WpEventHookStats *hs;
+
+  g_return_val_if_fail (WP_IS_EVENT_DISPATCHER (self), FALSE);
+  g_return_val_if_fail (WP_IS_EVENT_HOOK (hook), FALSE);
+  g_return_val_if_fail (stats != NULL, FALSE);
+
+  hs = g_hash_table_lookup (self->hook_stats, hook);
+  if (!hs)
+    return FALSE;
+
+  *stats = *hs;
+  return TRUE;
+}
+
+/*!
+ * \brief Resets the execution statistics of all the registered hooks
+ * \ingroup wpeventdispatcher
+ *
+ * \param self the event dispatcher
+ */
+void
+wp_event_dispatcher_reset_hook_stats (WpEventDispatcher * self)
+{
+  GHashTableIter iter;
+  WpEventHookStats *hs;
+
+  g_return_if_fail (WP_IS_EVENT_DISPATCHER (self));
+
+  g_hash_table_iter_init (&iter, self->hook_stats);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &hs))
+    *hs = (WpEventHookStats) { 0 };
 }
 
 /*!
@@ -331,3 +499,267 @@ wp_event_dispatcher_new_hooks_iterator (WpEventDispatcher * self)
       g_ptr_array_copy (self->hooks, (GCopyFunc) g_object_ref, NULL);
   return wp_iterator_new_ptr_array (items, WP_TYPE_EVENT_HOOK);
 }
+
+static gboolean
+dependency_satisfied (GPtrArray * hooks, const gboolean * sorted, guint idx,
+    const gchar * dep)
+{
+  gboolean pending = FALSE;
+
+  for (guint i = 0; i < hooks->len; i++) {
+    WpEventHook *hook = g_ptr_array_index (hooks, i);
+
+    if (i == idx || !g_pattern_match_simple (dep, wp_event_hook_get_name (hook)))
+      continue;
+
+    /* if the dependency is already sorted, we consider it satisfied */
+    if (sorted[i])
+      return TRUE;
+    pending = TRUE;
+  }
+
+  /* if the dependency doesn't exist at all, we consider it satisfied */
+  return !pending;
+}
+
+/* sorts the hooks in place, so that their before/after dependencies are
+   respected; returns FALSE if the dependencies are circular */
+static gboolean
+sort_hooks (GPtrArray * hooks)
+{
+  const guint n_hooks = hooks->len;
+  g_autofree gboolean *sorted = g_new0 (gboolean, n_hooks);
+  g_autofree GPtrArray **deps = g_new0 (GPtrArray *, n_hooks);
+  g_autofree gpointer *result = g_new0 (gpointer, n_hooks);
+  g_autoptr (GArray) pending =
+      g_array_sized_new (FALSE, FALSE, sizeof (guint), n_hooks);
+  g_autoptr (GArray) remaining =
+      g_array_sized_new (FALSE, FALSE, sizeof (guint), n_hooks);
+  guint n_result = 0;
+  gboolean ret = TRUE;
+
+  /* record "after" dependencies directly */
+  for (guint i = 0; i < n_hooks; i++) {
+    WpEventHook *hook = g_ptr_array_index (hooks, i);
+    const gchar * const * strv = wp_event_hook_get_runs_after_hooks (hook);
+
+    deps[i] = g_ptr_array_new ();
+    while (strv && *strv)
+      g_ptr_array_add (deps[i], (gchar *) *strv++);
+    g_array_append_val (pending, i);
+  }
+
+  /* convert "before" dependencies into "after" dependencies */
+  for (guint i = 0; i < n_hooks; i++) {
+    WpEventHook *hook = g_ptr_array_index (hooks, i);
+    const gchar * const * strv = wp_event_hook_get_runs_before_hooks (hook);
+
+    /* like "after" dependencies, a glob may match several hooks, but here
+       only the first one that matches gets the dependency */
+    for (; strv && *strv; strv++) {
+      for (guint j = 0; j < n_hooks; j++) {
+        WpEventHook *target = g_ptr_array_index (hooks, j);
+        if (g_pattern_match_simple (*strv, wp_event_hook_get_name (target))) {
+          g_ptr_array_add (deps[j], (gchar *) wp_event_hook_get_name (hook));
+          break;
+        }
+      }
+    }
+  }
+
+  while (pending->len > 0) {
+    gboolean made_progress = FALSE;
+
+    /* examine each hook to see if its dependencies are satisfied in the
+       result list; if yes, then append it to the result too */
+    for (guint k = 0; k < pending->len; k++) {
+      guint i = g_array_index (pending, guint, k);
+      guint deps_satisfied = 0;
+
+      for (guint d = 0; d < deps[i]->len; d++) {
+        const gchar *dep = g_ptr_array_index (deps[i], d);
+        if (dependency_satisfied (hooks, sorted, i, dep))
+          deps_satisfied++;
+      }
+
+      if (deps_satisfied == deps[i]->len) {
+        sorted[i] = TRUE;
+        result[n_result++] = g_ptr_array_index (hooks, i);
+        made_progress = TRUE;
+      } else {
+        g_array_append_val (remaining, i);
+      }
+    }
+
+    /* if we did not make any progress towards growing the result list,
+       it means the dependencies cannot be satisfied because of circles */
+    if (!made_progress) {
+      ret = FALSE;
+      break;
+    }
+
+    /* run again with the remaining hooks */
+    g_array_set_size (pending, 0);
+    g_array_append_vals (pending, remaining->data, remaining->len);
+    g_array_set_size (remaining, 0);
+  }
+
+  if (ret)
+    memcpy (hooks->pdata, result, n_hooks * sizeof (gpointer));
+
+  for (guint i = 0; i < n_hooks; i++)
+    g_ptr_array_unref (deps[i]);
+
+  return ret;
+}
+
+/* checks if any of the globs in \a strv matches more than one of the
+   \a hooks, optionally ignoring the hook at index \a skip */
+static gboolean
+has_multi_match_glob (GPtrArray * hooks, const gchar * const * strv,
+    guint skip)
+{
+  for (; strv && *strv; strv++) {
+    guint n_matches = 0;
+
+    for (guint j = 0; j < hooks->len && n_matches < 2; j++) {
+      WpEventHook *target = g_ptr_array_index (hooks, j);
+      if (j != skip &&
+          g_pattern_match_simple (*strv, wp_event_hook_get_name (target)))
+        n_matches++;
+    }
+    if (n_matches > 1)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* checks if any dependency matches more than one of the hooks; then the
+   order depends on which of the matching hooks run for an event: a "before"
+   dependency applies only to the first one that matches and an "after"
+   dependency is satisfied by any one that is sorted, so the candidates
+   cannot be sorted in advance */
+static gboolean
+has_ambiguous_deps (GPtrArray * hooks)
+{
+  for (guint i = 0; i < hooks->len; i++) {
+    WpEventHook *hook = g_ptr_array_index (hooks, i);
+
+    if (has_multi_match_glob (hooks,
+            wp_event_hook_get_runs_before_hooks (hook), G_MAXUINT) ||
+        has_multi_match_glob (hooks,
+            wp_event_hook_get_runs_after_hooks (hook), i))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static HookTable *
+get_hook_table (WpEventDispatcher * self, const gchar * event_type)
+{
+  HookTable *table = g_hash_table_lookup (self->hook_tables, event_type);
+
+  if (G_LIKELY (table))
+    return table;
+
+  table = g_new0 (HookTable, 1);
+  table->hooks = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (guint i = 0; i < self->hooks->len; i++) {
+    WpEventHook *hook = g_ptr_array_index (self->hooks, i);
+    g_autoptr (GPtrArray) types = wp_event_hook_get_matching_event_types (hook);
+
+    if (!types || g_ptr_array_find_with_equal_func (types, event_type,
+            g_str_equal, NULL))
+      g_ptr_array_add (table->hooks, g_object_ref (hook));
+  }
+
+  /* if the candidate hooks have circular or ambiguous dependencies, they
+     are kept in the order of registration and the hooks that actually run
+     are sorted again for every event */
+  if (has_ambiguous_deps (table->hooks)) {
+    wp_debug_object (self, "candidate hooks for event type '%s' have "
+        "ambiguous dependencies", event_type);
+  } else if (!(table->sorted = sort_hooks (table->hooks))) {
+    wp_info_object (self, "candidate hooks for event type '%s' have circular "
+        "dependencies", event_type);
+  }
+
+  wp_debug_object (self, "cached %u candidate hooks for event type '%s'",
+      table->hooks->len, event_type);
+
+  g_hash_table_insert (self->hook_tables, g_strdup (event_type), table);
+  return table;
+}
+
+/*!
+ * \brief Collects the registered hooks that run for the given \a event
+ *
+ * The candidate hooks for each event type are selected and sorted according
+ * to their dependencies only once and cached, so that this function only
+ * needs to filter the (already sorted) candidates of the event's type.
+ * Candidates whose dependencies match more than one hook are sorted for
+ * every event instead, because the order that such a dependency imposes
+ * depends on which of the matching hooks run for the event.
+ *
+ * \private
+ * \ingroup wpeventdispatcher
+ * \param self the event dispatcher
+ * \param event the event
+ * \return (transfer full)(nullable): the hooks that run for \a event, in the
+ *   order in which they must run, or NULL if their dependencies are circular
+ */
+GPtrArray *
+wp_event_dispatcher_collect_hooks_for_event (WpEventDispatcher * self,
+    WpEvent * event)
+{
+  const gchar *event_type = wp_event_get_property (event, "event.type");
+  g_autoptr (GPtrArray) candidates = NULL;
+  g_autoptr (GPtrArray) hooks = NULL;
+  HookTable *table;
+
+  g_return_val_if_fail (WP_IS_EVENT_DISPATCHER (self), NULL);
+
+  table = get_hook_table (self, event_type ? event_type : "");
+
+  /* keep the candidates alive in case a hook gets (un)registered
+     while we are iterating */
+  candidates = g_ptr_array_ref (table->hooks);
+  hooks = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (guint i = 0; i < candidates->len; i++) {
+    WpEventHook *hook = g_ptr_array_index (candidates, i);
+    if (wp_event_hook_runs_for_event (hook, event)) {
+      g_ptr_array_add (hooks, g_object_ref (hook));
+    } else {
+      WpEventHookStats *stats = g_hash_table_lookup (self->hook_stats, hook);
+      if (stats)
+        stats->n_skipped++;
+    }
+  }
+
+  if (!table->sorted && !sort_hooks (hooks)) {
+    wp_critical_object (self, "detected circular dependencies in the hooks "
+        "collected for event (%s)!", wp_event_get_name (event));
+    return NULL;
+  }
+
+  return g_steal_pointer (&hooks);
+}
+
+/*!
+ * \brief Drops the cached per-event-type hook lists
+ *
+ * This is called internally when hooks are registered or unregistered and
+ * when the interests of a registered hook change.
+ *
+ * \private
+ * \ingroup wpeventdispatcher
+ * \param self the event dispatcher
+ */
+void
+wp_event_dispatcher_invalidate_hooks_cache (WpEventDispatcher * self)
+{
+  g_return_if_fail (WP_IS_EVENT_DISPATCHER (self));
+  g_hash_table_remove_all (self->hook_tables);
+}
@@ -20,7 +20,46 @@ G_BEGIN_DECLS
  * \struct WpEventDispatcher
  *
  * The event dispatcher holds all the events and hooks and dispatches them. It orchestras the show on event stack.
+ *
+ * \gsignals
+ *
+ * \par event-dispatched
+ * \parblock
+ * \code
+ * void
+ * event_dispatched_callback (WpEventDispatcher * self,
+ *                            WpEvent * event,
+ *                            gpointer user_data)
+ * \endcode
+ *
+ * Emitted when the dispatcher starts dispatching an event, before any of its
+ * hooks runs. From this point on, the event is no longer waiting in the
+ * queue, so the information that it carries must not be updated anymore.
+ *
+ * Parameters:
+ * - `event` - the event that is being dispatched
+ *
+ * Flags: G_SIGNAL_RUN_FIRST
+ * \endparblock
+ */
+/*!
+ * \brief Execution statistics of an event hook, as recorded by the
+ *   event dispatcher
+ * \ingroup wpeventdispatcher
  */
+typedef struct _WpEventHookStats WpEventHookStats;
+struct _WpEventHookStats
+{
+  /*! the number of times the hook has run */
+  guint64 n_runs;
+  /*! the number of times wp_event_hook_runs_for_event() returned FALSE */
+  guint64 n_skipped;
+  /*! the total time spent running the hook, in microseconds */
+  gint64 total_time;
+  /*! the longest time that a single run of the hook took, in microseconds */
+  gint64 max_time;
+};
+
 #define WP_TYPE_EVENT_DISPATCHER (wp_event_dispatcher_get_type ())
 WP_API
 G_DECLARE_FINAL_TYPE (WpEventDispatcher, wp_event_dispatcher,
@@ -40,9 +79,23 @@ WP_API
 void wp_event_dispatcher_unregister_hook (WpEventDispatcher * self,
     WpEventHook * hook);
 
+WP_API
+gboolean wp_event_dispatcher_get_hook_stats (WpEventDispatcher * self,
+    WpEventHook * hook, WpEventHookStats * stats);
+
+WP_API
+void wp_event_dispatcher_reset_hook_stats (WpEventDispatcher * self);
+
 WP_API
 WpIterator * wp_event_dispatcher_new_hooks_iterator (WpEventDispatcher * self);
 
+WP_PRIVATE_API
+GPtrArray * wp_event_dispatcher_collect_hooks_for_event (
+    WpEventDispatcher * self, WpEvent * event);
+
+WP_PRIVATE_API
+void wp_event_dispatcher_invalidate_hooks_cache (WpEventDispatcher * self);
+
 G_END_DECLS
 
 #endif
@@ -232,6 +232,28 @@ wp_event_hook_runs_for_event (WpEventHook * self, WpEvent * event)
   return WP_EVENT_HOOK_GET_CLASS (self)->runs_for_event (self, event);
 }
 
+/*!
+ * \brief Returns the types of the events that this hook can possibly run for
+ *
+ * This is used by the event dispatcher to pre-select the hooks that are
+ * candidates for running on each event type. The result does not need to be
+ * exact, but it must not leave out any event type for which
+ * wp_event_hook_runs_for_event() may return TRUE.
+ *
+ * \ingroup wpeventhook
+ * \param self the event hook
+ * \return (transfer full)(nullable)(element-type utf8): the event types, or
+ *    NULL if the hook may run for events of any type
+ */
+GPtrArray *
+wp_event_hook_get_matching_event_types (WpEventHook * self)
+{
+  g_return_val_if_fail (WP_IS_EVENT_HOOK (self), NULL);
+  if (WP_EVENT_HOOK_GET_CLASS (self)->get_matching_event_types)
+    return WP_EVENT_HOOK_GET_CLASS (self)->get_matching_event_types (self);
+  return NULL;
+}
+
 /*!
  * \brief Runs the hook on the given event
  *
@@ -319,7 +341,6 @@ wp_interest_event_hook_runs_for_event (WpEventHook * hook, WpEvent * event)
   WpInterestEventHook *self = WP_INTEREST_EVENT_HOOK (hook);
   WpInterestEventHookPrivate *priv =
       wp_interest_event_hook_get_instance_private (self);
-  g_autoptr (WpProperties) properties = wp_event_get_properties (event);
   g_autoptr (GObject) subject = wp_event_get_subject (event);
   GType gtype = subject ? G_OBJECT_TYPE (subject) : WP_TYPE_EVENT;
   guint i;
@@ -332,9 +353,8 @@ wp_interest_event_hook_runs_for_event (WpEventHook * hook, WpEvent * event)
 
   for (i = 0; i < priv->interests->len; i++) {
     interest = g_ptr_array_index (priv->interests, i);
-    match = wp_object_interest_matches_full (interest,
-        WP_INTEREST_MATCH_FLAGS_CHECK_ALL,
-        gtype, subject, properties, properties);
+    match = wp_object_interest_matches_event (interest,
+        WP_INTEREST_MATCH_FLAGS_CHECK_ALL, gtype, subject, event);
 
     /* the interest may have a GType that matches the GType of the subject
        or it may have WP_TYPE_EVENT as its GType, in which case it will
@@ -351,6 +371,33 @@ wp_interest_event_hook_runs_for_event (WpEventHook * hook, WpEvent * event)
   return FALSE;
 }
 
+static GPtrArray *
+wp_interest_event_hook_get_matching_event_types (WpEventHook * hook)
+{
+  WpInterestEventHook *self = WP_INTEREST_EVENT_HOOK (hook);
+  WpInterestEventHookPrivate *priv =
+      wp_interest_event_hook_get_instance_private (self);
+  g_autoptr (GPtrArray) types = NULL;
+
+  if (priv->interests->len == 0)
+    return NULL;
+
+  types = g_ptr_array_new_with_free_func (g_free);
+
+  for (guint i = 0; i < priv->interests->len; i++) {
+    WpObjectInterest *interest = g_ptr_array_index (priv->interests, i);
+    g_autoptr (GPtrArray) values =
+        wp_object_interest_find_allowed_values (interest, "event.type");
+
+    /* this interest does not restrict the event type */
+    if (!values)
+      return NULL;
+
+    g_ptr_array_extend_and_steal (types, g_steal_pointer (&values));
+  }
+  return g_steal_pointer (&types);
+}
+
 static void
 wp_interest_event_hook_class_init (WpInterestEventHookClass * klass)
 {
@@ -359,6 +406,8 @@ wp_interest_event_hook_class_init (WpInterestEventHookClass * klass)
 
   object_class->finalize = wp_interest_event_hook_finalize;
   hook_class->runs_for_event = wp_interest_event_hook_runs_for_event;
+  hook_class->get_matching_event_types =
+      wp_interest_event_hook_get_matching_event_types;
 }
 
 /*!
@@ -415,6 +464,12 @@ wp_interest_event_hook_add_interest_full (WpInterestEventHook * self,
   WpInterestEventHookPrivate *priv =
       wp_interest_event_hook_get_instance_private (self);
   g_ptr_array_add (priv->interests, interest);
+
+  /* the set of event types that this hook runs for may have changed */
+  g_autoptr (WpEventDispatcher) dispatcher =
+      wp_event_hook_get_dispatcher (WP_EVENT_HOOK (self));
+  if (dispatcher)
+    wp_event_dispatcher_invalidate_hooks_cache (dispatcher);
 }
 
 
@@ -22,7 +22,6 @@ struct _HookData
 {
   struct spa_list link;
   WpEventHook *hook;
-  GPtrArray *dependencies;
 };
 
 static inline HookData *
@@ -31,7 +30,6 @@ hook_data_new (WpEventHook * hook)
   HookData *hook_data = g_new0 (HookData, 1);
   spa_list_init (&hook_data->link);
   hook_data->hook = g_object_ref (hook);
-  hook_data->dependencies = g_ptr_array_new ();
   return hook_data;
 }
 
@@ -39,7 +37,6 @@ static void
 hook_data_free (HookData *self)
 {
   g_clear_object (&self->hook);
-  g_clear_pointer (&self->dependencies, g_ptr_array_unref);
   g_free (self);
 }
 
@@ -51,11 +48,16 @@ struct _WpEvent
 
   /* immutable fields */
   gint priority;
-  WpProperties *properties;
+  WpProperties *properties; /* the event's own properties */
+  WpProperties *subject_properties;
+  WpProperties *subject_global_properties;
   GObject *source;
   GObject *subject;
   GCancellable *cancellable;
   gchar *name;
+
+  /* all the properties merged together; created on demand */
+  WpProperties *merged_properties;
 };
 
 G_DEFINE_BOXED_TYPE (WpEvent, wp_event, wp_event_ref, wp_event_unref)
@@ -63,11 +65,10 @@ G_DEFINE_BOXED_TYPE (WpEvent, wp_event, wp_event_ref, wp_event_unref)
 static gchar *
 form_event_name (WpEvent *e)
 {
-  WpProperties *props = e->properties;
-  const gchar *type = wp_properties_get (props, "event.type");
-  const gchar *subject_type = wp_properties_get (props, "event.subject.type");
-  const gchar *metadata_name = wp_properties_get (props, "metadata.name");
-  const gchar *param = wp_properties_get (props, "event.subject.param-id");
+  const gchar *type = wp_event_get_property (e, "event.type");
+  const gchar *subject_type = wp_event_get_property (e, "event.subject.type");
+  const gchar *metadata_name = wp_event_get_property (e, "metadata.name");
+  const gchar *param = wp_event_get_property (e, "event.subject.param-id");
 
   return g_strdup_printf ("<%p>%s%s%s%s%s%s%s", e, (type ? type : ""),
     ((type && subject_type) ? "@" : ""),
@@ -108,28 +109,19 @@ wp_event_new (const gchar * type, gint priority, WpProperties * properties,
   self->cancellable = g_cancellable_new ();
 
   if (self->subject) {
-    /* merge properties from subject */
-    /* PW properties */
+    /* keep references to the properties of the subject; these are merged
+       with the event's own properties only if someone asks for all of them */
     GParamSpec *pspec = g_object_class_find_property (
         G_OBJECT_GET_CLASS (self->subject), "properties");
-    if (pspec && G_PARAM_SPEC_VALUE_TYPE (pspec) == WP_TYPE_PROPERTIES) {
-      g_autoptr (WpProperties) subj_props = NULL;
-      g_object_get (self->subject, "properties", &subj_props, NULL);
-      if (subj_props) {
-        wp_properties_update (self->properties, subj_props);
-      }
-    }
+    if (pspec && G_PARAM_SPEC_VALUE_TYPE (pspec) == WP_TYPE_PROPERTIES)
+      g_object_get (self->subject, "properties", &self->subject_properties,
+          NULL);
 
-    /* global properties */
-    pspec = g_object_class_find_property ( G_OBJECT_GET_CLASS (self->subject),
+    pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (self->subject),
         "global-properties");
-    if (pspec && G_PARAM_SPEC_VALUE_TYPE (pspec) == WP_TYPE_PROPERTIES) {
-      g_autoptr (WpProperties) subj_props = NULL;
-      g_object_get (self->subject, "global-properties", &subj_props, NULL);
-      if (subj_props) {
-        wp_properties_update (self->properties, subj_props);
-      }
-    }
+    if (pspec && G_PARAM_SPEC_VALUE_TYPE (pspec) == WP_TYPE_PROPERTIES)
+      g_object_get (self->subject, "global-properties",
+          &self->subject_global_properties, NULL);
   }
 
   wp_properties_set (self->properties, "event.type", type);
@@ -162,6 +154,9 @@ wp_event_free (WpEvent * self)
   }
   g_datalist_clear (&self->datalist);
   g_clear_pointer (&self->properties, wp_properties_unref);
+  g_clear_pointer (&self->subject_properties, wp_properties_unref);
+  g_clear_pointer (&self->subject_global_properties, wp_properties_unref);
+  g_clear_pointer (&self->merged_properties, wp_properties_unref);
   g_clear_object (&self->source);
   g_clear_object (&self->subject);
   g_cancellable_cancel (self->cancellable);
@@ -199,6 +194,12 @@ wp_event_get_priority (WpEvent * self)
 
 /*!
  * \brief Gets the properties of the Event
+ *
+ * These are the properties that were given to wp_event_new(), merged with
+ * the "properties" and "global-properties" of the subject, if any. The merged
+ * set is constructed the first time that this function is called; if you only
+ * need to look up a few keys, wp_event_get_property() is cheaper.
+ *
  * \ingroup wpevent
  * \param self the handle
  * \return (transfer full): the properties of the event
@@ -207,7 +208,59 @@ WpProperties *
 wp_event_get_properties (WpEvent * self)
 {
   g_return_val_if_fail(self != NULL, NULL);
-  return wp_properties_ref (self->properties);
+
+  if (!self->merged_properties) {
+    if (!self->subject_properties && !self->subject_global_properties) {
+      self->merged_properties = wp_properties_ref (self->properties);
+    } else {
+      WpProperties *merged = wp_properties_copy (self->properties);
+      if (self->subject_properties)
+        wp_properties_update (merged, self->subject_properties);
+      if (self->subject_global_properties)
+        wp_properties_update (merged, self->subject_global_properties);
+      wp_properties_set (merged, "event.type",
+          wp_properties_get (self->properties, "event.type"));
+      self->merged_properties = merged;
+    }
+  }
+  return wp_properties_ref (self->merged_properties);
+}
+
+/*!
+ * \brief Looks up a single property of the Event
+ *
+ * This is equivalent to calling wp_properties_get() on the properties
+ * returned by wp_event_get_properties(), but it does not need to merge
+ * the event's properties with the properties of its subject.
+ *
+ * \ingroup wpevent
+ * \param self the handle
+ * \param key the property key
+ * \return (transfer none)(nullable): the value of the property, or NULL if
+ *   the event does not have such a property
+ */
+const gchar *
+wp_event_get_property (WpEvent * self, const gchar * key)
+{
+  const gchar *value = NULL;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (key != NULL, NULL);
+
+  if (self->merged_properties)
+    return wp_properties_get (self->merged_properties, key);
+
+  /* same precedence as in the merged set: the event type comes first,
+     then the subject's global properties, then its properties */
+  if (!g_str_equal (key, "event.type")) {
+    if (self->subject_global_properties &&
+        (value = wp_properties_get (self->subject_global_properties, key)))
+      return value;
+    if (self->subject_properties &&
+        (value = wp_properties_get (self->subject_properties, key)))
+      return value;
+  }
+  return wp_properties_get (self->properties, key);
 }
 
 /*!
@@ -316,33 +369,6 @@ wp_event_get_data (WpEvent * self, const gchar * key)
   return g_datalist_get_data (&self->datalist, key);
 }
 
-static inline void
-record_dependency (struct spa_list *list, const gchar *target,
-    const gchar *dependency)
-{
-  HookData *hook_data;
-  spa_list_for_each (hook_data, list, link) {
-    if (g_pattern_match_simple (target, wp_event_hook_get_name (hook_data->hook))) {
-      g_ptr_array_insert (hook_data->dependencies, -1, (gchar *) dependency);
-      break;
-    }
-  }
-}
-
-static inline gboolean
-hook_exists_in (const gchar *hook_name, struct spa_list *list)
-{
-  HookData *hook_data;
-  if (!spa_list_is_empty (list)) {
-    spa_list_for_each (hook_data, list, link) {
-      if (g_pattern_match_simple (hook_name, wp_event_hook_get_name (hook_data->hook))) {
-        return TRUE;
-      }
-    }
-  }
-  return FALSE;
-}
-
 /*!
  * \brief Collects all the hooks registered in the \a dispatcher that run for
  *    this \a event
@@ -355,9 +381,7 @@ hook_exists_in (const gchar *hook_name, struct spa_list *list)
 gboolean
 wp_event_collect_hooks (WpEvent * event, WpEventDispatcher * dispatcher)
 {
-  struct spa_list collected, result, remaining;
-  g_autoptr (WpIterator) all_hooks = NULL;
-  g_auto (GValue) value = G_VALUE_INIT;
+  g_autoptr (GPtrArray) hooks = NULL;
 
   g_return_val_if_fail (event != NULL, FALSE);
   g_return_val_if_fail (WP_IS_EVENT_DISPATCHER (dispatcher), FALSE);
@@ -366,118 +390,21 @@ wp_event_collect_hooks (WpEvent * event, WpEventDispatcher * dispatcher)
   if (!spa_list_is_empty (&event->hooks))
     return TRUE;
 
-  spa_list_init (&collected);
-  spa_list_init (&result);
-  spa_list_init (&remaining);
-
-  /* collect hooks that run for this event */
-  all_hooks = wp_event_dispatcher_new_hooks_iterator (dispatcher);
-  while (wp_iterator_next (all_hooks, &value)) {
-    WpEventHook *hook = g_value_get_object (&value);
+  /* collect hooks that run for this event, already sorted */
+  hooks = wp_event_dispatcher_collect_hooks_for_event (dispatcher, event);
+  if (!hooks)
+    return FALSE;
 
-    if (wp_event_hook_runs_for_event (hook, event)) {
-      HookData *hook_data = hook_data_new (hook);
+  for (guint i = 0; i < hooks->len; i++) {
+    WpEventHook *hook = g_ptr_array_index (hooks, i);
+    HookData *hook_data = hook_data_new (hook);
 
-      /* record "after" dependencies directly */
-      const gchar * const * strv =
-          wp_event_hook_get_runs_after_hooks (hook_data->hook);
-      while (strv && *strv) {
-        g_ptr_array_insert (hook_data->dependencies, -1, (gchar *) *strv);
-        strv++;
-      }
-
-      spa_list_append (&collected, &hook_data->link);
-
-      wp_debug_boxed (WP_TYPE_EVENT, event, "added "WP_OBJECT_FORMAT"(%s)",
-          WP_OBJECT_ARGS (hook), wp_event_hook_get_name (hook));
-    }
+    spa_list_append (&event->hooks, &hook_data->link);
 
-    g_value_unset (&value);
-  }
-
-  if (!spa_list_is_empty (&collected)) {
-    HookData *hook_data;
-
-    /* convert "before" dependencies into "after" dependencies */
-    spa_list_for_each (hook_data, &collected, link) {
-      const gchar * const * strv =
-          wp_event_hook_get_runs_before_hooks (hook_data->hook);
-      while (strv && *strv) {
-        /* record hook_data->hook as a dependency of the *strv hook */
-        record_dependency (&collected, *strv,
-            wp_event_hook_get_name (hook_data->hook));
-        strv++;
-      }
-    }
-
-    /* sort */
-    while (!spa_list_is_empty (&collected)) {
-      gboolean made_progress = FALSE;
-
-      /* examine each hook to see if its dependencies are satisfied in the
-         result list; if yes, then append it to the result too */
-      spa_list_consume (hook_data, &collected, link) {
-        guint deps_satisfied = 0;
-
-        spa_list_remove (&hook_data->link);
-
-        wp_trace_boxed (WP_TYPE_EVENT, event,
-              "examining: %s", wp_event_hook_get_name (hook_data->hook));
-
-        for (guint i = 0; i < hook_data->dependencies->len; i++) {
-          const gchar *dep = g_ptr_array_index (hook_data->dependencies, i);
-          /* if the dependency is already in the sorted result list or if
-             it doesn't exist at all, we consider it satisfied */
-          if (hook_exists_in (dep, &result) ||
-              !(hook_exists_in (dep, &collected) ||
-                hook_exists_in (dep, &remaining))) {
-            deps_satisfied++;
-          }
-
-          wp_trace_boxed (WP_TYPE_EVENT, event, "depends: %s, satisfied: %u/%u",
-              dep, deps_satisfied, hook_data->dependencies->len);
-        }
-
-        if (deps_satisfied == hook_data->dependencies->len) {
-          wp_trace_boxed (WP_TYPE_EVENT, event,
-              "sorted: "WP_OBJECT_FORMAT"(%s)",
-              WP_OBJECT_ARGS (hook_data->hook),
-              wp_event_hook_get_name (hook_data->hook));
-
-          spa_list_append (&result, &hook_data->link);
-          made_progress = TRUE;
-        } else {
-          spa_list_append (&remaining, &hook_data->link);
-        }
-      }
-
-      if (made_progress) {
-        /* run again with the remaining hooks */
-        spa_list_insert_list (&collected, &remaining);
-        spa_list_init (&remaining);
-      }
-      else if (!spa_list_is_empty (&remaining)) {
-        /* if we did not make any progress towards growing the result list,
-           it means the dependencies cannot be satisfied because of circles */
-        wp_critical_boxed (WP_TYPE_EVENT, event, "detected circular "
-            "dependencies in the collected hooks!");
-
-        /* clean up */
-        spa_list_consume (hook_data, &result, link) {
-          spa_list_remove (&hook_data->link);
-          hook_data_free (hook_data);
-        }
-        spa_list_consume (hook_data, &remaining, link) {
-          spa_list_remove (&hook_data->link);
-          hook_data_free (hook_data);
-        }
-
-        return FALSE;
-      }
-    }
+    wp_debug_boxed (WP_TYPE_EVENT, event, "added "WP_OBJECT_FORMAT"(%s)",
+        WP_OBJECT_ARGS (hook), wp_event_hook_get_name (hook));
   }
 
-  spa_list_insert_list (&event->hooks, &result);
   return !spa_list_is_empty (&event->hooks);
 }
 
@@ -46,6 +46,9 @@ gint wp_event_get_priority (WpEvent * self);
 WP_API
 WpProperties * wp_event_get_properties (WpEvent * self);
 
+WP_API
+const gchar * wp_event_get_property (WpEvent * self, const gchar * key);
+
 WP_API
 GObject * wp_event_get_source (WpEvent * self);
 
@@ -406,3 +406,107 @@ wp_global_proxy_bind (WpGlobalProxy * self)
   wp_proxy_set_pw_proxy (WP_PROXY (self), p);
   return TRUE;
 }
+
+typedef struct _ProxyTypeKey ProxyTypeKey;
+struct _ProxyTypeKey
+{
+  gchar *iface_type;
+  guint32 version;
+};
+
+static guint
+proxy_type_key_hash (gconstpointer key)
+{
+  const ProxyTypeKey *k = key;
+  return g_str_hash (k->iface_type) * 31 + k->version;
+}
+
+static gboolean
+proxy_type_key_equal (gconstpointer a, gconstpointer b)
+{
+  const ProxyTypeKey *ka = a, *kb = b;
+  return ka->version == kb->version && g_str_equal (ka->iface_type, kb->iface_type);
+}
+
+static void
+proxy_type_key_free (ProxyTypeKey * key)
+{
+  g_free (key->iface_type);
+  g_free (key);
+}
+
+G_LOCK_DEFINE_STATIC (proxy_types);
+/* element-type: <ProxyTypeKey*, GType> */
+static GHashTable *proxy_types = NULL;
+/* the number of WpGlobalProxy subclasses that proxy_types was built from */
+static guint proxy_types_n_children = 0;
+
+static void
+proxy_types_rebuild (GType * children, guint n_children)
+{
+  if (!proxy_types)
+    proxy_types = g_hash_table_new_full (proxy_type_key_hash,
+        proxy_type_key_equal, (GDestroyNotify) proxy_type_key_free, NULL);
+  else
+    g_hash_table_remove_all (proxy_types);
+
+  for (guint i = 0; i < n_children; i++) {
+    WpProxyClass *klass = (WpProxyClass *) g_type_class_ref (children[i]);
+    ProxyTypeKey lookup = { (gchar *) klass->pw_iface_type,
+        klass->pw_iface_version };
+
+    /* the first subclass that handles a given interface wins */
+    if (klass->pw_iface_type && !g_hash_table_contains (proxy_types, &lookup)) {
+      ProxyTypeKey *key = g_new (ProxyTypeKey, 1);
+      key->iface_type = g_strdup (klass->pw_iface_type);
+      key->version = klass->pw_iface_version;
+      g_hash_table_insert (proxy_types, key, GSIZE_TO_POINTER (children[i]));
+    }
+
+    g_type_class_unref (klass);
+  }
+  proxy_types_n_children = n_children;
+}
+
+/*!
+ * \brief Finds the subclass of WpGlobalProxy that can handle the given
+ *   PipeWire interface type of the given version
+ *
+ * The subclasses are indexed by interface type and version on first use.
+ * The index is rebuilt when a lookup fails and the set of subclasses has
+ * changed since it was built.
+ *
+ * \private
+ * \ingroup wpglobalproxy
+ * \param pw_iface_type the PipeWire interface type (ex. PW_TYPE_INTERFACE_Node)
+ * \param version the version of the interface
+ * \returns the subclass of WpGlobalProxy that handles this interface, or
+ *   WP_TYPE_GLOBAL_PROXY if there is no such subclass
+ */
+GType
+wp_global_proxy_find_instance_type (const gchar * pw_iface_type,
+    guint32 version)
+{
+  ProxyTypeKey lookup = { (gchar *) pw_iface_type, version };
+  gpointer type = NULL;
+
+  g_return_val_if_fail (pw_iface_type != NULL, WP_TYPE_GLOBAL_PROXY);
+
+  G_LOCK (proxy_types);
+
+  if (!proxy_types ||
+      !g_hash_table_lookup_extended (proxy_types, &lookup, NULL, &type)) {
+    guint n_children;
+    g_autofree GType *children =
+        g_type_children (WP_TYPE_GLOBAL_PROXY, &n_children);
+
+    if (!proxy_types || n_children != proxy_types_n_children) {
+      proxy_types_rebuild (children, n_children);
+      type = g_hash_table_lookup (proxy_types, &lookup);
+    }
+  }
+
+  G_UNLOCK (proxy_types);
+
+  return type ? (GType) GPOINTER_TO_SIZE (type) : WP_TYPE_GLOBAL_PROXY;
+}
@@ -44,6 +44,12 @@ WpProperties * wp_global_proxy_get_global_properties (
 WP_API
 gboolean wp_global_proxy_bind (WpGlobalProxy * self);
 
+/* private */
+
+WP_PRIVATE_API
+GType wp_global_proxy_find_instance_type (const gchar * pw_iface_type,
+    guint32 version);
+
 G_END_DECLS
 
 #endif
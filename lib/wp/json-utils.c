@@ -10,27 +10,445 @@
 #include "error.h"
 #include "log.h"
 
-#include <pipewire/pipewire.h>
+#include <regex.h>
+#include <spa/utils/json.h>
 #include <spa/utils/result.h>
 
 WP_DEFINE_LOCAL_LOG_TOPIC ("wp-json-utils")
 
 /*! \defgroup wpjsonutils Json Utilities */
 
-struct match_rules_cb_data
+/*!
+ * \struct WpRulesMatcher
+ *
+ * A set of rules, in the format accepted by wp_json_utils_match_rules(),
+ * that is parsed once so that properties can be matched against it without
+ * parsing the JSON again. Regular expressions are compiled in advance and the
+ * conditions that compare a property with a fixed value are looked up in a
+ * hash table, so that only the "matches" objects that can possibly match are
+ * evaluated.
+ */
+
+enum {
+  CONDITION_NEGATE = (1 << 0),
+  CONDITION_NULL = (1 << 1),
+  CONDITION_REGEX = (1 << 2),
+  /* a regular expression that failed to compile; it never matches */
+  CONDITION_INVALID = (1 << 3),
+};
+
+/* a property of an object in "matches" */
+struct condition
 {
-  WpRuleMatchCallback callback;
-  gpointer data;
-  GError **error;
+  gchar *key;
+  gchar *value;
+  guint flags;
+  regex_t regex;
 };
 
-static int
-match_rules_cb (void *data, const char *location, const char *action,
-    const char *str, size_t len)
+/* an object in "matches"; all its conditions must match */
+struct clause
+{
+  guint first_condition;
+  guint n_conditions;
+  /* the condition that is looked up in the index, or -1 */
+  gint anchor;
+};
+
+struct action
+{
+  gchar *name;
+  WpSpaJson *value;
+};
+
+struct rule
+{
+  guint first_clause;
+  guint n_clauses;
+  guint first_action;
+  guint n_actions;
+};
+
+struct _WpRulesMatcher
+{
+  /* a private copy of the rules, which the action values point to */
+  WpSpaJson *json;
+  GArray *conditions;
+  GArray *clauses;
+  GArray *actions;
+  GArray *rules;
+  /* key -> (value -> GArray of the indexes of the clauses anchored on it) */
+  GHashTable *index;
+};
+
+G_DEFINE_BOXED_TYPE (WpRulesMatcher, wp_rules_matcher,
+    wp_rules_matcher_ref, wp_rules_matcher_unref)
+
+static void
+condition_clear (struct condition *c)
+{
+  g_clear_pointer (&c->key, g_free);
+  g_clear_pointer (&c->value, g_free);
+  if ((c->flags & CONDITION_REGEX) &&
+      !(c->flags & (CONDITION_NULL | CONDITION_INVALID)))
+    regfree (&c->regex);
+}
+
+static void
+action_clear (struct action *a)
+{
+  g_clear_pointer (&a->name, g_free);
+  g_clear_pointer (&a->value, wp_spa_json_unref);
+}
+
+/* Modifiers are parsed the same way as pw_conf_match_rules() does: quoted
+   strings are unquoted before looking for them, so "!~foo" is a negated
+   regular expression, and null is only null if it is not quoted, unless it
+   has a modifier, so "!null" matches when the property is set */
+static void
+condition_init (struct condition *c, const gchar *key,
+    const WpSpaJsonCursor *value)
+{
+  g_autofree gchar *str = NULL;
+  gboolean quoted = wp_spa_json_cursor_is_string (value);
+  const gchar *v;
+  gsize len, skip = 0;
+
+  c->key = g_strdup (key);
+  c->flags = 0;
+
+  if (quoted) {
+    v = str = wp_spa_json_cursor_dup_string (value);
+    len = strlen (str);
+  } else {
+    v = wp_spa_json_cursor_get_data (value, &len);
+  }
+
+  if (len > 0 && v[0] == '!') {
+    c->flags |= CONDITION_NEGATE;
+    skip++;
+  }
+  if (len > skip && v[skip] == '~') {
+    c->flags |= CONDITION_REGEX;
+    skip++;
+  }
+
+  if ((!quoted || skip > 0) && spa_json_is_null (v + skip, (int) (len - skip))) {
+    c->flags |= CONDITION_NULL;
+    return;
+  }
+
+  if (quoted) {
+    c->value = g_strdup (v + skip);
+  } else {
+    c->value = g_malloc (len - skip + 1);
+    spa_json_parse_stringn (v + skip, (int) (len - skip), c->value,
+        (int) (len - skip + 1));
+  }
+
+  if (c->flags & CONDITION_REGEX) {
+    int res = regcomp (&c->regex, c->value, REG_EXTENDED | REG_NOSUB);
+    if (res != 0) {
+      gchar errbuf[256];
+      regerror (res, &c->regex, errbuf, sizeof (errbuf));
+      wp_warning ("invalid regex %s: %s", c->value, errbuf);
+      c->flags |= CONDITION_INVALID;
+    }
+  }
+}
+
+static gboolean
+condition_matches (const struct condition *c, const gchar *str)
+{
+  gboolean matched;
+
+  if (c->flags & CONDITION_NULL)
+    matched = (str == NULL);
+  else if (!str || (c->flags & CONDITION_INVALID))
+    matched = FALSE;
+  else if (c->flags & CONDITION_REGEX)
+    matched = (regexec (&c->regex, str, 0, NULL, 0) == 0);
+  else
+    matched = g_str_equal (str, c->value);
+
+  return (c->flags & CONDITION_NEGATE) ? !matched : matched;
+}
+
+static void
+wp_rules_matcher_index_clause (WpRulesMatcher *self, guint clause_idx,
+    const struct condition *c)
+{
+  GHashTable *values = g_hash_table_lookup (self->index, c->key);
+  GArray *clauses;
+
+  if (!values) {
+    values = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+        (GDestroyNotify) g_array_unref);
+    g_hash_table_insert (self->index, c->key, values);
+  }
+
+  clauses = g_hash_table_lookup (values, c->value);
+  if (!clauses) {
+    clauses = g_array_new (FALSE, FALSE, sizeof (guint));
+    g_hash_table_insert (values, c->value, clauses);
+  }
+  g_array_append_val (clauses, clause_idx);
+}
+
+static void
+wp_rules_matcher_compile_matches (WpRulesMatcher *self,
+    const WpSpaJsonCursor *matches)
+{
+  WpSpaJsonCursor it, props;
+  gchar key[256];
+
+  wp_spa_json_cursor_enter (matches, &it);
+  while (wp_spa_json_cursor_next (&it) && wp_spa_json_cursor_is_object (&it)) {
+    struct clause clause = { self->conditions->len, 0, -1 };
+
+    wp_spa_json_cursor_enter (&it, &props);
+    while (wp_spa_json_cursor_next (&props) &&
+        wp_spa_json_cursor_get_string (&props, key, sizeof (key)) &&
+        wp_spa_json_cursor_next (&props)) {
+      struct condition c = { 0, };
+      condition_init (&c, key, &props);
+      if (clause.anchor < 0 && c.flags == 0)
+        clause.anchor = clause.n_conditions;
+      g_array_append_val (self->conditions, c);
+      clause.n_conditions++;
+    }
+
+    if (clause.anchor >= 0)
+      wp_rules_matcher_index_clause (self, self->clauses->len,
+          &g_array_index (self->conditions, struct condition,
+              clause.first_condition + clause.anchor));
+    g_array_append_val (self->clauses, clause);
+  }
+}
+
+static void
+wp_rules_matcher_compile_rule (WpRulesMatcher *self,
+    const WpSpaJsonCursor *object)
+{
+  struct rule rule = { 0, };
+  gboolean have_matches = FALSE, have_actions = FALSE;
+  WpSpaJsonCursor it, actions;
+  gchar key[64];
+
+  wp_spa_json_cursor_enter (object, &it);
+  while (wp_spa_json_cursor_next (&it) &&
+      wp_spa_json_cursor_get_string (&it, key, sizeof (key)) &&
+      wp_spa_json_cursor_next (&it)) {
+    if (g_str_equal (key, "matches")) {
+      if (!wp_spa_json_cursor_is_array (&it))
+        break;
+      rule.first_clause = self->clauses->len;
+      wp_rules_matcher_compile_matches (self, &it);
+      rule.n_clauses = self->clauses->len - rule.first_clause;
+      have_matches = TRUE;
+    }
+    else if (g_str_equal (key, "actions") &&
+        wp_spa_json_cursor_is_object (&it) &&
+        wp_spa_json_cursor_enter (&it, &actions)) {
+      rule.first_action = self->actions->len;
+      while (wp_spa_json_cursor_next (&actions)) {
+        struct action a = { wp_spa_json_cursor_dup_string (&actions), NULL };
+        if (!wp_spa_json_cursor_next (&actions)) {
+          g_free (a.name);
+          break;
+        }
+        a.value = wp_spa_json_cursor_get_json (&actions);
+        g_array_append_val (self->actions, a);
+      }
+      rule.n_actions = self->actions->len - rule.first_action;
+      have_actions = TRUE;
+    }
+  }
+
+  /* a rule without both matches and actions never does anything */
+  if (have_matches && have_actions)
+    g_array_append_val (self->rules, rule);
+}
+
+/*!
+ * \brief Parses a set of rules, so that properties can be matched against it
+ *   without parsing the JSON again
+ *
+ * \ingroup wpjsonutils
+ * \param rules a JSON array containing rules in the format accepted by
+ *    wp_json_utils_match_rules()
+ * \returns (transfer full): the new rules matcher
+ */
+WpRulesMatcher *
+wp_rules_matcher_new (WpSpaJson *rules)
 {
-  struct match_rules_cb_data *cb_data = data;
-  g_autoptr (WpSpaJson) json = wp_spa_json_new_wrap_stringn (str, len);
-  return cb_data->callback (cb_data->data, action, json, cb_data->error) ? 0 : -EPIPE;
+  WpRulesMatcher *self;
+  WpSpaJsonCursor it;
+
+  g_return_val_if_fail (rules, NULL);
+
+  self = g_rc_box_new0 (WpRulesMatcher);
+  self->json = wp_spa_json_copy (rules);
+  self->conditions = g_array_new (FALSE, FALSE, sizeof (struct condition));
+  g_array_set_clear_func (self->conditions, (GDestroyNotify) condition_clear);
+  self->clauses = g_array_new (FALSE, FALSE, sizeof (struct clause));
+  self->actions = g_array_new (FALSE, FALSE, sizeof (struct action));
+  g_array_set_clear_func (self->actions, (GDestroyNotify) action_clear);
+  self->rules = g_array_new (FALSE, FALSE, sizeof (struct rule));
+  self->index = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+      (GDestroyNotify) g_hash_table_unref);
+
+  if (wp_spa_json_is_array (self->json) &&
+      wp_spa_json_cursor_init (&it, self->json)) {
+    while (wp_spa_json_cursor_next (&it) && wp_spa_json_cursor_is_object (&it))
+      wp_rules_matcher_compile_rule (self, &it);
+  }
+
+  wp_debug_boxed (WP_TYPE_RULES_MATCHER, self,
+      "compiled %u rules, %u conditions, %u indexed keys", self->rules->len,
+      self->conditions->len, g_hash_table_size (self->index));
+
+  return self;
+}
+
+/*!
+ * \brief Increases the reference count of a rules matcher
+ * \ingroup wpjsonutils
+ * \param self a rules matcher
+ * \returns (transfer full): \a self with an additional reference count on it
+ */
+WpRulesMatcher *
+wp_rules_matcher_ref (WpRulesMatcher *self)
+{
+  return g_rc_box_acquire (self);
+}
+
+static void
+wp_rules_matcher_free (WpRulesMatcher *self)
+{
+  /* the index points to the strings of the conditions */
+  g_clear_pointer (&self->index, g_hash_table_unref);
+  g_clear_pointer (&self->rules, g_array_unref);
+  g_clear_pointer (&self->actions, g_array_unref);
+  g_clear_pointer (&self->clauses, g_array_unref);
+  g_clear_pointer (&self->conditions, g_array_unref);
+  g_clear_pointer (&self->json, wp_spa_json_unref);
+}
+
+/*!
+ * \brief Decreases the reference count on \a self and frees it when the ref
+ * count reaches zero.
+ * \ingroup wpjsonutils
+ * \param self (transfer full): a rules matcher
+ */
+void
+wp_rules_matcher_unref (WpRulesMatcher *self)
+{
+  g_rc_box_release_full (self, (GDestroyNotify) wp_rules_matcher_free);
+}
+
+static gboolean
+wp_rules_matcher_clause_matches (WpRulesMatcher *self, guint clause_idx,
+    const guint8 *candidates, WpProperties *props)
+{
+  const struct clause *clause =
+      &g_array_index (self->clauses, struct clause, clause_idx);
+
+  if (clause->n_conditions == 0)
+    return FALSE;
+
+  /* the anchor condition was already checked by looking up the index */
+  if (clause->anchor >= 0 && !candidates[clause_idx])
+    return FALSE;
+
+  for (guint i = 0; i < clause->n_conditions; i++) {
+    const struct condition *c = &g_array_index (self->conditions,
+        struct condition, clause->first_condition + i);
+    if ((gint) i != clause->anchor &&
+        !condition_matches (c, wp_properties_get (props, c->key)))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/*!
+ * \brief Matches the given properties against the rules and calls the given
+ * callback to perform actions on a successful match.
+ *
+ * This behaves exactly like wp_json_utils_match_rules(). The values that are
+ * passed to \a callback point to data owned by \a self.
+ *
+ * \ingroup wpjsonutils
+ * \param self the rules matcher
+ * \param match_props (transfer none): the properties to match against the rules
+ * \param callback (scope call): a function to call for each action on a successful match
+ * \param data (closure callback): data to be passed to \a callback
+ * \param error (out)(optional): the error that occurred, if any
+ * \returns FALSE if an error occurred, TRUE otherwise
+ */
+gboolean
+wp_rules_matcher_match (WpRulesMatcher *self, WpProperties *match_props,
+    WpRuleMatchCallback callback, gpointer data, GError ** error)
+{
+  guint8 stack_candidates[256];
+  g_autofree guint8 *heap_candidates = NULL;
+  guint8 *candidates = stack_candidates;
+  GHashTableIter iter;
+  gpointer key, values;
+  gboolean dirty = TRUE;
+
+  g_return_val_if_fail (self, FALSE);
+  g_return_val_if_fail (match_props, FALSE);
+  g_return_val_if_fail (callback, FALSE);
+
+  if (self->clauses->len > sizeof (stack_candidates))
+    candidates = heap_candidates = g_malloc (self->clauses->len);
+
+  for (guint i = 0; i < self->rules->len; i++) {
+    const struct rule *rule = &g_array_index (self->rules, struct rule, i);
+    gboolean matched = FALSE;
+
+    /* mark the clauses whose anchor condition matches; this is done again
+       after running actions, because they may modify the properties */
+    if (dirty) {
+      memset (candidates, 0, self->clauses->len);
+      g_hash_table_iter_init (&iter, self->index);
+      while (g_hash_table_iter_next (&iter, &key, &values)) {
+        const gchar *str = wp_properties_get (match_props, key);
+        GArray *clauses = str ? g_hash_table_lookup (values, str) : NULL;
+        for (guint j = 0; clauses && j < clauses->len; j++)
+          candidates[g_array_index (clauses, guint, j)] = 1;
+      }
+      dirty = FALSE;
+    }
+
+    for (guint j = 0; j < rule->n_clauses && !matched; j++)
+      matched = wp_rules_matcher_clause_matches (self, rule->first_clause + j,
+          candidates, match_props);
+    if (!matched)
+      continue;
+
+    for (guint j = 0; j < rule->n_actions; j++) {
+      const struct action *a = &g_array_index (self->actions, struct action,
+          rule->first_action + j);
+      g_autoptr (GError) cb_error = NULL;
+
+      wp_trace_boxed (WP_TYPE_RULES_MATCHER, self, "action %s", a->name);
+
+      if (!callback (data, a->name, a->value, &cb_error)) {
+        if (cb_error)
+          g_propagate_error (error, g_steal_pointer (&cb_error));
+        else
+          g_set_error (error, WP_DOMAIN_LIBRARY,
+              WP_LIBRARY_ERROR_OPERATION_FAILED,
+              "match rules error: %s", spa_strerror (-EPIPE));
+        return FALSE;
+      }
+    }
+    dirty = TRUE;
+  }
+
+  return TRUE;
 }
 
 /*!
@@ -48,6 +466,10 @@ match_rules_cb (void *data, const char *location, const char *action,
  * and the value can be any valid JSON. Both the action name and the value are
  * passed as-is on the \a callback.
  *
+ * The rules are compiled into a WpRulesMatcher the first time that \a json
+ * is used and the result is kept together with \a json, so matching against
+ * the same object repeatedly does not need to parse it again.
+ *
  * \verbatim
  * [
  *     {
@@ -81,23 +503,22 @@ gboolean
 wp_json_utils_match_rules (WpSpaJson *json, WpProperties *match_props,
     WpRuleMatchCallback callback, gpointer data, GError ** error)
 {
-  g_autoptr (GError) cb_error = NULL;
-  struct match_rules_cb_data cb_data = { callback, data, &cb_error };
-
-  int res = pw_conf_match_rules (wp_spa_json_get_data (json),
-      wp_spa_json_get_size (json), NULL, wp_properties_peek_dict (match_props),
-      match_rules_cb, &cb_data);
-
-  if (res < 0) {
-    if (cb_error)
-      g_propagate_error (error, g_steal_pointer (&cb_error));
-    else
-      g_set_error (error, WP_DOMAIN_LIBRARY, WP_LIBRARY_ERROR_OPERATION_FAILED,
-          "match rules error: %s", spa_strerror (res));
-    return FALSE;
+  static GQuark matcher_quark = 0;
+  WpRulesMatcher *matcher;
+
+  if (G_UNLIKELY (!matcher_quark))
+    matcher_quark = g_quark_from_static_string ("wp-rules-matcher");
+
+  /* the rules are compiled on first use and cached on the json, which never
+     changes; a modified configuration comes in a new WpSpaJson */
+  matcher = wp_spa_json_get_qdata (json, matcher_quark);
+  if (!matcher) {
+    matcher = wp_rules_matcher_new (json);
+    wp_spa_json_set_qdata_full (json, matcher_quark, matcher,
+        (GDestroyNotify) wp_rules_matcher_unref);
   }
 
-  return TRUE;
+  return wp_rules_matcher_match (matcher, match_props, callback, data, error);
 }
 
 struct update_props_cb_data
@@ -143,89 +564,122 @@ wp_json_utils_match_rules_update_properties (WpSpaJson *json, WpProperties *prop
 
 
 #define OVERRIDE_SECTION_PREFIX "override."
+#define KEY_BUFFER_SIZE 256
+
+/* Parses the key that @cursor points to into @buf or, if it does not fit,
+   into a newly allocated string that is returned in @str */
+static const gchar *
+cursor_get_key (const WpSpaJsonCursor *cursor, gchar *buf, gsize size,
+    gchar **str)
+{
+  if (wp_spa_json_cursor_get_string (cursor, buf, size))
+    return buf;
+  return (*str = wp_spa_json_cursor_dup_string (cursor));
+}
+
+/* Finds the value of @key, or of its "override." variant if @key does not
+   exist, in the object that @object points to */
+static gboolean
+object_lookup (const WpSpaJsonCursor *object, const gchar *key,
+    WpSpaJsonCursor *value)
+{
+  WpSpaJsonCursor it;
+  gchar buf[KEY_BUFFER_SIZE];
+  gboolean found = FALSE;
+
+  if (!wp_spa_json_cursor_enter (object, &it))
+    return FALSE;
+
+  while (wp_spa_json_cursor_next (&it)) {
+    g_autofree gchar *str = NULL;
+    const gchar *k = cursor_get_key (&it, buf, sizeof (buf), &str);
+
+    if (!wp_spa_json_cursor_next (&it))
+      break;
+    if (!k)
+      continue;
+
+    if (g_str_equal (k, key)) {
+      *value = it;
+      return TRUE;
+    }
+    if (!found && g_str_has_prefix (k, OVERRIDE_SECTION_PREFIX) &&
+        g_str_equal (k + strlen (OVERRIDE_SECTION_PREFIX), key)) {
+      *value = it;
+      found = TRUE;
+    }
+  }
+
+  return found;
+}
+
+static void
+builder_add_cursor (WpSpaJsonBuilder *builder, const WpSpaJsonCursor *cursor)
+{
+  gsize size;
+  const gchar *data = wp_spa_json_cursor_get_data (cursor, &size);
+  wp_spa_json_builder_add_from_stringn (builder, data, size);
+}
+
+static WpSpaJson * merge_containers (const WpSpaJsonCursor *a,
+    const WpSpaJsonCursor *b);
 
 static WpSpaJson *
-merge_json_objects (WpSpaJson *a, WpSpaJson *b)
+merge_json_objects (const WpSpaJsonCursor *a, const WpSpaJsonCursor *b)
 {
   g_autoptr (WpSpaJsonBuilder) builder = NULL;
+  WpSpaJsonCursor it, j;
+  gchar buf[KEY_BUFFER_SIZE];
 
   builder = wp_spa_json_builder_new_object ();
 
   /* Add all properties from 'a' that don't exist in 'b' */
-  {
-    g_autoptr (WpIterator) it = wp_spa_json_new_iterator (a);
-    g_auto (GValue) item = G_VALUE_INIT;
-    for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
-      g_autoptr (WpSpaJson) key = NULL;
-      g_autoptr (WpSpaJson) val = NULL;
-      g_autoptr (WpSpaJson) j = NULL;
-      g_autofree gchar *str = NULL;
-      const gchar *key_str;
-      g_autofree gchar *override_key_str = NULL;
-      gboolean override;
-
-      key = g_value_dup_boxed (&item);
-      key_str = str = wp_spa_json_parse_string (key);
-      g_return_val_if_fail (key_str, NULL);
-      override = g_str_has_prefix (str, OVERRIDE_SECTION_PREFIX);
-      if (override)
-        key_str += strlen (OVERRIDE_SECTION_PREFIX);
-      override_key_str = g_strdup_printf (OVERRIDE_SECTION_PREFIX "%s", key_str);
-
-      g_value_unset (&item);
-      g_return_val_if_fail (wp_iterator_next (it, &item), NULL);
-      val = g_value_dup_boxed (&item);
-
-      if (!wp_spa_json_object_get (b, key_str, "J", &j, NULL) &&
-          !wp_spa_json_object_get (b, override_key_str, "J", &j, NULL)) {
-        wp_spa_json_builder_add_property (builder, key_str);
-        wp_spa_json_builder_add_json (builder, val);
-      }
+  wp_spa_json_cursor_enter (a, &it);
+  while (wp_spa_json_cursor_next (&it)) {
+    g_autofree gchar *str = NULL;
+    const gchar *key_str = cursor_get_key (&it, buf, sizeof (buf), &str);
+
+    g_return_val_if_fail (key_str, NULL);
+    if (g_str_has_prefix (key_str, OVERRIDE_SECTION_PREFIX))
+      key_str += strlen (OVERRIDE_SECTION_PREFIX);
+
+    g_return_val_if_fail (wp_spa_json_cursor_next (&it), NULL);
+
+    if (!object_lookup (b, key_str, &j)) {
+      wp_spa_json_builder_add_property (builder, key_str);
+      builder_add_cursor (builder, &it);
     }
   }
 
   /* Add properties from 'b' that don't exist in 'a'. If a property
    * exists in 'a' and does not have the 'override.' prefix, recursively
    * merge it before adding it. Otherwise override it. */
-  {
-    g_autoptr (WpIterator) it = wp_spa_json_new_iterator (b);
-    g_auto (GValue) item = G_VALUE_INIT;
-    for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
-      g_autoptr (WpSpaJson) key = NULL;
-      g_autoptr (WpSpaJson) val = NULL;
-      g_autoptr (WpSpaJson) j = NULL;
-      g_autofree gchar *str = NULL;
-      const gchar *key_str;
-      g_autofree gchar *override_key_str = NULL;
-      gboolean override;
-
-      key = g_value_dup_boxed (&item);
-      key_str = str = wp_spa_json_parse_string (key);
-      g_return_val_if_fail (key_str, NULL);
-      override = g_str_has_prefix (str, OVERRIDE_SECTION_PREFIX);
-      if (override)
-        key_str += strlen (OVERRIDE_SECTION_PREFIX);
-      override_key_str = g_strdup_printf (OVERRIDE_SECTION_PREFIX "%s", key_str);
-
-      g_value_unset (&item);
-      g_return_val_if_fail (wp_iterator_next (it, &item), NULL);
-      val = g_value_dup_boxed (&item);
-
-      if (!override && wp_spa_json_is_container (val) &&
-          (wp_spa_json_object_get (a, key_str, "J", &j, NULL) ||
-           wp_spa_json_object_get (a, override_key_str, "J", &j, NULL))) {
-        g_autoptr (WpSpaJson) merged = wp_json_utils_merge_containers (j, val);
-        if (!merged) {
-          wp_warning ("skipping merge of %s as JSON values are not compatible containers",
-              key_str);
-          continue;
-        }
-        wp_spa_json_builder_add_property (builder, key_str);
-        wp_spa_json_builder_add_json (builder, merged);
-      } else {
-        wp_spa_json_builder_add_property (builder, key_str);
-        wp_spa_json_builder_add_json (builder, val);
+  wp_spa_json_cursor_enter (b, &it);
+  while (wp_spa_json_cursor_next (&it)) {
+    g_autofree gchar *str = NULL;
+    const gchar *key_str = cursor_get_key (&it, buf, sizeof (buf), &str);
+    gboolean override;
+
+    g_return_val_if_fail (key_str, NULL);
+    override = g_str_has_prefix (key_str, OVERRIDE_SECTION_PREFIX);
+    if (override)
+      key_str += strlen (OVERRIDE_SECTION_PREFIX);
+
+    g_return_val_if_fail (wp_spa_json_cursor_next (&it), NULL);
+
+    if (!override && wp_spa_json_cursor_is_container (&it) &&
+        object_lookup (a, key_str, &j)) {
+      g_autoptr (WpSpaJson) merged = merge_containers (&j, &it);
+      if (!merged) {
+        wp_warning ("skipping merge of %s as JSON values are not compatible containers",
+            key_str);
+        continue;
       }
+      wp_spa_json_builder_add_property (builder, key_str);
+      wp_spa_json_builder_add_json (builder, merged);
+    } else {
+      wp_spa_json_builder_add_property (builder, key_str);
+      builder_add_cursor (builder, &it);
     }
   }
 
@@ -233,35 +687,36 @@ merge_json_objects (WpSpaJson *a, WpSpaJson *b)
 }
 
 static WpSpaJson *
-merge_json_arrays (WpSpaJson * a, WpSpaJson * b)
+merge_json_arrays (const WpSpaJsonCursor *a, const WpSpaJsonCursor *b)
 {
   g_autoptr (WpSpaJsonBuilder) builder = NULL;
+  WpSpaJsonCursor it;
 
   builder = wp_spa_json_builder_new_array ();
 
   /* Add all elements from 'a' */
-  {
-    g_autoptr (WpIterator) it = wp_spa_json_new_iterator (a);
-    g_auto (GValue) item = G_VALUE_INIT;
-    for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
-      WpSpaJson *j = g_value_get_boxed (&item);
-      wp_spa_json_builder_add_json (builder, j);
-    }
-  }
+  wp_spa_json_cursor_enter (a, &it);
+  while (wp_spa_json_cursor_next (&it))
+    builder_add_cursor (builder, &it);
 
   /* Add all elements from 'b' */
-  {
-    g_autoptr (WpIterator) it = wp_spa_json_new_iterator (b);
-    g_auto (GValue) item = G_VALUE_INIT;
-    for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
-      WpSpaJson *j = g_value_get_boxed (&item);
-      wp_spa_json_builder_add_json (builder, j);
-    }
-  }
+  wp_spa_json_cursor_enter (b, &it);
+  while (wp_spa_json_cursor_next (&it))
+    builder_add_cursor (builder, &it);
 
   return wp_spa_json_builder_end (builder);
 }
 
+static WpSpaJson *
+merge_containers (const WpSpaJsonCursor *a, const WpSpaJsonCursor *b)
+{
+  if (wp_spa_json_cursor_is_array (a) && wp_spa_json_cursor_is_array (b))
+    return merge_json_arrays (a, b);
+  else if (wp_spa_json_cursor_is_object (a) && wp_spa_json_cursor_is_object (b))
+    return merge_json_objects (a, b);
+  return NULL;
+}
+
 /*!
  * \brief Merges two JSON containers (objects or arrays) into one.
  *
@@ -286,9 +741,12 @@ merge_json_arrays (WpSpaJson * a, WpSpaJson * b)
 WpSpaJson *
 wp_json_utils_merge_containers (WpSpaJson * a, WpSpaJson * b)
 {
-  if (wp_spa_json_is_array (a) && wp_spa_json_is_array (b))
-    return merge_json_arrays (a, b);
-  else if (wp_spa_json_is_object (a) && wp_spa_json_is_object (b))
-    return merge_json_objects (a, b);
-  return NULL;
+  WpSpaJsonCursor ca, cb;
+
+  wp_spa_json_cursor_init_undefined (&ca, a);
+  wp_spa_json_cursor_init_undefined (&cb, b);
+  if (!wp_spa_json_cursor_next (&ca) || !wp_spa_json_cursor_next (&cb))
+    return NULL;
+
+  return merge_containers (&ca, &cb);
 }
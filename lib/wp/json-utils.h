@@ -36,6 +36,32 @@ gint wp_json_utils_match_rules_update_properties (WpSpaJson *json, WpProperties
 WP_API
 WpSpaJson * wp_json_utils_merge_containers (WpSpaJson * a, WpSpaJson * b);
 
+/*!
+ * \brief The WpRulesMatcher GType
+ * \ingroup wpjsonutils
+ */
+#define WP_TYPE_RULES_MATCHER (wp_rules_matcher_get_type ())
+WP_API
+GType wp_rules_matcher_get_type (void);
+
+typedef struct _WpRulesMatcher WpRulesMatcher;
+
+WP_API
+WpRulesMatcher * wp_rules_matcher_new (WpSpaJson * rules);
+
+WP_API
+WpRulesMatcher * wp_rules_matcher_ref (WpRulesMatcher * self);
+
+WP_API
+void wp_rules_matcher_unref (WpRulesMatcher * self);
+
+WP_API
+gboolean wp_rules_matcher_match (WpRulesMatcher * self,
+    WpProperties * match_props, WpRuleMatchCallback callback, gpointer data,
+    GError ** error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (WpRulesMatcher, wp_rules_matcher_unref)
+
 G_END_DECLS
 
 #endif
@@ -10,6 +10,11 @@
 #include "wp.h"
 #include <pipewire/pipewire.h>
 #include <spa/support/log.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
 
 WP_DEFINE_LOCAL_LOG_TOPIC ("wp-log")
 
@@ -221,7 +226,9 @@ static struct {
   gboolean use_color;
   gboolean output_is_journal;
   gboolean set_pw_log;
+  gboolean async;
   gint global_log_level;
+  gint max_log_level;
   GLogLevelFlags global_log_level_flags;
   struct log_topic_pattern *patterns;
   GPtrArray *log_topics;
@@ -230,12 +237,17 @@ static struct {
   .use_color = FALSE,
   .output_is_journal = FALSE,
   .set_pw_log = FALSE,
+  .async = FALSE,
   .global_log_level = DEFAULT_LOG_LEVEL,
+  .max_log_level = DEFAULT_LOG_LEVEL,
   .global_log_level_flags = DEFAULT_LOG_LEVEL_FLAGS,
   .patterns = NULL,
   .log_topics = NULL,
 };
 
+static void async_log_start (void);
+static gboolean trace_file_open (const gchar *path);
+
 /* reference: https://en.wikipedia.org/wiki/ANSI_escape_code#3/4_bit */
 #define COLOR_RED            "\033[1;31m"
 #define COLOR_GREEN          "\033[1;32m"
@@ -516,9 +528,9 @@ format_pw_log_level_string (gint level, const struct log_topic_pattern *patterns
 gboolean
 wp_log_set_level (const gchar *level_str)
 {
-  gint level;
+  gint level, max_level;
   GLogLevelFlags flags;
-  struct log_topic_pattern *patterns;
+  struct log_topic_pattern *patterns, *p;
 
   level = DEFAULT_LOG_LEVEL;
   if (!parse_log_level (level_str, &patterns, &level))
@@ -526,8 +538,15 @@ wp_log_set_level (const gchar *level_str)
 
   flags = level_index_to_full_flags (level);
 
+  /* the highest level enabled for any topic; messages above it can be
+     discarded without matching their topic against the patterns */
+  max_level = level;
+  for (p = patterns; p->spec; p++)
+    max_level = MAX (max_level, p->log_level);
+
   g_mutex_lock (&log_state.log_topics_lock);
   log_state.global_log_level = level;
+  log_state.max_log_level = max_level;
   log_state.global_log_level_flags = flags;
   SPA_SWAP (log_state.patterns, patterns);
   g_mutex_unlock (&log_state.log_topics_lock);
@@ -562,6 +581,10 @@ wp_log_init (gint flags)
   log_state.output_is_journal = g_log_writer_is_journald (fileno (stderr));
   log_state.set_pw_log = flags & WP_INIT_SET_PW_LOG && !g_getenv ("WIREPLUMBER_NO_PW_LOG");
 
+  if (!log_state.async && g_getenv ("WIREPLUMBER_LOG_ASYNC") &&
+      !g_str_equal (g_getenv ("WIREPLUMBER_LOG_ASYNC"), "0"))
+    async_log_start ();
+
   if (flags & WP_INIT_SET_GLIB_LOG)
     g_log_set_writer_func (wp_log_writer_default, NULL, NULL);
 
@@ -574,6 +597,10 @@ wp_log_init (gint flags)
     wp_log_set_level (NULL);
   }
 
+  if (g_getenv ("WIREPLUMBER_TRACE_FILE") &&
+      g_getenv ("WIREPLUMBER_TRACE_FILE")[0] != '\0')
+    trace_file_open (g_getenv ("WIREPLUMBER_TRACE_FILE"));
+
   if (log_state.set_pw_log) {
     /* always set PIPEWIRE_DEBUG for 2 reasons:
      * 1. to overwrite it from the environment, in case the user has set it
@@ -677,6 +704,8 @@ struct _WpLogFields
   gboolean debug;
   GType object_type;
   gconstpointer object;
+  guint32 object_id;
+  gint64 time;
 };
 
 static void
@@ -699,9 +728,21 @@ wp_log_fields_init (WpLogFields *lf,
   lf->func = func;
   lf->object_type = object_type;
   lf->object = object;
+  lf->object_id = SPA_ID_INVALID;
+  lf->time = 0;
   lf->message = message ? message : "(null)";
 }
 
+/* reads everything that is printed about the object while it is known to be
+   alive, so that the message can be formatted later */
+static void
+wp_log_fields_resolve_object (WpLogFields *lf)
+{
+  if (lf->object && g_type_is_a (lf->object_type, WP_TYPE_PROXY) &&
+      (wp_object_test_active_features ((WpObject *) lf->object, WP_PROXY_FEATURE_BOUND)))
+    lf->object_id = wp_proxy_get_bound_id ((WpProxy *) lf->object);
+}
+
 static gboolean
 wp_want_debug_log (const struct spa_log_topic *topic)
 {
@@ -738,12 +779,11 @@ wp_log_fields_init_from_glib (WpLogFields *lf, GLogLevelFlags log_level_flags,
 static void
 wp_log_fields_write_to_stream (WpLogFields *lf, FILE *s)
 {
-  gint64 now;
+  gint64 now = lf->time;
   time_t now_secs;
   struct tm now_tm;
   gchar time_buf[128];
 
-  now = g_get_real_time ();
   now_secs = (time_t) (now / G_USEC_PER_SEC);
   localtime_r (&now_secs, &now_tm);
   strftime (time_buf, sizeof (time_buf), "%H:%M:%S", &now_tm);
@@ -766,7 +806,6 @@ wp_log_fields_write_to_stream (WpLogFields *lf, FILE *s)
       log_state.use_color ? RESET_COLOR : "",
       /* message */
       lf->message);
-  fflush (s);
 }
 
 static gboolean
@@ -831,10 +870,8 @@ wp_log_fields_format_message (WpLogFields *lf)
     extra_message = g_string_free (spa_dbg_str, FALSE);
     spa_dbg_str = NULL;
   }
-  else if (lf->object && g_type_is_a (lf->object_type, WP_TYPE_PROXY) &&
-      (wp_object_test_active_features ((WpObject *) lf->object, WP_PROXY_FEATURE_BOUND))) {
-    extra_object = g_strdup_printf (":%u:",
-        wp_proxy_get_bound_id ((WpProxy *) lf->object));
+  else if (lf->object_id != SPA_ID_INVALID) {
+    extra_object = g_strdup_printf (":%u:", lf->object_id);
   }
 
   return g_strdup_printf ("%s<%s%s%p>%s %s",
@@ -846,8 +883,10 @@ wp_log_fields_format_message (WpLogFields *lf)
       extra_message ? extra_message : lf->message);
 }
 
+/* writes a message whose object has been resolved already;
+   the caller has to flush stderr */
 static GLogWriterOutput
-wp_log_fields_log (WpLogFields *lf)
+wp_log_fields_write (WpLogFields *lf)
 {
   g_autofree gchar *full_message = NULL;
 
@@ -868,6 +907,1116 @@ wp_log_fields_log (WpLogFields *lf)
   return G_LOG_WRITER_HANDLED;
 }
 
+static GLogWriterOutput
+wp_log_fields_log (WpLogFields *lf)
+{
+  GLogWriterOutput ret;
+
+  if (!lf->time)
+    lf->time = g_get_real_time ();
+  wp_log_fields_resolve_object (lf);
+
+  ret = wp_log_fields_write (lf);
+  if (stderr)
+    fflush (stderr);
+  return ret;
+}
+
+/*
+ * Asynchronous output
+ *
+ * When WIREPLUMBER_LOG_ASYNC is set, messages are queued in a bounded ring
+ * and written to stderr or the journal by a dedicated thread, so that the
+ * thread that logs never blocks on I/O. The message is printed directly in
+ * its slot, which makes a copy of all the arguments that it references; the
+ * object is resolved, but the object prefix, the timestamp and the journal
+ * fields are formatted later, by the writer thread.
+ *
+ * Slots are reserved with an atomic compare-and-swap on the head, so that
+ * producers on different threads never wait for each other. A reserved slot
+ * is published by setting its ready flag, after which it belongs to the
+ * writer thread until it moves the tail past it. When the ring is full,
+ * messages are dropped and counted, and the writer reports the count in the
+ * stream when there is space again. Fatal messages are always written
+ * synchronously, after waiting for the queue to be drained.
+ */
+
+#define ASYNC_LOG_N_SLOTS 1024 /* must be a power of 2 */
+#define ASYNC_LOG_SLOT_DATA_SIZE 448
+
+enum {
+  ASYNC_FIELD_TOPIC,
+  ASYNC_FIELD_FILE,
+  ASYNC_FIELD_LINE,
+  ASYNC_FIELD_FUNC,
+  ASYNC_FIELD_MESSAGE,
+  N_ASYNC_FIELDS,
+};
+
+struct async_log_slot
+{
+  gint ready;
+  gint log_level;
+  gboolean debug;
+  GType object_type;
+  gconstpointer object;
+  guint32 object_id;
+  gint64 time;
+  /* message that did not fit in data */
+  gchar *long_message;
+  /* offsets of the string fields in data, or -1 for NULL */
+  gint16 offsets[N_ASYNC_FIELDS];
+  gchar data[ASYNC_LOG_SLOT_DATA_SIZE];
+};
+
+static struct {
+  struct async_log_slot *slots;
+  gint head;
+  gint tail;
+  guint dropped;
+  gint sleeping;
+  gint stopping;
+  GThread *thread;
+  GMutex lock;
+  GCond wake_cond;
+  GCond drained_cond;
+} async_log;
+
+static gboolean
+async_log_slot_add_string (struct async_log_slot *slot, gsize *pos,
+    gint field, const gchar *str)
+{
+  gsize len;
+
+  if (!str) {
+    slot->offsets[field] = -1;
+    return TRUE;
+  }
+
+  len = strlen (str) + 1;
+  if (len > ASYNC_LOG_SLOT_DATA_SIZE - *pos)
+    return FALSE;
+
+  memcpy (slot->data + *pos, str, len);
+  slot->offsets[field] = *pos;
+  *pos += len;
+  return TRUE;
+}
+
+static inline const gchar *
+async_log_slot_get_string (struct async_log_slot *slot, gint field)
+{
+  return slot->offsets[field] >= 0 ? slot->data + slot->offsets[field] : NULL;
+}
+
+/* reserves a slot and stores everything except the message in it */
+static struct async_log_slot *
+async_log_reserve (WpLogFields *lf, gsize *pos)
+{
+  struct async_log_slot *slot;
+  gint head, tail;
+
+  do {
+    head = g_atomic_int_get (&async_log.head);
+    tail = g_atomic_int_get (&async_log.tail);
+    if ((guint) head - (guint) tail >= ASYNC_LOG_N_SLOTS) {
+      g_atomic_int_inc (&async_log.dropped);
+      return NULL;
+    }
+  } while (!g_atomic_int_compare_and_exchange (&async_log.head, head,
+          (gint) ((guint) head + 1)));
+
+  slot = &async_log.slots[head & (ASYNC_LOG_N_SLOTS - 1)];
+  slot->log_level = lf->log_level;
+  slot->debug = lf->debug;
+  slot->object_type = lf->object_type;
+  slot->object = lf->object;
+  slot->object_id = lf->object_id;
+  slot->time = g_get_real_time ();
+  slot->long_message = NULL;
+
+  /* the topic and the location are short; drop them if they are not */
+  *pos = 0;
+  if (!async_log_slot_add_string (slot, pos, ASYNC_FIELD_TOPIC, lf->log_topic))
+    slot->offsets[ASYNC_FIELD_TOPIC] = -1;
+  if (!async_log_slot_add_string (slot, pos, ASYNC_FIELD_FILE, lf->file) ||
+      !async_log_slot_add_string (slot, pos, ASYNC_FIELD_LINE, lf->line) ||
+      !async_log_slot_add_string (slot, pos, ASYNC_FIELD_FUNC, lf->func)) {
+    slot->offsets[ASYNC_FIELD_FILE] = -1;
+    slot->offsets[ASYNC_FIELD_LINE] = -1;
+    slot->offsets[ASYNC_FIELD_FUNC] = -1;
+  }
+  slot->offsets[ASYNC_FIELD_MESSAGE] = *pos;
+  return slot;
+}
+
+static void
+async_log_publish (struct async_log_slot *slot)
+{
+  g_atomic_int_set (&slot->ready, 1);
+
+  if (g_atomic_int_get (&async_log.sleeping)) {
+    g_mutex_lock (&async_log.lock);
+    g_cond_signal (&async_log.wake_cond);
+    g_mutex_unlock (&async_log.lock);
+  }
+}
+
+static G_GNUC_PRINTF (2, 0) void
+async_log_pushv (WpLogFields *lf, const gchar *format, va_list args)
+{
+  struct async_log_slot *slot;
+  va_list args_copy;
+  gsize pos;
+  gint len;
+
+  if (!(slot = async_log_reserve (lf, &pos)))
+    return;
+
+  va_copy (args_copy, args);
+  len = g_vsnprintf (slot->data + pos, ASYNC_LOG_SLOT_DATA_SIZE - pos,
+      format, args_copy);
+  va_end (args_copy);
+
+  if (len < 0 || (gsize) len >= ASYNC_LOG_SLOT_DATA_SIZE - pos)
+    slot->long_message = g_strdup_vprintf (format, args);
+
+  async_log_publish (slot);
+}
+
+/* queues a message that is already formatted */
+static void
+async_log_push (WpLogFields *lf)
+{
+  struct async_log_slot *slot;
+  gsize pos;
+
+  if (!(slot = async_log_reserve (lf, &pos)))
+    return;
+
+  if (!async_log_slot_add_string (slot, &pos, ASYNC_FIELD_MESSAGE, lf->message))
+    slot->long_message = g_strdup (lf->message);
+
+  async_log_publish (slot);
+}
+
+static void
+async_log_slot_write (struct async_log_slot *slot)
+{
+  WpLogFields lf = {0};
+
+  wp_log_fields_init (&lf,
+      async_log_slot_get_string (slot, ASYNC_FIELD_TOPIC),
+      slot->log_level, slot->debug,
+      async_log_slot_get_string (slot, ASYNC_FIELD_FILE),
+      async_log_slot_get_string (slot, ASYNC_FIELD_LINE),
+      async_log_slot_get_string (slot, ASYNC_FIELD_FUNC),
+      slot->object_type, slot->object,
+      slot->long_message ? slot->long_message :
+          async_log_slot_get_string (slot, ASYNC_FIELD_MESSAGE));
+  lf.object_id = slot->object_id;
+  lf.time = slot->time;
+
+  wp_log_fields_write (&lf);
+  g_clear_pointer (&slot->long_message, g_free);
+}
+
+static void
+async_log_report_dropped (guint dropped)
+{
+  WpLogFields lf = {0};
+  g_autofree gchar *message =
+      g_strdup_printf ("%u messages were dropped, the log queue was full",
+          dropped);
+
+  wp_log_fields_init (&lf, WP_LOCAL_LOG_TOPIC->topic_name,
+      level_index_from_flags (G_LOG_LEVEL_WARNING), FALSE,
+      NULL, NULL, NULL, 0, NULL, message);
+  lf.time = g_get_real_time ();
+  wp_log_fields_write (&lf);
+}
+
+/* writes all the published slots; returns FALSE if there were none */
+static gboolean
+async_log_drain (void)
+{
+  gint tail = g_atomic_int_get (&async_log.tail);
+  gboolean written = FALSE;
+  guint dropped;
+
+  for (;;) {
+    struct async_log_slot *slot =
+        &async_log.slots[tail & (ASYNC_LOG_N_SLOTS - 1)];
+
+    if (!g_atomic_int_get (&slot->ready))
+      break;
+
+    async_log_slot_write (slot);
+    g_atomic_int_set (&slot->ready, 0);
+    tail = (gint) ((guint) tail + 1);
+    g_atomic_int_set (&async_log.tail, tail);
+    written = TRUE;
+  }
+
+  /* report after the messages that were queued before the drop */
+  dropped = g_atomic_int_and (&async_log.dropped, 0);
+  if (dropped > 0) {
+    async_log_report_dropped (dropped);
+    written = TRUE;
+  }
+
+  if (written && stderr)
+    fflush (stderr);
+  return written;
+}
+
+static gpointer
+async_log_thread_func (gpointer data)
+{
+  for (;;) {
+    gboolean stopping = g_atomic_int_get (&async_log.stopping);
+
+    if (async_log_drain ())
+      continue;
+
+    g_mutex_lock (&async_log.lock);
+    g_cond_broadcast (&async_log.drained_cond);
+
+    if (stopping) {
+      g_mutex_unlock (&async_log.lock);
+      break;
+    }
+
+    /* check again after announcing that we are going to sleep, so that
+       a producer either sees the flag or its slot is seen here */
+    g_atomic_int_set (&async_log.sleeping, 1);
+    if (!g_atomic_int_get (&async_log.slots[
+            g_atomic_int_get (&async_log.tail) & (ASYNC_LOG_N_SLOTS - 1)].ready) &&
+        !g_atomic_int_get (&async_log.stopping))
+      g_cond_wait_until (&async_log.wake_cond, &async_log.lock,
+          g_get_monotonic_time () + G_TIME_SPAN_SECOND);
+    g_atomic_int_set (&async_log.sleeping, 0);
+    g_mutex_unlock (&async_log.lock);
+  }
+  return NULL;
+}
+
+/* waits until all the messages that have been queued so far are written */
+static void
+async_log_flush (void)
+{
+  guint head = g_atomic_int_get (&async_log.head);
+
+  g_mutex_lock (&async_log.lock);
+  while ((gint) ((guint) g_atomic_int_get (&async_log.tail) - head) < 0) {
+    g_cond_signal (&async_log.wake_cond);
+    g_cond_wait (&async_log.drained_cond, &async_log.lock);
+  }
+  g_mutex_unlock (&async_log.lock);
+}
+
+static void
+async_log_stop (void)
+{
+  log_state.async = FALSE;
+  g_atomic_int_set (&async_log.stopping, 1);
+
+  g_mutex_lock (&async_log.lock);
+  g_cond_signal (&async_log.wake_cond);
+  g_mutex_unlock (&async_log.lock);
+
+  g_thread_join (async_log.thread);
+  async_log.thread = NULL;
+}
+
+static void
+async_log_start (void)
+{
+  async_log.slots = g_new0 (struct async_log_slot, ASYNC_LOG_N_SLOTS);
+  async_log.thread = g_thread_new ("wp-log", async_log_thread_func, NULL);
+  log_state.async = TRUE;
+
+  /* write out whatever is left in the queue when the process exits */
+  atexit (async_log_stop);
+}
+
+/*
+ * Binary trace output
+ *
+ * When WIREPLUMBER_TRACE_FILE is set, trace messages are not formatted;
+ * they are stored as fixed-size records in a ring that lives in a memory
+ * mapped file, which can be printed with wp_log_trace_file_print() (this is
+ * what the wptrace tool does). The file starts with a header, followed by a
+ * table of strings and the ring of records. Only the first process that
+ * locks the file writes to it; other processes that are started with the
+ * same environment, such as wpctl, format their trace messages as usual.
+ * Messages about spa pods are also formatted, as the pod is dumped in full.
+ *
+ * The topic, the location, the object type and the format of the message are
+ * stored in the string table once and records refer to them by their offset
+ * in it; offset 0 is the empty string, which stands for NULL. When the table
+ * is full, new strings are stored as NULL.
+ *
+ * The format arguments are stored in the record, each one as a tag followed
+ * by its value: integers, floating point numbers and pointers as 64-bit
+ * values and strings inline, including their terminating nul byte. When they
+ * do not fit, or when the format contains a conversion that is not supported,
+ * the record is marked as truncated and the rest of the format is printed
+ * verbatim.
+ *
+ * Records are reserved by atomically incrementing the position in the header
+ * and are written in place. The sequence number of a record is cleared while
+ * it is written and is set to its position + 1 when it is complete, so that
+ * records that were not completed (or were overwritten while they were being
+ * read) can be detected.
+ */
+
+#define TRACE_FILE_MAGIC "WPTRACE1"
+#define TRACE_FILE_N_RECORDS (1 << 16) /* must be a power of 2 */
+#define TRACE_FILE_STRINGS_SIZE (1 << 20)
+#define TRACE_RECORD_SIZE 256
+
+struct trace_file_header
+{
+  gchar magic[8];
+  guint32 header_size;
+  guint32 record_size;
+  guint32 n_records;
+  guint32 strings_size;
+  gint strings_used;
+  gint position;
+  gint wrapped;
+  guint32 padding;
+};
+
+struct trace_record
+{
+  gint seq;
+  guint8 log_level;
+  guint8 flags;
+  guint16 payload_size;
+  gint64 time;
+  guint64 object;
+  guint32 object_id;
+  guint32 object_type;
+  guint32 topic;
+  guint32 format;
+  guint32 file;
+  guint32 line;
+  guint32 func;
+  guint8 payload[];
+};
+
+#define TRACE_RECORD_PAYLOAD_SIZE \
+  (TRACE_RECORD_SIZE - sizeof (struct trace_record))
+#define TRACE_RECORD_FLAG_TRUNCATED (1 << 0)
+
+enum {
+  TRACE_ARG_INT = 1,
+  TRACE_ARG_UINT,
+  TRACE_ARG_DOUBLE,
+  TRACE_ARG_POINTER,
+  TRACE_ARG_STRING,
+  TRACE_ARG_NULL_STRING,
+};
+
+G_STATIC_ASSERT (sizeof (struct trace_file_header) == 40);
+
+static struct {
+  struct trace_file_header *header;
+  /* kept open to hold the lock on the file */
+  int fd;
+  gchar *strings;
+  guint8 *records;
+  GHashTable *string_offsets;
+} trace_file;
+
+G_LOCK_DEFINE_STATIC (trace_file_strings);
+
+enum conversion_length {
+  LENGTH_NONE,
+  LENGTH_CHAR,
+  LENGTH_SHORT,
+  LENGTH_LONG,
+  LENGTH_LONG_LONG,
+  LENGTH_LONG_DOUBLE,
+  LENGTH_INTMAX,
+  LENGTH_SIZE,
+  LENGTH_PTRDIFF,
+};
+
+/* a printf conversion specification, from '%' to the conversion character */
+struct conversion
+{
+  const gchar *start;
+  const gchar *flags_end;
+  const gchar *end;
+  gboolean star_width;
+  gboolean star_precision;
+  enum conversion_length length;
+  gchar conv;
+};
+
+static const gchar *
+parse_conversion (const gchar *fmt, struct conversion *c)
+{
+  c->start = fmt++;
+  c->star_width = c->star_precision = FALSE;
+  c->length = LENGTH_NONE;
+
+  while (*fmt && strchr ("-+ #0'", *fmt))
+    fmt++;
+  c->flags_end = fmt;
+
+  if (*fmt == '*') {
+    c->star_width = TRUE;
+    fmt++;
+  } else {
+    while (g_ascii_isdigit (*fmt))
+      fmt++;
+  }
+
+  if (*fmt == '.') {
+    fmt++;
+    if (*fmt == '*') {
+      c->star_precision = TRUE;
+      fmt++;
+    } else {
+      while (g_ascii_isdigit (*fmt))
+        fmt++;
+    }
+  }
+
+  switch (*fmt) {
+    case 'h':
+      c->length = (fmt[1] == 'h') ? LENGTH_CHAR : LENGTH_SHORT;
+      fmt += (fmt[1] == 'h') ? 2 : 1;
+      break;
+    case 'l':
+      c->length = (fmt[1] == 'l') ? LENGTH_LONG_LONG : LENGTH_LONG;
+      fmt += (fmt[1] == 'l') ? 2 : 1;
+      break;
+    case 'q':
+      c->length = LENGTH_LONG_LONG;
+      fmt++;
+      break;
+    case 'L':
+      c->length = LENGTH_LONG_DOUBLE;
+      fmt++;
+      break;
+    case 'j':
+      c->length = LENGTH_INTMAX;
+      fmt++;
+      break;
+    case 'z':
+      c->length = LENGTH_SIZE;
+      fmt++;
+      break;
+    case 't':
+      c->length = LENGTH_PTRDIFF;
+      fmt++;
+      break;
+    default:
+      break;
+  }
+
+  c->conv = *fmt;
+  c->end = *fmt ? fmt + 1 : fmt;
+  return c->end;
+}
+
+static gboolean
+trace_file_open (const gchar *path)
+{
+  gsize size = sizeof (struct trace_file_header) + TRACE_FILE_STRINGS_SIZE +
+      (gsize) TRACE_FILE_N_RECORDS * TRACE_RECORD_SIZE;
+  struct trace_file_header *header;
+  int fd;
+
+  if (trace_file.header)
+    return TRUE;
+
+  /* every process that is started with the same environment tries to open
+     the file, but only the first one writes to it; the file is cleared only
+     after it has been locked, so that the others do not clear it */
+  fd = open (path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    wp_warning ("failed to open trace file %s: %s", path, g_strerror (errno));
+    return FALSE;
+  }
+
+  if (flock (fd, LOCK_EX | LOCK_NB) < 0) {
+    if (errno == EWOULDBLOCK)
+      wp_info ("trace file %s is used by another process", path);
+    else
+      wp_warning ("failed to lock trace file %s: %s", path,
+          g_strerror (errno));
+    close (fd);
+    return FALSE;
+  }
+
+  if (ftruncate (fd, 0) < 0 || ftruncate (fd, size) < 0) {
+    wp_warning ("failed to allocate trace file %s: %s", path,
+        g_strerror (errno));
+    close (fd);
+    return FALSE;
+  }
+
+  header = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (header == MAP_FAILED) {
+    wp_warning ("failed to map trace file %s: %s", path, g_strerror (errno));
+    close (fd);
+    return FALSE;
+  }
+
+  memcpy (header->magic, TRACE_FILE_MAGIC, sizeof (header->magic));
+  header->header_size = sizeof (struct trace_file_header);
+  header->record_size = TRACE_RECORD_SIZE;
+  header->n_records = TRACE_FILE_N_RECORDS;
+  header->strings_size = TRACE_FILE_STRINGS_SIZE;
+  /* offset 0 is the empty string, the table is zero-filled */
+  header->strings_used = 1;
+
+  trace_file.header = header;
+  trace_file.fd = fd;
+  trace_file.strings = (gchar *) header + header->header_size;
+  trace_file.records = (guint8 *) trace_file.strings + header->strings_size;
+  trace_file.string_offsets = g_hash_table_new (g_str_hash, g_str_equal);
+  return TRUE;
+}
+
+/* must be called with the trace_file_strings lock held */
+static guint32
+trace_file_intern (const gchar *str)
+{
+  struct trace_file_header *header = trace_file.header;
+  gpointer offset;
+  gsize len;
+
+  if (!str)
+    return 0;
+
+  if (g_hash_table_lookup_extended (trace_file.string_offsets, str, NULL,
+          &offset))
+    return GPOINTER_TO_UINT (offset);
+
+  len = strlen (str) + 1;
+  if (len > header->strings_size - header->strings_used)
+    return 0;
+
+  offset = GUINT_TO_POINTER (header->strings_used);
+  memcpy (trace_file.strings + header->strings_used, str, len);
+  header->strings_used += len;
+
+  /* the copy in the table is the key; it is never freed */
+  g_hash_table_insert (trace_file.string_offsets,
+      trace_file.strings + GPOINTER_TO_UINT (offset), offset);
+  return GPOINTER_TO_UINT (offset);
+}
+
+static gboolean
+trace_record_add_value (struct trace_record *rec, guint8 tag,
+    gconstpointer value, gsize size)
+{
+  if (rec->payload_size + 1 + size > TRACE_RECORD_PAYLOAD_SIZE)
+    return FALSE;
+
+  rec->payload[rec->payload_size] = tag;
+  if (size > 0)
+    memcpy (rec->payload + rec->payload_size + 1, value, size);
+  rec->payload_size += 1 + size;
+  return TRUE;
+}
+
+static gboolean
+trace_record_add_int (struct trace_record *rec, guint8 tag, guint64 value)
+{
+  return trace_record_add_value (rec, tag, &value, sizeof (value));
+}
+
+/* stores at most max_len bytes of str, or all of it if max_len is -1 */
+static gboolean
+trace_record_add_string (struct trace_record *rec, const gchar *str,
+    gssize max_len)
+{
+  gsize len;
+
+  if (!str)
+    return trace_record_add_value (rec, TRACE_ARG_NULL_STRING, NULL, 0);
+
+  len = (max_len < 0) ? strlen (str) : strnlen (str, max_len);
+  if (rec->payload_size + 2 + len > TRACE_RECORD_PAYLOAD_SIZE)
+    return FALSE;
+
+  rec->payload[rec->payload_size] = TRACE_ARG_STRING;
+  memcpy (rec->payload + rec->payload_size + 1, str, len);
+  rec->payload[rec->payload_size + 1 + len] = '\0';
+  rec->payload_size += 2 + len;
+  return TRUE;
+}
+
+static gboolean
+trace_record_add_args (struct trace_record *rec, const gchar *format,
+    gint saved_errno, va_list args)
+{
+  struct conversion c;
+  const gchar *fmt = format;
+
+  while ((fmt = strchr (fmt, '%'))) {
+    gboolean is_signed = FALSE;
+    gint precision = -1;
+    const gchar *dot;
+    gint64 ivalue;
+
+    fmt = parse_conversion (fmt, &c);
+
+    if (c.star_width &&
+        !trace_record_add_int (rec, TRACE_ARG_INT, va_arg (args, int)))
+      return FALSE;
+    if (c.star_precision) {
+      precision = va_arg (args, int);
+      if (!trace_record_add_int (rec, TRACE_ARG_INT, precision))
+        return FALSE;
+    } else if ((dot = strchr (c.flags_end, '.')) && dot < c.end) {
+      precision = atoi (dot + 1);
+    }
+
+    switch (c.conv) {
+      case '%':
+        break;
+      case 'd': case 'i':
+        is_signed = TRUE;
+        G_GNUC_FALLTHROUGH;
+      case 'o': case 'u': case 'x': case 'X':
+        switch (c.length) {
+          case LENGTH_LONG:
+            ivalue = is_signed ? va_arg (args, long) :
+                (gint64) va_arg (args, unsigned long);
+            break;
+          case LENGTH_LONG_LONG:
+            ivalue = is_signed ? va_arg (args, long long) :
+                (gint64) va_arg (args, unsigned long long);
+            break;
+          case LENGTH_INTMAX:
+            ivalue = is_signed ? va_arg (args, intmax_t) :
+                (gint64) va_arg (args, uintmax_t);
+            break;
+          case LENGTH_SIZE:
+            ivalue = is_signed ? va_arg (args, gssize) :
+                (gint64) va_arg (args, gsize);
+            break;
+          case LENGTH_PTRDIFF:
+            ivalue = va_arg (args, ptrdiff_t);
+            break;
+          case LENGTH_NONE: case LENGTH_CHAR: case LENGTH_SHORT:
+            ivalue = is_signed ? va_arg (args, int) :
+                (gint64) va_arg (args, unsigned int);
+            break;
+          default:
+            return FALSE;
+        }
+        if (!trace_record_add_int (rec,
+                is_signed ? TRACE_ARG_INT : TRACE_ARG_UINT, ivalue))
+          return FALSE;
+        break;
+      case 'c':
+        if (c.length != LENGTH_NONE ||
+            !trace_record_add_int (rec, TRACE_ARG_INT, va_arg (args, int)))
+          return FALSE;
+        break;
+      case 'e': case 'E': case 'f': case 'F':
+      case 'g': case 'G': case 'a': case 'A': {
+        gdouble dvalue = (c.length == LENGTH_LONG_DOUBLE) ?
+            (gdouble) va_arg (args, long double) : va_arg (args, gdouble);
+        if (!trace_record_add_value (rec, TRACE_ARG_DOUBLE, &dvalue,
+                sizeof (dvalue)))
+          return FALSE;
+        break;
+      }
+      case 'p':
+        if (!trace_record_add_int (rec, TRACE_ARG_POINTER,
+                (guintptr) va_arg (args, gpointer)))
+          return FALSE;
+        break;
+      case 's':
+        /* with a precision, the string does not need to be terminated */
+        if (c.length != LENGTH_NONE ||
+            !trace_record_add_string (rec, va_arg (args, const gchar *),
+                precision))
+          return FALSE;
+        break;
+      case 'm':
+        if (!trace_record_add_string (rec, g_strerror (saved_errno), -1))
+          return FALSE;
+        break;
+      default:
+        return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+static G_GNUC_PRINTF (2, 0) void
+trace_file_write (WpLogFields *lf, const gchar *format, va_list args)
+{
+  struct trace_file_header *header = trace_file.header;
+  struct trace_record *rec;
+  gint saved_errno = errno;
+  va_list args_copy;
+  guint pos;
+
+  pos = (guint) g_atomic_int_add (&header->position, 1);
+  if (pos + 1 >= header->n_records)
+    g_atomic_int_set (&header->wrapped, 1);
+
+  rec = (struct trace_record *)
+      (trace_file.records + (gsize) (pos & (header->n_records - 1)) *
+          header->record_size);
+  g_atomic_int_set (&rec->seq, 0);
+  /* the record must not be seen as complete while it is being changed */
+  __atomic_thread_fence (__ATOMIC_RELEASE);
+
+  rec->log_level = lf->log_level;
+  rec->flags = 0;
+  rec->payload_size = 0;
+  rec->time = g_get_real_time ();
+  rec->object = (guintptr) lf->object;
+  rec->object_id = lf->object_id;
+
+  G_LOCK (trace_file_strings);
+  rec->object_type = lf->object_type ?
+      trace_file_intern (g_type_name (lf->object_type)) : 0;
+  rec->topic = trace_file_intern (lf->log_topic);
+  rec->format = trace_file_intern (format);
+  rec->file = trace_file_intern (lf->file);
+  rec->line = trace_file_intern (lf->line);
+  rec->func = trace_file_intern (lf->func);
+  G_UNLOCK (trace_file_strings);
+
+  va_copy (args_copy, args);
+  if (!trace_record_add_args (rec, format, saved_errno, args_copy))
+    rec->flags |= TRACE_RECORD_FLAG_TRUNCATED;
+  va_end (args_copy);
+
+  g_atomic_int_set (&rec->seq, (gint) (pos + 1));
+}
+
+/* reads the value of the next argument; returns NULL if its tag is not
+   the expected one or if it is truncated */
+static const guint8 *
+trace_record_read_value (const guint8 *p, const guint8 *end, guint8 tag,
+    gpointer value, gsize size)
+{
+  if (p >= end || *p != tag || (gsize) (end - p - 1) < size)
+    return NULL;
+  memcpy (value, p + 1, size);
+  return p + 1 + size;
+}
+
+static const guint8 *
+trace_record_read_int (const guint8 *p, const guint8 *end, gint64 *value)
+{
+  if (p < end && *p == TRACE_ARG_UINT)
+    return trace_record_read_value (p, end, TRACE_ARG_UINT, value,
+        sizeof (*value));
+  return trace_record_read_value (p, end, TRACE_ARG_INT, value,
+      sizeof (*value));
+}
+
+static const guint8 *
+trace_record_read_string (const guint8 *p, const guint8 *end,
+    const gchar **value)
+{
+  const guint8 *nul;
+
+  if (p < end && *p == TRACE_ARG_NULL_STRING) {
+    *value = NULL;
+    return p + 1;
+  }
+  if (p >= end || *p != TRACE_ARG_STRING ||
+      !(nul = memchr (p + 1, '\0', end - p - 1)))
+    return NULL;
+  *value = (const gchar *) p + 1;
+  return nul + 1;
+}
+
+/* formats the message of a record with the arguments stored in it */
+static gchar *
+trace_record_format_message (const struct trace_record *rec,
+    const gchar *format)
+{
+  GString *str = g_string_new (NULL);
+  const guint8 *p = rec->payload;
+  const guint8 *end = rec->payload + rec->payload_size;
+  const gchar *fmt = format;
+  const gchar *percent;
+  struct conversion c;
+
+  while ((percent = strchr (fmt, '%'))) {
+    g_autoptr (GString) spec = NULL;
+    const gchar *precision;
+    gint64 width = 0, prec = 0;
+
+    g_string_append_len (str, fmt, percent - fmt);
+    fmt = parse_conversion (percent, &c);
+
+    if (c.conv == '%') {
+      g_string_append_c (str, '%');
+      continue;
+    }
+
+    if ((c.star_width && !(p = trace_record_read_int (p, end, &width))) ||
+        (c.star_precision && !(p = trace_record_read_int (p, end, &prec)))) {
+      fmt = c.start;
+      break;
+    }
+
+    /* rebuild the conversion with the widths resolved and the length
+       modifier that matches the stored value */
+    spec = g_string_new_len (c.start, c.flags_end - c.start);
+    if (c.star_width)
+      g_string_append_printf (spec, "%d", (gint) width);
+    else
+      for (const gchar *s = c.flags_end; g_ascii_isdigit (*s); s++)
+        g_string_append_c (spec, *s);
+
+    precision = strchr (c.flags_end, '.');
+    if (precision && precision < c.end) {
+      if (c.star_precision)
+        g_string_append_printf (spec, ".%d", (gint) prec);
+      else {
+        g_string_append_c (spec, '.');
+        for (const gchar *s = precision + 1; g_ascii_isdigit (*s); s++)
+          g_string_append_c (spec, *s);
+      }
+    }
+
+    switch (c.conv) {
+      case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': {
+        gint64 value;
+        if (!(p = trace_record_read_int (p, end, &value)))
+          break;
+        g_string_append (spec, G_GINT64_MODIFIER);
+        g_string_append_c (spec, c.conv);
+        g_string_append_printf (str, spec->str, value);
+        break;
+      }
+      case 'c': {
+        gint64 value;
+        if (!(p = trace_record_read_int (p, end, &value)))
+          break;
+        g_string_append_c (spec, 'c');
+        g_string_append_printf (str, spec->str, (gint) value);
+        break;
+      }
+      case 'e': case 'E': case 'f': case 'F':
+      case 'g': case 'G': case 'a': case 'A': {
+        gdouble value;
+        if (!(p = trace_record_read_value (p, end, TRACE_ARG_DOUBLE, &value,
+                sizeof (value))))
+          break;
+        g_string_append_c (spec, c.conv);
+        g_string_append_printf (str, spec->str, value);
+        break;
+      }
+      case 'p': {
+        guint64 value;
+        if (!(p = trace_record_read_value (p, end, TRACE_ARG_POINTER, &value,
+                sizeof (value))))
+          break;
+        g_string_append_printf (str, "%p", (gpointer) (guintptr) value);
+        break;
+      }
+      case 's': case 'm': {
+        const gchar *value;
+        if (!(p = trace_record_read_string (p, end, &value)))
+          break;
+        g_string_append_c (spec, 's');
+        g_string_append_printf (str, spec->str, value ? value : "(null)");
+        break;
+      }
+      default:
+        p = NULL;
+        break;
+    }
+
+    if (!p) {
+      fmt = c.start;
+      break;
+    }
+  }
+
+  /* whatever could not be formatted is printed verbatim */
+  if (percent && !p)
+    g_string_append_printf (str, "%s [...]", fmt);
+  else
+    g_string_append (str, fmt);
+
+  return g_string_free (str, FALSE);
+}
+
+static const gchar *
+trace_file_get_string (const gchar *strings, guint32 strings_used,
+    guint32 offset)
+{
+  if (offset == 0 || offset >= strings_used ||
+      !memchr (strings + offset, '\0', strings_used - offset))
+    return NULL;
+  return strings + offset;
+}
+
+static void
+trace_record_print (const struct trace_record *rec, const gchar *strings,
+    guint32 strings_used, FILE *stream)
+{
+  WpLogFields lf = {0};
+  g_autofree gchar *message = NULL;
+  g_autofree gchar *full_message = NULL;
+  const gchar *format, *object_type;
+  gint log_level = rec->log_level;
+
+  if (log_level >= (gint) G_N_ELEMENTS (log_level_info))
+    log_level = 0;
+
+  format = trace_file_get_string (strings, strings_used, rec->format);
+  message = format ? trace_record_format_message (rec, format) : NULL;
+
+  /* same as wp_log_fields_format_message(), without colors */
+  object_type = trace_file_get_string (strings, strings_used,
+      rec->object_type);
+  if (object_type) {
+    g_autofree gchar *extra_object = (rec->object_id != SPA_ID_INVALID) ?
+        g_strdup_printf (":%u:", rec->object_id) : NULL;
+    message = full_message = g_strdup_printf ("<%s%s%p> %s",
+        object_type, extra_object ? extra_object : ":",
+        (gpointer) (guintptr) rec->object, message ? message : "(null)");
+  }
+
+  wp_log_fields_init (&lf,
+      trace_file_get_string (strings, strings_used, rec->topic),
+      log_level, TRUE,
+      trace_file_get_string (strings, strings_used, rec->file),
+      trace_file_get_string (strings, strings_used, rec->line),
+      trace_file_get_string (strings, strings_used, rec->func),
+      0, NULL, message);
+  lf.time = rec->time;
+  wp_log_fields_write_to_stream (&lf, stream);
+}
+
+/*!
+ * \brief Prints the messages that are stored in a binary trace file
+ *
+ * When the WIREPLUMBER_TRACE_FILE environment variable is set to the path
+ * of a file, trace messages are stored in that file in a binary form instead
+ * of being written to the log output. This prints them in \a stream, in the
+ * same format as the log output, from the oldest to the newest.
+ *
+ * The file can be printed while it is still being written. It must have been
+ * written on a machine of the same architecture.
+ *
+ * \ingroup wplog
+ * \param filename the path of the trace file
+ * \param stream the stream to print to
+ * \param error (out) (optional): the error that occurred, if any
+ * \returns TRUE on success, FALSE if the file could not be read
+ */
+gboolean
+wp_log_trace_file_print (const gchar *filename, FILE *stream, GError **error)
+{
+  g_autoptr (GMappedFile) file = NULL;
+  const struct trace_file_header *header;
+  const gchar *data, *strings;
+  const guint8 *records;
+  guint32 strings_used;
+  guint position, start;
+  gsize size;
+  union {
+    struct trace_record rec;
+    guint8 data[TRACE_RECORD_SIZE];
+  } buf;
+
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (stream != NULL, FALSE);
+
+  if (!(file = g_mapped_file_new (filename, FALSE, error)))
+    return FALSE;
+
+  data = g_mapped_file_get_contents (file);
+  size = g_mapped_file_get_length (file);
+  header = (const struct trace_file_header *) data;
+
+  if (size < sizeof (*header) ||
+      memcmp (header->magic, TRACE_FILE_MAGIC, sizeof (header->magic)) != 0 ||
+      header->header_size != sizeof (*header) ||
+      header->record_size != TRACE_RECORD_SIZE ||
+      header->n_records == 0 ||
+      (header->n_records & (header->n_records - 1)) != 0 ||
+      size < (gsize) header->header_size + header->strings_size +
+          (gsize) header->n_records * header->record_size) {
+    g_set_error (error, WP_DOMAIN_LIBRARY, WP_LIBRARY_ERROR_INVALID_ARGUMENT,
+        "'%s' is not a trace file", filename);
+    return FALSE;
+  }
+
+  strings = data + header->header_size;
+  records = (const guint8 *) strings + header->strings_size;
+  strings_used = MIN ((guint32) header->strings_used, header->strings_size);
+  position = (guint) header->position;
+  start = header->wrapped ? position - header->n_records : 0;
+
+  for (guint i = start; i != position; i++) {
+    const struct trace_record *rec = (const struct trace_record *)
+        (records + (gsize) (i & (header->n_records - 1)) * TRACE_RECORD_SIZE);
+
+    /* copy the record and skip it if it was modified in the meantime;
+       the copy must be complete before the sequence number is read again */
+    if ((guint) g_atomic_int_get (&rec->seq) != i + 1)
+      continue;
+    memcpy (&buf, rec, TRACE_RECORD_SIZE);
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+    if ((guint) g_atomic_int_get (&rec->seq) != i + 1 ||
+        buf.rec.payload_size > TRACE_RECORD_PAYLOAD_SIZE)
+      continue;
+
+    trace_record_print (&buf.rec, strings, strings_used, stream);
+  }
+
+  fflush (stream);
+  return TRUE;
+}
+
+/* formats and writes a message, or queues it when logging asynchronously */
+static G_GNUC_PRINTF (2, 0) void
+wp_log_fields_logv (WpLogFields *lf, const gchar *format, va_list args)
+{
+  g_autofree gchar *message = NULL;
+
+  /* spa pods are dumped in full, which the trace file cannot store */
+  if (trace_file.header && lf->object_type != WP_TYPE_SPA_POD &&
+      lf->log_level == level_index_from_flags (WP_LOG_LEVEL_TRACE)) {
+    wp_log_fields_resolve_object (lf);
+    trace_file_write (lf, format, args);
+    return;
+  }
+
+  if (log_state.async) {
+    wp_log_fields_resolve_object (lf);
+
+    /* spa pods are dumped while they are known to be alive */
+    if (lf->object_type != WP_TYPE_SPA_POD &&
+        lf->log_level > level_index_from_flags (G_LOG_LEVEL_ERROR)) {
+      async_log_pushv (lf, format, args);
+      return;
+    }
+
+    /* keep the order of messages */
+    async_log_flush ();
+  }
+
+  lf->message = message = g_strdup_vprintf (format, args);
+  wp_log_fields_log (lf);
+}
+
 /*!
  * \brief WirePlumber's GLogWriterFunc
  *
@@ -884,12 +2033,26 @@ wp_log_writer_default (GLogLevelFlags log_level_flags,
   g_return_val_if_fail (fields != NULL, G_LOG_WRITER_UNHANDLED);
   g_return_val_if_fail (n_fields > 0, G_LOG_WRITER_UNHANDLED);
 
+  /* no topic has this level enabled, skip matching the topic */
+  if (level_index_from_flags (log_level_flags) > log_state.max_log_level)
+    return G_LOG_WRITER_HANDLED;
+
   wp_log_fields_init_from_glib (&lf, log_level_flags, fields, n_fields);
 
   /* check if debug level & topic is enabled */
   if (lf.log_level > find_topic_log_level (lf.log_topic, NULL))
     return G_LOG_WRITER_HANDLED;
 
+  /* fatal messages abort right after being written, so they cannot wait
+     in the queue; this includes warnings made fatal by GLib */
+  if (log_state.async && !(log_level_flags & G_LOG_FLAG_FATAL) &&
+      lf.log_level > level_index_from_flags (G_LOG_LEVEL_ERROR)) {
+    async_log_push (&lf);
+    return G_LOG_WRITER_HANDLED;
+  }
+  if (log_state.async)
+    async_log_flush ();
+
   return wp_log_fields_log (&lf);
 }
 
@@ -915,17 +2078,15 @@ wp_log_checked (
     ...)
 {
   WpLogFields lf = {0};
-  g_autofree gchar *message = NULL;
   va_list args;
 
-  va_start (args, message_format);
-  message = g_strdup_vprintf (message_format, args);
-  va_end (args);
-
   wp_log_fields_init (&lf, log_topic, level_index_from_flags (log_level_flags),
       wp_want_debug_log (NULL),
-      file, line, func, object_type, object, message);
-  wp_log_fields_log (&lf);
+      file, line, func, object_type, object, NULL);
+
+  va_start (args, message_format);
+  wp_log_fields_logv (&lf, message_format, args);
+  va_end (args);
 }
 
 /*!
@@ -948,7 +2109,6 @@ wp_logt_checked (
     ...)
 {
   WpLogFields lf = {0};
-  g_autofree gchar *message = NULL;
   va_list args;
   const gchar *log_topic = topic ? topic->topic_name : NULL;
   gboolean debug;
@@ -958,13 +2118,12 @@ wp_logt_checked (
   else
     debug = wp_want_debug_log (NULL);
 
+  wp_log_fields_init (&lf, log_topic, level_index_from_flags (log_level_flags), debug,
+      file, line, func, object_type, object, NULL);
+
   va_start (args, message_format);
-  message = g_strdup_vprintf (message_format, args);
+  wp_log_fields_logv (&lf, message_format, args);
   va_end (args);
-
-  wp_log_fields_init (&lf, log_topic, level_index_from_flags (log_level_flags), debug,
-      file, line, func, object_type, object, message);
-  wp_log_fields_log (&lf);
 }
 
 static G_GNUC_PRINTF (7, 0) void
@@ -979,16 +2138,14 @@ wp_spa_log_logtv (void *object,
 {
   WpLogFields lf = {0};
   gint log_level = level_index_from_spa (level, FALSE);
-  g_autofree gchar *message = NULL;
   gchar line_str[11];
 
   sprintf (line_str, "%d", line);
-  message = g_strdup_vprintf (fmt, args);
 
   wp_log_fields_init (&lf, topic ? topic->topic : NULL, log_level,
       wp_want_debug_log (topic),
-      file, line_str, func, 0, NULL, message);
-  wp_log_fields_log (&lf);
+      file, line_str, func, 0, NULL, NULL);
+  wp_log_fields_logv (&lf, fmt, args);
 }
 
 static G_GNUC_PRINTF (7, 8) void
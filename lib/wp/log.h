@@ -10,6 +10,7 @@
 #define __WIREPLUMBER_LOG_H__
 
 #include <glib-object.h>
+#include <stdio.h>
 #include "defs.h"
 
 G_BEGIN_DECLS
@@ -177,6 +178,10 @@ void wp_logt_checked (const WpLogTopic *topic, GLogLevelFlags log_level,
 #define wp_trace_boxed(type, object, ...) \
     wp_log (WP_LOCAL_LOG_TOPIC, WP_LOG_LEVEL_TRACE, type, object, __VA_ARGS__)
 
+WP_API
+gboolean wp_log_trace_file_print (const gchar *filename, FILE *stream,
+    GError **error);
+
 struct spa_log;
 
 WP_API
@@ -61,74 +61,203 @@ static guint32 signals[N_SIGNALS] = {0};
 
 /* data structure */
 
+/* Items are kept in a list in insertion order, which is the iteration order,
+   and in a list per subject, in the same order. The live items are also
+   indexed by (subject, key). While iterators exist, removed items are only
+   marked as such and stay linked, so that iterators can step over them;
+   they are freed when the last iterator goes away */
 struct item
 {
+  struct spa_list link;
+  struct spa_list subject_link;
   uint32_t subject;
+  gboolean removed;
   gchar *key;
   gchar *type;
   gchar *value;
 };
 
+struct store
+{
+  struct spa_list items;
+  GHashTable *index;
+  GHashTable *subjects;
+  guint n_iterators;
+  guint n_removed;
+};
+
+static guint
+item_hash (gconstpointer p)
+{
+  const struct item *item = p;
+  return g_str_hash (item->key) ^ (item->subject * 2654435761u);
+}
+
+static gboolean
+item_equal (gconstpointer a, gconstpointer b)
+{
+  const struct item *ia = a, *ib = b;
+  return ia->subject == ib->subject && g_str_equal (ia->key, ib->key);
+}
+
 static void
-set_item (struct item * item, uint32_t subject, const char * key,
-    const char * type, const char * value)
+set_item (struct item * item, const char * type, const char * value)
 {
-  item->subject = subject;
-  item->key = g_strdup (key);
+  g_free (item->type);
+  g_free (item->value);
   item->type = g_strdup (type);
   item->value = g_strdup (value);
 }
 
 static void
-clear_item (struct item * item)
+store_init (struct store * store)
+{
+  spa_list_init (&store->items);
+  store->index = g_hash_table_new (item_hash, item_equal);
+  store->subjects = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, g_free);
+  store->n_iterators = 0;
+  store->n_removed = 0;
+}
+
+static struct spa_list *
+store_get_subject (struct store * store, uint32_t subject)
+{
+  return g_hash_table_lookup (store->subjects, GUINT_TO_POINTER (subject));
+}
+
+static struct item *
+store_find (struct store * store, uint32_t subject, const char * key)
+{
+  struct item lookup = { .subject = subject, .key = (gchar *) key };
+  return g_hash_table_lookup (store->index, &lookup);
+}
+
+static struct item *
+store_add (struct store * store, uint32_t subject, const char * key)
+{
+  struct spa_list *subject_items = store_get_subject (store, subject);
+  struct item *item = g_new0 (struct item, 1);
+
+  if (!subject_items) {
+    subject_items = g_new (struct spa_list, 1);
+    spa_list_init (subject_items);
+    g_hash_table_insert (store->subjects, GUINT_TO_POINTER (subject),
+        subject_items);
+  }
+
+  item->subject = subject;
+  item->key = g_strdup (key);
+  spa_list_append (&store->items, &item->link);
+  spa_list_append (subject_items, &item->subject_link);
+  g_hash_table_add (store->index, item);
+  return item;
+}
+
+/* does not free the subject list, even if it becomes empty */
+static void
+store_unlink (struct store * store, struct item * item)
 {
+  spa_list_remove (&item->link);
+  spa_list_remove (&item->subject_link);
   g_free (item->key);
   g_free (item->type);
   g_free (item->value);
-  spa_zero (*item);
+  g_free (item);
 }
 
-static struct item *
-find_item (struct pw_array * metadata, uint32_t subject, const char * key)
+static gboolean
+subject_is_empty (gpointer key, gpointer value, gpointer data)
 {
-  struct item *item;
+  return spa_list_is_empty ((struct spa_list *) value);
+}
 
-  pw_array_for_each (item, metadata) {
-    if (item->subject == subject && (key == NULL || !strcmp (item->key, key))) {
-      return item;
-    }
+static void
+store_prune_subject (struct store * store, uint32_t subject)
+{
+  struct spa_list *subject_items = store_get_subject (store, subject);
+  if (subject_items && spa_list_is_empty (subject_items))
+    g_hash_table_remove (store->subjects, GUINT_TO_POINTER (subject));
+}
+
+static void
+store_remove (struct store * store, struct item * item)
+{
+  g_hash_table_remove (store->index, item);
+
+  if (store->n_iterators > 0) {
+    item->removed = TRUE;
+    store->n_removed++;
+  } else {
+    store_unlink (store, item);
   }
-  return NULL;
 }
 
-static int
-clear_subject (struct pw_array * metadata, uint32_t subject)
+static guint
+store_clear_subject (struct store * store, uint32_t subject)
 {
-  struct item *item;
-  uint32_t removed = 0;
-
-  while (true) {
-    item = find_item (metadata, subject, NULL);
-    if (item == NULL)
-      break;
-    clear_item (item);
-    pw_array_remove (metadata, item);
-    removed++;
+  struct spa_list *subject_items = store_get_subject (store, subject);
+  struct item *item, *tmp;
+  guint removed = 0;
+
+  if (!subject_items)
+    return 0;
+
+  spa_list_for_each_safe (item, tmp, subject_items, subject_link) {
+    if (!item->removed) {
+      store_remove (store, item);
+      removed++;
+    }
   }
 
+  if (store->n_iterators == 0)
+    store_prune_subject (store, subject);
   return removed;
 }
 
 static void
-clear_items (struct pw_array * metadata)
+store_clear (struct store * store)
 {
-  struct item *item;
+  struct item *item, *tmp;
+
+  g_hash_table_remove_all (store->index);
+
+  spa_list_for_each_safe (item, tmp, &store->items, link) {
+    if (store->n_iterators == 0) {
+      store_unlink (store, item);
+    } else if (!item->removed) {
+      item->removed = TRUE;
+      store->n_removed++;
+    }
+  }
+
+  if (store->n_iterators == 0)
+    g_hash_table_remove_all (store->subjects);
+}
+
+/* frees the items that were removed while iterating */
+static void
+store_sweep (struct store * store)
+{
+  struct item *item, *tmp;
+
+  if (store->n_removed == 0)
+    return;
 
-  pw_array_consume (item, metadata) {
-    clear_item (item);
-    pw_array_remove (metadata, item);
+  spa_list_for_each_safe (item, tmp, &store->items, link) {
+    if (item->removed)
+      store_unlink (store, item);
   }
-  pw_array_reset (metadata);
+  g_hash_table_foreach_remove (store->subjects, subject_is_empty, NULL);
+  store->n_removed = 0;
+}
+
+static void
+store_finalize (struct store * store)
+{
+  store_clear (store);
+  g_clear_pointer (&store->index, g_hash_table_unref);
+  g_clear_pointer (&store->subjects, g_hash_table_unref);
 }
 
 typedef struct _WpMetadataPrivate WpMetadataPrivate;
@@ -136,7 +265,7 @@ struct _WpMetadataPrivate
 {
   struct pw_metadata *iface;
   struct spa_hook listener;
-  struct pw_array metadata;
+  struct store store;
   gboolean remove_listener;
 };
 
@@ -146,7 +275,7 @@ static void
 wp_metadata_init (WpMetadata * self)
 {
   WpMetadataPrivate *priv = wp_metadata_get_instance_private (self);
-  pw_array_init (&priv->metadata, 4096);
+  store_init (&priv->store);
 }
 
 static void
@@ -155,7 +284,7 @@ wp_metadata_finalize (GObject * object)
   WpMetadataPrivate *priv =
       wp_metadata_get_instance_private (WP_METADATA (object));
 
-  pw_array_clear (&priv->metadata);
+  store_finalize (&priv->store);
 
   G_OBJECT_CLASS (wp_metadata_parent_class)->finalize (object);
 }
@@ -213,7 +342,7 @@ metadata_event_property (void *object, uint32_t subject, const char *key,
   struct item *item = NULL;
 
   if (key == NULL) {
-    if (clear_subject (&priv->metadata, subject) > 0) {
+    if (store_clear_subject (&priv->store, subject) > 0) {
       wp_debug_object (self, "remove id:%d", subject);
       g_signal_emit (self, signals[SIGNAL_CHANGED], 0, subject, NULL, NULL,
           NULL);
@@ -221,26 +350,24 @@ metadata_event_property (void *object, uint32_t subject, const char *key,
     return 0;
   }
 
-  item = find_item (&priv->metadata, subject, key);
+  item = store_find (&priv->store, subject, key);
   if (item == NULL) {
     if (value == NULL)
       return 0;
-    item = pw_array_add (&priv->metadata, sizeof (*item));
-    if (item == NULL)
-      return -errno;
-  } else {
-    clear_item (item);
+    item = store_add (&priv->store, subject, key);
   }
 
   if (value != NULL) {
     if (type == NULL)
       type = "string";
-    set_item (item, subject, key, type, value);
+    set_item (item, type, value);
     wp_debug_object (self, "add id:%d key:%s type:%s value:%s",
         subject, key, type, value);
   } else {
     type = NULL;
-    pw_array_remove (&priv->metadata, item);
+    store_remove (&priv->store, item);
+    if (priv->store.n_iterators == 0)
+      store_prune_subject (&priv->store, subject);
     wp_debug_object (self, "remove id:%d key:%s", subject, key);
   }
 
@@ -290,7 +417,7 @@ wp_metadata_pw_proxy_destroyed (WpProxy * proxy)
     spa_hook_remove (&priv->listener);
     priv->remove_listener = FALSE;
   }
-  clear_items (&priv->metadata);
+  store_clear (&priv->store);
   wp_object_update_features (WP_OBJECT (self), 0, WP_METADATA_FEATURE_DATA);
 
   WP_PROXY_CLASS (wp_metadata_parent_class)->pw_proxy_destroyed (proxy);
@@ -445,10 +572,34 @@ wp_metadata_item_get_value (WpMetadataItem * self)
 struct metadata_iterator_data
 {
   WpMetadata *metadata;
-  const struct item *item;
+  struct spa_list *head;
+  struct spa_list *pos;
   guint32 subject;
 };
 
+static inline struct item *
+metadata_iterator_get_item (struct metadata_iterator_data *it_data,
+    struct spa_list *pos)
+{
+  return (it_data->subject == PW_ID_ANY) ?
+      SPA_CONTAINER_OF (pos, struct item, link) :
+      SPA_CONTAINER_OF (pos, struct item, subject_link);
+}
+
+static WpMetadataItem *
+metadata_iterator_next_item (struct metadata_iterator_data *it_data,
+    struct spa_list **pos)
+{
+  while (*pos && *pos != it_data->head) {
+    struct item *i = metadata_iterator_get_item (it_data, *pos);
+    *pos = (*pos)->next;
+    if (!i->removed)
+      return wp_metadata_item_new (it_data->metadata, i->subject, i->key,
+          i->type, i->value);
+  }
+  return NULL;
+}
+
 static void
 metadata_iterator_reset (WpIterator *it)
 {
@@ -456,28 +607,26 @@ metadata_iterator_reset (WpIterator *it)
   WpMetadataPrivate *priv =
       wp_metadata_get_instance_private (it_data->metadata);
 
-  it_data->item = pw_array_first (&priv->metadata);
+  /* the subject list may have been created after the last reset;
+     lists are never freed while there are iterators */
+  if (it_data->subject == PW_ID_ANY)
+    it_data->head = &priv->store.items;
+  else
+    it_data->head = store_get_subject (&priv->store, it_data->subject);
+
+  it_data->pos = it_data->head ? it_data->head->next : NULL;
 }
 
 static gboolean
 metadata_iterator_next (WpIterator *it, GValue *item)
 {
   struct metadata_iterator_data *it_data = wp_iterator_get_user_data (it);
-  WpMetadataPrivate *priv =
-      wp_metadata_get_instance_private (it_data->metadata);
+  WpMetadataItem *mi = metadata_iterator_next_item (it_data, &it_data->pos);
 
-  while (pw_array_check (&priv->metadata, it_data->item)) {
-    if ((it_data->subject == PW_ID_ANY ||
-            it_data->subject == it_data->item->subject)) {
-      g_autoptr (WpMetadataItem) mi = wp_metadata_item_new (it_data->metadata,
-          it_data->item->subject, it_data->item->key, it_data->item->type,
-          it_data->item->value);
-      g_value_init (item, WP_TYPE_METADATA_ITEM);
-      g_value_take_boxed (item, g_steal_pointer (&mi));
-      it_data->item++;
-      return TRUE;
-    }
-    it_data->item++;
+  if (mi) {
+    g_value_init (item, WP_TYPE_METADATA_ITEM);
+    g_value_take_boxed (item, mi);
+    return TRUE;
   }
   return FALSE;
 }
@@ -487,22 +636,15 @@ metadata_iterator_fold (WpIterator *it, WpIteratorFoldFunc func, GValue *ret,
     gpointer data)
 {
   struct metadata_iterator_data *it_data = wp_iterator_get_user_data (it);
-  WpMetadataPrivate *priv =
-      wp_metadata_get_instance_private (it_data->metadata);
-  const struct item *i;
-
-  pw_array_for_each (i, &priv->metadata) {
-    if ((it_data->subject == PW_ID_ANY ||
-            it_data->subject == it_data->item->subject)) {
-      g_auto (GValue) item = G_VALUE_INIT;
-      g_autoptr (WpMetadataItem) mi = wp_metadata_item_new (it_data->metadata,
-          it_data->item->subject, it_data->item->key, it_data->item->type,
-          it_data->item->value);
-      g_value_init (&item, WP_TYPE_METADATA_ITEM);
-      g_value_take_boxed (&item, g_steal_pointer (&mi));
-      if (!func (&item, ret, data))
-        return FALSE;
-    }
+  struct spa_list *pos = it_data->head ? it_data->head->next : NULL;
+  WpMetadataItem *mi;
+
+  while ((mi = metadata_iterator_next_item (it_data, &pos))) {
+    g_auto (GValue) item = G_VALUE_INIT;
+    g_value_init (&item, WP_TYPE_METADATA_ITEM);
+    g_value_take_boxed (&item, mi);
+    if (!func (&item, ret, data))
+      return FALSE;
   }
   return TRUE;
 }
@@ -511,6 +653,11 @@ static void
 metadata_iterator_finalize (WpIterator *it)
 {
   struct metadata_iterator_data *it_data = wp_iterator_get_user_data (it);
+  WpMetadataPrivate *priv =
+      wp_metadata_get_instance_private (it_data->metadata);
+
+  if (--priv->store.n_iterators == 0)
+    store_sweep (&priv->store);
   g_object_unref (it_data->metadata);
 }
 
@@ -552,8 +699,9 @@ wp_metadata_new_iterator (WpMetadata * self, guint32 subject)
       sizeof (struct metadata_iterator_data));
   it_data = wp_iterator_get_user_data (it);
   it_data->metadata = g_object_ref (self);
-  it_data->item = pw_array_first (&priv->metadata);
   it_data->subject = subject;
+  priv->store.n_iterators++;
+  metadata_iterator_reset (it);
   return g_steal_pointer (&it);
 }
 
@@ -571,22 +719,22 @@ const gchar *
 wp_metadata_find (WpMetadata * self, guint32 subject, const gchar * key,
   const gchar ** type)
 {
-  g_autoptr (WpIterator) it = NULL;
-  g_auto (GValue) val = G_VALUE_INIT;
-  it = wp_metadata_new_iterator (self, subject);
-  for (; wp_iterator_next (it, &val); g_value_unset (&val)) {
-    WpMetadataItem *mi = g_value_get_boxed (&val);
-    const gchar *k = wp_metadata_item_get_key (mi);
-    const gchar *t = wp_metadata_item_get_value_type (mi);
-    const gchar *v = wp_metadata_item_get_value (mi);
-    if (g_strcmp0 (k, key) == 0) {
-      if (type)
-        *type = t;
-      g_value_unset (&val);
-      return v;
-    }
-  }
-  return NULL;
+  WpMetadataPrivate *priv;
+  struct item *item;
+
+  g_return_val_if_fail (WP_IS_METADATA (self), NULL);
+
+  if (!key)
+    return NULL;
+
+  priv = wp_metadata_get_instance_private (self);
+  item = store_find (&priv->store, subject, key);
+  if (!item)
+    return NULL;
+
+  if (type)
+    *type = item->type;
+  return item->value;
 }
 
 /*!
@@ -31,13 +31,35 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("wp-object-interest")
  * are satisfied.
  */
 
+/* a constraint value, decoded according to the constraint's subject_type;
+   'i' and 'u' are stored widened in the 'x' and 't' members respectively */
+typedef union _ConstraintValue ConstraintValue;
+union _ConstraintValue
+{
+  gboolean b;
+  gint64 x;
+  guint64 t;
+  gdouble d;
+  const gchar *s;
+};
+
 struct constraint
 {
   WpConstraintType type;
   WpConstraintVerb verb;
   gchar subject_type; /* a basic GVariantType as a single char */
   gchar *subject;
+  GQuark subject_atom; /* for PW_PROPERTY and PW_GLOBAL_PROPERTY */
   GVariant *value;
+
+  /* the compiled form of value, filled in by _validate() */
+  union {
+    ConstraintValue equals; /* EQUALS, NOT_EQUALS */
+    ConstraintValue range[2]; /* IN_RANGE: min, max */
+    GPatternSpec *pattern; /* MATCHES */
+    GHashTable *str_set; /* IN_LIST of strings */
+    GArray *list; /* IN_LIST of numbers, as ConstraintValue */
+  } compiled;
 };
 
 struct _WpObjectInterest
@@ -239,7 +261,10 @@ wp_object_interest_add_constraint (WpObjectInterest * self,
   /* subject_type is filled in by _validate() */
   c->subject_type = '\0';
   c->subject = g_strdup (subject);
+  c->subject_atom = (subject && type != WP_CONSTRAINT_TYPE_G_PROPERTY) ?
+      g_quark_from_string (subject) : 0;
   c->value = value ? g_variant_ref_sink (value) : NULL;
+  memset (&c->compiled, 0, sizeof (c->compiled));
 
   /* mark as invalid to force validation */
   self->valid = FALSE;
@@ -258,6 +283,19 @@ wp_object_interest_ref (WpObjectInterest *self)
   return self;
 }
 
+static void
+constraint_clear_compiled (struct constraint * c)
+{
+  if (c->verb == WP_CONSTRAINT_VERB_MATCHES)
+    g_clear_pointer (&c->compiled.pattern, g_pattern_spec_free);
+  else if (c->verb == WP_CONSTRAINT_VERB_IN_LIST && c->subject_type == 's')
+    g_clear_pointer (&c->compiled.str_set, g_hash_table_unref);
+  else if (c->verb == WP_CONSTRAINT_VERB_IN_LIST)
+    g_clear_pointer (&c->compiled.list, g_array_unref);
+  memset (&c->compiled, 0, sizeof (c->compiled));
+  c->subject_type = '\0';
+}
+
 static void
 wp_object_interest_free (WpObjectInterest * self)
 {
@@ -266,6 +304,7 @@ wp_object_interest_free (WpObjectInterest * self)
   g_return_if_fail (self != NULL);
 
   pw_array_for_each (c, &self->constraints) {
+    constraint_clear_compiled (c);
     g_clear_pointer (&c->subject, g_free);
     g_clear_pointer (&c->value, g_variant_unref);
   }
@@ -287,6 +326,72 @@ wp_object_interest_unref (WpObjectInterest * self)
     wp_object_interest_free (self);
 }
 
+static void
+constraint_value_from_variant (gchar subj_type, GVariant * v,
+    ConstraintValue * cv)
+{
+  switch (subj_type) {
+    case 'b': cv->b = g_variant_get_boolean (v); break;
+    case 'i': cv->x = g_variant_get_int32 (v); break;
+    case 'u': cv->t = g_variant_get_uint32 (v); break;
+    case 'x': cv->x = g_variant_get_int64 (v); break;
+    case 't': cv->t = g_variant_get_uint64 (v); break;
+    case 'd': cv->d = g_variant_get_double (v); break;
+    case 's': cv->s = g_variant_get_string (v, NULL); break;
+    default: g_return_if_reached ();
+  }
+}
+
+/* decodes the constraint value once, so that matching does not need
+   to walk GVariants or compile patterns; strings point into c->value */
+static void
+constraint_compile (struct constraint * c)
+{
+  switch (c->verb) {
+    case WP_CONSTRAINT_VERB_EQUALS:
+    case WP_CONSTRAINT_VERB_NOT_EQUALS:
+      constraint_value_from_variant (c->subject_type, c->value,
+          &c->compiled.equals);
+      break;
+    case WP_CONSTRAINT_VERB_IN_RANGE: {
+      g_autoptr (GVariant) min = g_variant_get_child_value (c->value, 0);
+      g_autoptr (GVariant) max = g_variant_get_child_value (c->value, 1);
+      constraint_value_from_variant (c->subject_type, min,
+          &c->compiled.range[0]);
+      constraint_value_from_variant (c->subject_type, max,
+          &c->compiled.range[1]);
+      break;
+    }
+    case WP_CONSTRAINT_VERB_MATCHES:
+      c->compiled.pattern =
+          g_pattern_spec_new (g_variant_get_string (c->value, NULL));
+      break;
+    case WP_CONSTRAINT_VERB_IN_LIST: {
+      gsize n = g_variant_n_children (c->value);
+
+      if (c->subject_type == 's')
+        c->compiled.str_set = g_hash_table_new (g_str_hash, g_str_equal);
+      else
+        c->compiled.list = g_array_sized_new (FALSE, FALSE,
+            sizeof (ConstraintValue), n);
+
+      for (gsize i = 0; i < n; i++) {
+        g_autoptr (GVariant) child = g_variant_get_child_value (c->value, i);
+        ConstraintValue cv;
+
+        constraint_value_from_variant (c->subject_type, child, &cv);
+        if (c->subject_type == 's')
+          g_hash_table_add (c->compiled.str_set, (gpointer) cv.s);
+        else
+          g_array_append_val (c->compiled.list, cv);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
 /*!
  * \brief Validates the interest, ensuring that the interest GType
  * is a valid object and that all the constraints have been expressed properly.
@@ -325,6 +430,9 @@ wp_object_interest_validate (WpObjectInterest * self, GError ** error)
   pw_array_for_each (c, &self->constraints) {
     const GVariantType *value_type = NULL;
 
+    /* drop the compiled form of a previous validation */
+    constraint_clear_compiled (c);
+
     if (c->type <= WP_CONSTRAINT_TYPE_NONE ||
         c->type > WP_CONSTRAINT_TYPE_G_PROPERTY) {
       g_set_error (error, WP_DOMAIN_LIBRARY, WP_LIBRARY_ERROR_INVARIANT,
@@ -507,11 +615,99 @@ wp_object_interest_validate (WpObjectInterest * self, GError ** error)
     /* cache the type that the property must have */
     if (value_type)
       c->subject_type = *g_variant_type_peek_string (value_type);
+
+    constraint_compile (c);
   }
 
   return (self->valid = TRUE);
 }
 
+/*!
+ * \brief Finds the set of string values that the PipeWire property \a subject
+ *   is restricted to by the constraints of this interest
+ *
+ * This looks for a WP_CONSTRAINT_VERB_EQUALS or WP_CONSTRAINT_VERB_IN_LIST
+ * constraint with string values on \a subject and returns these values.
+ * An object can only match this interest if its \a subject property has one
+ * of the returned values.
+ *
+ * \private
+ * \ingroup wpobjectinterest
+ * \param self the object interest
+ * \param subject the name of the PipeWire property
+ * \returns (transfer full)(nullable)(element-type utf8): the allowed values,
+ *   or NULL if the interest does not restrict \a subject to a fixed set of
+ *   string values
+ */
+GPtrArray *
+wp_object_interest_find_allowed_values (WpObjectInterest * self,
+    const gchar * subject)
+{
+  struct constraint *c;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (subject != NULL, NULL);
+
+  if (!wp_object_interest_validate (self, NULL))
+    return NULL;
+
+  pw_array_for_each (c, &self->constraints) {
+    if ((c->type != WP_CONSTRAINT_TYPE_PW_PROPERTY &&
+            c->type != WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY) ||
+        c->subject_type != 's' || !g_str_equal (c->subject, subject))
+      continue;
+
+    if (c->verb == WP_CONSTRAINT_VERB_EQUALS) {
+      GPtrArray *values = g_ptr_array_new_with_free_func (g_free);
+      g_ptr_array_add (values, g_variant_dup_string (c->value, NULL));
+      return values;
+    }
+    else if (c->verb == WP_CONSTRAINT_VERB_IN_LIST) {
+      GPtrArray *values = g_ptr_array_new_with_free_func (g_free);
+      GVariantIter iter;
+      const gchar *str;
+
+      g_variant_iter_init (&iter, c->value);
+      while (g_variant_iter_next (&iter, "&s", &str))
+        g_ptr_array_add (values, g_strdup (str));
+      return values;
+    }
+  }
+  return NULL;
+}
+
+/*!
+ * \brief Finds the value of a WP_CONSTRAINT_VERB_EQUALS constraint of the
+ *   given \a type on \a subject
+ *
+ * \private
+ * \ingroup wpobjectinterest
+ * \param self the object interest
+ * \param type the constraint type
+ * \param subject the subject of the constraint
+ * \returns (transfer none)(nullable): the value of the first matching
+ *   constraint, or NULL if there is no such constraint
+ */
+GVariant *
+wp_object_interest_find_equals_value (WpObjectInterest * self,
+    WpConstraintType type, const gchar * subject)
+{
+  struct constraint *c;
+
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (subject != NULL, NULL);
+
+  if (!wp_object_interest_validate (self, NULL))
+    return NULL;
+
+  pw_array_for_each (c, &self->constraints) {
+    if (c->type == type && c->verb == WP_CONSTRAINT_VERB_EQUALS &&
+        g_str_equal (c->subject, subject))
+      return c->value;
+  }
+  return NULL;
+}
+
 G_GNUC_CONST static GType
 subject_type_to_gtype (gchar type)
 {
@@ -528,26 +724,25 @@ subject_type_to_gtype (gchar type)
 }
 
 static inline gboolean
-property_string_to_gvalue (gchar subj_type, const gchar * str, GValue * val)
+property_string_to_value (gchar subj_type, const gchar * str,
+    ConstraintValue * val)
 {
-  g_value_init (val, subject_type_to_gtype (subj_type));
-
   switch (subj_type) {
     case 'b':
       if (!strcmp (str, "true") || !strcmp (str, "1"))
-        g_value_set_boolean (val, TRUE);
+        val->b = TRUE;
       else if (!strcmp (str, "false") || !strcmp (str, "0"))
-        g_value_set_boolean (val, FALSE);
+        val->b = FALSE;
       else {
         wp_trace ("failed to convert '%s' to boolean", str);
         return FALSE;
       }
       break;
     case 's':
-      g_value_set_static_string (val, str);
+      val->s = str;
       break;
 
-#define CASE_NUMBER(l, T, convert) \
+#define CASE_NUMBER(l, m, T, convert) \
     case l: { \
       g##T number; \
       errno = 0; \
@@ -556,14 +751,14 @@ property_string_to_gvalue (gchar subj_type, const gchar * str, GValue * val)
         wp_trace ("failed to convert '%s' to " #T, str); \
         return FALSE; \
       } \
-      g_value_set_##T (val, number); \
+      val->m = number; \
       break; \
     }
-    CASE_NUMBER ('i', int, strtol (str, NULL, 10))
-    CASE_NUMBER ('u', uint, strtoul (str, NULL, 10))
-    CASE_NUMBER ('x', int64, strtoll (str, NULL, 10))
-    CASE_NUMBER ('t', uint64, strtoull (str, NULL, 10))
-    CASE_NUMBER ('d', double, strtod (str, NULL))
+    CASE_NUMBER ('i', x, int, strtol (str, NULL, 10))
+    CASE_NUMBER ('u', t, uint, strtoul (str, NULL, 10))
+    CASE_NUMBER ('x', x, int64, strtoll (str, NULL, 10))
+    CASE_NUMBER ('t', t, uint64, strtoull (str, NULL, 10))
+    CASE_NUMBER ('d', d, double, strtod (str, NULL))
 #undef CASE_NUMBER
     default:
       g_return_val_if_reached (FALSE);
@@ -571,91 +766,97 @@ property_string_to_gvalue (gchar subj_type, const gchar * str, GValue * val)
   return TRUE;
 }
 
-static inline gboolean
-constraint_verb_equals (gchar subj_type, const GValue * subj_val,
-    GVariant * check_val)
+static inline void
+gvalue_to_value (gchar subj_type, const GValue * gval, ConstraintValue * val)
 {
   switch (subj_type) {
-    case 'd': {
-      gdouble a = g_value_get_double (subj_val);
-      gdouble b = g_variant_get_double (check_val);
-      return G_APPROX_VALUE (a, b, FLT_EPSILON);
-    }
-    case 's':
-      return !g_strcmp0 (g_value_get_string (subj_val),
-                         g_variant_get_string (check_val, NULL));
-#define CASE_BASIC(l, T, R) \
-    case l: \
-      return (g_value_get_##T (subj_val) == g_variant_get_##R (check_val));
-    CASE_BASIC ('b', boolean, boolean)
-    CASE_BASIC ('i', int, int32)
-    CASE_BASIC ('u', uint, uint32)
-    CASE_BASIC ('x', int64, int64)
-    CASE_BASIC ('t', uint64, uint64)
-#undef CASE_BASIC
-    default:
-      g_return_val_if_reached (FALSE);
+    case 'b': val->b = g_value_get_boolean (gval); break;
+    case 'i': val->x = g_value_get_int (gval); break;
+    case 'u': val->t = g_value_get_uint (gval); break;
+    case 'x': val->x = g_value_get_int64 (gval); break;
+    case 't': val->t = g_value_get_uint64 (gval); break;
+    case 'd': val->d = g_value_get_double (gval); break;
+    case 's': val->s = g_value_get_string (gval); break;
+    default: g_return_if_reached ();
   }
 }
 
 static inline gboolean
-constraint_verb_matches (gchar subj_type, const GValue * subj_val,
-    GVariant * check_val)
+constraint_value_equals (gchar subj_type, const ConstraintValue * a,
+    const ConstraintValue * b)
 {
   switch (subj_type) {
-    case 's': {
-      const gchar *check_str = g_variant_get_string (check_val, NULL);
-      const gchar *subj_str = g_value_get_string (subj_val);
-      if (!check_str || !subj_str)
-        return FALSE;
-      return g_pattern_match_simple (check_str, subj_str);
-    }
+    case 'd':
+      return G_APPROX_VALUE (a->d, b->d, FLT_EPSILON);
+    case 's':
+      return !g_strcmp0 (a->s, b->s);
+    case 'b':
+      return a->b == b->b;
+    case 'i':
+    case 'x':
+      return a->x == b->x;
+    case 'u':
+    case 't':
+      return a->t == b->t;
     default:
       g_return_val_if_reached (FALSE);
   }
-  return TRUE;
 }
 
 static inline gboolean
-constraint_verb_in_list (gchar subj_type, const GValue * subj_val,
-    GVariant * check_val)
+constraint_verb_equals (const struct constraint * c,
+    const ConstraintValue * subj_val)
+{
+  return constraint_value_equals (c->subject_type, subj_val,
+      &c->compiled.equals);
+}
+
+static inline gboolean
+constraint_verb_matches (const struct constraint * c,
+    const ConstraintValue * subj_val)
+{
+  g_return_val_if_fail (c->subject_type == 's', FALSE);
+
+  if (!subj_val->s)
+    return FALSE;
+  return g_pattern_match_string (c->compiled.pattern, subj_val->s);
+}
+
+static inline gboolean
+constraint_verb_in_list (const struct constraint * c,
+    const ConstraintValue * subj_val)
 {
-  GVariantIter iter;
-  g_autoptr (GVariant) child = NULL;
+  if (c->subject_type == 's')
+    return subj_val->s &&
+        g_hash_table_contains (c->compiled.str_set, subj_val->s);
 
-  g_variant_iter_init (&iter, check_val);
-  while ((child = g_variant_iter_next_value (&iter))) {
-    if (constraint_verb_equals (subj_type, subj_val, child))
+  for (guint i = 0; i < c->compiled.list->len; i++) {
+    if (constraint_value_equals (c->subject_type, subj_val,
+            &g_array_index (c->compiled.list, ConstraintValue, i)))
       return TRUE;
-    g_variant_unref (child);
   }
   return FALSE;
 }
 
 static inline gboolean
-constraint_verb_in_range (gchar subj_type, const GValue * subj_val,
-    GVariant * check_val)
+constraint_verb_in_range (const struct constraint * c,
+    const ConstraintValue * subj_val)
 {
-  switch (subj_type) {
-#define CASE_RANGE(l, t, T) \
-    case l: { \
-      g##T val, min, max; \
-      g_variant_get (check_val, "("#t#t")", &min, &max); \
-      val = g_value_get_##T (subj_val); \
-      if (val < min || val > max) \
-        return FALSE; \
-      break; \
-    }
-    CASE_RANGE('i', i, int)
-    CASE_RANGE('u', u, uint)
-    CASE_RANGE('x', x, int64)
-    CASE_RANGE('t', t, uint64)
-    CASE_RANGE('d', d, double)
-#undef CASE_RANGE
+  const ConstraintValue *min = &c->compiled.range[0];
+  const ConstraintValue *max = &c->compiled.range[1];
+
+  switch (c->subject_type) {
+    case 'i':
+    case 'x':
+      return subj_val->x >= min->x && subj_val->x <= max->x;
+    case 'u':
+    case 't':
+      return subj_val->t >= min->t && subj_val->t <= max->t;
+    case 'd':
+      return subj_val->d >= min->d && subj_val->d <= max->d;
     default:
       g_return_val_if_reached (FALSE);
   }
-  return TRUE;
 }
 
 /*!
@@ -688,50 +889,10 @@ wp_object_interest_matches (WpObjectInterest * self, gpointer object)
   }
 }
 
-/*!
- * \brief A low-level version of wp_object_interest_matches().
- *
- * In this version, the object's type is directly given in \a object_type and
- * is not inferred from the \a object. \a object is only used to check for
- * constraints against GObject properties.
- *
- * \a pw_props and \a pw_global_props are used to check constraints against
- * PipeWire object properties and global properties, respectively.
- *
- * \a object, \a pw_props and \a pw_global_props may be NULL, but in case there
- * are any constraints that require them, the match will fail.
- * As a special case, if \a object is not NULL and is a subclass of WpProxy,
- * then \a pw_props and \a pw_global_props, if required, will be internally
- * retrieved from \a object by calling wp_pipewire_object_get_properties() and
- * wp_global_proxy_get_global_properties() respectively.
- *
- * When \a flags contains WP_INTEREST_MATCH_FLAGS_CHECK_ALL, all the constraints
- * are checked and the returned value contains accurate information about which
- * types of constraints have failed to match, if any. When this flag is not
- * present, this function returns after the first failure has been encountered.
- * This means that the returned flags set will contain all but one flag, which
- * will indicate the kind of constraint that failed (more could have failed,
- * but they are not checked...)
- *
- * \ingroup wpobjectinterest
- * \param self the object interest
- * \param flags flags to alter the behavior of this function
- * \param object_type the type to be checked against the interest's type
- * \param object (type GObject)(transfer none)(nullable): the object to be used for
- *   checking constraints of type WP_CONSTRAINT_TYPE_G_PROPERTY
- * \param pw_props (transfer none)(nullable): the properties to be used for
- *   checking constraints of type WP_CONSTRAINT_TYPE_PW_PROPERTY
- * \param pw_global_props (transfer none)(nullable): the properties to be used for
- *   checking constraints of type WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY
- * \returns flags that indicate which components of the interest match.
- *   WP_INTEREST_MATCH_ALL indicates a fully successful match; any other
- *   combination indicates a failure on the component(s) that do not appear on
- *   the flag set
- */
-WpInterestMatch
-wp_object_interest_matches_full (WpObjectInterest * self,
+static WpInterestMatch
+object_interest_matches (WpObjectInterest * self,
     WpInterestMatchFlags flags, GType object_type, gpointer object,
-    WpProperties * pw_props, WpProperties * pw_global_props)
+    WpProperties * pw_props, WpProperties * pw_global_props, WpEvent * event)
 {
   WpInterestMatch result = WP_INTEREST_MATCH_ALL;
   g_autoptr (WpProperties) props = NULL;
@@ -752,7 +913,7 @@ wp_object_interest_matches_full (WpObjectInterest * self,
     result &= ~WP_INTEREST_MATCH_GTYPE;
 
   /* prepare for constraint lookups on proxy properties */
-  if (object) {
+  if (object && !event) {
     if (!pw_global_props && WP_IS_GLOBAL_PROXY (object)) {
       WpGlobalProxy *pwg = (WpGlobalProxy *) object;
       pw_global_props = global_props =
@@ -776,7 +937,8 @@ wp_object_interest_matches_full (WpObjectInterest * self,
   /* check all constraints; if any of them fails at any point, fail the match */
   pw_array_for_each (c, &self->constraints) {
     WpProperties *lookup_props = pw_global_props;
-    g_auto (GValue) value = G_VALUE_INIT;
+    g_auto (GValue) gvalue = G_VALUE_INIT;
+    ConstraintValue value = { 0 };
     gboolean exists = FALSE;
 
     /* return early if the match failed and CHECK_ALL is not specified */
@@ -793,11 +955,14 @@ wp_object_interest_matches_full (WpObjectInterest * self,
       case WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY: {
         const gchar *lookup_str = NULL;
 
-        if (lookup_props)
-          exists = !!(lookup_str = wp_properties_get (lookup_props, c->subject));
+        if (event)
+          exists = !!(lookup_str = wp_event_get_property (event, c->subject));
+        else if (lookup_props)
+          exists = !!(lookup_str =
+              wp_properties_get_atom (lookup_props, c->subject_atom));
 
         if (exists && c->subject_type)
-          property_string_to_gvalue (c->subject_type, lookup_str, &value);
+          property_string_to_value (c->subject_type, lookup_str, &value);
         break;
       }
       case WP_CONSTRAINT_TYPE_G_PROPERTY: {
@@ -809,9 +974,9 @@ wp_object_interest_matches_full (WpObjectInterest * self,
               G_OBJECT_GET_CLASS (object), c->subject));
 
         if (exists && c->subject_type) {
-          g_value_init (&value, pspec->value_type);
-          g_object_get_property (object, c->subject, &value);
-          value_type = G_VALUE_TYPE (&value);
+          g_value_init (&gvalue, pspec->value_type);
+          g_object_get_property (object, c->subject, &gvalue);
+          value_type = G_VALUE_TYPE (&gvalue);
 
           /* transform if not compatible */
           if (value_type != subject_type_to_gtype (c->subject_type)) {
@@ -819,16 +984,18 @@ wp_object_interest_matches_full (WpObjectInterest * self,
                     subject_type_to_gtype (c->subject_type))) {
               g_auto (GValue) orig = G_VALUE_INIT;
               g_value_init (&orig, value_type);
-              g_value_copy (&value, &orig);
-              g_value_unset (&value);
-              g_value_init (&value, subject_type_to_gtype (c->subject_type));
-              g_value_transform (&orig, &value);
+              g_value_copy (&gvalue, &orig);
+              g_value_unset (&gvalue);
+              g_value_init (&gvalue, subject_type_to_gtype (c->subject_type));
+              g_value_transform (&orig, &gvalue);
             }
             else {
               result &= ~(1 << c->type);
               continue;
             }
           }
+
+          gvalue_to_value (c->subject_type, &gvalue, &value);
         }
 
         break;
@@ -842,27 +1009,27 @@ wp_object_interest_matches_full (WpObjectInterest * self,
     switch (c->verb) {
       case WP_CONSTRAINT_VERB_EQUALS:
         if (!exists ||
-            !constraint_verb_equals (c->subject_type, &value, c->value))
+            !constraint_verb_equals (c, &value))
           result &= ~(1 << c->type);
         break;
       case WP_CONSTRAINT_VERB_NOT_EQUALS:
         if (exists &&
-            constraint_verb_equals (c->subject_type, &value, c->value))
+            constraint_verb_equals (c, &value))
           result &= ~(1 << c->type);
         break;
       case WP_CONSTRAINT_VERB_MATCHES:
         if (!exists ||
-            !constraint_verb_matches (c->subject_type, &value, c->value))
+            !constraint_verb_matches (c, &value))
           result &= ~(1 << c->type);
         break;
       case WP_CONSTRAINT_VERB_IN_LIST:
         if (!exists ||
-            !constraint_verb_in_list (c->subject_type, &value, c->value))
+            !constraint_verb_in_list (c, &value))
           result &= ~(1 << c->type);
         break;
       case WP_CONSTRAINT_VERB_IN_RANGE:
         if (!exists ||
-            !constraint_verb_in_range (c->subject_type, &value, c->value))
+            !constraint_verb_in_range (c, &value))
           result &= ~(1 << c->type);
         break;
       case WP_CONSTRAINT_VERB_IS_PRESENT:
@@ -879,3 +1046,80 @@ wp_object_interest_matches_full (WpObjectInterest * self,
   }
   return result;
 }
+
+/*!
+ * \brief A low-level version of wp_object_interest_matches().
+ *
+ * In this version, the object's type is directly given in \a object_type and
+ * is not inferred from the \a object. \a object is only used to check for
+ * constraints against GObject properties.
+ *
+ * \a pw_props and \a pw_global_props are used to check constraints against
+ * PipeWire object properties and global properties, respectively.
+ *
+ * \a object, \a pw_props and \a pw_global_props may be NULL, but in case there
+ * are any constraints that require them, the match will fail.
+ * As a special case, if \a object is not NULL and is a subclass of WpProxy,
+ * then \a pw_props and \a pw_global_props, if required, will be internally
+ * retrieved from \a object by calling wp_pipewire_object_get_properties() and
+ * wp_global_proxy_get_global_properties() respectively.
+ *
+ * When \a flags contains WP_INTEREST_MATCH_FLAGS_CHECK_ALL, all the constraints
+ * are checked and the returned value contains accurate information about which
+ * types of constraints have failed to match, if any. When this flag is not
+ * present, this function returns after the first failure has been encountered.
+ * This means that the returned flags set will contain all but one flag, which
+ * will indicate the kind of constraint that failed (more could have failed,
+ * but they are not checked...)
+ *
+ * \ingroup wpobjectinterest
+ * \param self the object interest
+ * \param flags flags to alter the behavior of this function
+ * \param object_type the type to be checked against the interest's type
+ * \param object (type GObject)(transfer none)(nullable): the object to be used for
+ *   checking constraints of type WP_CONSTRAINT_TYPE_G_PROPERTY
+ * \param pw_props (transfer none)(nullable): the properties to be used for
+ *   checking constraints of type WP_CONSTRAINT_TYPE_PW_PROPERTY
+ * \param pw_global_props (transfer none)(nullable): the properties to be used for
+ *   checking constraints of type WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY
+ * \returns flags that indicate which components of the interest match.
+ *   WP_INTEREST_MATCH_ALL indicates a fully successful match; any other
+ *   combination indicates a failure on the component(s) that do not appear on
+ *   the flag set
+ */
+WpInterestMatch
+wp_object_interest_matches_full (WpObjectInterest * self,
+    WpInterestMatchFlags flags, GType object_type, gpointer object,
+    WpProperties * pw_props, WpProperties * pw_global_props)
+{
+  return object_interest_matches (self, flags, object_type, object,
+      pw_props, pw_global_props, NULL);
+}
+
+/*!
+ * \brief A variant of wp_object_interest_matches_full() that checks
+ * constraints of type WP_CONSTRAINT_TYPE_PW_PROPERTY and
+ * WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY against the properties of \a event,
+ * using wp_event_get_property()
+ *
+ * This avoids constructing the full properties set of the event.
+ *
+ * \private
+ * \ingroup wpobjectinterest
+ * \param self the object interest
+ * \param flags flags to alter the behavior of this function
+ * \param object_type the type to be checked against the interest's type
+ * \param object (type GObject)(transfer none)(nullable): the object to be used
+ *   for checking constraints of type WP_CONSTRAINT_TYPE_G_PROPERTY
+ * \param event the event whose properties are checked
+ * \returns flags that indicate which components of the interest match
+ */
+WpInterestMatch
+wp_object_interest_matches_event (WpObjectInterest * self,
+    WpInterestMatchFlags flags, GType object_type, gpointer object,
+    WpEvent * event)
+{
+  g_return_val_if_fail (event != NULL, WP_INTEREST_MATCH_NONE);
+  return object_interest_matches (self, flags, object_type, object,
+      NULL, NULL, event);
+}
@@ -98,6 +98,7 @@ WP_API
 GType wp_object_interest_get_type (void) G_GNUC_CONST;
 
 typedef struct _WpObjectInterest WpObjectInterest;
+typedef struct _WpEvent WpEvent;
 
 WP_API
 WpObjectInterest * wp_object_interest_new (GType gtype, ...) G_GNUC_NULL_TERMINATED;
@@ -130,6 +131,19 @@ WpInterestMatch wp_object_interest_matches_full (WpObjectInterest * self,
     WpInterestMatchFlags flags, GType object_type, gpointer object,
     WpProperties * pw_props, WpProperties * pw_global_props);
 
+WP_PRIVATE_API
+WpInterestMatch wp_object_interest_matches_event (WpObjectInterest * self,
+    WpInterestMatchFlags flags, GType object_type, gpointer object,
+    WpEvent * event);
+
+WP_PRIVATE_API
+GPtrArray * wp_object_interest_find_allowed_values (WpObjectInterest * self,
+    const gchar * subject);
+
+WP_PRIVATE_API
+GVariant * wp_object_interest_find_equals_value (WpObjectInterest * self,
+    WpConstraintType type, const gchar * subject);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (WpObjectInterest, wp_object_interest_unref)
 
 G_END_DECLS
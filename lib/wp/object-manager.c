@@ -9,6 +9,8 @@
 #include "object-manager.h"
 #include "log.h"
 #include "proxy-interfaces.h"
+#include "global-proxy.h"
+#include "session-item.h"
 #include "private/registry.h"
 
 #include <pipewire/pipewire.h>
@@ -128,6 +130,20 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("wp-object-manager")
  * \endparblock
  */
 
+/* a secondary index of the managed objects on the value of a property */
+typedef struct _ObjectIndex ObjectIndex;
+struct _ObjectIndex
+{
+  WpConstraintType type;
+  gchar *subject;
+  /* element-type: <utf8, GPtrArray<GObject*>>, objects without a ref */
+  GHashTable *buckets;
+  /* element-type: <GObject*, utf8>, the key each object is indexed under */
+  GHashTable *keys;
+  /* number of indexed keys that are not plain non-negative integers */
+  guint n_nonplain;
+};
+
 struct _WpObjectManager
 {
   GObject parent;
@@ -137,8 +153,13 @@ struct _WpObjectManager
   GPtrArray *interests;
   /* element-type: <GType, WpProxyFeatures> */
   GHashTable *features;
-  /* objects that we are interested in, without a ref */
+  /* objects that we are interested in, without a ref; this array is shared
+     with iterators and copied before being modified while it is shared */
   GPtrArray *objects;
+  /* number of iterators that hold a reference on the current objects array */
+  guint objects_pins;
+  /* element-type: ObjectIndex* */
+  GPtrArray *indexes;
 
   gboolean installed;
   gboolean changed;
@@ -163,6 +184,250 @@ static guint signals[LAST_SIGNAL] = { 0 };
 
 G_DEFINE_TYPE (WpObjectManager, wp_object_manager, G_TYPE_OBJECT)
 
+static void
+object_index_free (ObjectIndex * idx)
+{
+  g_free (idx->subject);
+  g_clear_pointer (&idx->buckets, g_hash_table_unref);
+  g_clear_pointer (&idx->keys, g_hash_table_unref);
+  g_free (idx);
+}
+
+/* A plain key is the canonical decimal form of an integer that fits in all
+   the integer types that constraints can have. Integer constraints on a plain
+   key match if and only if the constraint value prints to the same string,
+   so they can be looked up in the index as long as all the keys are plain. */
+static gboolean
+object_index_key_is_plain (const gchar * key)
+{
+  gsize len = strlen (key);
+
+  if (len == 0 || len > 9)
+    return FALSE;
+  if (key[0] == '0')
+    return len == 1;
+  for (gsize i = 0; i < len; i++) {
+    if (!g_ascii_isdigit (key[i]))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/* computes the key of an object, following the same rules for retrieving the
+   subject value as wp_object_interest_matches_full() */
+static gchar *
+object_index_get_key (ObjectIndex * idx, GObject * object)
+{
+  switch (idx->type) {
+    case WP_CONSTRAINT_TYPE_PW_PROPERTY: {
+      g_autoptr (WpProperties) props = NULL;
+
+      if (WP_IS_PIPEWIRE_OBJECT (object) &&
+          wp_object_test_active_features (WP_OBJECT (object),
+              WP_PIPEWIRE_OBJECT_FEATURE_INFO))
+        props = wp_pipewire_object_get_properties (WP_PIPEWIRE_OBJECT (object));
+
+      return props ? g_strdup (wp_properties_get (props, idx->subject)) : NULL;
+    }
+    case WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY: {
+      g_autoptr (WpProperties) props = NULL;
+
+      if (WP_IS_GLOBAL_PROXY (object))
+        props = wp_global_proxy_get_global_properties (WP_GLOBAL_PROXY (object));
+      else if (WP_IS_SESSION_ITEM (object))
+        props = wp_session_item_get_properties (WP_SESSION_ITEM (object));
+
+      return props ? g_strdup (wp_properties_get (props, idx->subject)) : NULL;
+    }
+    case WP_CONSTRAINT_TYPE_G_PROPERTY: {
+      GParamSpec *pspec = g_object_class_find_property (
+          G_OBJECT_GET_CLASS (object), idx->subject);
+      g_auto (GValue) value = G_VALUE_INIT;
+      g_auto (GValue) str = G_VALUE_INIT;
+
+      if (!pspec)
+        return NULL;
+
+      g_value_init (&value, pspec->value_type);
+      g_value_init (&str, G_TYPE_STRING);
+      g_object_get_property (object, idx->subject, &value);
+
+      /* values without a string form are indexed under an empty, non-plain
+         key; string constraints cannot match them and integer constraints
+         fall back to scanning all the objects */
+      if (!g_value_type_transformable (pspec->value_type, G_TYPE_STRING) ||
+          !g_value_transform (&value, &str) || !g_value_get_string (&str))
+        return g_strdup ("");
+
+      return g_value_dup_string (&str);
+    }
+    default:
+      g_return_val_if_reached (NULL);
+  }
+}
+
+static void
+object_index_remove (ObjectIndex * idx, GObject * object)
+{
+  const gchar *key = g_hash_table_lookup (idx->keys, object);
+  GPtrArray *bucket;
+
+  if (!key)
+    return;
+
+  bucket = g_hash_table_lookup (idx->buckets, key);
+  if (bucket) {
+    g_ptr_array_remove (bucket, object);
+    if (bucket->len == 0)
+      g_hash_table_remove (idx->buckets, key);
+  }
+  if (!object_index_key_is_plain (key))
+    idx->n_nonplain--;
+  g_hash_table_remove (idx->keys, object);
+}
+
+static void
+object_index_add (ObjectIndex * idx, GObject * object)
+{
+  gchar *key = object_index_get_key (idx, object);
+  GPtrArray *bucket;
+
+  if (!key)
+    return;
+
+  bucket = g_hash_table_lookup (idx->buckets, key);
+  if (!bucket) {
+    bucket = g_ptr_array_new ();
+    g_hash_table_insert (idx->buckets, g_strdup (key), bucket);
+  }
+  g_ptr_array_add (bucket, object);
+  if (!object_index_key_is_plain (key))
+    idx->n_nonplain++;
+  g_hash_table_insert (idx->keys, object, key);
+}
+
+/* returns the key under which objects that satisfy \a value are indexed,
+   or NULL if the index cannot answer this query exactly */
+static gchar *
+object_index_get_lookup_key (ObjectIndex * idx, GVariant * value)
+{
+  switch (*g_variant_get_type_string (value)) {
+    case 's':
+      return g_variant_dup_string (value, NULL);
+
+#define CASE_INT(l, T, get, FMT) \
+    case l: { \
+      T v = get (value); \
+      if (idx->n_nonplain > 0 || v < 0 || v >= 1000000000) \
+        return NULL; \
+      return g_strdup_printf ("%" FMT, v); \
+    }
+    CASE_INT ('i', gint32, g_variant_get_int32, G_GINT32_FORMAT)
+    CASE_INT ('x', gint64, g_variant_get_int64, G_GINT64_FORMAT)
+#undef CASE_INT
+
+#define CASE_UINT(l, T, get, FMT) \
+    case l: { \
+      T v = get (value); \
+      if (idx->n_nonplain > 0 || v >= 1000000000) \
+        return NULL; \
+      return g_strdup_printf ("%" FMT, v); \
+    }
+    CASE_UINT ('u', guint32, g_variant_get_uint32, G_GUINT32_FORMAT)
+    CASE_UINT ('t', guint64, g_variant_get_uint64, G_GUINT64_FORMAT)
+#undef CASE_UINT
+
+    default:
+      return NULL;
+  }
+}
+
+/* returns TRUE if the key of an object in \a idx may change when the
+   GObject property called \a property is notified */
+static gboolean
+object_index_depends_on (ObjectIndex * idx, const gchar * property)
+{
+  switch (idx->type) {
+    case WP_CONSTRAINT_TYPE_PW_PROPERTY:
+      /* the PipeWire properties are only available with FEATURE_INFO */
+      return g_str_equal (property, "properties") ||
+          g_str_equal (property, "active-features");
+    case WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY:
+      /* the global properties of proxies never change, but session items
+         use their "properties" as global properties */
+      return g_str_equal (property, "properties");
+    case WP_CONSTRAINT_TYPE_G_PROPERTY:
+      return g_str_equal (property, idx->subject);
+    default:
+      return FALSE;
+  }
+}
+
+static void
+wp_object_manager_reindex_object (WpObjectManager * self, GObject * object,
+    const gchar * property)
+{
+  for (guint i = 0; i < self->indexes->len; i++) {
+    ObjectIndex *idx = g_ptr_array_index (self->indexes, i);
+    if (property && !object_index_depends_on (idx, property))
+      continue;
+    object_index_remove (idx, object);
+    object_index_add (idx, object);
+  }
+}
+
+static void
+on_indexed_object_notify (GObject * object, GParamSpec * pspec,
+    WpObjectManager * self)
+{
+  wp_object_manager_reindex_object (self, object, pspec->name);
+}
+
+/* WpProxy does not notify "bound-id", so objects that were added before
+   being bound must be reindexed when they get bound */
+static void
+on_indexed_proxy_bound (WpProxy * proxy, guint32 bound_id,
+    WpObjectManager * self)
+{
+  wp_object_manager_reindex_object (self, G_OBJECT (proxy), "bound-id");
+}
+
+static void
+wp_object_manager_watch_indexed_object (WpObjectManager * self,
+    GObject * object)
+{
+  g_signal_connect (object, "notify",
+      G_CALLBACK (on_indexed_object_notify), self);
+  if (WP_IS_PROXY (object))
+    g_signal_connect (object, "bound",
+        G_CALLBACK (on_indexed_proxy_bound), self);
+}
+
+static void
+wp_object_manager_unwatch_indexed_object (WpObjectManager * self,
+    GObject * object)
+{
+  g_signal_handlers_disconnect_by_func (object,
+      on_indexed_object_notify, self);
+  if (WP_IS_PROXY (object))
+    g_signal_handlers_disconnect_by_func (object,
+        on_indexed_proxy_bound, self);
+}
+
+/* Ensures that self->objects is not shared with any iterator; iterators keep
+   iterating over the previous generation of the array, which is freed when
+   the last of them is finalized */
+static void
+wp_object_manager_make_objects_writable (WpObjectManager * self)
+{
+  if (self->objects_pins > 0) {
+    GPtrArray *objects = g_ptr_array_copy (self->objects, NULL, NULL);
+    g_ptr_array_unref (self->objects);
+    self->objects = objects;
+    self->objects_pins = 0;
+  }
+}
+
 static void
 wp_object_manager_init (WpObjectManager * self)
 {
@@ -171,6 +436,8 @@ wp_object_manager_init (WpObjectManager * self)
       (GDestroyNotify) wp_object_interest_unref);
   self->features = g_hash_table_new (g_direct_hash, g_direct_equal);
   self->objects = g_ptr_array_new ();
+  self->indexes = g_ptr_array_new_with_free_func (
+      (GDestroyNotify) object_index_free);
   self->installed = FALSE;
   self->changed = FALSE;
   self->pending_objects = 0;
@@ -185,6 +452,10 @@ wp_object_manager_finalize (GObject * object)
     g_source_destroy (self->idle_source);
     g_clear_pointer (&self->idle_source, g_source_unref);
   }
+  for (guint i = 0; self->indexes->len > 0 && i < self->objects->len; i++)
+    wp_object_manager_unwatch_indexed_object (self,
+        g_ptr_array_index (self->objects, i));
+  g_clear_pointer (&self->indexes, g_ptr_array_unref);
   g_clear_pointer (&self->objects, g_ptr_array_unref);
   g_clear_pointer (&self->features, g_hash_table_unref);
   g_clear_pointer (&self->interests, g_ptr_array_unref);
@@ -320,6 +591,13 @@ wp_object_manager_add_interest_full (WpObjectManager *self,
     return;
   }
   g_ptr_array_add (self->interests, interest);
+
+  /* the registry indexes installed object managers by interest type */
+  {
+    g_autoptr (WpCore) core = g_weak_ref_get (&self->core);
+    if (core)
+      wp_registry_invalidate_object_manager_index (wp_core_get_registry (core));
+  }
 }
 
 static void
@@ -365,6 +643,94 @@ wp_object_manager_request_object_features (WpObjectManager *self,
   store_children_object_features (self->features, object_type, wanted_features);
 }
 
+/*!
+ * \brief Declares a secondary index on the value of a property of the
+ * managed objects.
+ *
+ * Lookups and filtered iterators whose interest has a
+ * WP_CONSTRAINT_VERB_EQUALS constraint on an indexed property only need to
+ * check the objects that have the requested value, instead of checking all
+ * the managed objects. This is useful for object managers that are queried
+ * very often by an identifier, such as "bound-id" or "node.id".
+ *
+ * The index is updated when objects are added or removed, when their
+ * properties change and when proxies get bound. Indexes only affect performance; the results of
+ * lookups are the same, except that when more than one object matches,
+ * lookups may return a different one of them.
+ *
+ * \ingroup wpobjectmanager
+ * \param self the object manager
+ * \param type the type of the property, which must be one of
+ *   WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, WP_CONSTRAINT_TYPE_PW_PROPERTY or
+ *   WP_CONSTRAINT_TYPE_G_PROPERTY
+ * \param subject the name of the property
+ */
+void
+wp_object_manager_add_index (WpObjectManager * self, WpConstraintType type,
+    const gchar * subject)
+{
+  ObjectIndex *idx;
+
+  g_return_if_fail (WP_IS_OBJECT_MANAGER (self));
+  g_return_if_fail (type == WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY ||
+                    type == WP_CONSTRAINT_TYPE_PW_PROPERTY ||
+                    type == WP_CONSTRAINT_TYPE_G_PROPERTY);
+  g_return_if_fail (subject != NULL);
+
+  for (guint i = 0; i < self->indexes->len; i++) {
+    idx = g_ptr_array_index (self->indexes, i);
+    if (idx->type == type && g_str_equal (idx->subject, subject))
+      return;
+  }
+
+  idx = g_new0 (ObjectIndex, 1);
+  idx->type = type;
+  idx->subject = g_strdup (subject);
+  idx->buckets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+      (GDestroyNotify) g_ptr_array_unref);
+  idx->keys = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  g_ptr_array_add (self->indexes, idx);
+
+  for (guint i = 0; i < self->objects->len; i++) {
+    GObject *object = g_ptr_array_index (self->objects, i);
+    object_index_add (idx, object);
+    if (self->indexes->len == 1)
+      wp_object_manager_watch_indexed_object (self, object);
+  }
+}
+
+/* returns a snapshot of all the managed objects, without copying them */
+static GPtrArray *
+wp_object_manager_pin_objects (WpObjectManager * self)
+{
+  self->objects_pins++;
+  return g_ptr_array_ref (self->objects);
+}
+
+/* returns a snapshot of the objects that may match the interest; if the
+   interest has an equality constraint on an indexed property, this is only
+   the objects that are indexed under the requested value */
+static GPtrArray *
+wp_object_manager_get_candidates (WpObjectManager * self,
+    WpObjectInterest * interest)
+{
+  for (guint i = 0; interest && i < self->indexes->len; i++) {
+    ObjectIndex *idx = g_ptr_array_index (self->indexes, i);
+    GVariant *value;
+    g_autofree gchar *key = NULL;
+    GPtrArray *bucket;
+
+    value = wp_object_interest_find_equals_value (interest, idx->type,
+        idx->subject);
+    if (!value || !(key = object_index_get_lookup_key (idx, value)))
+      continue;
+
+    bucket = g_hash_table_lookup (idx->buckets, key);
+    return bucket ? g_ptr_array_copy (bucket, NULL, NULL) : g_ptr_array_new ();
+  }
+  return wp_object_manager_pin_objects (self);
+}
+
 /*!
  * \brief Gets the number of objects managed by the object manager.
  * \ingroup wpobjectmanager
@@ -381,7 +747,7 @@ wp_object_manager_get_n_objects (WpObjectManager * self)
 struct om_iterator_data
 {
   WpObjectManager *om;
-  GPtrArray *objects;
+  GPtrArray *objects; /* a snapshot of om->objects or a subset of it */
   WpObjectInterest *interest;
   guint index;
 };
@@ -440,6 +806,12 @@ static void
 om_iterator_finalize (WpIterator *it)
 {
   struct om_iterator_data *it_data = wp_iterator_get_user_data (it);
+
+  /* unpin the array if it is still the current generation; an array that
+     we hold cannot be freed, so its address cannot be reused */
+  if (it_data->objects == it_data->om->objects)
+    it_data->om->objects_pins--;
+
   g_clear_pointer (&it_data->objects, g_ptr_array_unref);
   g_clear_pointer (&it_data->interest, wp_object_interest_unref);
   g_object_unref (it_data->om);
@@ -471,7 +843,7 @@ wp_object_manager_new_iterator (WpObjectManager * self)
   it = wp_iterator_new (&om_iterator_methods, sizeof (struct om_iterator_data));
   it_data = wp_iterator_get_user_data (it);
   it_data->om = g_object_ref (self);
-  it_data->objects = g_ptr_array_copy (self->objects, NULL, NULL);
+  it_data->objects = wp_object_manager_pin_objects (self);
   it_data->index = 0;
   return it;
 }
@@ -539,7 +911,7 @@ wp_object_manager_new_filtered_iterator_full (WpObjectManager * self,
   it = wp_iterator_new (&om_iterator_methods, sizeof (struct om_iterator_data));
   it_data = wp_iterator_get_user_data (it);
   it_data->om = g_object_ref (self);
-  it_data->objects = g_ptr_array_copy (self->objects, NULL, NULL);
+  it_data->objects = wp_object_manager_get_candidates (self, interest);
   it_data->interest = interest;
   it_data->index = 0;
   return it;
@@ -620,6 +992,28 @@ wp_object_manager_is_interested_in_object (WpObjectManager * self,
   return FALSE;
 }
 
+/*!
+ * \brief Checks if any of the interests of the object manager can match
+ * objects of the given \a type, regardless of their properties.
+ * \private
+ * \ingroup wpobjectmanager
+ * \param self the object manager
+ * \param type the type of the object
+ * \returns TRUE if objects of \a type may match, FALSE otherwise
+ */
+gboolean
+wp_object_manager_is_interested_in_type (WpObjectManager * self, GType type)
+{
+  for (guint i = 0; i < self->interests->len; i++) {
+    WpObjectInterest *interest = g_ptr_array_index (self->interests, i);
+    WpInterestMatch match = wp_object_interest_matches_full (interest,
+        WP_INTEREST_MATCH_FLAGS_CHECK_ALL, type, NULL, NULL, NULL);
+    if (match & WP_INTEREST_MATCH_GTYPE)
+      return TRUE;
+  }
+  return FALSE;
+}
+
 static gboolean
 wp_object_manager_is_interested_in_global (WpObjectManager * self,
     WpGlobal * global, WpObjectFeatures * wanted_features)
@@ -743,7 +1137,12 @@ wp_object_manager_add_object (WpObjectManager * self, gpointer object)
 {
   if (wp_object_manager_is_interested_in_object (self, object)) {
     wp_trace_object (self, "added: " WP_OBJECT_FORMAT, WP_OBJECT_ARGS (object));
+    wp_object_manager_make_objects_writable (self);
     g_ptr_array_add (self->objects, object);
+    if (self->indexes->len > 0) {
+      wp_object_manager_reindex_object (self, object, NULL);
+      wp_object_manager_watch_indexed_object (self, object);
+    }
     g_signal_emit (self, signals[SIGNAL_OBJECT_ADDED], 0, object);
     self->changed = TRUE;
   }
@@ -762,7 +1161,13 @@ wp_object_manager_rm_object (WpObjectManager * self, gpointer object)
 {
   guint index;
   if (g_ptr_array_find (self->objects, object, &index)) {
+    wp_object_manager_make_objects_writable (self);
     g_ptr_array_remove_index_fast (self->objects, index);
+    if (self->indexes->len > 0) {
+      wp_object_manager_unwatch_indexed_object (self, object);
+      for (guint i = 0; i < self->indexes->len; i++)
+        object_index_remove (g_ptr_array_index (self->indexes, i), object);
+    }
     g_signal_emit (self, signals[SIGNAL_OBJECT_REMOVED], 0, object);
     self->changed = TRUE;
   }
@@ -72,6 +72,12 @@ WP_API
 gpointer wp_object_manager_lookup_full (WpObjectManager * self,
     WpObjectInterest * interest);
 
+/* indexes */
+
+WP_API
+void wp_object_manager_add_index (WpObjectManager * self,
+    WpConstraintType type, const gchar * subject);
+
 /* private */
 
 typedef struct _WpGlobal WpGlobal;
@@ -88,6 +94,10 @@ void wp_object_manager_rm_object (WpObjectManager * self, gpointer object);
 WP_PRIVATE_API
 void wp_object_manager_add_global (WpObjectManager * self, WpGlobal * global);
 
+WP_PRIVATE_API
+gboolean wp_object_manager_is_interested_in_type (WpObjectManager * self,
+    GType type);
+
 G_END_DECLS
 
 #endif
@@ -385,6 +385,8 @@ struct _WpPwObjectMixinParamStore
 {
   guint32 param_id;
   GPtrArray *params;
+  GArray *hashes;  /* element-type: guint64; the content hash of each param,
+                      used to skip comparing params that are different */
 };
 
 static WpPwObjectMixinParamStore *
@@ -399,9 +401,37 @@ wp_pw_object_mixin_param_store_free (gpointer data)
 {
   WpPwObjectMixinParamStore * p = data;
   g_clear_pointer (&p->params, g_ptr_array_unref);
+  g_clear_pointer (&p->hashes, g_array_unref);
   g_slice_free (WpPwObjectMixinParamStore, p);
 }
 
+/* FNV-1a over the whole pod, including its header */
+static guint64
+param_hash (WpSpaPod * param)
+{
+  const struct spa_pod *pod = wp_spa_pod_get_spa_pod (param);
+  const guint8 *data = (const guint8 *) pod;
+  guint64 hash = 0xcbf29ce484222325ULL;
+
+  for (gsize i = 0; i < SPA_POD_SIZE (pod); i++) {
+    hash ^= data[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/* compares the whole pods; the hashes only avoid comparing the contents
+   of params that are most likely different */
+static gboolean
+param_equal (WpSpaPod * a, guint64 a_hash, WpSpaPod * b, guint64 b_hash)
+{
+  const struct spa_pod *a_pod = wp_spa_pod_get_spa_pod (a);
+  const struct spa_pod *b_pod = wp_spa_pod_get_spa_pod (b);
+
+  return a_hash == b_hash && SPA_POD_SIZE (a_pod) == SPA_POD_SIZE (b_pod) &&
+      memcmp (a_pod, b_pod, SPA_POD_SIZE (a_pod)) == 0;
+}
+
 static gint
 param_store_has_id (gconstpointer param, gconstpointer id)
 {
@@ -443,20 +473,33 @@ wp_pw_object_mixin_store_param (WpPwObjectMixinData * data, guint32 id,
     return;
   }
 
-  if (flags & WP_PW_OBJECT_MIXIN_STORE_PARAM_CLEAR)
+  if (flags & WP_PW_OBJECT_MIXIN_STORE_PARAM_CLEAR) {
     g_clear_pointer (&s->params, g_ptr_array_unref);
+    g_clear_pointer (&s->hashes, g_array_unref);
+  }
 
   if (!param)
     return;
 
+  if (!s->hashes)
+    s->hashes = g_array_new (FALSE, FALSE, sizeof (guint64));
+
   if (flags & WP_PW_OBJECT_MIXIN_STORE_PARAM_ARRAY) {
+    GPtrArray *params = param;
+
+    for (guint i = 0; i < params->len; i++) {
+      guint64 hash = param_hash (g_ptr_array_index (params, i));
+      g_array_append_val (s->hashes, hash);
+    }
+
     if (!s->params)
-      s->params = (GPtrArray *) param;
+      s->params = params;
     else
-      g_ptr_array_extend_and_steal (s->params, (GPtrArray *) param);
+      g_ptr_array_extend_and_steal (s->params, params);
   }
   else {
     WpSpaPod *param_pod = param;
+    guint64 hash;
 
     if (!s->params)
       s->params =
@@ -466,9 +509,60 @@ wp_pw_object_mixin_store_param (WpPwObjectMixinData * data, guint32 id,
        `const struct spa_pod *` data allocated on the stack */
     param_pod = wp_spa_pod_ensure_unique_owner (param_pod);
     g_ptr_array_insert (s->params, index, param_pod);
+
+    hash = param_hash (param_pod);
+    if (index < 0)
+      g_array_append_val (s->hashes, hash);
+    else
+      g_array_insert_val (s->hashes, index, hash);
   }
 }
 
+GArray *
+wp_pw_object_mixin_replace_params (WpPwObjectMixinData * data, guint32 id,
+    GPtrArray * params)
+{
+  GList *link = g_list_find_custom (data->params, GUINT_TO_POINTER (id),
+      param_store_has_id);
+  WpPwObjectMixinParamStore *s = link ? link->data : NULL;
+  g_autoptr (GPtrArray) old_params =
+      (s && s->params) ? g_ptr_array_ref (s->params) : NULL;
+  g_autoptr (GArray) old_hashes =
+      (s && s->hashes) ? g_array_ref (s->hashes) : NULL;
+  gboolean existed = (s != NULL);
+  guint n_old, n_new;
+  GArray *changed;
+
+  wp_pw_object_mixin_store_param (data, id,
+      WP_PW_OBJECT_MIXIN_STORE_PARAM_ARRAY |
+      WP_PW_OBJECT_MIXIN_STORE_PARAM_CLEAR |
+      WP_PW_OBJECT_MIXIN_STORE_PARAM_APPEND,
+      params);
+
+  if (!s) {
+    link = g_list_find_custom (data->params, GUINT_TO_POINTER (id),
+        param_store_has_id);
+    s = link->data;
+  }
+
+  n_old = old_params ? old_params->len : 0;
+  n_new = s->params ? s->params->len : 0;
+  changed = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  for (guint32 i = 0; i < MAX (n_old, n_new); i++) {
+    if (i >= n_old || i >= n_new ||
+        !param_equal (g_ptr_array_index (old_params, i),
+            g_array_index (old_hashes, guint64, i),
+            g_ptr_array_index (s->params, i),
+            g_array_index (s->hashes, guint64, i)))
+      g_array_append_val (changed, i);
+  }
+
+  if (existed && changed->len == 0)
+    g_clear_pointer (&changed, g_array_unref);
+  return changed;
+}
+
 /******************/
 /* PROPERTIES API */
 
@@ -583,6 +677,9 @@ enum_params_for_cache_done (GObject * object, GAsyncResult * res, gpointer data)
   g_autoptr (GPtrArray) params = NULL;
   const gchar *name = NULL;
 
+  g_autoptr (GArray) changed = NULL;
+  g_autoptr (GVariant) indexes = NULL;
+
   params = g_task_propagate_pointer (G_TASK (res), &error);
   if (error) {
     wp_debug_object (object, "enum params failed: %s", error->message);
@@ -595,12 +692,19 @@ enum_params_for_cache_done (GObject * object, GAsyncResult * res, gpointer data)
   wp_debug_object (object, "cached params id:%u (%s), n_params:%u", param_id,
       name, params->len);
 
-  wp_pw_object_mixin_store_param (d, param_id,
-      WP_PW_OBJECT_MIXIN_STORE_PARAM_ARRAY |
-      WP_PW_OBJECT_MIXIN_STORE_PARAM_CLEAR |
-      WP_PW_OBJECT_MIXIN_STORE_PARAM_APPEND,
+  /* PipeWire re-announces params that did not change, for example when
+     other params of the same object change; do not notify about those */
+  changed = wp_pw_object_mixin_replace_params (d, param_id,
       g_steal_pointer (&params));
+  if (!changed) {
+    wp_debug_object (object, "params id:%u (%s) did not change", param_id,
+        name);
+    return;
+  }
 
+  indexes = g_variant_ref_sink (g_variant_new_fixed_array (
+          G_VARIANT_TYPE_UINT32, changed->data, changed->len, sizeof (guint32)));
+  g_signal_emit_by_name (object, "param-entries-changed", name, indexes);
   g_signal_emit_by_name (object, "params-changed", name);
 }
 
@@ -782,8 +886,10 @@ wp_pw_object_mixin_handle_event_info (gpointer instance, gconstpointer update)
     const struct spa_dict * props =
         G_STRUCT_MEMBER (const struct spa_dict *, d->info, iface->props_offset);
 
+    /* take a copy, so that references to these properties remain valid
+       after the info structure is updated again */
     g_clear_pointer (&d->properties, wp_properties_unref);
-    d->properties = wp_properties_new_wrap_dict (props);
+    d->properties = wp_properties_new_interned_dict (props);
 
     g_object_notify (G_OBJECT (instance), "properties");
   }
@@ -1001,5 +1107,6 @@ wp_pw_object_mixin_notify_params_changed (gpointer instance, guint32 id)
   if (subscribed)
     wp_pw_object_mixin_impl_enum_params (instance, 1, id, 0, -1, NULL);
 
+  g_signal_emit_by_name (instance, "param-entries-changed", name, NULL);
   g_signal_emit_by_name (instance, "params-changed", name);
 }
@@ -147,6 +147,13 @@ GPtrArray * wp_pw_object_mixin_get_stored_params (WpPwObjectMixinData * data,
 void wp_pw_object_mixin_store_param (WpPwObjectMixinData * data, guint32 id,
     guint32 flags, gpointer param);
 
+/* replace all the stored params for @em id with @em params (transfer full)
+ * and return the indexes of the params that differ from the ones that were
+ * stored before, including added and removed ones; returns NULL if there
+ * were params stored for @em id and none of them changed */
+GArray * wp_pw_object_mixin_replace_params (WpPwObjectMixinData * data,
+    guint32 id, GPtrArray * params);
+
 /* set the index at which to store the new param */
 #define WP_PW_OBJECT_MIXIN_STORE_PARAM_SET(x)  ((x) & 0x7fff)
 #define WP_PW_OBJECT_MIXIN_STORE_PARAM_APPEND  (0xffff)
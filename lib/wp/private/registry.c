@@ -68,30 +68,37 @@ object_manager_destroyed (gpointer data, GObject * om)
 {
   WpRegistry *self = data;
   g_ptr_array_remove_fast (self->object_managers, om);
+  wp_registry_invalidate_object_manager_index (self);
 }
 
-/* find the subclass of WpPipewireGloabl that can handle
-   the given pipewire interface type of the given version */
-static inline GType
-find_proxy_instance_type (const char * type, guint32 version)
+/* Drops the index of object managers by global type; this must be called
+   when an object manager is installed or destroyed, or when the interests
+   of an installed object manager change */
+void
+wp_registry_invalidate_object_manager_index (WpRegistry *self)
 {
-  g_autofree GType *children;
-  guint n_children;
-
-  children = g_type_children (WP_TYPE_GLOBAL_PROXY, &n_children);
+  if (self->om_index)
+    g_hash_table_remove_all (self->om_index);
+}
 
-  for (guint i = 0; i < n_children; i++) {
-    WpProxyClass *klass = (WpProxyClass *) g_type_class_ref (children[i]);
-    if (g_strcmp0 (klass->pw_iface_type, type) == 0 &&
-        klass->pw_iface_version == version) {
-      g_type_class_unref (klass);
-      return children[i];
+/* returns the object managers that may be interested in globals of the given
+   type, i.e. those that have an interest on this type or a parent type */
+static GPtrArray *
+wp_registry_get_interested_object_managers (WpRegistry *self, GType type)
+{
+  GPtrArray *oms = g_hash_table_lookup (self->om_index,
+      GSIZE_TO_POINTER (type));
+
+  if (!oms) {
+    oms = g_ptr_array_new ();
+    for (guint i = 0; i < self->object_managers->len; i++) {
+      WpObjectManager *om = g_ptr_array_index (self->object_managers, i);
+      if (wp_object_manager_is_interested_in_type (om, type))
+        g_ptr_array_add (oms, om);
     }
-
-    g_type_class_unref (klass);
+    g_hash_table_insert (self->om_index, GSIZE_TO_POINTER (type), oms);
   }
-
-  return WP_TYPE_GLOBAL_PROXY;
+  return oms;
 }
 
 /* called by the registry when a global appears */
@@ -100,7 +107,7 @@ registry_global (void *data, uint32_t id, uint32_t permissions,
     const char *type, uint32_t version, const struct spa_dict *props)
 {
   WpRegistry *self = data;
-  GType gtype = find_proxy_instance_type (type, version);
+  GType gtype = wp_global_proxy_find_instance_type (type, version);
 
   wp_debug_object (wp_registry_get_core (self),
       "global:%u perm:0x%x type:%s/%u -> %s",
@@ -155,6 +162,8 @@ wp_registry_init (WpRegistry *self)
       g_ptr_array_new_with_free_func ((GDestroyNotify) wp_global_unref);
   self->objects = g_ptr_array_new_with_free_func (g_object_unref);
   self->object_managers = g_ptr_array_new ();
+  self->om_index = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) g_ptr_array_unref);
   self->features = g_ptr_array_new_with_free_func (g_free);
 }
 
@@ -192,6 +201,8 @@ wp_registry_clear (WpRegistry *self)
       g_object_weak_unref (om, object_manager_destroyed, self);
     }
   }
+
+  g_clear_pointer (&self->om_index, g_hash_table_unref);
 }
 
 void
@@ -249,6 +260,7 @@ expose_tmp_globals (WpCore *core)
   WpRegistry *self = wp_core_get_registry (core);
   g_autoptr (GPtrArray) tmp_globals = NULL;
   g_autoptr (GPtrArray) object_managers = NULL;
+  g_autoptr (GHashTable) om_globals = NULL;
 
   /* in case the registry was cleared in the meantime... */
   if (G_UNLIKELY (!self->tmp_globals))
@@ -292,12 +304,37 @@ expose_tmp_globals (WpCore *core)
       (GCopyFunc) g_object_ref, NULL);
   g_ptr_array_set_free_func (object_managers, g_object_unref);
 
+  /* distribute the globals to the object managers that have an interest on
+     their type, before notifying any of them, as the index may be invalidated
+     by the callbacks */
+  om_globals = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+      (GDestroyNotify) g_ptr_array_unref);
+  for (guint i = 0; i < tmp_globals->len; i++) {
+    WpGlobal *g = g_ptr_array_index (tmp_globals, i);
+    GPtrArray *oms;
+
+    if (g->flags == 0 || g->id == SPA_ID_INVALID)
+      continue;
+
+    oms = wp_registry_get_interested_object_managers (self, g->type);
+    for (guint j = 0; j < oms->len; j++) {
+      gpointer om = g_ptr_array_index (oms, j);
+      GPtrArray *globals = g_hash_table_lookup (om_globals, om);
+      if (!globals) {
+        globals = g_ptr_array_new ();
+        g_hash_table_insert (om_globals, om, globals);
+      }
+      g_ptr_array_add (globals, g);
+    }
+  }
+
   /* notify object managers */
   for (guint i = 0; i < object_managers->len; i++) {
     WpObjectManager *om = g_ptr_array_index (object_managers, i);
+    GPtrArray *globals = g_hash_table_lookup (om_globals, om);
 
-    for (guint i = 0; i < tmp_globals->len; i++) {
-      WpGlobal *g = g_ptr_array_index (tmp_globals, i);
+    for (guint j = 0; globals && j < globals->len; j++) {
+      WpGlobal *g = g_ptr_array_index (globals, j);
 
       /* if global was already removed, drop it */
       if (g->flags == 0 || g->id == SPA_ID_INVALID)
@@ -311,6 +348,32 @@ expose_tmp_globals (WpCore *core)
   return G_SOURCE_REMOVE;
 }
 
+/* the properties of a new global, with 'object.id' so that we can filter
+   by id on object managers, unless the id is SPA_ID_INVALID; globals are many
+   and their properties are mostly read, so they are stored with interned keys */
+static WpProperties *
+global_properties_new (const struct spa_dict * props, guint32 id)
+{
+  g_autofree struct spa_dict_item *items =
+      g_new (struct spa_dict_item, (props ? props->n_items : 0) + 1);
+  const struct spa_dict_item *item;
+  gchar id_str[16];
+  guint32 n_items = 0;
+
+  if (props) {
+    spa_dict_for_each (item, props) {
+      if (g_strcmp0 (item->key, PW_KEY_OBJECT_ID) != 0)
+        items[n_items++] = *item;
+    }
+  }
+  if (id != SPA_ID_INVALID) {
+    g_snprintf (id_str, sizeof (id_str), "%u", id);
+    items[n_items++] = SPA_DICT_ITEM_INIT (PW_KEY_OBJECT_ID, id_str);
+  }
+
+  return wp_properties_new_interned_dict (&SPA_DICT_INIT (items, n_items));
+}
+
 /*
  * \param new_global (out) (transfer full) (optional): the new global
  *
@@ -349,14 +412,10 @@ wp_registry_prepare_new_global (WpRegistry * self, guint32 id,
     global->id = id;
     global->type = type;
     global->permissions = permissions;
-    global->properties = props ?
-        wp_properties_new_copy_dict (props) : wp_properties_new_empty ();
+    global->properties = global_properties_new (props, id);
     global->proxy = proxy;
     g_ptr_array_add (self->tmp_globals, wp_global_ref (global));
 
-    /* ensure we have 'object.id' so that we can filter by id on object managers */
-    wp_properties_setf (global->properties, PW_KEY_OBJECT_ID, "%u", global->id);
-
     /* schedule exposing when adding the first global */
     if (self->tmp_globals->len == 1) {
       wp_core_idle_add_closure (core, NULL,
@@ -413,15 +472,32 @@ wp_registry_install_object_manager (WpRegistry * self, WpObjectManager * om)
 {
   guint i;
 
+  g_autoptr (GHashTable) interested_types = NULL;
+
   g_object_weak_ref (G_OBJECT (om), object_manager_destroyed, self);
   g_ptr_array_add (self->object_managers, om);
+  wp_registry_invalidate_object_manager_index (self);
 
   /* add pre-existing objects to the object manager,
-     in case it's interested in them */
+     in case it's interested in them; check the type once per type */
+  interested_types = g_hash_table_new (g_direct_hash, g_direct_equal);
   for (i = 0; i < self->globals->len; i++) {
     WpGlobal *g = g_ptr_array_index (self->globals, i);
+    gpointer interested;
+
     /* check if null because the globals array can have gaps */
-    if (g)
+    if (!g)
+      continue;
+
+    if (!g_hash_table_lookup_extended (interested_types,
+            GSIZE_TO_POINTER (g->type), NULL, &interested)) {
+      interested = GINT_TO_POINTER (
+          wp_object_manager_is_interested_in_type (om, g->type));
+      g_hash_table_insert (interested_types, GSIZE_TO_POINTER (g->type),
+          interested);
+    }
+
+    if (interested)
       wp_object_manager_add_global (om, g);
   }
   for (i = 0; i < self->objects->len; i++) {
@@ -494,7 +570,15 @@ wp_global_rm_flag (WpGlobal *global, guint rm_flag)
      * this WpGlobal is not used in reference to objects added later.
      */
     global->id = SPA_ID_INVALID;
-    wp_properties_setf (global->properties, PW_KEY_OBJECT_ID, NULL);
+
+    /* replace the properties with a copy without 'object.id'; modifying
+       them would free the interned set that proxies may still borrow */
+    {
+      WpProperties *props = global_properties_new (
+          wp_properties_peek_dict (global->properties), SPA_ID_INVALID);
+      wp_properties_unref (global->properties);
+      global->properties = props;
+    }
   }
 
   /* drop the registry's ref on global when it does not appear on the registry anymore */
@@ -30,6 +30,7 @@ struct _WpRegistry
   GPtrArray *tmp_globals; // elementy-type: WpGlobal*
   GPtrArray *objects; // element-type: GObject*
   GPtrArray *object_managers; // element-type: WpObjectManager*
+  GHashTable *om_index; // element-type: <GType, GPtrArray<WpObjectManager*>>
   GPtrArray *features; // element-type: gchar*
 };
 
@@ -48,6 +49,7 @@ void wp_registry_notify_rm_object (WpRegistry * self, gpointer object);
 
 void wp_registry_install_object_manager (WpRegistry * self,
     WpObjectManager * om);
+void wp_registry_invalidate_object_manager_index (WpRegistry * self);
 
 static inline void
 wp_registry_mark_feature_provided (WpRegistry * reg, const gchar * feature)
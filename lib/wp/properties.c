@@ -41,6 +41,14 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("wp-properties")
  * the ownership of the `struct pw_properties` remains outside. This must
  * be used with care, as the `struct pw_properties` may be free'ed externally.
  *
+ * WpProperties created with wp_properties_new_interned_dict() store their
+ * values in one block of memory and share the well-known keys, which are
+ * atoms (GQuarks), with all the other sets, instead of copying them. Keys in
+ * such sets can be looked up with wp_properties_get_atom(), which compares
+ * keys by address instead of comparing strings. They can be modified like
+ * any other set, but they are converted back to a normal
+ * `struct pw_properties` the first time that this happens.
+ *
  * WpProperties is reference-counted with wp_properties_ref() and
  * wp_properties_unref().
  */
@@ -48,6 +56,9 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("wp-properties")
 enum {
   FLAG_IS_DICT = (1<<1),
   FLAG_NO_OWNERSHIP = (1<<2),
+  FLAG_INTERNED = (1<<3),
+  /* an interned set that also has keys that are not atoms */
+  FLAG_COPIED_KEYS = (1<<4),
 };
 
 struct _WpProperties
@@ -62,6 +73,129 @@ struct _WpProperties
 
 G_DEFINE_BOXED_TYPE(WpProperties, wp_properties, wp_properties_ref, wp_properties_unref)
 
+/* Keys that appear on most PipeWire objects. Only these and the keys that
+   were made atoms elsewhere (for instance, by object interests) are shared
+   by interned sets, because atoms are never freed and the keys of PipeWire
+   objects are chosen by clients. Other keys are copied in each set */
+static const gchar * const known_keys[] = {
+  "object.id", "object.serial", "object.path", "object.register",
+  "factory.id", "factory.name", "module.id", "client.id", "client.api",
+  "client.name", "library.name", "metadata.name",
+  "pipewire.access", "pipewire.sec.pid", "pipewire.sec.uid",
+  "pipewire.sec.gid", "pipewire.sec.label", "pipewire.protocol",
+  "application.name", "application.id", "application.icon-name",
+  "application.language", "application.process.id",
+  "application.process.binary", "application.process.user",
+  "application.process.host", "application.process.machine-id",
+  "application.process.session-id",
+  "device.id", "device.name", "device.nick", "device.description",
+  "device.api", "device.class", "device.bus", "device.bus-path",
+  "device.form-factor", "device.icon-name", "device.vendor.id",
+  "device.vendor.name", "device.product.id", "device.product.name",
+  "device.serial", "device.string", "device.enum.api",
+  "node.id", "node.name", "node.nick", "node.description", "node.driver",
+  "node.virtual", "node.plugged", "node.latency", "node.passive",
+  "node.autoconnect", "node.dont-reconnect", "node.link-group",
+  "node.always-process", "node.group", "node.rate",
+  "priority.session", "priority.driver",
+  "media.class", "media.type", "media.category", "media.role", "media.name",
+  "media.title", "media.software", "media.icon-name",
+  "port.id", "port.name", "port.alias", "port.direction", "port.physical",
+  "port.terminal", "port.control", "port.monitor", "port.group",
+  "format.dsp", "audio.channel", "audio.channels", "audio.format",
+  "audio.rate", "audio.position",
+  "link.input.node", "link.input.port", "link.output.node",
+  "link.output.port", "link.passive", "link.feedback",
+  "stream.is-live", "stream.monitor",
+  "api.alsa.path", "api.alsa.card", "api.alsa.pcm.card",
+  "api.alsa.pcm.device", "api.alsa.pcm.stream", "api.alsa.card.name",
+  "api.alsa.card.longname", "api.bluez5.address", "api.bluez5.profile",
+  "api.bluez5.codec", "api.v4l2.path",
+  "card.profile.device", "session.suspend-timeout-seconds",
+  NULL
+};
+
+static void
+ensure_known_atoms (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    for (guint i = 0; known_keys[i]; i++)
+      g_intern_static_string (known_keys[i]);
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+/* copies \a dict in a single allocation, sharing the keys that are atoms;
+   \a copied_keys is set to TRUE if some keys had to be copied */
+static struct spa_dict *
+interned_dict_new (const struct spa_dict * dict, gboolean * copied_keys)
+{
+  const struct spa_dict_item *item;
+  struct spa_dict_item *items;
+  struct spa_dict *d;
+  gsize size = sizeof (struct spa_dict);
+  guint32 n_items = 0;
+  gchar *str;
+
+  ensure_known_atoms ();
+  *copied_keys = FALSE;
+
+  spa_dict_for_each (item, dict) {
+    if (item->key && item->value) {
+      size += sizeof (struct spa_dict_item) + strlen (item->value) + 1;
+      if (!g_quark_try_string (item->key))
+        size += strlen (item->key) + 1;
+      n_items++;
+    }
+  }
+
+  d = g_malloc (size);
+  items = (struct spa_dict_item *) (d + 1);
+  str = (gchar *) (items + n_items);
+  *d = SPA_DICT_INIT (items, 0);
+
+  spa_dict_for_each (item, dict) {
+    GQuark atom;
+    const gchar *key;
+    gsize len;
+
+    if (!item->key || !item->value)
+      continue;
+
+    if ((atom = g_quark_try_string (item->key))) {
+      key = g_quark_to_string (atom);
+    } else {
+      len = strlen (item->key) + 1;
+      memcpy (str, item->key, len);
+      key = str;
+      str += len;
+      *copied_keys = TRUE;
+    }
+
+    len = strlen (item->value) + 1;
+    memcpy (str, item->value, len);
+    items[d->n_items++] = SPA_DICT_ITEM_INIT (key, str);
+    str += len;
+  }
+  return d;
+}
+
+/* converts an interned set to a pw_properties, so that it can be modified;
+   the single block of the interned set is freed, like the values that
+   pw_properties frees when they are modified */
+static void
+ensure_pw_properties (WpProperties * self)
+{
+  if (self->flags & FLAG_INTERNED) {
+    struct spa_dict *interned = (struct spa_dict *) self->dict;
+    self->props = pw_properties_new_dict (interned);
+    self->flags &= ~(FLAG_INTERNED | FLAG_COPIED_KEYS);
+    g_free (interned);
+  }
+}
+
 /*!
  * \brief Creates a new empty properties set
  * \ingroup wpproperties
@@ -298,6 +432,38 @@ wp_properties_new_copy_dict (const struct spa_dict * dict)
   return self;
 }
 
+/*!
+ * \brief Constructs a new WpProperties that contains a copy of all the
+ * properties contained in the given \a dict, with interned keys
+ *
+ * This is meant for large numbers of sets that are mostly read, such as the
+ * properties of PipeWire objects. The whole set is stored in a single block
+ * of memory. Keys that are atoms, such as the well-known PipeWire keys, are
+ * not copied; other keys are copied in the block and never become atoms, so
+ * this can be used with keys that are chosen by other processes.
+ *
+ * The set is converted to a normal `struct pw_properties` when it is first
+ * modified. This invalidates all the strings that were previously returned
+ * by wp_properties_get() on it, not only the modified ones.
+ *
+ * \ingroup wpproperties
+ * \param dict a native `spa_dict` structure to copy
+ * \returns (transfer full): the newly constructed properties set
+ */
+WpProperties *
+wp_properties_new_interned_dict (const struct spa_dict * dict)
+{
+  g_return_val_if_fail (dict != NULL, NULL);
+
+  WpProperties * self = g_slice_new0 (WpProperties);
+  gboolean copied_keys;
+
+  g_ref_count_init (&self->ref);
+  self->dict = interned_dict_new (dict, &copied_keys);
+  self->flags = FLAG_INTERNED | (copied_keys ? FLAG_COPIED_KEYS : 0);
+  return self;
+}
+
 /*!
  * \brief Constructs and returns a new WpProperties object that contains a copy
  * of all the properties contained in \a other.
@@ -316,7 +482,9 @@ wp_properties_copy (WpProperties * other)
 static void
 wp_properties_free (WpProperties * self)
 {
-  if (!(self->flags & FLAG_NO_OWNERSHIP))
+  if (self->flags & FLAG_INTERNED)
+    g_free ((gpointer) self->dict);
+  else if (!(self->flags & FLAG_NO_OWNERSHIP))
     pw_properties_free (self->props);
   g_slice_free (WpProperties, self);
 }
@@ -392,6 +560,7 @@ wp_properties_update (WpProperties * self, WpProperties * props)
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   return pw_properties_update (self->props, wp_properties_peek_dict (props));
 }
@@ -414,6 +583,7 @@ wp_properties_update_from_dict (WpProperties * self,
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   return pw_properties_update (self->props, dict);
 }
@@ -435,6 +605,7 @@ wp_properties_update_from_json (WpProperties * self, const WpSpaJson * json)
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   return pw_properties_update_string (self->props, wp_spa_json_get_data (json),
       wp_spa_json_get_size (json));
@@ -458,6 +629,7 @@ wp_properties_add (WpProperties * self, WpProperties * props)
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   return pw_properties_add (self->props, wp_properties_peek_dict (props));
 }
@@ -481,6 +653,7 @@ wp_properties_add_from_dict (WpProperties * self,
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   return pw_properties_add (self->props, dict);
 }
@@ -509,6 +682,7 @@ wp_properties_update_keys (WpProperties * self, WpProperties * props,
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   va_list args;
   va_start (args, key1);
@@ -544,6 +718,7 @@ wp_properties_update_keys_from_dict (WpProperties * self,
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   va_list args;
   va_start (args, key1);
@@ -572,6 +747,7 @@ wp_properties_update_keys_array (WpProperties * self, WpProperties * props,
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   return pw_properties_update_keys (self->props,
       wp_properties_peek_dict (props), keys);
@@ -600,6 +776,7 @@ wp_properties_add_keys (WpProperties * self, WpProperties * props,
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   va_list args;
   va_start (args, key1);
@@ -636,6 +813,7 @@ wp_properties_add_keys_from_dict (WpProperties * self,
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   va_list args;
   va_start (args, key1);
@@ -666,6 +844,7 @@ wp_properties_add_keys_array (WpProperties * self, WpProperties * props,
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   return pw_properties_add_keys (self->props,
       wp_properties_peek_dict (props), keys);
@@ -689,6 +868,47 @@ wp_properties_get (WpProperties * self, const gchar * key)
   return spa_dict_lookup (wp_properties_peek_dict (self), key);
 }
 
+/*!
+ * \brief Looks up a given property value from a key atom
+ *
+ * In sets that were created with wp_properties_new_interned_dict(), this
+ * compares keys by address, without comparing any strings, unless the set
+ * also has keys that were not atoms when it was created. In any other set,
+ * this is the same as calling wp_properties_get() with the string of
+ * \a atom.
+ *
+ * \ingroup wpproperties
+ * \param self a properties object
+ * \param atom the GQuark of a property key, as returned by
+ *   g_quark_from_string()
+ * \returns (transfer none) (nullable): the value of the property identified
+ *   with \a atom, or NULL if this property is not contained in \a self
+ */
+const gchar *
+wp_properties_get_atom (WpProperties * self, GQuark atom)
+{
+  const struct spa_dict_item *item;
+  const gchar *key;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  if (atom == 0)
+    return NULL;
+
+  key = g_quark_to_string (atom);
+  if (!(self->flags & FLAG_INTERNED))
+    return spa_dict_lookup (wp_properties_peek_dict (self), key);
+
+  spa_dict_for_each (item, self->dict) {
+    if (item->key == key)
+      return item->value;
+  }
+
+  /* the key may have become an atom after this set was created */
+  return (self->flags & FLAG_COPIED_KEYS) ?
+      spa_dict_lookup (self->dict, key) : NULL;
+}
+
 /*!
  * \brief Sets the given property \a key - \a value pair on \a self.
  *
@@ -711,6 +931,7 @@ wp_properties_set (WpProperties * self, const gchar * key,
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   return pw_properties_set (self->props, key, value);
 }
@@ -761,6 +982,7 @@ wp_properties_setf_valist (WpProperties * self, const gchar * key,
   g_return_val_if_fail (self != NULL, -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_IS_DICT), -EINVAL);
   g_return_val_if_fail (!(self->flags & FLAG_NO_OWNERSHIP), -EINVAL);
+  ensure_pw_properties (self);
 
   return pw_properties_setva (self->props, key, format, args);
 }
@@ -964,6 +1186,7 @@ wp_properties_sort (WpProperties * self)
   g_return_if_fail (self != NULL);
   g_return_if_fail (!(self->flags & FLAG_IS_DICT));
   g_return_if_fail (!(self->flags & FLAG_NO_OWNERSHIP));
+  ensure_pw_properties (self);
 
   return spa_dict_qsort (&self->props->dict);
 }
@@ -980,7 +1203,8 @@ wp_properties_peek_dict (WpProperties * self)
 {
   g_return_val_if_fail (self != NULL, NULL);
 
-  return (self->flags & FLAG_IS_DICT) ? self->dict : &self->props->dict;
+  return (self->flags & (FLAG_IS_DICT | FLAG_INTERNED)) ?
+      self->dict : &self->props->dict;
 }
 
 /*!
@@ -1018,6 +1242,7 @@ wp_properties_unref_and_take_pw_properties (WpProperties * self)
   g_return_val_if_fail (self != NULL, NULL);
 
   g_autoptr (WpProperties) unique = wp_properties_ensure_unique_owner (self);
+  ensure_pw_properties (unique);
   /* set the flag so that unref-ing \a unique will not destroy unique->props */
   unique->flags = FLAG_NO_OWNERSHIP;
   return unique->props;
@@ -59,6 +59,9 @@ WpProperties * wp_properties_new_wrap_dict (const struct spa_dict * dict);
 WP_API
 WpProperties * wp_properties_new_copy_dict (const struct spa_dict * dict);
 
+WP_API
+WpProperties * wp_properties_new_interned_dict (const struct spa_dict * dict);
+
 WP_API
 WpProperties * wp_properties_copy (WpProperties * other);
 
@@ -127,6 +130,9 @@ gint wp_properties_add_keys_array (WpProperties * self, WpProperties * props,
 WP_API
 const gchar * wp_properties_get (WpProperties * self, const gchar * key);
 
+WP_API
+const gchar * wp_properties_get_atom (WpProperties * self, GQuark atom);
+
 WP_API
 gint wp_properties_set (WpProperties * self, const gchar * key,
     const gchar * value);
@@ -55,6 +55,29 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("wp-proxy-ifaces")
  *
  * Flags: G_SIGNAL_RUN_FIRST
  * \endparblock
+ *
+ * \par param-entries-changed
+ * \parblock
+ * \code
+ * param_entries_changed_callback (WpPipewireObject * self,
+ *                                 const gchar *id,
+ *                                 GVariant *indexes,
+ *                                 gpointer user_data)
+ * \endcode
+ *
+ * Emitted right before params-changed, with the indexes of the params that
+ * have changed. On proxies that cache params from a remote object, cached
+ * params are compared with the previous ones by their contents, and
+ * neither of the two signals is emitted if none of them changed.
+ *
+ * Parameters:
+ * - `id` - the parameter id as a string (ex "Props", "EnumRoute")
+ * - `indexes` - (nullable) the indexes of the params that were modified,
+ *   added or removed, as an array of uint32 ("au"), or NULL if they are
+ *   not known
+ *
+ * Flags: G_SIGNAL_RUN_FIRST
+ * \endparblock
  */
 
 G_DEFINE_INTERFACE (WpPipewireObject, wp_pipewire_object, WP_TYPE_PROXY)
@@ -79,6 +102,10 @@ wp_pipewire_object_default_init (WpPipewireObjectInterface * iface)
 
   g_signal_new ("params-changed", G_TYPE_FROM_INTERFACE (iface),
       G_SIGNAL_RUN_FIRST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_STRING);
+
+  g_signal_new ("param-entries-changed", G_TYPE_FROM_INTERFACE (iface),
+      G_SIGNAL_RUN_FIRST, 0, NULL, NULL, NULL, G_TYPE_NONE, 2, G_TYPE_STRING,
+      G_TYPE_VARIANT);
 }
 
 /*!
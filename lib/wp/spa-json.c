@@ -61,6 +61,9 @@ struct _WpSpaJson
   gchar *data;
   size_t size;
   struct spa_json *json;
+
+  /* data derived from the json, such as compiled rules */
+  GData *qdata;
 };
 
 G_DEFINE_BOXED_TYPE (WpSpaJson, wp_spa_json, wp_spa_json_ref, wp_spa_json_unref)
@@ -103,6 +106,7 @@ wp_spa_json_ref (WpSpaJson *self)
 static void
 wp_spa_json_free (WpSpaJson *self)
 {
+  g_datalist_clear (&self->qdata);
   g_clear_pointer (&self->builder, wp_spa_json_builder_unref);
   g_slice_free (WpSpaJson, self);
 }
@@ -340,6 +344,43 @@ wp_spa_json_copy (WpSpaJson *other)
   return wp_spa_json_new (other->data, other->size);
 }
 
+/*!
+ * \brief Gets data that was attached to \a self with
+ *   wp_spa_json_set_qdata_full()
+ *
+ * \ingroup wpspajson
+ * \param self a spa json object
+ * \param quark the key of the data
+ * \returns (transfer none)(nullable): the data
+ */
+gpointer
+wp_spa_json_get_qdata (WpSpaJson *self, GQuark quark)
+{
+  g_return_val_if_fail (self, NULL);
+  return g_datalist_id_get_data (&self->qdata, quark);
+}
+
+/*!
+ * \brief Attaches data to \a self, which is freed together with it
+ *
+ * This is used to cache data that is derived from the json, such as
+ * compiled rules; since the json data never changes, the cache remains
+ * valid for as long as \a self is alive.
+ *
+ * \ingroup wpspajson
+ * \param self a spa json object
+ * \param quark the key of the data
+ * \param data (transfer full)(nullable): the data
+ * \param destroy (nullable): the function to free \a data
+ */
+void
+wp_spa_json_set_qdata_full (WpSpaJson *self, GQuark quark, gpointer data,
+    GDestroyNotify destroy)
+{
+  g_return_if_fail (self);
+  g_datalist_id_set_data_full (&self->qdata, quark, data, destroy);
+}
+
 /*!
  * \brief Checks if the json is the unique owner of its data or not
  *
@@ -1619,6 +1660,396 @@ wp_spa_json_parser_end (WpSpaJsonParser *self)
   self->pos = NULL;
 }
 
+/*!
+ * \struct WpSpaJsonCursor
+ *
+ * A cursor iterates the values of a container without allocating: it is
+ * initialized on the stack with wp_spa_json_cursor_init(), advanced with
+ * wp_spa_json_cursor_next() and nested containers are iterated by entering
+ * them with wp_spa_json_cursor_enter(). In objects, keys and values are
+ * returned as consecutive values, like in WpSpaJsonParser.
+ *
+ * \code
+ * WpSpaJsonCursor cursor;
+ * if (wp_spa_json_cursor_init (&cursor, json)) {
+ *   while (wp_spa_json_cursor_next (&cursor)) {
+ *     gsize size;
+ *     const gchar *data = wp_spa_json_cursor_get_data (&cursor, &size);
+ *     ...
+ *   }
+ * }
+ * \endcode
+ *
+ * The values returned by a cursor point to the data of the WpSpaJson that the
+ * cursor was initialized with, which must stay alive while the cursor is used.
+ * Cursors may be copied by value to remember a position.
+ */
+typedef struct _WpSpaJsonCursorReal WpSpaJsonCursorReal;
+struct _WpSpaJsonCursorReal
+{
+  struct spa_json iter;
+  const gchar *value;
+  int size;
+};
+
+G_STATIC_ASSERT (sizeof (WpSpaJsonCursorReal) <= sizeof (WpSpaJsonCursor));
+
+static gboolean
+wp_spa_json_cursor_real_init (WpSpaJsonCursorReal *self, const gchar *data,
+    int size)
+{
+  struct spa_json outer;
+
+  spa_json_init (&outer, data, size);
+  if (spa_json_is_object (data, size)) {
+    if (spa_json_enter_object (&outer, &self->iter) <= 0)
+      return FALSE;
+  } else if (spa_json_is_array (data, size)) {
+    if (spa_json_enter_array (&outer, &self->iter) <= 0)
+      return FALSE;
+  } else {
+    return FALSE;
+  }
+
+  /* the outer iterator only lives on this stack frame; detach from it so
+     that the cursor does not point to it and can be freely copied */
+  self->iter.parent = NULL;
+  self->value = NULL;
+  self->size = 0;
+  return TRUE;
+}
+
+/*!
+ * \brief Initializes a cursor to iterate the values of an array or object
+ *
+ * \ingroup wpspajson
+ * \param self (out caller-allocates): the cursor to initialize
+ * \param json the spa json array or object to iterate
+ * \returns TRUE if the cursor was initialized, FALSE if \a json is not an
+ *   array or an object
+ */
+gboolean
+wp_spa_json_cursor_init (WpSpaJsonCursor *self, WpSpaJson *json)
+{
+  WpSpaJsonCursorReal *real = (WpSpaJsonCursorReal *) self;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (json != NULL, FALSE);
+
+  memset (real, 0, sizeof (*real));
+  return wp_spa_json_cursor_real_init (real, json->data, json->size);
+}
+
+/*!
+ * \brief Initializes a cursor to iterate the top-level values of \a json
+ *
+ * This is the cursor equivalent of wp_spa_json_parser_new_undefined(): the
+ * values are iterated as they appear in \a json, without entering a
+ * container, which is useful for non-standard JSON such as the main
+ * configuration file.
+ *
+ * \ingroup wpspajson
+ * \param self (out caller-allocates): the cursor to initialize
+ * \param json the spa json to iterate
+ */
+void
+wp_spa_json_cursor_init_undefined (WpSpaJsonCursor *self, WpSpaJson *json)
+{
+  WpSpaJsonCursorReal *real = (WpSpaJsonCursorReal *) self;
+
+  g_return_if_fail (self != NULL);
+  g_return_if_fail (json != NULL);
+
+  memset (real, 0, sizeof (*real));
+  spa_json_init (&real->iter, json->data, json->size);
+}
+
+/*!
+ * \brief Initializes \a child to iterate the values of the array or object
+ *   that \a self currently points to
+ *
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \param child (out caller-allocates): the cursor to initialize
+ * \returns TRUE if \a child was initialized, FALSE if the current value of
+ *   \a self is not an array or an object
+ */
+gboolean
+wp_spa_json_cursor_enter (const WpSpaJsonCursor *self, WpSpaJsonCursor *child)
+{
+  const WpSpaJsonCursorReal *real = (const WpSpaJsonCursorReal *) self;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (child != NULL, FALSE);
+
+  if (!real->value)
+    return FALSE;
+  return wp_spa_json_cursor_real_init ((WpSpaJsonCursorReal *) child,
+      real->value, real->size);
+}
+
+/*!
+ * \brief Advances the cursor to the next value
+ *
+ * Arrays and objects are returned as a single value that spans the whole
+ * container.
+ *
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \returns TRUE if the cursor points to a new value, FALSE if the end of the
+ *   container was reached or the data is not valid
+ */
+gboolean
+wp_spa_json_cursor_next (WpSpaJsonCursor *self)
+{
+  WpSpaJsonCursorReal *real = (WpSpaJsonCursorReal *) self;
+  const gchar *value = NULL;
+  int size;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+
+  real->value = NULL;
+  real->size = 0;
+
+  size = spa_json_next (&real->iter, &value);
+  if (size <= 0 || !value)
+    return FALSE;
+
+  if (spa_json_is_container (value, size)) {
+    size = spa_json_container_len (&real->iter, value, size);
+    if (size <= 0)
+      return FALSE;
+  }
+
+  real->value = value;
+  real->size = size;
+  return TRUE;
+}
+
+/*!
+ * \brief Gets the data of the value that the cursor points to
+ *
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \param size (out)(optional): the size of the data
+ * \returns (transfer none)(nullable): a pointer to the value, inside the data
+ *   of the json that is being iterated; it is not NUL-terminated
+ */
+const gchar *
+wp_spa_json_cursor_get_data (const WpSpaJsonCursor *self, gsize *size)
+{
+  const WpSpaJsonCursorReal *real = (const WpSpaJsonCursorReal *) self;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  if (size)
+    *size = real->size;
+  return real->value;
+}
+
+#define CURSOR_VALUE(self) \
+    ((const WpSpaJsonCursorReal *) (self))->value, \
+    ((const WpSpaJsonCursorReal *) (self))->size
+
+/*!
+ * \brief Checks whether the cursor points to a null value
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \returns TRUE if the current value is null, FALSE otherwise
+ */
+gboolean
+wp_spa_json_cursor_is_null (const WpSpaJsonCursor *self)
+{
+  return spa_json_is_null (CURSOR_VALUE (self));
+}
+
+/*!
+ * \brief Checks whether the cursor points to a boolean value
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \returns TRUE if the current value is a boolean, FALSE otherwise
+ */
+gboolean
+wp_spa_json_cursor_is_boolean (const WpSpaJsonCursor *self)
+{
+  return spa_json_is_bool (CURSOR_VALUE (self));
+}
+
+/*!
+ * \brief Checks whether the cursor points to an int value
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \returns TRUE if the current value is an int, FALSE otherwise
+ */
+gboolean
+wp_spa_json_cursor_is_int (const WpSpaJsonCursor *self)
+{
+  return spa_json_is_int (CURSOR_VALUE (self));
+}
+
+/*!
+ * \brief Checks whether the cursor points to a float value
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \returns TRUE if the current value is a float, FALSE otherwise
+ */
+gboolean
+wp_spa_json_cursor_is_float (const WpSpaJsonCursor *self)
+{
+  return spa_json_is_float (CURSOR_VALUE (self));
+}
+
+/*!
+ * \brief Checks whether the cursor points to a quoted string
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \returns TRUE if the current value is a string, FALSE otherwise
+ */
+gboolean
+wp_spa_json_cursor_is_string (const WpSpaJsonCursor *self)
+{
+  return spa_json_is_string (CURSOR_VALUE (self));
+}
+
+/*!
+ * \brief Checks whether the cursor points to an array
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \returns TRUE if the current value is an array, FALSE otherwise
+ */
+gboolean
+wp_spa_json_cursor_is_array (const WpSpaJsonCursor *self)
+{
+  return spa_json_is_array (CURSOR_VALUE (self));
+}
+
+/*!
+ * \brief Checks whether the cursor points to an object
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \returns TRUE if the current value is an object, FALSE otherwise
+ */
+gboolean
+wp_spa_json_cursor_is_object (const WpSpaJsonCursor *self)
+{
+  return spa_json_is_object (CURSOR_VALUE (self));
+}
+
+/*!
+ * \brief Checks whether the cursor points to an array or an object
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \returns TRUE if the current value is a container, FALSE otherwise
+ */
+gboolean
+wp_spa_json_cursor_is_container (const WpSpaJsonCursor *self)
+{
+  return spa_json_is_container (CURSOR_VALUE (self));
+}
+
+/*!
+ * \brief Parses the boolean value that the cursor points to
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \param value (out): the boolean value
+ * \returns TRUE if the value was obtained, FALSE otherwise
+ */
+gboolean
+wp_spa_json_cursor_get_boolean (const WpSpaJsonCursor *self, gboolean *value)
+{
+  return wp_spa_json_parse_boolean_internal (CURSOR_VALUE (self), value);
+}
+
+/*!
+ * \brief Parses the int value that the cursor points to
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \param value (out): the int value
+ * \returns TRUE if the value was obtained, FALSE otherwise
+ */
+gboolean
+wp_spa_json_cursor_get_int (const WpSpaJsonCursor *self, gint *value)
+{
+  return spa_json_parse_int (CURSOR_VALUE (self), value) >= 0;
+}
+
+/*!
+ * \brief Parses the float value that the cursor points to
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \param value (out): the float value
+ * \returns TRUE if the value was obtained, FALSE otherwise
+ */
+gboolean
+wp_spa_json_cursor_get_float (const WpSpaJsonCursor *self, float *value)
+{
+  return spa_json_parse_float (CURSOR_VALUE (self), value) >= 0;
+}
+
+/*!
+ * \brief Parses the string value that the cursor points to into a buffer
+ *
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \param buf (out caller-allocates): the buffer where the NUL-terminated
+ *   string is stored
+ * \param size the size of \a buf, which needs to be larger than the size of
+ *   the (unparsed) value
+ * \returns TRUE if the string was stored in \a buf, FALSE if it does not fit
+ */
+gboolean
+wp_spa_json_cursor_get_string (const WpSpaJsonCursor *self, gchar *buf,
+    gsize size)
+{
+  const WpSpaJsonCursorReal *real = (const WpSpaJsonCursorReal *) self;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (buf != NULL, FALSE);
+
+  if (!real->value || size <= (gsize) real->size)
+    return FALSE;
+  return spa_json_parse_stringn (real->value, real->size, buf, size) >= 0;
+}
+
+/*!
+ * \brief Parses the string value that the cursor points to
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \returns (transfer full)(nullable): the newly allocated parsed string
+ */
+gchar *
+wp_spa_json_cursor_dup_string (const WpSpaJsonCursor *self)
+{
+  const WpSpaJsonCursorReal *real = (const WpSpaJsonCursorReal *) self;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  return real->value ?
+      wp_spa_json_parse_string_internal (real->value, real->size) : NULL;
+}
+
+/*!
+ * \brief Wraps the value that the cursor points to in a WpSpaJson
+ *
+ * \note the returned spa json object references the original data instead
+ * of copying it, therefore the original data must be valid for the entire
+ * life-cycle of the returned object
+ *
+ * \ingroup wpspajson
+ * \param self the cursor
+ * \returns (transfer full)(nullable): the spa json value
+ */
+WpSpaJson *
+wp_spa_json_cursor_get_json (const WpSpaJsonCursor *self)
+{
+  const WpSpaJsonCursorReal *real = (const WpSpaJsonCursorReal *) self;
+
+  g_return_val_if_fail (self != NULL, NULL);
+
+  return real->value ?
+      wp_spa_json_new_wrap_stringn (real->value, real->size) : NULL;
+}
+
 struct _WpSpaJsonIterator
 {
   WpSpaJson *json;
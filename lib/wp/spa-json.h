@@ -67,6 +67,13 @@ WpSpaJson *wp_spa_json_copy (WpSpaJson *other);
 WP_API
 gboolean wp_spa_json_is_unique_owner (WpSpaJson *self);
 
+WP_PRIVATE_API
+gpointer wp_spa_json_get_qdata (WpSpaJson *self, GQuark quark);
+
+WP_PRIVATE_API
+void wp_spa_json_set_qdata_full (WpSpaJson *self, GQuark quark, gpointer data,
+    GDestroyNotify destroy);
+
 WP_API
 WpSpaJson *wp_spa_json_ensure_unique_owner (WpSpaJson *self);
 
@@ -278,6 +285,86 @@ void wp_spa_json_parser_end (WpSpaJsonParser *self);
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (WpSpaJsonParser, wp_spa_json_parser_unref)
 
+/*!
+ * \brief A cursor over the values of a spa json container
+ *
+ * Unlike WpSpaJsonParser, a cursor is meant to be allocated on the stack
+ * and it does not allocate anything while iterating; the current value is
+ * a view into the original data.
+ *
+ * \ingroup wpspajson
+ */
+typedef struct _WpSpaJsonCursor WpSpaJsonCursor;
+struct _WpSpaJsonCursor
+{
+  /*< private >*/
+  gpointer _wp_reserved[12];
+};
+
+WP_API
+gboolean wp_spa_json_cursor_init (WpSpaJsonCursor *self, WpSpaJson *json);
+
+WP_API
+void wp_spa_json_cursor_init_undefined (WpSpaJsonCursor *self,
+    WpSpaJson *json);
+
+WP_API
+gboolean wp_spa_json_cursor_enter (const WpSpaJsonCursor *self,
+    WpSpaJsonCursor *child);
+
+WP_API
+gboolean wp_spa_json_cursor_next (WpSpaJsonCursor *self);
+
+WP_API
+const gchar *wp_spa_json_cursor_get_data (const WpSpaJsonCursor *self,
+    gsize *size);
+
+WP_API
+gboolean wp_spa_json_cursor_is_null (const WpSpaJsonCursor *self);
+
+WP_API
+gboolean wp_spa_json_cursor_is_boolean (const WpSpaJsonCursor *self);
+
+WP_API
+gboolean wp_spa_json_cursor_is_int (const WpSpaJsonCursor *self);
+
+WP_API
+gboolean wp_spa_json_cursor_is_float (const WpSpaJsonCursor *self);
+
+WP_API
+gboolean wp_spa_json_cursor_is_string (const WpSpaJsonCursor *self);
+
+WP_API
+gboolean wp_spa_json_cursor_is_array (const WpSpaJsonCursor *self);
+
+WP_API
+gboolean wp_spa_json_cursor_is_object (const WpSpaJsonCursor *self);
+
+WP_API
+gboolean wp_spa_json_cursor_is_container (const WpSpaJsonCursor *self);
+
+WP_API
+gboolean wp_spa_json_cursor_get_boolean (const WpSpaJsonCursor *self,
+    gboolean *value);
+
+WP_API
+gboolean wp_spa_json_cursor_get_int (const WpSpaJsonCursor *self,
+    gint *value);
+
+WP_API
+gboolean wp_spa_json_cursor_get_float (const WpSpaJsonCursor *self,
+    float *value);
+
+WP_API
+gboolean wp_spa_json_cursor_get_string (const WpSpaJsonCursor *self,
+    gchar *buf, gsize size);
+
+WP_API
+gchar *wp_spa_json_cursor_dup_string (const WpSpaJsonCursor *self);
+
+WP_API
+WpSpaJson *wp_spa_json_cursor_get_json (const WpSpaJsonCursor *self);
+
 G_END_DECLS
 
 #endif
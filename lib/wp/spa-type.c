@@ -52,6 +52,27 @@ static const WpSpaType SPA_TYPE_VENDOR_WirePlumber = 0x03000000;
 static GArray *extra_types = NULL;
 static GArray *extra_id_tables = NULL;
 
+/* Names are resolved with hash tables instead of walking the type tree.
+   The tables of the static types and id tables are built once, on first use;
+   the tables of the dynamic ones are filled in on registration and map names
+   to positions in the arrays above, as these may be reallocated. The values
+   of each id table are indexed by name and short name on the first lookup in
+   that table. Where names are duplicated, the tables keep the entry that the
+   linear lookup would have found first */
+static gsize static_index_initialized = 0;
+static GHashTable *static_types_index = NULL;
+static GHashTable *static_id_tables_index = NULL;
+static GHashTable *extra_types_index = NULL;
+static GHashTable *extra_id_tables_index = NULL;
+
+G_LOCK_DEFINE_STATIC (id_table_indices);
+static GHashTable *id_table_indices = NULL;
+
+typedef struct {
+  GHashTable *names;
+  GHashTable *short_names;
+} WpSpaIdTableIndex;
+
 typedef struct {
   const char *name;
   const struct spa_type_info *values;
@@ -114,37 +135,56 @@ wp_spa_type_info_find_by_type (WpSpaType type)
   return info;
 }
 
-/* similar to spa_debug_type_find() and unlike spa_debug_type_find_type(),
-   which steps into id values / object fields */
-static const struct spa_type_info *
-_spa_type_find_by_name (const struct spa_type_info * info, const char * name)
+static inline void
+index_insert (GHashTable * index, const gchar * name, gconstpointer value)
 {
-  const struct spa_type_info * res;
+  if (!g_hash_table_contains (index, name))
+    g_hash_table_insert (index, (gpointer) name, (gpointer) value);
+}
 
-  while (info->name) {
-    if (info->type == SPA_ID_INVALID) {
-      if (info->values && (res = _spa_type_find_by_name (info->values, name)))
-        return res;
-    }
-    if (strcmp (info->name, name) == 0)
-      return info;
-    info++;
+/* in the same order as spa_debug_type_find() and unlike
+   spa_debug_type_find_type(), which steps into id values / object fields */
+static void
+index_type_names (GHashTable * index, const struct spa_type_info * info)
+{
+  for (; info->name; info++) {
+    if (info->type == SPA_ID_INVALID && info->values)
+      index_type_names (index, info->values);
+    index_insert (index, info->name, info);
+  }
+}
+
+static void
+ensure_static_index (void)
+{
+  if (g_once_init_enter (&static_index_initialized)) {
+    static_types_index = g_hash_table_new (g_str_hash, g_str_equal);
+    index_type_names (static_types_index, SPA_TYPE_ROOT);
+
+    static_id_tables_index = g_hash_table_new (g_str_hash, g_str_equal);
+    for (const WpSpaIdTableInfo *info = static_id_tables; info->name; info++)
+      index_insert (static_id_tables_index, info->name, info->values);
+
+    g_once_init_leave (&static_index_initialized, 1);
   }
-  return NULL;
 }
 
 static const struct spa_type_info *
 wp_spa_type_info_find_by_name (const gchar *name)
 {
   const struct spa_type_info *info = NULL;
+  gpointer pos;
 
   g_return_val_if_fail (name != NULL, NULL);
 
-  if (extra_types)
-    info = _spa_type_find_by_name (
-        (const struct spa_type_info *) extra_types->data, name);
-  else
-    info = _spa_type_find_by_name (SPA_TYPE_ROOT, name);
+  /* the dynamic types chain up to the static ones, which are found first */
+  ensure_static_index ();
+  info = g_hash_table_lookup (static_types_index, name);
+
+  if (!info && extra_types_index &&
+      g_hash_table_lookup_extended (extra_types_index, name, NULL, &pos))
+    info = &g_array_index (extra_types, struct spa_type_info,
+        GPOINTER_TO_UINT (pos));
 
   return info;
 }
@@ -351,31 +391,60 @@ WpSpaIdTable
 wp_spa_id_table_from_name (const gchar *name)
 {
   g_return_val_if_fail (name != NULL, NULL);
-  const WpSpaIdTableInfo *info = NULL;
+  WpSpaIdTable table = NULL;
 
   /* first look in dynamic id tables */
-  if (extra_id_tables) {
-    info = (const WpSpaIdTableInfo *) extra_id_tables->data;
-    while (info && info->name) {
-      if (strcmp (info->name, name) == 0)
-        return info->values;
-      info++;
-    }
-  }
+  if (extra_id_tables_index &&
+      (table = g_hash_table_lookup (extra_id_tables_index, name)))
+    return table;
 
   /* then look at the well-known static ones */
-  info = static_id_tables;
-  while (info && info->name) {
-    if (strcmp (info->name, name) == 0)
-      return info->values;
-    info++;
-  }
+  ensure_static_index ();
+  if ((table = g_hash_table_lookup (static_id_tables_index, name)))
+    return table;
 
   /* then look into types, hoping to find an object type */
   const struct spa_type_info *tinfo = wp_spa_type_info_find_by_name (name);
   return tinfo ? tinfo->values : NULL;
 }
 
+static void
+wp_spa_id_table_index_free (WpSpaIdTableIndex * index)
+{
+  g_hash_table_unref (index->names);
+  g_hash_table_unref (index->short_names);
+  g_free (index);
+}
+
+static WpSpaIdTableIndex *
+wp_spa_id_table_get_index (WpSpaIdTable table)
+{
+  WpSpaIdTableIndex *index;
+
+  G_LOCK (id_table_indices);
+
+  if (G_UNLIKELY (!id_table_indices))
+    id_table_indices = g_hash_table_new_full (NULL, NULL, NULL,
+        (GDestroyNotify) wp_spa_id_table_index_free);
+
+  index = g_hash_table_lookup (id_table_indices, table);
+  if (!index) {
+    index = g_new0 (WpSpaIdTableIndex, 1);
+    index->names = g_hash_table_new (g_str_hash, g_str_equal);
+    index->short_names = g_hash_table_new (g_str_hash, g_str_equal);
+
+    for (const struct spa_type_info *info = table; info->name; info++) {
+      index_insert (index->names, info->name, info);
+      index_insert (index->short_names,
+          spa_debug_type_short_name (info->name), info);
+    }
+    g_hash_table_insert (id_table_indices, (gpointer) table, index);
+  }
+
+  G_UNLOCK (id_table_indices);
+  return index;
+}
+
 /*!
  * \brief This function returns an iterator that allows you to iterate
  * through the values associated with this table.
@@ -434,13 +503,7 @@ wp_spa_id_table_find_value_from_name (WpSpaIdTable table, const gchar * name)
 {
   g_return_val_if_fail (table != NULL, NULL);
 
-  const struct spa_type_info *info = table;
-  while (info && info->name) {
-    if (!strcmp (info->name, name))
-      return info;
-    info++;
-  }
-  return NULL;
+  return g_hash_table_lookup (wp_spa_id_table_get_index (table)->names, name);
 }
 
 /*!
@@ -457,13 +520,8 @@ wp_spa_id_table_find_value_from_short_name (WpSpaIdTable table,
 {
   g_return_val_if_fail (table != NULL, NULL);
 
-  const struct spa_type_info *info = table;
-  while (info && info->name) {
-    if (!strcmp (spa_debug_type_short_name (info->name), short_name))
-      return info;
-    info++;
-  }
-  return NULL;
+  return g_hash_table_lookup (wp_spa_id_table_get_index (table)->short_names,
+      short_name);
 }
 
 static WpSpaIdTable
@@ -675,12 +733,15 @@ wp_spa_dynamic_type_init (void)
 {
   extra_types = g_array_new (TRUE, FALSE, sizeof (struct spa_type_info));
   extra_id_tables = g_array_new (TRUE, FALSE, sizeof (WpSpaIdTableInfo));
+  extra_types_index = g_hash_table_new (g_str_hash, g_str_equal);
+  extra_id_tables_index = g_hash_table_new (g_str_hash, g_str_equal);
 
   /* init to chain up to spa types */
   struct spa_type_info info = {
       SPA_ID_INVALID, SPA_ID_INVALID, "spa_types", SPA_TYPE_ROOT
   };
   g_array_append_val (extra_types, info);
+  index_insert (extra_types_index, info.name, GUINT_TO_POINTER (0));
 }
 
 /*!
@@ -697,6 +758,13 @@ wp_spa_dynamic_type_deinit (void)
 {
   g_clear_pointer (&extra_types, g_array_unref);
   g_clear_pointer (&extra_id_tables, g_array_unref);
+  g_clear_pointer (&extra_types_index, g_hash_table_unref);
+  g_clear_pointer (&extra_id_tables_index, g_hash_table_unref);
+
+  /* the registered id tables may be freed after this */
+  G_LOCK (id_table_indices);
+  g_clear_pointer (&id_table_indices, g_hash_table_unref);
+  G_UNLOCK (id_table_indices);
 }
 
 /*!
@@ -724,6 +792,7 @@ wp_spa_dynamic_type_register (const gchar *name, WpSpaType parent,
   info.name = name;
   info.parent = parent;
   info.values = values;
+  index_insert (extra_types_index, name, GUINT_TO_POINTER (extra_types->len));
   g_array_append_val (extra_types, info);
   return info.type;
 }
@@ -750,5 +819,6 @@ wp_spa_dynamic_id_table_register (const gchar *name,
   info.name = name;
   info.values = values;
   g_array_append_val (extra_id_tables, info);
+  index_insert (extra_id_tables_index, name, values);
   return values;
 }
@@ -8,6 +8,10 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <spa/utils/dict.h>
 
 #include "log.h"
 #include "state.h"
@@ -17,6 +21,8 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("wp-state")
 
 #define DEFAULT_TIMEOUT_MS 1000
 #define ESCAPED_CHARACTER '\\'
+#define LOG_HEADER "# WirePlumber state log 2\n"
+#define MIN_COMPACT_RECORDS 64
 
 static char *
 escape_string (const gchar *str)
@@ -110,12 +116,97 @@ compress_string (const gchar *str)
   return res;
 }
 
+/* The state is stored as a GKeyFile, so that older versions of WirePlumber
+   can still read it, but it is written as a log: saving only appends the
+   "key=value" lines of the keys that changed since the last save, and since
+   GKeyFile keeps the last value of keys that appear more than once, loading
+   replays the log. Removing a key and a log that holds many more records
+   than keys rewrite the whole file (compaction). Files that start with
+   LOG_HEADER are known to be logs that can be appended to; other keyfiles are
+   rewritten on the next save */
+
+/* Appends the "key=value" lines for the given keys, escaped like the keys
+   and values of GKeyFile */
+static void
+log_append_records (GString *str, const gchar *group, GHashTable *records)
+{
+  g_autoptr (GKeyFile) keyfile = g_key_file_new ();
+  g_autofree gchar *data = NULL;
+  const gchar *lines;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_hash_table_iter_init (&iter, records);
+  while (g_hash_table_iter_next (&iter, &key, &value)) {
+    g_autofree gchar *escaped_key = escape_string (key);
+    if (escaped_key)
+      g_key_file_set_string (keyfile, group, escaped_key, value);
+  }
+
+  /* skip the group line */
+  data = g_key_file_to_data (keyfile, NULL, NULL);
+  if (data && (lines = strchr (data, '\n')))
+    g_string_append (str, lines + 1);
+}
+
+/* Loads the keys of @group into @table and returns the number of records,
+   counting keys that appear more than once; for logs, @valid_size is set to
+   the size of the data up to the last complete line, as an interrupted write
+   may have left an incomplete record at the end */
+static guint
+keyfile_parse (const gchar *data, gsize size, const gchar *group,
+    GHashTable *table, goffset *valid_size)
+{
+  g_autoptr (GKeyFile) keyfile = g_key_file_new ();
+  g_auto (GStrv) keys = NULL;
+  guint n_records = 0;
+
+  if (g_str_has_prefix (data, LOG_HEADER)) {
+    while (size > 0 && data[size - 1] != '\n')
+      size--;
+  }
+  *valid_size = size;
+
+  if (!g_key_file_load_from_data (keyfile, data, size, G_KEY_FILE_NONE, NULL))
+    return 0;
+
+  keys = g_key_file_get_keys (keyfile, group, NULL, NULL);
+  if (!keys)
+    return 0;
+
+  for (guint i = 0; keys[i]; i++) {
+    gchar *val = g_key_file_get_string (keyfile, group, keys[i], NULL);
+    gchar *compressed_key = NULL;
+    if (!val)
+      continue;
+    compressed_key = compress_string (keys[i]);
+    if (compressed_key)
+      g_hash_table_replace (table, compressed_key, val);
+    else
+      g_free (val);
+    n_records++;
+  }
+
+  return n_records;
+}
+
 /*! \defgroup wpstate WpState */
 /*!
  * \struct WpState
  *
  * The WpState class saves and loads properties from a file
  *
+ * The file is a key file that is written as an append-only log, so saving
+ * only writes the keys that changed since the last save or load. Keys that
+ * appear more than once take their last value. The file is rewritten when
+ * keys are removed and when it grows too large compared to the amount of
+ * stored keys.
+ *
+ * Since the file remains a valid key file, older versions of WirePlumber can
+ * still load it after a downgrade, with the same contents. When they save
+ * it, they replace it with a plain key file, which is loaded normally and
+ * turned back into a log on the next save.
+ *
  * \gproperties
  * \gproperty{name, gchar *, G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY,
  *   The file name where the state will be stored.}
@@ -138,6 +229,19 @@ struct _WpState
   gchar *location;
   GSource *timeout_source;
   WpProperties *timeout_props;
+
+  /* the contents of the file, as of the last load or save; NULL if unknown */
+  GHashTable *stored;
+  /* the number of records in the log */
+  guint n_records;
+  /* the size of the log after the last write, or -1 if the file needs to be
+     rewritten (it is missing, it is not a log or it was modified externally) */
+  goffset log_size;
+  /* the identity of the file after the last write, to detect modifications
+     that do not change its size */
+  dev_t log_dev;
+  ino_t log_ino;
+  struct timespec log_mtime;
 };
 
 G_DEFINE_TYPE (WpState, wp_state, G_TYPE_OBJECT)
@@ -179,6 +283,168 @@ wp_state_ensure_location (WpState *self)
   g_return_if_fail (self->location);
 }
 
+static GHashTable *
+stored_table_new (void)
+{
+  return g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+}
+
+/* Remembers the identity of the log file, as of the last read or write */
+static void
+wp_state_set_log_stat (WpState *self, const struct stat *st)
+{
+  self->log_dev = st->st_dev;
+  self->log_ino = st->st_ino;
+  self->log_mtime = st->st_mtim;
+}
+
+/* Checks that the log file was not modified or replaced by someone else */
+static gboolean
+wp_state_check_log_stat (WpState *self, const struct stat *st)
+{
+  return st->st_size == self->log_size &&
+      st->st_dev == self->log_dev && st->st_ino == self->log_ino &&
+      st->st_mtim.tv_sec == self->log_mtime.tv_sec &&
+      st->st_mtim.tv_nsec == self->log_mtime.tv_nsec;
+}
+
+/* Reads the file into self->stored */
+static void
+wp_state_read (WpState *self)
+{
+  g_autofree gchar *data = NULL;
+  gsize size = 0;
+  goffset valid_size = 0;
+  struct stat st;
+
+  wp_state_ensure_location (self);
+
+  g_clear_pointer (&self->stored, g_hash_table_unref);
+  self->stored = stored_table_new ();
+  self->n_records = 0;
+  self->log_size = -1;
+
+  if (!g_file_get_contents (self->location, &data, &size, NULL))
+    return;
+
+  self->n_records =
+      keyfile_parse (data, size, self->name, self->stored, &valid_size);
+
+  if (!g_str_has_prefix (data, LOG_HEADER)) {
+    wp_info_object (self, "%s is a plain keyfile; it will be rewritten as a log",
+        self->location);
+  } else if (stat (self->location, &st) == 0) {
+    self->log_size = valid_size;
+    wp_state_set_log_stat (self, &st);
+  }
+}
+
+/* Atomically replaces the file with a log that contains only self->stored */
+static gboolean
+wp_state_compact (WpState *self, GError ** error)
+{
+  g_autoptr (GString) str = g_string_new (LOG_HEADER);
+  GError *err = NULL;
+  struct stat st;
+
+  wp_info_object (self, "saving state into %s", self->location);
+
+  g_string_append_printf (str, "[%s]\n", self->name);
+  log_append_records (str, self->name, self->stored);
+
+  if (!g_file_set_contents (self->location, str->str, str->len, &err)) {
+    self->log_size = -1;
+    g_propagate_prefixed_error (error, err, "could not save %s: ", self->name);
+    return FALSE;
+  }
+
+  self->n_records = g_hash_table_size (self->stored);
+  if (stat (self->location, &st) == 0) {
+    self->log_size = str->len;
+    wp_state_set_log_stat (self, &st);
+  } else {
+    self->log_size = -1;
+  }
+  return TRUE;
+}
+
+/* Appends records to the log; returns FALSE if the log needs to be compacted
+   instead, because it was modified externally or the write failed */
+static gboolean
+wp_state_append (WpState *self, GString *records, guint n_records)
+{
+  struct stat st;
+  gsize written = 0;
+  int fd;
+
+  fd = open (self->location, O_WRONLY | O_APPEND | O_CLOEXEC);
+  if (fd < 0)
+    return FALSE;
+
+  if (fstat (fd, &st) < 0 || !wp_state_check_log_stat (self, &st)) {
+    wp_info_object (self, "%s was modified externally", self->location);
+    close (fd);
+    return FALSE;
+  }
+
+  wp_debug_object (self, "appending %u records to %s", n_records,
+      self->location);
+
+  while (written < records->len) {
+    gssize r = write (fd, records->str + written, records->len - written);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      break;
+    written += r;
+  }
+
+  if (written < records->len) {
+    wp_warning_object (self, "failed to append to %s: %s", self->location,
+        g_strerror (errno));
+    close (fd);
+    self->log_size = -1;
+    return FALSE;
+  }
+
+  self->n_records += n_records;
+  self->log_size += written;
+  if (fstat (fd, &st) == 0)
+    wp_state_set_log_stat (self, &st);
+  else
+    self->log_size = -1;
+  close (fd);
+  return TRUE;
+}
+
+/* Writes the @changed keys, which have already been applied on self->stored;
+   the file is compacted if keys were @removed, since key files cannot express
+   that, and once the log holds more than twice as many records as keys, so
+   that its size stays proportional to the state */
+static gboolean
+wp_state_write (WpState *self, GHashTable *changed, gboolean removed,
+    GError ** error)
+{
+  guint n_records = g_hash_table_size (changed);
+  guint max_records =
+      MAX (MIN_COMPACT_RECORDS, 2 * g_hash_table_size (self->stored));
+
+  if (self->log_size >= 0 && !removed) {
+    g_autoptr (GString) records = NULL;
+
+    if (n_records == 0)
+      return TRUE;
+    if (self->n_records + n_records <= max_records) {
+      records = g_string_new (NULL);
+      log_append_records (records, self->name, changed);
+      if (wp_state_append (self, records, n_records))
+        return TRUE;
+    }
+  }
+
+  return wp_state_compact (self, error);
+}
+
 static void
 wp_state_set_property (GObject * object, guint property_id,
     const GValue * value, GParamSpec * pspec)
@@ -227,6 +493,7 @@ wp_state_finalize (GObject * object)
   g_clear_pointer (&self->location, g_free);
   g_clear_pointer (&self->timeout_source, g_source_unref);
   g_clear_pointer (&self->timeout_props, wp_properties_unref);
+  g_clear_pointer (&self->stored, g_hash_table_unref);
 
   G_OBJECT_CLASS (wp_state_parent_class)->finalize (object);
 }
@@ -235,6 +502,7 @@ static void
 wp_state_init (WpState * self)
 {
   self->timeout = DEFAULT_TIMEOUT_MS;
+  self->log_size = -1;
 }
 
 static void
@@ -313,10 +581,18 @@ wp_state_clear (WpState *self)
   wp_state_ensure_location (self);
   if (remove (self->location) < 0)
     wp_warning ("failed to remove %s: %s", self->location, g_strerror (errno));
+
+  g_clear_pointer (&self->stored, g_hash_table_unref);
+  self->n_records = 0;
+  self->log_size = -1;
 }
 
 /*!
  * \brief Saves new properties in the state, overwriting all previous data.
+ *
+ * Only the keys that were added, changed or removed since the state was last
+ * saved or loaded are written to the file.
+ *
  * \ingroup wpstate
  * \param self the state
  * \param props (transfer none): the properties to save
@@ -326,35 +602,83 @@ wp_state_clear (WpState *self)
 gboolean
 wp_state_save (WpState *self, WpProperties *props, GError ** error)
 {
-  g_autoptr (GKeyFile) keyfile = g_key_file_new ();
-  g_autoptr (WpIterator) it = NULL;
-  g_auto (GValue) item = G_VALUE_INIT;
-  GError *err = NULL;
+  g_autoptr (GHashTable) old = NULL;
+  g_autoptr (GHashTable) changed = stored_table_new ();
+  const struct spa_dict_item *item;
+  gboolean removed = FALSE;
 
   g_return_val_if_fail (WP_IS_STATE (self), FALSE);
   g_return_val_if_fail (props, FALSE);
   wp_state_ensure_location (self);
 
-  wp_info_object (self, "saving state into %s", self->location);
+  old = g_steal_pointer (&self->stored);
+  self->stored = stored_table_new ();
 
-  /* Set the properties */
-  for (it = wp_properties_new_iterator (props);
-      wp_iterator_next (it, &item);
-      g_value_unset (&item)) {
-    WpPropertiesItem *pi = g_value_get_boxed (&item);
-    const gchar *key = wp_properties_item_get_key (pi);
-    const gchar *val = wp_properties_item_get_value (pi);
-    g_autofree gchar *escaped_key = escape_string (key);
-    if (escaped_key)
-      g_key_file_set_string (keyfile, self->name, escaped_key, val);
+  spa_dict_for_each (item, wp_properties_peek_dict (props)) {
+    const gchar *old_value = old ? g_hash_table_lookup (old, item->key) : NULL;
+
+    if (!old_value || !g_str_equal (old_value, item->value))
+      g_hash_table_replace (changed, g_strdup (item->key),
+          g_strdup (item->value));
+    g_hash_table_replace (self->stored, g_strdup (item->key),
+        g_strdup (item->value));
   }
 
-  if (!g_key_file_save_to_file (keyfile, self->location, &err)) {
-    g_propagate_prefixed_error (error, err, "could not save %s: ", self->name);
-    return FALSE;
+  if (old) {
+    GHashTableIter iter;
+    gpointer key;
+
+    g_hash_table_iter_init (&iter, old);
+    while (!removed && g_hash_table_iter_next (&iter, &key, NULL))
+      removed = !g_hash_table_contains (self->stored, key);
+  } else {
+    /* the contents of the file are unknown, so it must be rewritten */
+    self->log_size = -1;
   }
 
-  return TRUE;
+  return wp_state_write (self, changed, removed, error);
+}
+
+/*!
+ * \brief Sets or removes a single key of the state
+ *
+ * This saves a single change without having to pass the whole state to
+ * wp_state_save(). Keys that are not mentioned are left untouched.
+ *
+ * \ingroup wpstate
+ * \param self the state
+ * \param key the key to set
+ * \param value (nullable): the new value of \a key, or NULL to remove it
+ * \param error (out)(optional): return location for a GError, or NULL
+ * \returns TRUE if the change could be saved, FALSE otherwise
+ */
+gboolean
+wp_state_update (WpState *self, const gchar *key, const gchar *value,
+    GError ** error)
+{
+  g_autoptr (GHashTable) changed = stored_table_new ();
+  const gchar *old_value;
+
+  g_return_val_if_fail (WP_IS_STATE (self), FALSE);
+  g_return_val_if_fail (key, FALSE);
+
+  if (!self->stored)
+    wp_state_read (self);
+
+  old_value = g_hash_table_lookup (self->stored, key);
+
+  if (value) {
+    if (old_value && g_str_equal (old_value, value))
+      return wp_state_write (self, changed, FALSE, error);
+    g_hash_table_replace (changed, g_strdup (key), g_strdup (value));
+    g_hash_table_replace (self->stored, g_strdup (key), g_strdup (value));
+    return wp_state_write (self, changed, FALSE, error);
+  } else {
+    if (!old_value)
+      return wp_state_write (self, changed, FALSE, error);
+    g_hash_table_remove (self->stored, key);
+    return wp_state_write (self, changed, TRUE, error);
+  }
 }
 
 static gboolean
@@ -422,36 +746,19 @@ wp_state_save_after_timeout (WpState *self, WpCore *core, WpProperties *props)
 WpProperties *
 wp_state_load (WpState *self)
 {
-  g_autoptr (GKeyFile) keyfile = g_key_file_new ();
-  g_autoptr (WpProperties) props = wp_properties_new_empty ();
-  gchar ** keys = NULL;
+  g_autofree struct spa_dict_item *items = NULL;
+  GHashTableIter iter;
+  gpointer key, value;
+  guint n_items = 0;
 
   g_return_val_if_fail (WP_IS_STATE (self), NULL);
-  wp_state_ensure_location (self);
 
-  /* Open */
-  if (!g_key_file_load_from_file (keyfile, self->location,
-      G_KEY_FILE_NONE, NULL))
-    return g_steal_pointer (&props);
-
-  /* Load all keys */
-  keys = g_key_file_get_keys (keyfile, self->name, NULL, NULL);
-  if (!keys)
-    return g_steal_pointer (&props);
-
-  for (guint i = 0; keys[i]; i++) {
-    g_autofree gchar *compressed_key = NULL;
-    const gchar *key = keys[i];
-    g_autofree gchar *val = NULL;
-    val = g_key_file_get_string (keyfile, self->name, key, NULL);
-    if (!val)
-      continue;
-    compressed_key = compress_string (key);
-    if (compressed_key)
-      wp_properties_set (props, compressed_key, val);
-  }
+  wp_state_read (self);
 
-  g_strfreev (keys);
+  items = g_new (struct spa_dict_item, g_hash_table_size (self->stored));
+  g_hash_table_iter_init (&iter, self->stored);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    items[n_items++] = SPA_DICT_ITEM_INIT (key, value);
 
-  return g_steal_pointer (&props);
+  return wp_properties_new_copy_dict (&SPA_DICT_INIT (items, n_items));
 }
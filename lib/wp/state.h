@@ -39,6 +39,10 @@ void wp_state_clear (WpState *self);
 WP_API
 gboolean wp_state_save (WpState *self, WpProperties *props, GError ** error);
 
+WP_API
+gboolean wp_state_update (WpState *self, const gchar *key, const gchar *value,
+    GError ** error);
+
 WP_API
 void wp_state_save_after_timeout (WpState *self, WpCore *core,
     WpProperties *props);
@@ -28,6 +28,58 @@ wp_log_settings_plugin_init (WpLogSettingsPlugin * self)
 {
 }
 
+static void
+builder_add_int64 (WpSpaJsonBuilder *b, const gchar *key, gint64 value)
+{
+  gchar buf[32];
+  g_snprintf (buf, sizeof (buf), "%" G_GINT64_FORMAT, value);
+  wp_spa_json_builder_add_property (b, key);
+  wp_spa_json_builder_add_from_string (b, buf);
+}
+
+static void
+dump_hook_stats (WpCore * core, WpMetadata *m, guint32 subject,
+    gboolean reset)
+{
+  g_autoptr (WpEventDispatcher) dispatcher =
+      wp_event_dispatcher_get_instance (core);
+  g_autoptr (WpSpaJsonBuilder) b = wp_spa_json_builder_new_array ();
+  g_autoptr (WpIterator) it = NULL;
+  g_auto (GValue) item = G_VALUE_INIT;
+  g_autoptr (WpSpaJson) json = NULL;
+  g_autofree gchar *str = NULL;
+
+  g_return_if_fail (dispatcher);
+
+  it = wp_event_dispatcher_new_hooks_iterator (dispatcher);
+  for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
+    WpEventHook *hook = g_value_get_object (&item);
+    WpEventHookStats stats;
+    g_autoptr (WpSpaJsonBuilder) hb = NULL;
+    g_autoptr (WpSpaJson) hook_json = NULL;
+
+    if (!wp_event_dispatcher_get_hook_stats (dispatcher, hook, &stats))
+      continue;
+
+    hb = wp_spa_json_builder_new_object ();
+    wp_spa_json_builder_add_property (hb, "name");
+    wp_spa_json_builder_add_string (hb, wp_event_hook_get_name (hook));
+    builder_add_int64 (hb, "runs", stats.n_runs);
+    builder_add_int64 (hb, "skipped", stats.n_skipped);
+    builder_add_int64 (hb, "total-time", stats.total_time);
+    builder_add_int64 (hb, "max-time", stats.max_time);
+    hook_json = wp_spa_json_builder_end (hb);
+    wp_spa_json_builder_add_json (b, hook_json);
+  }
+  json = wp_spa_json_builder_end (b);
+  str = wp_spa_json_to_string (json);
+
+  wp_metadata_set (m, subject, "hook-stats", "Spa:String:JSON", str);
+
+  if (reset)
+    wp_event_dispatcher_reset_hook_stats (dispatcher);
+}
+
 static void
 on_metadata_changed (WpMetadata *m, guint32 subject,
     const gchar *key, const gchar *type, const gchar *value, gpointer d)
@@ -41,6 +93,10 @@ on_metadata_changed (WpMetadata *m, guint32 subject,
 
   if (spa_streq(key, "log.level"))
     wp_log_set_level (value ? value : "2");
+  else if (spa_streq(key, "hook-stats.dump") && value) {
+    dump_hook_stats (core, m, subject, spa_streq (value, "reset"));
+    wp_metadata_set (m, subject, "hook-stats.dump", NULL, NULL);
+  }
 }
 
 static void
@@ -351,8 +351,9 @@ log_log (lua_State *L, GLogLevelFlags lvl)
   int index = 1;
   WpLogTopic *topic = log_topic_lua_scripting;
 
-  /* if called with log topic object */
-  if (lua_istable (L, index)) {
+  /* if called with log topic object; a properties table or userdata in this
+     position is skipped as well */
+  if (wplua_isproperties (L, index)) {
     if (lua_getmetatable (L, index)) {
       lua_getfield (L, -1, "__topic");
       if (wplua_isboxed (L, -1, wp_lua_log_topic_get_type ())) {
@@ -826,7 +827,7 @@ object_interest_matches (lua_State *L)
   if (wplua_isobject (L, 2, G_TYPE_OBJECT)) {
     matches = wp_object_interest_matches (interest, wplua_toobject (L, 2));
   }
-  else if (lua_istable (L, 2)) {
+  else if (wplua_isproperties (L, 2)) {
     g_autoptr (WpProperties) props = wplua_table_to_properties (L, 2);
     matches = wp_object_interest_matches (interest, props);
   } else
@@ -988,7 +989,7 @@ impl_metadata_new (lua_State *L)
   WpProperties *properties = NULL;
 
   if (lua_type (L, 2) != LUA_TNONE && lua_type (L, 2) != LUA_TNIL) {
-    luaL_checktype (L, 2, LUA_TTABLE);
+    luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
     properties = wplua_table_to_properties (L, 2);
   }
 
@@ -1008,7 +1009,7 @@ device_new (lua_State *L)
   WpProperties *properties = NULL;
 
   if (lua_type (L, 2) != LUA_TNONE && lua_type (L, 2) != LUA_TNIL) {
-    luaL_checktype (L, 2, LUA_TTABLE);
+    luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
     properties = wplua_table_to_properties (L, 2);
   }
 
@@ -1028,7 +1029,7 @@ spa_device_new (lua_State *L)
   WpProperties *properties = NULL;
 
   if (lua_type (L, 2) != LUA_TNONE && lua_type (L, 2) != LUA_TNIL) {
-    luaL_checktype (L, 2, LUA_TTABLE);
+    luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
     properties = wplua_table_to_properties (L, 2);
   }
 
@@ -1086,7 +1087,7 @@ node_new (lua_State *L)
   WpProperties *properties = NULL;
 
   if (lua_type (L, 2) != LUA_TNONE && lua_type (L, 2) != LUA_TNIL) {
-    luaL_checktype (L, 2, LUA_TTABLE);
+    luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
     properties = wplua_table_to_properties (L, 2);
   }
 
@@ -1195,7 +1196,7 @@ impl_node_new (lua_State *L)
   WpProperties *properties = NULL;
 
   if (lua_type (L, 2) != LUA_TNONE && lua_type (L, 2) != LUA_TNIL) {
-    luaL_checktype (L, 2, LUA_TTABLE);
+    luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
     properties = wplua_table_to_properties (L, 2);
   }
 
@@ -1231,7 +1232,7 @@ link_new (lua_State *L)
   WpProperties *properties = NULL;
 
   if (lua_type (L, 2) != LUA_TNONE && lua_type (L, 2) != LUA_TNIL) {
-    luaL_checktype (L, 2, LUA_TTABLE);
+    luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
     properties = wplua_table_to_properties (L, 2);
   }
 
@@ -1275,7 +1276,10 @@ client_update_permissions (lua_State *L)
   WpClient *client = wplua_checkobject (L, 1, WP_TYPE_CLIENT);
   g_autoptr (GArray) arr = NULL;
 
-  luaL_checktype (L, 2, LUA_TTABLE);
+  luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
+  wplua_pushproperties_as_table (L, 2);
+  lua_replace (L, 2);
+  lua_settop (L, 2);
 
   lua_pushnil(L);
   while (lua_next (L, -2)) {
@@ -1310,7 +1314,7 @@ client_update_properties (lua_State *L)
 {
   WpClient *client = wplua_checkobject (L, 1, WP_TYPE_CLIENT);
 
-  luaL_checktype (L, 2, LUA_TTABLE);
+  luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
   WpProperties *properties = wplua_table_to_properties (L, 2);
 
   wp_client_update_properties (client, properties);
@@ -1373,8 +1377,11 @@ session_item_configure (lua_State *L)
   WpSessionItem *si = wplua_checkobject (L, 1, WP_TYPE_SESSION_ITEM);
   WpProperties *props = wp_properties_new_empty ();
 
-  /* validate arguments */
-  luaL_checktype (L, 2, LUA_TTABLE);
+  /* validate arguments; properties userdata are converted to a table, so
+     that the values assigned from Lua are converted like those of a table */
+  luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
+  wplua_pushproperties_as_table (L, 2);
+  lua_replace (L, 2);
 
   /* build the configuration properties */
   lua_pushnil (L);
@@ -1551,7 +1558,7 @@ static int
 state_save (lua_State *L)
 {
   WpState *state = wplua_checkobject (L, 1, WP_TYPE_STATE);
-  luaL_checktype (L, 2, LUA_TTABLE);
+  luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
   g_autoptr (WpProperties) props = wplua_table_to_properties (L, 2);
   g_autoptr (GError) error = NULL;
   gboolean saved = wp_state_save (state, props, &error);
@@ -1564,7 +1571,7 @@ static int
 state_save_after_timeout (lua_State *L)
 {
   WpState *state = wplua_checkobject (L, 1, WP_TYPE_STATE);
-  luaL_checktype (L, 2, LUA_TTABLE);
+  luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
   g_autoptr (WpProperties) props = wplua_table_to_properties (L, 2);
   wp_state_save_after_timeout (state, get_wp_core (L), props);
   return 0;
@@ -1601,7 +1608,7 @@ impl_module_new (lua_State *L)
     args = luaL_checkstring (L, 2);
 
   if (lua_type (L, 3) != LUA_TNONE && lua_type (L, 3) != LUA_TNIL) {
-    luaL_checktype (L, 3, LUA_TTABLE);
+    luaL_argcheck (L, wplua_isproperties (L, 3), 3, "expected table");
     properties = wplua_table_to_properties (L, 3);
   }
 
@@ -1626,7 +1633,7 @@ conf_new (lua_State *L)
   WpProperties *p = NULL;
   WpConf *conf = NULL;
 
-  if (lua_istable (L, 2)) {
+  if (wplua_isproperties (L, 2)) {
     p = wplua_table_to_properties (L, 2);
   }
 
@@ -1679,7 +1686,7 @@ conf_get_section_as_properties (lua_State *L)
   section = luaL_checkstring (L, argi);
   argi++;
 
-  if (lua_istable (L, argi))
+  if (wplua_isproperties (L, argi))
     props = wplua_table_to_properties (L, argi);
   else
     props = wp_properties_new_empty ();
@@ -1719,8 +1726,8 @@ conf_get_section_as_object (lua_State *L)
     }
   }
 
-  if (lua_istable (L, argi))
-    lua_pushvalue (L, argi);
+  if (wplua_isproperties (L, argi))
+    wplua_pushproperties_as_table (L, argi);
   else
     lua_newtable (L);
   return 1;
@@ -1752,8 +1759,8 @@ conf_get_section_as_array (lua_State *L)
     }
   }
 
-  if (lua_istable (L, argi))
-    lua_pushvalue (L, argi);
+  if (wplua_isproperties (L, argi))
+    wplua_pushproperties_as_table (L, argi);
   else
     lua_newtable (L);
   return 1;
@@ -1846,7 +1853,7 @@ json_utils_match_rules (lua_State *L)
   gboolean res;
 
   json = wplua_checkboxed (L, 1, WP_TYPE_SPA_JSON);
-  luaL_checktype (L, 2, LUA_TTABLE);
+  luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
   luaL_checktype (L, 3, LUA_TFUNCTION);
 
   properties = wplua_table_to_properties (L, 2);
@@ -1870,7 +1877,7 @@ json_utils_match_rules_update_properties (lua_State *L)
   int count;
 
   json = wplua_checkboxed (L, 1, WP_TYPE_SPA_JSON);
-  luaL_checktype (L, 2, LUA_TTABLE);
+  luaL_argcheck (L, wplua_isproperties (L, 2), 2, "expected table");
   properties = wplua_table_to_properties (L, 2);
 
   count = wp_json_utils_match_rules_update_properties (json, properties);
@@ -2179,8 +2186,7 @@ static int
 event_get_properties (lua_State *L)
 {
   WpEvent *event = wplua_checkboxed (L, 1, WP_TYPE_EVENT);
-  g_autoptr (WpProperties) props = wp_event_get_properties (event);
-  wplua_properties_to_table (L, props);
+  wplua_pushproperties (L, wp_event_get_properties (event));
   return 1;
 }
 
@@ -2303,7 +2309,8 @@ event_dispatcher_push_event (lua_State *L)
 
     lua_pushliteral (L, "properties");
     if (lua_gettable (L, 1) != LUA_TNIL) {
-      luaL_checktype (L, -1, LUA_TTABLE);
+      if (!wplua_isproperties (L, -1))
+        luaL_error (L, "EventDispatcher.push_event: expected 'properties' as table");
       properties = wplua_table_to_properties (L, -1);
     }
     lua_pop (L, 1);
@@ -300,6 +300,24 @@ spa_json_object_new (lua_State *L)
 {
   g_autoptr (WpSpaJsonBuilder) builder = wp_spa_json_builder_new_object ();
 
+  /* WpProperties userdata; all values are strings */
+  if (!lua_istable (L, 1) && wplua_isproperties (L, 1)) {
+    g_autoptr (WpProperties) props = wplua_table_to_properties (L, 1);
+    g_autoptr (WpIterator) it = wp_properties_new_iterator (props);
+    g_auto (GValue) item = G_VALUE_INIT;
+
+    for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
+      WpPropertiesItem *pi = g_value_get_boxed (&item);
+      wp_spa_json_builder_add_property (builder,
+          wp_properties_item_get_key (pi));
+      wp_spa_json_builder_add_string (builder,
+          wp_properties_item_get_value (pi));
+    }
+
+    wplua_pushboxed (L, WP_TYPE_SPA_JSON, wp_spa_json_builder_end (builder));
+    return 1;
+  }
+
   luaL_checktype (L, 1, LUA_TTABLE);
 
   lua_pushnil (L);
@@ -10,6 +10,8 @@
 #include <wplua/wplua.h>
 
 #include <spa/utils/type.h>
+#include <spa/utils/type-info.h>
+#include <spa/pod/iter.h>
 
 #define WP_LOCAL_LOG_TOPIC log_topic_lua_scripting
 WP_LOG_TOPIC_EXTERN (log_topic_lua_scripting)
@@ -870,73 +872,80 @@ spa_pod_get_type_name (lua_State *L)
   return 1;
 }
 
+/* Parser; this walks the raw spa_pod in a single pass, instead of wrapping
+   every nested pod, property and array item in a WpSpaPod */
+
 static void
-push_primitive_values (lua_State *L, WpSpaPod *pod, WpSpaType type,
-    guint start_index, WpSpaIdTable idtable)
+push_primitive_values (lua_State *L, guint32 type, guint32 child_size,
+    const void *values, const void *end, WpSpaIdTable idtable)
 {
-  g_auto (GValue) item = G_VALUE_INIT;
-  g_autoptr (WpIterator) it = wp_spa_pod_new_iterator (pod);
-  for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
-    gpointer p = g_value_get_pointer (&item);
-    if (!p)
-      continue;
+  guint i = 1;
+
+  if (child_size == 0)
+    return;
+
+  for (const guint8 *p = values; p + child_size <= (const guint8 *) end;
+       p += child_size) {
     switch (type) {
     case SPA_TYPE_Bool:
-      lua_pushboolean (L, *(gboolean *)p);
+      lua_pushboolean (L, *(const int32_t *)p);
       break;
     case SPA_TYPE_Id: {
       WpSpaIdValue idval = NULL;
       if (idtable)
-        idval = wp_spa_id_table_find_value (idtable, *(guint32 *)p);
+        idval = wp_spa_id_table_find_value (idtable, *(const guint32 *)p);
       if (idval)
         lua_pushstring (L, wp_spa_id_value_short_name (idval));
       else
-        lua_pushinteger (L, *(guint32 *)p);
+        lua_pushinteger (L, *(const guint32 *)p);
       break;
     }
     case SPA_TYPE_Int:
-      lua_pushinteger (L, *(gint *)p);
+      lua_pushinteger (L, *(const gint32 *)p);
       break;
     case SPA_TYPE_Long:
-      lua_pushinteger (L, *(long *)p);
+      lua_pushinteger (L, *(const gint64 *)p);
       break;
     case SPA_TYPE_Float:
-      lua_pushnumber (L, *(float *)p);
+      lua_pushnumber (L, *(const float *)p);
       break;
     case SPA_TYPE_Double:
-      lua_pushnumber (L, *(double *)p);
+      lua_pushnumber (L, *(const double *)p);
       break;
     case SPA_TYPE_Fd:
-      lua_pushnumber (L, *(gint64 *)p);
+      lua_pushnumber (L, *(const gint64 *)p);
       break;
     default:
       continue;
     }
-    lua_rawseti (L, -2, start_index++);
+    lua_rawseti (L, -2, i++);
   }
 }
 
+/* filter_idx: if not 0, the index of a table whose keys are the names of
+   the object properties to convert; the rest are skipped without being
+   converted. This only applies to the top-level object */
 static void
-push_luapod (lua_State *L, WpSpaPod *pod, WpSpaIdValue field_idval)
+push_luapod (lua_State *L, const struct spa_pod *pod, WpSpaIdValue field_idval,
+    int filter_idx)
 {
-  /* None */
-  if (wp_spa_pod_is_none (pod)) {
+  switch (SPA_POD_TYPE (pod)) {
+  case SPA_TYPE_None:
     lua_pushnil (L);
-  }
+    break;
 
-  /* Boolean */
-  else if (wp_spa_pod_is_boolean (pod)) {
-    gboolean value = FALSE;
-    g_warn_if_fail (wp_spa_pod_get_boolean (pod, &value));
+  case SPA_TYPE_Bool: {
+    bool value = false;
+    g_warn_if_fail (spa_pod_get_bool (pod, &value) >= 0);
     lua_pushboolean (L, value);
+    break;
   }
 
-  /* Id */
-  else if (wp_spa_pod_is_id (pod)) {
+  case SPA_TYPE_Id: {
     guint32 value = 0;
     WpSpaIdTable idtable = NULL;
     WpSpaIdValue idval = NULL;
-    g_warn_if_fail (wp_spa_pod_get_id (pod, &value));
+    g_warn_if_fail (spa_pod_get_id (pod, &value) >= 0);
     if (field_idval && SPA_TYPE_Id ==
             wp_spa_id_value_get_value_type (field_idval, &idtable)) {
       idval = wp_spa_id_table_find_value (idtable, value);
@@ -945,174 +954,177 @@ push_luapod (lua_State *L, WpSpaPod *pod, WpSpaIdValue field_idval)
       lua_pushstring (L, wp_spa_id_value_short_name (idval));
     else
       lua_pushinteger (L, value);
+    break;
   }
 
-  /* Int */
-  else if (wp_spa_pod_is_int (pod)) {
-    gint value = 0;
-    g_warn_if_fail (wp_spa_pod_get_int (pod, &value));
+  case SPA_TYPE_Int: {
+    gint32 value = 0;
+    g_warn_if_fail (spa_pod_get_int (pod, &value) >= 0);
     lua_pushinteger (L, value);
+    break;
   }
 
-  /* Long */
-  else if (wp_spa_pod_is_long (pod)) {
+  case SPA_TYPE_Long: {
     gint64 value = 0;
-    wp_spa_pod_get_long (pod, &value);
+    spa_pod_get_long (pod, &value);
     lua_pushinteger (L, value);
+    break;
   }
 
-  /* Float */
-  else if (wp_spa_pod_is_float (pod)) {
+  case SPA_TYPE_Float: {
     float value = 0;
-    g_warn_if_fail (wp_spa_pod_get_float (pod, &value));
+    g_warn_if_fail (spa_pod_get_float (pod, &value) >= 0);
     lua_pushnumber (L, value);
+    break;
   }
 
-  /* Double */
-  else if (wp_spa_pod_is_double (pod)) {
+  case SPA_TYPE_Double: {
     double value = 0;
-    g_warn_if_fail (wp_spa_pod_get_double (pod, &value));
+    g_warn_if_fail (spa_pod_get_double (pod, &value) >= 0);
     lua_pushnumber (L, value);
+    break;
   }
 
-  /* String */
-  else if (wp_spa_pod_is_string (pod)) {
-    const gchar *value = NULL;
-    g_warn_if_fail (wp_spa_pod_get_string (pod, &value));
+  case SPA_TYPE_String: {
+    const char *value = NULL;
+    g_warn_if_fail (spa_pod_get_string (pod, &value) >= 0);
     lua_pushstring (L, value);
+    break;
   }
 
-  /* Bytes */
-  else if (wp_spa_pod_is_bytes (pod)) {
-    gconstpointer value = NULL;
+  case SPA_TYPE_Bytes: {
+    const void *value = NULL;
     guint32 size = 0;
-    g_warn_if_fail (wp_spa_pod_get_bytes (pod, &value, &size));
-    char str[size + 1];
-    for (guint i = 0; i < size; i++)
-      str[i] = ((const gchar *)value)[i];
-    str[size] = '\0';
-    lua_pushstring (L, str);
+    g_warn_if_fail (spa_pod_get_bytes (pod, &value, &size) >= 0);
+    /* like a C string, up to the first nul character */
+    lua_pushlstring (L, value, value ? strnlen (value, size) : 0);
+    break;
   }
 
-  /* Pointer */
-  else if (wp_spa_pod_is_pointer (pod)) {
-    gconstpointer value = NULL;
-    g_warn_if_fail (wp_spa_pod_get_pointer (pod, &value));
+  case SPA_TYPE_Pointer: {
+    const void *value = NULL;
+    guint32 type = 0;
+    g_warn_if_fail (spa_pod_get_pointer (pod, &type, &value) >= 0);
     if (!value)
       lua_pushnil (L);
     else
-      lua_pushlightuserdata (L, (gpointer)value);
+      lua_pushlightuserdata (L, (gpointer) value);
+    break;
   }
 
-  /* Fd */
-  else if (wp_spa_pod_is_fd (pod)) {
+  case SPA_TYPE_Fd: {
     gint64 value = 0;
-    g_warn_if_fail (wp_spa_pod_get_fd (pod, &value));
+    g_warn_if_fail (spa_pod_get_fd (pod, &value) >= 0);
     lua_pushinteger (L, value);
+    break;
   }
 
-  /* Rectangle */
-  else if (wp_spa_pod_is_rectangle (pod)) {
-    guint32 width = 0, height = 0;
-    g_warn_if_fail (wp_spa_pod_get_rectangle (pod, &width, &height));
+  case SPA_TYPE_Rectangle: {
+    struct spa_rectangle value = { 0 };
+    g_warn_if_fail (spa_pod_get_rectangle (pod, &value) >= 0);
     lua_newtable (L);
     lua_pushstring (L, "Rectangle");
     lua_setfield (L, -2, "pod_type");
-    lua_pushinteger (L, width);
+    lua_pushinteger (L, value.width);
     lua_setfield (L, -2, "width");
-    lua_pushinteger (L, height);
+    lua_pushinteger (L, value.height);
     lua_setfield (L, -2, "height");
+    break;
   }
 
-  /* Fraction */
-  else if (wp_spa_pod_is_fraction (pod)) {
-    guint32 num = 0, denom = 0;
-    g_warn_if_fail (wp_spa_pod_get_fraction (pod, &num, &denom));
+  case SPA_TYPE_Fraction: {
+    struct spa_fraction value = { 0 };
+    g_warn_if_fail (spa_pod_get_fraction (pod, &value) >= 0);
     lua_newtable (L);
     lua_pushstring (L, "Fraction");
     lua_setfield (L, -2, "pod_type");
-    lua_pushinteger (L, num);
+    lua_pushinteger (L, value.num);
     lua_setfield (L, -2, "num");
-    lua_pushinteger (L, denom);
+    lua_pushinteger (L, value.denom);
     lua_setfield (L, -2, "denom");
+    break;
   }
 
-  /* Object */
-  else if (wp_spa_pod_is_object (pod)) {
-    WpSpaType type = wp_spa_pod_get_spa_type (pod);
+  case SPA_TYPE_Object: {
+    const struct spa_pod_object *obj = (const struct spa_pod_object *) pod;
+    const struct spa_pod_prop *prop;
+    WpSpaType type = obj->body.type;
     WpSpaIdTable values_table = wp_spa_type_get_values_table (type);
-    const gchar *id_name = NULL;
-    g_auto (GValue) item = G_VALUE_INIT;
-    g_autoptr (WpIterator) it = NULL;
-    g_warn_if_fail (wp_spa_pod_get_object (pod, &id_name, NULL));
+    WpSpaIdTable id_table = wp_spa_type_get_object_id_values_table (type);
+    WpSpaIdValue id_val = id_table ?
+        wp_spa_id_table_find_value (id_table, obj->body.id) : NULL;
     lua_newtable (L);
     lua_pushstring (L, "Object");
     lua_setfield (L, -2, "pod_type");
-    lua_pushstring (L, id_name);
+    lua_pushstring (L, id_val ? wp_spa_id_value_short_name (id_val) : NULL);
     lua_setfield (L, -2, "object_id");
-    it = wp_spa_pod_new_iterator (pod);
     lua_newtable (L);
-    for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
-      WpSpaPod *prop = g_value_get_boxed (&item);
-      const gchar *key = NULL;
-      g_autoptr (WpSpaPod) val = NULL;
-      //FIXME: this is suboptimal because _get_property() converts
-      // the key to a short name and we convert it back
-      g_warn_if_fail (wp_spa_pod_get_property (prop, &key, &val));
-      if (key) {
-        push_luapod (L, val,
-            wp_spa_id_table_find_value_from_short_name (values_table, key));
-        lua_setfield (L, -2, key);
+    SPA_POD_OBJECT_FOREACH (obj, prop) {
+      WpSpaIdValue key_val = values_table ?
+          wp_spa_id_table_find_value (values_table, prop->key) : NULL;
+      gchar id_key[12];
+      const gchar *key;
+
+      if (key_val) {
+        key = wp_spa_id_value_short_name (key_val);
+      } else {
+        g_snprintf (id_key, sizeof (id_key), "id-%08x", prop->key);
+        key = id_key;
+      }
+
+      if (filter_idx) {
+        gboolean selected = (lua_getfield (L, filter_idx, key) != LUA_TNIL);
+        lua_pop (L, 1);
+        if (!selected)
+          continue;
       }
+
+      push_luapod (L, &prop->value, key_val, 0);
+      lua_setfield (L, -2, key);
     }
     lua_setfield (L, -2, "properties");
+    break;
   }
 
-  /* Struct */
-  else if (wp_spa_pod_is_struct (pod)) {
-    g_auto (GValue) item = G_VALUE_INIT;
-    g_autoptr (WpIterator) it = wp_spa_pod_new_iterator (pod);
+  case SPA_TYPE_Struct: {
+    const struct spa_pod *field;
     guint i = 1;
     lua_newtable (L);
     lua_pushstring (L, "Struct");
     lua_setfield (L, -2, "pod_type");
-    for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
-      WpSpaPod *val = g_value_get_boxed (&item);
-      push_luapod (L, val, NULL);
+    SPA_POD_STRUCT_FOREACH (pod, field) {
+      push_luapod (L, field, NULL, 0);
       lua_rawseti (L, -2, i++);
     }
+    break;
   }
 
-  /* Sequence */
-  else if (wp_spa_pod_is_sequence (pod)) {
-    g_auto (GValue) item = G_VALUE_INIT;
-    g_autoptr (WpIterator) it = wp_spa_pod_new_iterator (pod);
+  case SPA_TYPE_Sequence: {
+    const struct spa_pod_sequence *seq = (const struct spa_pod_sequence *) pod;
+    const struct spa_pod_control *control;
     guint i = 1;
     lua_newtable (L);
     lua_pushstring (L, "Sequence");
     lua_setfield (L, -2, "pod_type");
-    for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
-      WpSpaPod *control = g_value_get_boxed (&item);
-      guint32 offset = 0;
-      const char *type_name = NULL;
-      g_autoptr (WpSpaPod) val = NULL;
-      g_warn_if_fail (wp_spa_pod_get_control (control, &offset, &type_name,
-          &val));
+    SPA_POD_SEQUENCE_FOREACH (seq, control) {
+      WpSpaIdValue type_val =
+          wp_spa_id_value_from_number (SPA_TYPE_INFO_Control, control->type);
       lua_newtable (L);
-      lua_pushinteger (L, offset);
+      lua_pushinteger (L, control->offset);
       lua_setfield (L, -2, "offset");
-      lua_pushstring (L, type_name);
+      lua_pushstring (L,
+          type_val ? wp_spa_id_value_short_name (type_val) : NULL);
       lua_setfield (L, -2, "typename");
-      push_luapod (L, val, NULL);
+      push_luapod (L, &control->value, NULL, 0);
       lua_setfield (L, -2, "value");
       lua_rawseti (L, -2, i++);
     }
+    break;
   }
 
-  /* Array */
-  else if (wp_spa_pod_is_array (pod)) {
-    g_autoptr (WpSpaPod) child = wp_spa_pod_get_array_child (pod);
-    WpSpaType type = wp_spa_pod_get_spa_type (child);
+  case SPA_TYPE_Array: {
+    const struct spa_pod_array *arr = (const struct spa_pod_array *) pod;
+    WpSpaType type = arr->body.child.type;
     WpSpaIdTable idtable = NULL;
     if (field_idval && type == SPA_TYPE_Id && SPA_TYPE_Array ==
             wp_spa_id_value_get_value_type (field_idval, &idtable))
@@ -1122,30 +1134,35 @@ push_luapod (lua_State *L, WpSpaPod *pod, WpSpaIdValue field_idval)
     lua_setfield (L, -2, "pod_type");
     lua_pushstring (L, wp_spa_type_name (type));
     lua_setfield (L, -2, "value_type");
-    push_primitive_values (L, pod, type, 1, idtable);
+    push_primitive_values (L, type, arr->body.child.size,
+        SPA_PTROFF (&arr->body, sizeof (struct spa_pod_array_body), void),
+        SPA_PTROFF (&arr->body, SPA_POD_BODY_SIZE (arr), void), idtable);
+    break;
   }
 
-  /* Choice */
-  else if (wp_spa_pod_is_choice (pod)) {
-    g_autoptr (WpSpaPod) child = wp_spa_pod_get_choice_child (pod);
-    WpSpaType type = wp_spa_pod_get_spa_type (child);
-    g_autofree const gchar *choice_type = g_strdup_printf ("Choice.%s",
-        wp_spa_id_value_short_name (wp_spa_pod_get_choice_type (pod)));
+  case SPA_TYPE_Choice: {
+    const struct spa_pod_choice *choice = (const struct spa_pod_choice *) pod;
+    WpSpaType type = choice->body.child.type;
+    WpSpaIdValue choice_val = wp_spa_id_value_from_number (
+        SPA_TYPE_INFO_Choice, choice->body.type);
     WpSpaIdTable idtable = NULL;
     if (field_idval && type == SPA_TYPE_Id)
       wp_spa_id_value_get_value_type (field_idval, &idtable);
     lua_newtable (L);
-    lua_pushstring (L, choice_type);
+    lua_pushfstring (L, "Choice.%s",
+        choice_val ? wp_spa_id_value_short_name (choice_val) : "(null)");
     lua_setfield (L, -2, "pod_type");
     lua_pushstring (L, wp_spa_type_name (type));
     lua_setfield (L, -2, "value_type");
-    push_primitive_values (L, pod, type, 1, idtable);
+    push_primitive_values (L, type, choice->body.child.size,
+        SPA_PTROFF (&choice->body, sizeof (struct spa_pod_choice_body), void),
+        SPA_PTROFF (&choice->body, SPA_POD_BODY_SIZE (choice), void), idtable);
+    break;
   }
 
-  /* Error */
-  else {
-    luaL_error (L, "Unsupported pod type ",
-        wp_spa_type_name (wp_spa_pod_get_spa_type (pod)));
+  default:
+    luaL_error (L, "Unsupported pod type %s",
+        wp_spa_type_name (SPA_POD_TYPE (pod)));
   }
 }
 
@@ -1153,7 +1170,21 @@ static int
 spa_pod_parse (lua_State *L)
 {
   WpSpaPod *pod = wplua_checkboxed (L, 1, WP_TYPE_SPA_POD);
-  push_luapod (L, pod, NULL);
+  int filter_idx = 0;
+
+  /* the optional argument is a list of the object properties to convert */
+  if (!lua_isnoneornil (L, 2)) {
+    luaL_checktype (L, 2, LUA_TTABLE);
+    lua_newtable (L);
+    for (lua_Integer i = 1; lua_rawgeti (L, 2, i) != LUA_TNIL; i++) {
+      lua_pushboolean (L, TRUE);
+      lua_rawset (L, -3);
+    }
+    lua_pop (L, 1);
+    filter_idx = lua_gettop (L);
+  }
+
+  push_luapod (L, wp_spa_pod_get_spa_pod (pod), NULL, filter_idx);
   return 1;
 }
 
@@ -21,6 +21,14 @@ struct _WpLuaScriptingPlugin
 {
   WpPlugin parent;
   lua_State *L;
+
+  /* gc policy */
+  WpLuaGcMode gc_mode;
+  gint gc_step_size;
+  gint64 gc_idle_budget;
+  gboolean gc_collect_after_call;
+
+  gboolean bytecode_cache;
 };
 
 static int
@@ -90,6 +98,7 @@ G_DEFINE_TYPE_WITH_CODE (WpLuaScriptingPlugin, wp_lua_scripting_plugin,
 static void
 wp_lua_scripting_plugin_init (WpLuaScriptingPlugin * self)
 {
+  self->bytecode_cache = TRUE;
 }
 
 static void
@@ -100,6 +109,19 @@ wp_lua_scripting_plugin_enable (WpPlugin * plugin, WpTransition * transition)
 
   /* init lua engine */
   self->L = wplua_new ();
+  wplua_set_gc_policy (self->L, self->gc_mode, self->gc_step_size,
+      self->gc_idle_budget, self->gc_collect_after_call);
+
+  /* cache compiled scripts; only in the daemon, so that tools and tests
+     do not leave files around */
+  if (self->bytecode_cache) {
+    g_autoptr (WpProperties) p = wp_core_get_properties (core);
+    if (!g_strcmp0 (wp_properties_get (p, "wireplumber.daemon"), "true")) {
+      g_autofree gchar *dir = g_build_filename (g_get_user_cache_dir (),
+          "wireplumber", "lua-bytecode", NULL);
+      wplua_enable_bytecode_cache (self->L, dir);
+    }
+  }
 
   lua_pushliteral (self->L, "wireplumber_core");
   lua_pushlightuserdata (self->L, core);
@@ -220,8 +242,31 @@ wp_lua_scripting_component_loader_init (WpComponentLoaderInterface * iface)
 WP_PLUGIN_EXPORT GObject *
 wireplumber__module_init (WpCore * core, WpSpaJson * args, GError ** error)
 {
-  return G_OBJECT (g_object_new (wp_lua_scripting_plugin_get_type (),
+  WpLuaScriptingPlugin *self = g_object_new (wp_lua_scripting_plugin_get_type (),
       "name", "lua-scripting",
       "core", core,
-      NULL));
+      NULL);
+
+  if (args) {
+    g_autofree gchar *mode = NULL;
+    gint idle_budget = 0;
+
+    /* each key is optional, so look them up separately */
+    wp_spa_json_object_get (args, "gc.mode", "s", &mode, NULL);
+    wp_spa_json_object_get (args, "gc.step-size", "i", &self->gc_step_size,
+        NULL);
+    wp_spa_json_object_get (args, "gc.idle-budget", "i", &idle_budget, NULL);
+    wp_spa_json_object_get (args, "gc.collect-after-call", "b",
+        &self->gc_collect_after_call, NULL);
+    wp_spa_json_object_get (args, "bytecode-cache", "b",
+        &self->bytecode_cache, NULL);
+
+    if (!g_strcmp0 (mode, "generational"))
+      self->gc_mode = WP_LUA_GC_MODE_GENERATIONAL;
+    else if (mode && g_strcmp0 (mode, "incremental"))
+      wp_warning_object (self, "unknown gc.mode '%s', using incremental", mode);
+    self->gc_idle_budget = idle_budget;
+  }
+
+  return G_OBJECT (self);
 }
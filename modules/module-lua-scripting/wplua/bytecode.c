@@ -0,0 +1,204 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "wplua.h"
+#include "private.h"
+#include <wp/wp.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <string.h>
+
+/* Compiled chunks are cached in one file per source, named after a hash of
+   the source location, so that recompiling a modified source overwrites its
+   previous entry. The first line of the file is a hash of everything that
+   invalidates the chunk: the modification time and size of the source (or
+   its contents, for resources, which have no modification time) and the Lua
+   release. A chunk whose hash differs or that fails to load is silently
+   recompiled from source, which also covers incompatible builds of the same
+   Lua release. Loading an entry updates its modification time, so entries
+   that have been neither loaded nor written for BYTECODE_CACHE_MAX_AGE
+   belong to sources that are gone or no longer loaded, and are removed */
+
+#define BYTECODE_CACHE_MAX_AGE (30 * G_TIME_SPAN_DAY)
+
+static const gchar *
+_wplua_bytecode_cache_dir (lua_State *L)
+{
+  const gchar *dir;
+
+  lua_pushliteral (L, "wplua_bytecode_cache");
+  lua_rawget (L, LUA_REGISTRYINDEX);
+  dir = lua_tostring (L, -1);
+  lua_pop (L, 1);
+  return dir;
+}
+
+gchar *
+_wplua_bytecode_cache_path (lua_State *L, GFile *file)
+{
+  const gchar *dir = _wplua_bytecode_cache_dir (L);
+  g_autofree gchar *uri = NULL;
+  g_autofree gchar *hash = NULL;
+  g_autofree gchar *filename = NULL;
+
+  if (!dir)
+    return NULL;
+
+  uri = g_file_get_uri (file);
+  hash = g_compute_checksum_for_string (G_CHECKSUM_SHA256, uri, -1);
+  filename = g_strconcat (hash, ".luac", NULL);
+  return g_build_filename (dir, filename, NULL);
+}
+
+gchar *
+_wplua_bytecode_cache_key (GFile *file, GBytes *bytes)
+{
+  g_autofree gchar *key = NULL;
+
+  if (bytes) {
+    g_autofree gchar *content_hash =
+        g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, bytes);
+    key = g_strdup_printf ("%s\n%s", content_hash, LUA_RELEASE);
+  } else {
+    g_autoptr (GFileInfo) info = g_file_query_info (file,
+        G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+        G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+        G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+        G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    if (!info || !g_file_info_has_attribute (info,
+            G_FILE_ATTRIBUTE_TIME_MODIFIED))
+      return NULL;
+
+    key = g_strdup_printf ("%" G_GUINT64_FORMAT ".%u\n%" G_GOFFSET_FORMAT
+        "\n%s",
+        g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+        g_file_info_get_attribute_uint32 (info,
+            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC),
+        g_file_info_get_size (info), LUA_RELEASE);
+  }
+
+  return g_compute_checksum_for_string (G_CHECKSUM_SHA256, key, -1);
+}
+
+gboolean
+_wplua_bytecode_cache_load (lua_State *L, const gchar *path, const gchar *key,
+    const gchar *name)
+{
+  g_autofree gchar *data = NULL;
+  gsize size = 0;
+  gsize key_len = strlen (key);
+
+  if (!g_file_get_contents (path, &data, &size, NULL))
+    return FALSE;
+
+  if (size <= key_len || data[key_len] != '\n' ||
+      memcmp (data, key, key_len) != 0) {
+    wp_debug ("ignoring stale bytecode cache %s", path);
+    return FALSE;
+  }
+
+  if (luaL_loadbufferx (L, data + key_len + 1, size - key_len - 1, name,
+          "b") != LUA_OK) {
+    wp_debug ("ignoring bytecode cache %s: %s", path, lua_tostring (L, -1));
+    lua_pop (L, 1);
+    return FALSE;
+  }
+
+  /* mark the entry as used, so that it is not pruned */
+  if (g_utime (path, NULL) < 0)
+    wp_debug ("failed to update bytecode cache %s: %s", path,
+        g_strerror (errno));
+
+  wp_trace ("loaded %s from bytecode cache %s", name, path);
+  return TRUE;
+}
+
+static int
+_wplua_bytecode_writer (lua_State *L, const void *p, size_t sz, void *ud)
+{
+  g_byte_array_append ((GByteArray *) ud, p, sz);
+  return 0;
+}
+
+void
+_wplua_bytecode_cache_store (lua_State *L, const gchar *path, const gchar *key)
+{
+  g_autoptr (GByteArray) buf = g_byte_array_new ();
+  g_autoptr (GError) error = NULL;
+
+  g_byte_array_append (buf, (const guint8 *) key, strlen (key));
+  g_byte_array_append (buf, (const guint8 *) "\n", 1);
+
+  /* keep debug information, for meaningful error messages */
+  if (lua_dump (L, _wplua_bytecode_writer, buf, 0) != 0) {
+    wp_debug ("failed to dump bytecode for %s", path);
+    return;
+  }
+
+  /* this replaces the entry of the previous version of the source, if any */
+  if (!g_file_set_contents (path, (const gchar *) buf->data, buf->len,
+          &error))
+    wp_debug ("failed to write bytecode cache: %s", error->message);
+}
+
+/* removes the entries that have not been loaded or written for a long time */
+static void
+_wplua_bytecode_cache_prune (const gchar *dir)
+{
+  g_autoptr (GDir) d = g_dir_open (dir, 0, NULL);
+  gint64 now = g_get_real_time ();
+  const gchar *name;
+
+  while (d && (name = g_dir_read_name (d))) {
+    g_autofree gchar *path = NULL;
+    GStatBuf st;
+
+    if (!g_str_has_suffix (name, ".luac"))
+      continue;
+
+    path = g_build_filename (dir, name, NULL);
+    if (g_stat (path, &st) == 0 &&
+        now - (gint64) st.st_mtime * G_USEC_PER_SEC > BYTECODE_CACHE_MAX_AGE) {
+      wp_debug ("removing old bytecode cache %s", path);
+      g_remove (path);
+    }
+  }
+}
+
+/**
+ * wplua_enable_bytecode_cache:
+ * @param L: the lua_State
+ * @param dir: the directory where compiled chunks are stored; it is
+ *   created if it does not exist
+ *
+ * Makes wplua_load_uri() and wplua_load_path() keep a cache of compiled
+ * chunks in @em dir and load them from there instead of compiling the source
+ * again, as long as the source has not been modified. Entries that have not
+ * been loaded or written for 30 days are removed from @em dir when it is enabled.
+ *
+ * Loading bytecode is not safe against malicious input, so @em dir must only
+ * be writable by the current user.
+ */
+void
+wplua_enable_bytecode_cache (lua_State *L, const gchar *dir)
+{
+  g_return_if_fail (L != NULL);
+  g_return_if_fail (dir != NULL);
+
+  if (g_mkdir_with_parents (dir, 0700) < 0) {
+    wp_warning ("failed to create bytecode cache directory %s: %s", dir,
+        g_strerror (errno));
+    return;
+  }
+
+  wp_debug ("using bytecode cache in %s", dir);
+  _wplua_bytecode_cache_prune (dir);
+
+  lua_pushliteral (L, "wplua_bytecode_cache");
+  lua_pushstring (L, dir);
+  lua_rawset (L, LUA_REGISTRYINDEX);
+}
@@ -101,9 +101,10 @@ _wplua_closure_marshal (GClosure *closure, GValue *return_value,
   }
 
   /* clean up */
-  lua_gc (L, LUA_GCCOLLECT, 0);
-  if (reentrant == 0)
+  if (reentrant == 0) {
     lua_gc (L, LUA_GCRESTART, 0);
+    _wplua_gc_after_call (L);
+  }
 }
 
 static void
@@ -0,0 +1,177 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "wplua.h"
+#include "private.h"
+#include <wp/wp.h>
+
+#define DEFAULT_STEP_SIZE 16
+#define DEFAULT_IDLE_BUDGET 1000
+
+/* The garbage collector is stopped while a closure runs (see closure.c) and
+   the debt that accumulates during the call is paid back in small steps from
+   an idle source, so that the main loop never blocks on a full collection.
+   The policy lives in the registry and is freed when the lua_State closes,
+   which also destroys any pending idle source */
+typedef struct _WpLuaGcPolicy WpLuaGcPolicy;
+struct _WpLuaGcPolicy
+{
+  lua_State *L;
+  WpLuaGcMode mode;
+  gint step_size;
+  gint64 idle_budget;
+  gboolean collect_after_call;
+  GSource *idle_source;
+};
+
+static WpLuaGcPolicy *
+_wplua_gc_policy_new (lua_State *L)
+{
+  WpLuaGcPolicy *self = g_rc_box_new0 (WpLuaGcPolicy);
+  self->L = L;
+  self->mode = WP_LUA_GC_MODE_INCREMENTAL;
+  self->step_size = DEFAULT_STEP_SIZE;
+  self->idle_budget = DEFAULT_IDLE_BUDGET;
+  return self;
+}
+
+static void
+_wplua_gc_policy_finalize (WpLuaGcPolicy * self)
+{
+  if (self->idle_source) {
+    g_source_destroy (self->idle_source);
+    g_clear_pointer (&self->idle_source, g_source_unref);
+  }
+}
+
+static WpLuaGcPolicy *
+_wplua_gc_policy_ref (WpLuaGcPolicy * self)
+{
+  return g_rc_box_acquire (self);
+}
+
+static void
+_wplua_gc_policy_unref (WpLuaGcPolicy * self)
+{
+  g_rc_box_release_full (self, (GDestroyNotify) _wplua_gc_policy_finalize);
+}
+
+G_DEFINE_BOXED_TYPE(WpLuaGcPolicy, _wplua_gc_policy,
+    _wplua_gc_policy_ref, _wplua_gc_policy_unref)
+
+static WpLuaGcPolicy *
+_wplua_gc_policy_get (lua_State *L)
+{
+  WpLuaGcPolicy *self;
+
+  lua_pushliteral (L, "wplua_gc_policy");
+  lua_gettable (L, LUA_REGISTRYINDEX);
+  self = wplua_toboxed (L, -1);
+  lua_pop (L, 1);
+  return self;
+}
+
+static gboolean
+_wplua_gc_idle_step (WpLuaGcPolicy * self)
+{
+  gint64 deadline = g_get_monotonic_time () + self->idle_budget;
+  gboolean done = FALSE;
+
+  /* in generational mode, a step is a whole (minor) collection and the
+     collector never reports the end of a cycle, so run it only once */
+  if (self->mode == WP_LUA_GC_MODE_GENERATIONAL) {
+    lua_gc (self->L, LUA_GCSTEP, 0);
+    done = TRUE;
+  } else {
+    do {
+      done = lua_gc (self->L, LUA_GCSTEP, self->step_size);
+    } while (!done && g_get_monotonic_time () < deadline);
+  }
+
+  if (done) {
+    wp_trace_boxed (_wplua_gc_policy_get_type (), self, "gc cycle finished");
+    g_clear_pointer (&self->idle_source, g_source_unref);
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+void
+_wplua_gc_after_call (lua_State *L)
+{
+  WpLuaGcPolicy *self = _wplua_gc_policy_get (L);
+
+  if (G_UNLIKELY (!self || self->collect_after_call)) {
+    lua_gc (L, LUA_GCCOLLECT, 0);
+    return;
+  }
+
+  if (!self->idle_source) {
+    self->idle_source = g_idle_source_new ();
+    g_source_set_priority (self->idle_source, G_PRIORITY_LOW);
+    g_source_set_callback (self->idle_source,
+        G_SOURCE_FUNC (_wplua_gc_idle_step), self, NULL);
+    g_source_attach (self->idle_source, g_main_context_get_thread_default ());
+  }
+}
+
+/**
+ * wplua_set_gc_policy:
+ * @param L: the lua_State
+ * @param mode: the collector mode
+ * @param step_size: the amount of work (in KB) done on each incremental step,
+ *   or 0 to keep the current value
+ * @param idle_budget: the maximum time (in microseconds) spent collecting in
+ *   a single main loop idle iteration, or 0 to keep the current value
+ * @param collect_after_call: run a full collection after every closure call;
+ *   this is very expensive and only meant for debugging memory leaks
+ *
+ * Configures how the garbage collector of @em L reclaims the memory allocated
+ * while running closures.
+ */
+void
+wplua_set_gc_policy (lua_State *L, WpLuaGcMode mode, gint step_size,
+    gint64 idle_budget, gboolean collect_after_call)
+{
+  WpLuaGcPolicy *self = _wplua_gc_policy_get (L);
+  g_return_if_fail (self != NULL);
+
+#if LUA_VERSION_NUM >= 504
+  if (mode == WP_LUA_GC_MODE_GENERATIONAL)
+    lua_gc (L, LUA_GCGEN, 0, 0);
+  else
+    lua_gc (L, LUA_GCINC, 0, 0, 0);
+#else
+  if (mode == WP_LUA_GC_MODE_GENERATIONAL) {
+    wp_warning ("generational GC requires Lua 5.4; using incremental mode");
+    mode = WP_LUA_GC_MODE_INCREMENTAL;
+  }
+#endif
+
+  self->mode = mode;
+  if (step_size > 0)
+    self->step_size = step_size;
+  if (idle_budget > 0)
+    self->idle_budget = idle_budget;
+  self->collect_after_call = collect_after_call;
+
+  wp_debug ("gc policy: %s mode, step %d KB, idle budget %" G_GINT64_FORMAT
+      " us%s",
+      mode == WP_LUA_GC_MODE_GENERATIONAL ? "generational" : "incremental",
+      self->step_size, self->idle_budget,
+      collect_after_call ? ", full collection after each call" : "");
+}
+
+void
+_wplua_init_gc (lua_State *L)
+{
+  lua_pushliteral (L, "wplua_gc_policy");
+  wplua_pushboxed (L,
+      _wplua_gc_policy_get_type (),
+      _wplua_gc_policy_new (L));
+  lua_settable (L, LUA_REGISTRYINDEX);
+}
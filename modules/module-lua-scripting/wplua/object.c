@@ -85,73 +85,26 @@ _wplua_gobject_connect (lua_State *L)
   return 1;
 }
 
-static lua_CFunction
-find_method_in_luaL_Reg (luaL_Reg *reg, const gchar *method)
-{
-  if (reg) {
-    while (reg->name) {
-      if (!g_strcmp0 (method, reg->name))
-        return reg->func;
-      reg++;
-    }
-  }
-  return NULL;
-}
-
 static int
 _wplua_gobject___index (lua_State *L)
 {
   GObject *obj = wplua_checkobject (L, 1, G_TYPE_OBJECT);
   const gchar *key = luaL_checkstring (L, 2);
-  lua_CFunction func = NULL;
-  GHashTable *vtables;
 
-  lua_pushliteral (L, "wplua_vtables");
-  lua_gettable (L, LUA_REGISTRYINDEX);
-  vtables = wplua_toboxed (L, -1);
+  /* search in the resolved methods of this type */
+  lua_pushvalue (L, 2);
+  if (lua_rawget (L, lua_upvalueindex (1)) != LUA_TNIL)
+    return 1;
   lua_pop (L, 1);
 
-  if (!g_strcmp0 (key, "call"))
-    func = _wplua_gobject_call;
-  else if (!g_strcmp0 (key, "connect"))
-    func = _wplua_gobject_connect;
-
-  /* search in registered vtables */
-  if (!func) {
-    GType type = G_TYPE_FROM_INSTANCE (obj);
-    while (!func && type) {
-      luaL_Reg *reg = g_hash_table_lookup (vtables, GUINT_TO_POINTER (type));
-      func = find_method_in_luaL_Reg (reg, key);
-      type = g_type_parent (type);
-    }
-  }
-
-  /* search in registered vtables of interfaces */
-  if (!func) {
-    g_autofree GType *interfaces =
-        g_type_interfaces (G_TYPE_FROM_INSTANCE (obj), NULL);
-    GType *type = interfaces;
-    while (!func && *type) {
-      luaL_Reg *reg = g_hash_table_lookup (vtables, GUINT_TO_POINTER (*type));
-      func = find_method_in_luaL_Reg (reg, key);
-      type++;
-    }
-  }
-
-  if (func) {
-    lua_pushcfunction (L, func);
-    return 1;
-  }
-  else {
-    /* search in properties */
-    GObjectClass *klass = G_OBJECT_GET_CLASS (obj);
-    GParamSpec *pspec = g_object_class_find_property (klass, key);
-    if (pspec && (pspec->flags & G_PARAM_READABLE)) {
-      g_auto (GValue) v = G_VALUE_INIT;
-      g_value_init (&v, pspec->value_type);
-      g_object_get_property (obj, key, &v);
-      return wplua_gvalue_to_lua (L, &v);
-    }
+  /* search in properties */
+  GObjectClass *klass = G_OBJECT_GET_CLASS (obj);
+  GParamSpec *pspec = g_object_class_find_property (klass, key);
+  if (pspec && (pspec->flags & G_PARAM_READABLE)) {
+    g_auto (GValue) v = G_VALUE_INIT;
+    g_value_init (&v, pspec->value_type);
+    g_object_get_property (obj, key, &v);
+    return wplua_gvalue_to_lua (L, &v);
   }
 
   return 0;
@@ -191,21 +144,95 @@ _wplua_gobject__tostring (lua_State *L)
   return 1;
 }
 
-void
-_wplua_init_gobject (lua_State *L)
+/* adds the methods registered for @em type to the table at the top of the
+   stack, unless a method with the same name is already there */
+static void
+_wplua_gobject_add_methods (lua_State *L, GHashTable *vtables, GType type)
+{
+  const luaL_Reg *reg = g_hash_table_lookup (vtables, GUINT_TO_POINTER (type));
+
+  for (; reg && reg->name; reg++) {
+    if (lua_getfield (L, -1, reg->name) == LUA_TNIL) {
+      lua_pushcfunction (L, reg->func);
+      lua_setfield (L, -3, reg->name);
+    }
+    lua_pop (L, 1);
+  }
+}
+
+/* Pushes the metatable of objects of @em type, building it on first use.
+   Its __index holds all the methods of the type, resolved through the class
+   hierarchy and the interfaces, so that calling a method is a single table
+   lookup */
+static void
+_wplua_gobject_push_metatable (lua_State *L, GType type)
 {
   static const luaL_Reg gobject_meta[] = {
     { "__gc", _wplua_gvalue_userdata___gc },
     { "__eq", _wplua_gvalue_userdata___eq },
-    { "__index", _wplua_gobject___index },
     { "__newindex", _wplua_gobject___newindex },
     { "__tostring", _wplua_gobject__tostring },
     { NULL, NULL }
   };
+  GHashTable *vtables;
 
-  luaL_newmetatable (L, "GObject");
-  luaL_setfuncs (L, gobject_meta, 0);
+  lua_pushliteral (L, "wplua_gobject_metatables");
+  lua_rawget (L, LUA_REGISTRYINDEX);
+  if (lua_rawgetp (L, -1, GSIZE_TO_POINTER (type)) == LUA_TTABLE) {
+    lua_remove (L, -2);
+    return;
+  }
   lua_pop (L, 1);
+
+  lua_pushliteral (L, "wplua_vtables");
+  lua_rawget (L, LUA_REGISTRYINDEX);
+  vtables = wplua_toboxed (L, -1);
+  lua_pop (L, 1);
+
+  wp_debug ("building metatable for '%s'", g_type_name (type));
+
+  lua_newtable (L);
+  luaL_setfuncs (L, gobject_meta, 0);
+  lua_pushliteral (L, "GObject");
+  lua_setfield (L, -2, "__name");
+
+  /* methods, in order of precedence */
+  lua_newtable (L);
+  lua_pushcfunction (L, _wplua_gobject_call);
+  lua_setfield (L, -2, "call");
+  lua_pushcfunction (L, _wplua_gobject_connect);
+  lua_setfield (L, -2, "connect");
+
+  for (GType t = type; t; t = g_type_parent (t))
+    _wplua_gobject_add_methods (L, vtables, t);
+
+  {
+    g_autofree GType *interfaces = g_type_interfaces (type, NULL);
+    for (GType *t = interfaces; *t; t++)
+      _wplua_gobject_add_methods (L, vtables, *t);
+  }
+
+  lua_pushcclosure (L, _wplua_gobject___index, 1);
+  lua_setfield (L, -2, "__index");
+
+  /* cache it */
+  lua_pushvalue (L, -1);
+  lua_rawsetp (L, -3, GSIZE_TO_POINTER (type));
+  lua_remove (L, -2);
+}
+
+void
+_wplua_gobject_clear_metatables (lua_State *L)
+{
+  lua_pushliteral (L, "wplua_gobject_metatables");
+  lua_newtable (L);
+  lua_rawset (L, LUA_REGISTRYINDEX);
+}
+
+void
+_wplua_init_gobject (lua_State *L)
+{
+  _wplua_gobject_clear_metatables (L);
 }
 
 void
@@ -217,7 +244,7 @@ wplua_pushobject (lua_State * L, gpointer object)
   wp_trace_object (object, "pushing to Lua, v=%p", v);
   g_value_take_object (v, object);
 
-  luaL_getmetatable (L, "GObject");
+  _wplua_gobject_push_metatable (L, G_TYPE_FROM_INSTANCE (object));
   lua_setmetatable (L, -2);
 }
 
@@ -19,11 +19,28 @@ WP_LOG_TOPIC_EXTERN (log_topic_wplua)
 /* boxed.c */
 void _wplua_init_gboxed (lua_State *L);
 
+/* bytecode.c */
+gchar * _wplua_bytecode_cache_path (lua_State *L, GFile *file);
+gchar * _wplua_bytecode_cache_key (GFile *file, GBytes *bytes);
+gboolean _wplua_bytecode_cache_load (lua_State *L, const gchar *path,
+    const gchar *key, const gchar *name);
+void _wplua_bytecode_cache_store (lua_State *L, const gchar *path,
+    const gchar *key);
+
 /* closure.c */
 void _wplua_init_closure (lua_State *L);
 
+/* gc.c */
+void _wplua_init_gc (lua_State *L);
+void _wplua_gc_after_call (lua_State *L);
+
 /* object.c */
 void _wplua_init_gobject (lua_State *L);
+void _wplua_gobject_clear_metatables (lua_State *L);
+
+/* properties.c */
+void _wplua_init_properties (lua_State *L);
+WpProperties * _wplua_properties_userdata_copy (lua_State *L, int idx);
 
 /* userdata.c */
 GValue * _wplua_pushgvalue_userdata (lua_State * L, GType type);
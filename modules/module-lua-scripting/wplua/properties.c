@@ -0,0 +1,278 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "wplua.h"
+#include "private.h"
+#include <wp/wp.h>
+#include <spa/utils/dict.h>
+
+/* WpProperties are exposed to Lua as a GValue userdata that looks up keys
+   directly in the underlying dictionary, so that accessing `.properties` does
+   not need to build a table with all the keys. The dictionary is never
+   modified from Lua; assignments go to an overlay table that is stored as the
+   user value of the userdata and which shadows the dictionary. Keys that are
+   set to nil are marked in the overlay with the address of `removed_key` */
+static const char removed_key = 0;
+
+static inline WpProperties *
+_wplua_properties_peek (lua_State *L, int idx)
+{
+  return g_value_get_boxed ((GValue *) lua_touserdata (L, idx));
+}
+
+/* Keys are looked up by atom (see wp_properties_get_atom()), which are cached
+   in a table that is an upvalue of the metamethods, so that a key that is
+   accessed again does not need to be hashed again. Strings that are not atoms
+   are not cached, as they may become atoms later; sets with interned keys
+   copy the keys that are not atoms, so the string lookup still works for them */
+static GQuark
+_wplua_properties_atom (lua_State *L, int idx)
+{
+  GQuark atom;
+
+  lua_pushvalue (L, idx);
+  lua_rawget (L, lua_upvalueindex (1));
+  atom = (GQuark) lua_tointeger (L, -1);
+  lua_pop (L, 1);
+
+  if (!atom && (atom = g_quark_try_string (lua_tostring (L, idx)))) {
+    lua_pushvalue (L, idx);
+    lua_pushinteger (L, atom);
+    lua_rawset (L, lua_upvalueindex (1));
+  }
+  return atom;
+}
+
+static int
+_wplua_properties___index (lua_State *L)
+{
+  WpProperties *p = _wplua_properties_peek (L, 1);
+  GQuark atom;
+
+  if (lua_getuservalue (L, 1) == LUA_TTABLE) {
+    lua_pushvalue (L, 2);
+    if (lua_rawget (L, -2) != LUA_TNIL) {
+      if (lua_touserdata (L, -1) == &removed_key)
+        lua_pushnil (L);
+      return 1;
+    }
+  }
+
+  if (!p || lua_type (L, 2) != LUA_TSTRING)
+    lua_pushnil (L);
+  else if ((atom = _wplua_properties_atom (L, 2)))
+    lua_pushstring (L, wp_properties_get_atom (p, atom));
+  else
+    lua_pushstring (L, wp_properties_get (p, lua_tostring (L, 2)));
+  return 1;
+}
+
+static int
+_wplua_properties___newindex (lua_State *L)
+{
+  luaL_checkany (L, 2);
+
+  if (lua_getuservalue (L, 1) != LUA_TTABLE) {
+    lua_pop (L, 1);
+    lua_newtable (L);
+    lua_pushvalue (L, -1);
+    lua_setuservalue (L, 1);
+  }
+
+  lua_pushvalue (L, 2);
+  if (lua_isnil (L, 3))
+    lua_pushlightuserdata (L, (gpointer) &removed_key);
+  else
+    lua_pushvalue (L, 3);
+  lua_rawset (L, -3);
+  return 0;
+}
+
+/* upvalue 1: the next position in the dictionary;
+   upvalue 2: whether the dictionary is done and we iterate the overlay */
+static int
+_wplua_properties_next (lua_State *L)
+{
+  WpProperties *p = _wplua_properties_peek (L, 1);
+  const struct spa_dict *dict = p ? wp_properties_peek_dict (p) : NULL;
+  lua_Integer i = lua_tointeger (L, lua_upvalueindex (1));
+  gboolean has_overlay;
+
+  lua_settop (L, 2);
+  has_overlay = (lua_getuservalue (L, 1) == LUA_TTABLE);
+
+  if (!lua_toboolean (L, lua_upvalueindex (2))) {
+    while (dict && i < dict->n_items) {
+      const struct spa_dict_item *item = &dict->items[i++];
+
+      /* skip keys that are shadowed by the overlay */
+      if (has_overlay) {
+        lua_pushstring (L, item->key);
+        if (lua_rawget (L, 3) != LUA_TNIL) {
+          lua_pop (L, 1);
+          continue;
+        }
+        lua_pop (L, 1);
+      }
+
+      lua_pushinteger (L, i);
+      lua_replace (L, lua_upvalueindex (1));
+      lua_pushstring (L, item->key);
+      lua_pushstring (L, item->value);
+      return 2;
+    }
+
+    lua_pushboolean (L, TRUE);
+    lua_replace (L, lua_upvalueindex (2));
+    lua_pushnil (L);
+  } else {
+    lua_pushvalue (L, 2);
+  }
+
+  if (has_overlay) {
+    while (lua_next (L, 3)) {
+      if (lua_touserdata (L, -1) != &removed_key)
+        return 2;
+      lua_pop (L, 1);
+    }
+  }
+
+  lua_pushnil (L);
+  return 1;
+}
+
+static int
+_wplua_properties___pairs (lua_State *L)
+{
+  lua_pushinteger (L, 0);
+  lua_pushboolean (L, FALSE);
+  lua_pushcclosure (L, _wplua_properties_next, 2);
+  lua_pushvalue (L, 1);
+  lua_pushnil (L);
+  return 3;
+}
+
+WpProperties *
+_wplua_properties_userdata_copy (lua_State *L, int idx)
+{
+  WpProperties *src = _wplua_properties_peek (L, idx);
+  WpProperties *p = src ? wp_properties_copy (src) : wp_properties_new_empty ();
+  const gchar *key, *value;
+
+  if (lua_getuservalue (L, idx) == LUA_TTABLE) {
+    lua_pushnil (L);
+    while (lua_next (L, -2) != 0) {
+      key = luaL_tolstring (L, -2, NULL);
+      if (lua_touserdata (L, -2) == &removed_key) {
+        wp_properties_set (p, key, NULL);
+      } else {
+        value = luaL_tolstring (L, -2, NULL);
+        wp_properties_set (p, key, value);
+        lua_pop (L, 1);
+      }
+      lua_pop (L, 2);
+    }
+  }
+  lua_pop (L, 1);
+
+  return p;
+}
+
+/**
+ * wplua_pushproperties:
+ *
+ * Pushes @em p as a userdata that behaves like a read/write table of
+ * strings, without copying its contents into Lua.
+ * Takes ownership of @em p, which may be NULL.
+ */
+void
+wplua_pushproperties (lua_State *L, WpProperties *p)
+{
+  GValue *v = _wplua_pushgvalue_userdata (L, WP_TYPE_PROPERTIES);
+  g_value_take_boxed (v, p);
+
+  luaL_getmetatable (L, "WpProperties");
+  lua_setmetatable (L, -2);
+}
+
+/**
+ * wplua_isproperties:
+ *
+ * Returns: TRUE if the value at @em idx is a table or a userdata
+ *   holding WpProperties; both can be converted with
+ *   wplua_table_to_properties()
+ */
+gboolean
+wplua_isproperties (lua_State *L, int idx)
+{
+  return lua_istable (L, idx) ||
+      _wplua_isgvalue_userdata (L, idx, WP_TYPE_PROPERTIES);
+}
+
+/**
+ * wplua_pushproperties_as_table:
+ *
+ * Pushes a table with the contents of the table or WpProperties userdata at
+ * @em idx. Tables are pushed as they are. For userdata, a new table is built
+ * with the keys of the dictionary and those of the overlay; values that were
+ * assigned from Lua keep their Lua type, so that callers can convert them
+ * the same way as values of a plain table.
+ */
+void
+wplua_pushproperties_as_table (lua_State *L, int idx)
+{
+  WpProperties *p;
+
+  idx = lua_absindex (L, idx);
+  if (!_wplua_isgvalue_userdata (L, idx, WP_TYPE_PROPERTIES)) {
+    lua_pushvalue (L, idx);
+    return;
+  }
+
+  p = _wplua_properties_peek (L, idx);
+  lua_newtable (L);
+
+  if (p) {
+    const struct spa_dict_item *item;
+    spa_dict_for_each (item, wp_properties_peek_dict (p)) {
+      lua_pushstring (L, item->value);
+      lua_setfield (L, -2, item->key);
+    }
+  }
+
+  if (lua_getuservalue (L, idx) == LUA_TTABLE) {
+    lua_pushnil (L);
+    while (lua_next (L, -2) != 0) {
+      lua_pushvalue (L, -2);
+      if (lua_touserdata (L, -2) == &removed_key)
+        lua_pushnil (L);
+      else
+        lua_pushvalue (L, -2);
+      lua_rawset (L, -6);
+      lua_pop (L, 1);
+    }
+  }
+  lua_pop (L, 1);
+}
+
+void
+_wplua_init_properties (lua_State *L)
+{
+  static const luaL_Reg properties_meta[] = {
+    { "__gc", _wplua_gvalue_userdata___gc },
+    { "__eq", _wplua_gvalue_userdata___eq },
+    { "__index", _wplua_properties___index },
+    { "__newindex", _wplua_properties___newindex },
+    { "__pairs", _wplua_properties___pairs },
+    { NULL, NULL }
+  };
+
+  luaL_newmetatable (L, "WpProperties");
+  lua_newtable (L);
+  luaL_setfuncs (L, properties_meta, 1);
+  lua_pop (L, 1);
+}
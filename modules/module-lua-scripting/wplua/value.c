@@ -13,10 +13,14 @@
 WpProperties *
 wplua_table_to_properties (lua_State *L, int idx)
 {
-  WpProperties *p = wp_properties_new_empty ();
+  WpProperties *p;
   const gchar *key, *value;
   int table = lua_absindex (L, idx);
 
+  if (_wplua_isgvalue_userdata (L, table, WP_TYPE_PROPERTIES))
+    return _wplua_properties_userdata_copy (L, table);
+
+  p = wp_properties_new_empty ();
   if (lua_type (L, table) != LUA_TTABLE) {
     wp_critical ("skipping non-table value");
     return p;
@@ -244,11 +248,11 @@ wplua_lua_to_gvalue (lua_State *L, int idx, GValue *v)
       g_value_set_pointer (v, lua_touserdata (L, idx));
     break;
   case G_TYPE_BOXED:
-    if (_wplua_isgvalue_userdata (L, idx, G_VALUE_TYPE (v)))
-      g_value_set_boxed (v, wplua_toboxed (L, idx));
-    /* table -> WpProperties */
-    else if (lua_istable (L, idx) && G_VALUE_TYPE (v) == WP_TYPE_PROPERTIES)
+    /* table or WpProperties userdata -> WpProperties copy */
+    if (G_VALUE_TYPE (v) == WP_TYPE_PROPERTIES && wplua_isproperties (L, idx))
       g_value_take_boxed (v, wplua_table_to_properties (L, idx));
+    else if (_wplua_isgvalue_userdata (L, idx, G_VALUE_TYPE (v)))
+      g_value_set_boxed (v, wplua_toboxed (L, idx));
     break;
   case G_TYPE_OBJECT:
   case G_TYPE_INTERFACE:
@@ -314,7 +318,7 @@ wplua_gvalue_to_lua (lua_State *L, const GValue *v)
     break;
   case G_TYPE_BOXED:
     if (G_VALUE_TYPE (v) == WP_TYPE_PROPERTIES)
-      wplua_properties_to_table (L, g_value_get_boxed (v));
+      wplua_pushproperties (L, g_value_dup_boxed (v));
     else
       wplua_pushboxed (L, G_VALUE_TYPE (v), g_value_dup_boxed (v));
     break;
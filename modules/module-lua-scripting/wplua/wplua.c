@@ -94,7 +94,9 @@ wplua_new (void)
   _wplua_openlibs (L);
   _wplua_init_gboxed (L);
   _wplua_init_gobject (L);
+  _wplua_init_properties (L);
   _wplua_init_closure (L);
+  _wplua_init_gc (L);
 
   {
     GHashTable *t = g_hash_table_new (g_direct_hash, g_direct_equal);
@@ -191,6 +193,9 @@ wplua_register_type_methods (lua_State * L, GType type,
     }
 
     g_hash_table_insert (vtables, GUINT_TO_POINTER (type), (gpointer) methods);
+
+    /* objects pushed from now on will see the new methods */
+    _wplua_gobject_clear_metatables (L);
   }
 
   /* register constructor */
@@ -252,6 +257,9 @@ wplua_load_uri (lua_State * L, const gchar *uri, GError **error)
   g_autoptr (GBytes) bytes = NULL;
   g_autoptr (GError) err = NULL;
   g_autofree gchar *name = NULL;
+  g_autofree gchar *cache_path = NULL;
+  g_autofree gchar *cache_key = NULL;
+  gboolean is_resource;
   gconstpointer data;
   gsize size;
 
@@ -259,15 +267,38 @@ wplua_load_uri (lua_State * L, const gchar *uri, GError **error)
   g_return_val_if_fail (uri != NULL, FALSE);
 
   file = g_file_new_for_uri (uri);
+  name = g_path_get_basename (uri);
+  is_resource = g_file_has_uri_scheme (file, "resource");
+  cache_path = _wplua_bytecode_cache_path (L, file);
+
+  /* files are looked up in the cache by mtime, before reading them */
+  if (cache_path && !is_resource) {
+    cache_key = _wplua_bytecode_cache_key (file, NULL);
+    if (cache_key &&
+        _wplua_bytecode_cache_load (L, cache_path, cache_key, name))
+      return TRUE;
+  }
+
   if (!(bytes = g_file_load_bytes (file, NULL, NULL, &err))) {
     g_propagate_prefixed_error (error, err, "Failed to load '%s':", uri);
     err = NULL;
     return FALSE;
   }
 
-  name = g_path_get_basename (uri);
+  /* resources have no mtime, but reading them is free */
+  if (cache_path && is_resource) {
+    cache_key = _wplua_bytecode_cache_key (file, bytes);
+    if (_wplua_bytecode_cache_load (L, cache_path, cache_key, name))
+      return TRUE;
+  }
+
   data = g_bytes_get_data (bytes, &size);
-  return _wplua_load_buffer (L, data, size, name, error);
+  if (!_wplua_load_buffer (L, data, size, name, error))
+    return FALSE;
+
+  if (cache_path && cache_key)
+    _wplua_bytecode_cache_store (L, cache_path, cache_key);
+  return TRUE;
 }
 
 gboolean
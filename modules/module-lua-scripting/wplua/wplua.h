@@ -47,10 +47,26 @@ typedef enum {
   WP_LUA_SANDBOX_ISOLATE_ENV = 1,
 } WpLuaSandboxFlags;
 
+/**
+ * WpLuaGcMode:
+ *
+ * @brief
+ * @em WP_LUA_GC_MODE_INCREMENTAL: the incremental collector, stepped from
+ *   the main loop when idle
+ * @em WP_LUA_GC_MODE_GENERATIONAL: the generational collector (Lua 5.4 only)
+ */
+typedef enum {
+  WP_LUA_GC_MODE_INCREMENTAL,
+  WP_LUA_GC_MODE_GENERATIONAL,
+} WpLuaGcMode;
+
 lua_State * wplua_new (void);
 lua_State * wplua_ref (lua_State *L);
 void wplua_unref (lua_State * L);
 
+void wplua_set_gc_policy (lua_State *L, WpLuaGcMode mode, gint step_size,
+    gint64 idle_budget, gboolean collect_after_call);
+
 void wplua_enable_sandbox (lua_State * L, WpLuaSandboxFlags flags);
 int wplua_push_sandbox (lua_State * L);
 
@@ -87,6 +103,13 @@ void wplua_gvariant_to_lua (lua_State *L, GVariant *p);
 WpProperties * wplua_table_to_properties (lua_State *L, int idx);
 void wplua_properties_to_table (lua_State *L, WpProperties *p);
 
+/* push -> transfer full */
+void wplua_pushproperties (lua_State *L, WpProperties *p);
+gboolean wplua_isproperties (lua_State *L, int idx);
+void wplua_pushproperties_as_table (lua_State *L, int idx);
+
+void wplua_enable_bytecode_cache (lua_State *L, const gchar *dir);
+
 gboolean wplua_load_buffer (lua_State * L, const gchar *buf, gsize size,
     GError **error);
 gboolean wplua_load_uri (lua_State * L, const gchar *uri, GError **error);
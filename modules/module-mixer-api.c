@@ -25,8 +25,6 @@ struct channel_map {
 };
 
 struct node_info {
-  guint32 seq;
-
   guint32 device_id;
   gint32 route_index;
   gint32 route_device;
@@ -46,7 +44,7 @@ struct _WpMixerApi
   WpPlugin parent;
   WpObjectManager *om;
   GHashTable *node_infos;
-  guint32 seq;
+  GHashTable *dirty_nodes;
 
   /* properties */
   gint scale;
@@ -235,6 +233,29 @@ collect_node_info (WpMixerApi * self, struct node_info *info,
   }
 }
 
+static void
+mark_node_dirty (WpMixerApi * self, WpProxy * node)
+{
+  g_hash_table_add (self->dirty_nodes,
+      GUINT_TO_POINTER (wp_proxy_get_bound_id (node)));
+}
+
+/* the volume of these nodes may come from a Route of the device */
+static void
+mark_device_nodes_dirty (WpMixerApi * self, WpProxy * device)
+{
+  g_autofree gchar *id =
+      g_strdup_printf ("%u", wp_proxy_get_bound_id (device));
+  g_autoptr (WpIterator) it = wp_object_manager_new_filtered_iterator (
+      self->om, WP_TYPE_NODE,
+      WP_CONSTRAINT_TYPE_PW_PROPERTY, PW_KEY_DEVICE_ID, "=s", id,
+      NULL);
+  g_auto (GValue) val = G_VALUE_INIT;
+
+  for (; wp_iterator_next (it, &val); g_value_unset (&val))
+    mark_node_dirty (self, g_value_get_object (&val));
+}
+
 static void on_objects_changed (WpObjectManager * om, WpMixerApi * self);
 
 static void
@@ -248,39 +269,62 @@ on_sync_done (WpCore * core, GAsyncResult * res, WpMixerApi * self)
   }
 }
 
+static void
+schedule_update (WpMixerApi * self)
+{
+  g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (self));
+  wp_core_sync (core, NULL, (GAsyncReadyCallback) on_sync_done, self);
+}
+
 static void
 on_params_changed (WpPipewireObject * obj, const gchar * param_name,
     WpMixerApi * self)
 {
-  if ((WP_IS_NODE (obj) && !g_strcmp0 (param_name, "Props")) ||
-      (WP_IS_DEVICE (obj) && !g_strcmp0 (param_name, "Route"))) {
-    g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (self));
-    wp_core_sync (core, NULL, (GAsyncReadyCallback) on_sync_done, self);
+  if (WP_IS_NODE (obj) && !g_strcmp0 (param_name, "Props")) {
+    mark_node_dirty (self, WP_PROXY (obj));
+    schedule_update (self);
+  } else if (WP_IS_DEVICE (obj) && !g_strcmp0 (param_name, "Route")) {
+    mark_device_nodes_dirty (self, WP_PROXY (obj));
+    schedule_update (self);
   }
 }
 
+/* device.id and card.profile.device select the Route that holds the volume */
+static void
+on_node_properties_changed (WpPipewireObject * node, GParamSpec * pspec,
+    WpMixerApi * self)
+{
+  mark_node_dirty (self, WP_PROXY (node));
+  schedule_update (self);
+}
+
 static void
 on_objects_changed (WpObjectManager * om, WpMixerApi * self)
 {
-  g_autoptr (WpIterator) it =
-      wp_object_manager_new_filtered_iterator (om, WP_TYPE_NODE, NULL);
-  g_auto (GValue) val = G_VALUE_INIT;
-  GHashTableIter infos_it;
-  struct node_info *info;
-  struct node_info old;
+  /* handlers of the "changed" signal may cause more nodes to be marked */
+  g_autoptr (GHashTable) dirty_nodes = g_steal_pointer (&self->dirty_nodes);
+  GHashTableIter dirty_it;
+  gpointer key;
+
+  self->dirty_nodes = g_hash_table_new (g_direct_hash, g_direct_equal);
 
-  self->seq++;
+  g_hash_table_iter_init (&dirty_it, dirty_nodes);
+  while (g_hash_table_iter_next (&dirty_it, &key, NULL)) {
+    guint id = GPOINTER_TO_UINT (key);
+    g_autoptr (WpPipewireObject) node = NULL;
+    struct node_info *info;
+    struct node_info old;
 
-  for (; wp_iterator_next (it, &val); g_value_unset (&val)) {
-    WpPipewireObject *node = g_value_get_object (&val);
-    guint id = wp_proxy_get_bound_id (WP_PROXY (node));
+    node = wp_object_manager_lookup (om, WP_TYPE_NODE,
+        WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id", "=u", id, NULL);
+    if (!node)
+      continue;
 
     info = g_hash_table_lookup (self->node_infos, GUINT_TO_POINTER (id));
     if (!info) {
       info = g_slice_new0 (struct node_info);
       g_hash_table_insert (self->node_infos, GUINT_TO_POINTER (id), info);
     }
-    info->seq = self->seq;
 
     old = *info;
     collect_node_info (self, info, node);
@@ -289,25 +333,37 @@ on_objects_changed (WpObjectManager * om, WpMixerApi * self)
       g_signal_emit (self, signals[SIGNAL_CHANGED], 0, id);
     }
   }
-
-  /* remove node_info of nodes that were removed from the object manager */
-  g_hash_table_iter_init (&infos_it, self->node_infos);
-  while (g_hash_table_iter_next (&infos_it, NULL, (gpointer *) &info)) {
-    if (info->seq != self->seq)
-      g_hash_table_iter_remove (&infos_it);
-  }
 }
 
 static void
 on_object_added (WpObjectManager * om, WpProxy * obj, WpMixerApi * self)
 {
   g_signal_connect (obj, "params-changed", G_CALLBACK (on_params_changed), self);
+
+  if (WP_IS_NODE (obj)) {
+    g_signal_connect (obj, "notify::properties",
+        G_CALLBACK (on_node_properties_changed), self);
+    mark_node_dirty (self, obj);
+  } else if (WP_IS_DEVICE (obj)) {
+    mark_device_nodes_dirty (self, obj);
+  }
 }
 
 static void
 on_object_removed (WpObjectManager * om, WpProxy * obj, WpMixerApi * self)
 {
   g_signal_handlers_disconnect_by_func (obj, G_CALLBACK (on_params_changed), self);
+
+  if (WP_IS_NODE (obj)) {
+    guint id = wp_proxy_get_bound_id (obj);
+
+    g_signal_handlers_disconnect_by_func (obj,
+        G_CALLBACK (on_node_properties_changed), self);
+    g_hash_table_remove (self->node_infos, GUINT_TO_POINTER (id));
+    g_hash_table_remove (self->dirty_nodes, GUINT_TO_POINTER (id));
+  } else if (WP_IS_DEVICE (obj)) {
+    mark_device_nodes_dirty (self, obj);
+  }
 }
 
 static void
@@ -331,6 +387,7 @@ wp_mixer_api_enable (WpPlugin * plugin, WpTransition * transition)
 
   self->node_infos = g_hash_table_new_full (g_direct_hash, g_direct_equal,
       NULL, node_info_free);
+  self->dirty_nodes = g_hash_table_new (g_direct_hash, g_direct_equal);
 
   self->om = wp_object_manager_new ();
   wp_object_manager_add_interest (self->om, WP_TYPE_NODE,
@@ -341,6 +398,8 @@ wp_mixer_api_enable (WpPlugin * plugin, WpTransition * transition)
       NULL);
   wp_object_manager_request_object_features (self->om,
       WP_TYPE_GLOBAL_PROXY, WP_OBJECT_FEATURES_ALL);
+  wp_object_manager_add_index (self->om,
+      WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id");
   g_signal_connect_object (self->om, "objects-changed",
       G_CALLBACK (on_objects_changed), self, 0);
   g_signal_connect_object (self->om, "object-added",
@@ -369,6 +428,7 @@ wp_mixer_api_disable (WpPlugin * plugin)
 
   g_clear_object (&self->om);
   g_clear_pointer (&self->node_infos, g_hash_table_unref);
+  g_clear_pointer (&self->dirty_nodes, g_hash_table_unref);
 }
 
 static inline gdouble
@@ -15,6 +15,13 @@ WP_DEFINE_LOCAL_LOG_TOPIC ("m-standard-event-source")
  * events on to the Event Stack.
  */
 
+enum {
+  PROP_0,
+  PROP_COALESCE_EVENTS,
+  PROP_COALESCED_PARAMS_CHANGED,
+  PROP_COALESCED_METADATA_CHANGED,
+};
+
 enum {
   ACTION_GET_OBJECT_MANAGER,
   ACTION_CREATE_EVENT,
@@ -67,6 +74,13 @@ struct _WpStandardEventSource
   WpEventHook *rescan_done_hook;
   gboolean rescan_scheduled[N_RESCAN_CONTEXTS];
   gint n_oms_installed;
+
+  /* event coalescing */
+  gboolean coalesce_events;
+  gulong event_dispatched_id;
+  GHashTable *pending_events; /* coalescing key -> WpEvent */
+  guint64 n_coalesced_params_changed;
+  guint64 n_coalesced_metadata_changed;
 };
 
 static guint signals[N_SIGNALS] = {0};
@@ -78,6 +92,56 @@ G_DEFINE_TYPE (WpStandardEventSource, wp_standard_event_source, WP_TYPE_PLUGIN)
 static void
 wp_standard_event_source_init (WpStandardEventSource * self)
 {
+  self->pending_events = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, (GDestroyNotify) wp_event_unref);
+}
+
+static void
+wp_standard_event_source_finalize (GObject * object)
+{
+  WpStandardEventSource *self = WP_STANDARD_EVENT_SOURCE (object);
+
+  g_clear_pointer (&self->pending_events, g_hash_table_unref);
+
+  G_OBJECT_CLASS (wp_standard_event_source_parent_class)->finalize (object);
+}
+
+static void
+wp_standard_event_source_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  WpStandardEventSource *self = WP_STANDARD_EVENT_SOURCE (object);
+
+  switch (property_id) {
+  case PROP_COALESCE_EVENTS:
+    self->coalesce_events = g_value_get_boolean (value);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    break;
+  }
+}
+
+static void
+wp_standard_event_source_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  WpStandardEventSource *self = WP_STANDARD_EVENT_SOURCE (object);
+
+  switch (property_id) {
+  case PROP_COALESCE_EVENTS:
+    g_value_set_boolean (value, self->coalesce_events);
+    break;
+  case PROP_COALESCED_PARAMS_CHANGED:
+    g_value_set_uint64 (value, self->n_coalesced_params_changed);
+    break;
+  case PROP_COALESCED_METADATA_CHANGED:
+    g_value_set_uint64 (value, self->n_coalesced_metadata_changed);
+    break;
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    break;
+  }
 }
 
 static GType
@@ -268,12 +332,97 @@ wp_standard_event_source_create_event (WpStandardEventSource *self,
   return g_steal_pointer (&event);
 }
 
+/* Events that can be coalesced are identified by a key; two events with the
+   same key carry the same information, apart from metadata values */
+static gchar *
+get_coalescing_key (WpEvent * event)
+{
+  const gchar *event_type = wp_event_get_property (event, "event.type");
+  g_autoptr (GObject) subject = NULL;
+  const gchar *id, *key;
+
+  /* this is called for every dispatched event; check the type first */
+  if (!event_type || !(g_str_has_suffix (event_type, "-params-changed") ||
+          !g_strcmp0 (event_type, "metadata-changed")))
+    return NULL;
+
+  if (!(subject = wp_event_get_subject (event)))
+    return NULL;
+
+  if (g_str_has_suffix (event_type, "-params-changed")) {
+    id = wp_event_get_property (event, "event.subject.param-id");
+    return g_strdup_printf ("%s@%p@%s", event_type, subject, id ? id : "");
+  }
+  else if (!g_strcmp0 (event_type, "metadata-changed")) {
+    id = wp_event_get_property (event, "event.subject.id");
+    key = wp_event_get_property (event, "event.subject.key");
+    return g_strdup_printf ("%s@%p@%s@%s", event_type, subject,
+        id ? id : "", key ? key : "");
+  }
+  return NULL;
+}
+
+/* returns TRUE if the event was merged into an already queued event
+   and does not need to be pushed */
+static gboolean
+coalesce_event (WpStandardEventSource *self, WpEvent *event)
+{
+  g_autofree gchar *key = get_coalescing_key (event);
+  WpEvent *pending;
+
+  if (!key)
+    return FALSE;
+
+  pending = g_hash_table_lookup (self->pending_events, key);
+  if (pending &&
+      !g_cancellable_is_cancelled (wp_event_get_cancellable (pending))) {
+    if (g_str_has_prefix (key, "metadata-changed@")) {
+      /* the hooks read the new value from the event, so the latest
+         event wins and the queued one is discarded */
+      wp_event_stop_processing (pending);
+      self->n_coalesced_metadata_changed++;
+      wp_debug_object (self, "coalesced event (%s), replacing queued one",
+          wp_event_get_name (event));
+    } else {
+      /* the hooks read the params from the subject, so the queued event
+         will see the latest params anyway */
+      self->n_coalesced_params_changed++;
+      wp_debug_object (self, "coalesced event (%s) into a queued one",
+          wp_event_get_name (event));
+      return TRUE;
+    }
+  }
+
+  g_hash_table_insert (self->pending_events, g_steal_pointer (&key),
+      wp_event_ref (event));
+  return FALSE;
+}
+
+static void
+on_event_dispatched (WpEventDispatcher * dispatcher, WpEvent * event,
+    WpStandardEventSource * self)
+{
+  g_autofree gchar *key = get_coalescing_key (event);
+
+  /* from now on, new events cannot be merged into this one */
+  if (key && g_hash_table_lookup (self->pending_events, key) == event)
+    g_hash_table_remove (self->pending_events, key);
+}
+
+static gboolean
+pending_event_is_about (gpointer key, WpEvent * event, GObject * subject)
+{
+  g_autoptr (GObject) event_subject = wp_event_get_subject (event);
+  return event_subject == subject;
+}
+
 static void
 wp_standard_event_source_push_event (WpStandardEventSource *self,
     const gchar *event_type, gpointer subject, WpProperties *misc_properties)
 {
 
   g_autoptr (WpCore) core = wp_object_get_core (WP_OBJECT (self));
+  g_autoptr (WpEvent) event = NULL;
 
   /* this can happen during the core dispose sequence; the weak ref to the
      core is invalidated before the registered objects are destroyed */
@@ -284,9 +433,13 @@ wp_standard_event_source_push_event (WpStandardEventSource *self,
       wp_event_dispatcher_get_instance (core);
   g_return_if_fail (dispatcher);
 
-  wp_event_dispatcher_push_event (dispatcher,
-      wp_standard_event_source_create_event (
-      self, event_type, subject, misc_properties));
+  event = wp_standard_event_source_create_event (
+      self, event_type, subject, misc_properties);
+
+  if (self->event_dispatched_id && coalesce_event (self, event))
+    return;
+
+  wp_event_dispatcher_push_event (dispatcher, g_steal_pointer (&event));
 }
 
 static void
@@ -366,6 +519,9 @@ on_object_added (WpObjectManager *om, WpObject *obj, WpStandardEventSource *self
 static void
 on_object_removed (WpObjectManager *om, WpObject *obj, WpStandardEventSource *self)
 {
+  g_hash_table_foreach_remove (self->pending_events,
+      (GHRFunc) pending_event_is_about, obj);
+
   wp_standard_event_source_push_event (self, "removed", obj, NULL);
 }
 
@@ -379,8 +535,7 @@ on_om_installed (WpObjectManager * om, WpStandardEventSource * self)
 static void
 on_rescan_done (WpEvent * event, WpStandardEventSource * self)
 {
-  g_autoptr (WpProperties) properties = wp_event_get_properties (event);
-  const gchar *event_type = wp_properties_get (properties, "event.type");
+  const gchar *event_type = wp_event_get_property (event, "event.type");
 
   /* the event type is "rescan-for-<context>" and the enum nickname is just
      "<context>", so we get the substring from the 12th character onwards */
@@ -409,6 +564,18 @@ wp_standard_event_source_enable (WpPlugin * plugin, WpTransition * transition)
     wp_object_manager_add_interest (self->oms[i], gtype, NULL);
     wp_object_manager_request_object_features (self->oms[i],
         gtype, WP_OBJECT_FEATURES_ALL);
+
+    /* index the properties that scripts most often look objects up by */
+    if (i == OBJECT_TYPE_SESSION_ITEM) {
+      wp_object_manager_add_index (self->oms[i],
+          WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "out.item.id");
+      wp_object_manager_add_index (self->oms[i],
+          WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "in.item.id");
+    } else {
+      wp_object_manager_add_index (self->oms[i],
+          WP_CONSTRAINT_TYPE_G_PROPERTY, "bound-id");
+    }
+
     g_signal_connect_object (self->oms[i], "object-added",
         G_CALLBACK (on_object_added), self, 0);
     g_signal_connect_object (self->oms[i], "object-removed",
@@ -427,6 +594,13 @@ wp_standard_event_source_enable (WpPlugin * plugin, WpTransition * transition)
       WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "#s", "rescan-for-*",
       NULL);
   wp_event_dispatcher_register_hook (dispatcher, self->rescan_done_hook);
+
+  /* stop coalescing events as soon as they leave the queue, before any of
+     their hooks runs */
+  if (self->coalesce_events) {
+    self->event_dispatched_id = g_signal_connect_object (dispatcher,
+        "event-dispatched", G_CALLBACK (on_event_dispatched), self, 0);
+  }
 }
 
 static void
@@ -443,16 +617,46 @@ wp_standard_event_source_disable (WpPlugin * plugin)
   if (dispatcher)
     wp_event_dispatcher_unregister_hook (dispatcher, self->rescan_done_hook);
   g_clear_object (&self->rescan_done_hook);
+
+  if (dispatcher && self->event_dispatched_id)
+    g_signal_handler_disconnect (dispatcher, self->event_dispatched_id);
+  self->event_dispatched_id = 0;
+  g_hash_table_remove_all (self->pending_events);
 }
 
 static void
 wp_standard_event_source_class_init (WpStandardEventSourceClass * klass)
 {
+  GObjectClass *object_class = (GObjectClass *) klass;
   WpPluginClass *plugin_class = (WpPluginClass *) klass;
 
+  object_class->finalize = wp_standard_event_source_finalize;
+  object_class->set_property = wp_standard_event_source_set_property;
+  object_class->get_property = wp_standard_event_source_get_property;
+
   plugin_class->enable = wp_standard_event_source_enable;
   plugin_class->disable = wp_standard_event_source_disable;
 
+  g_object_class_install_property (object_class, PROP_COALESCE_EVENTS,
+      g_param_spec_boolean ("coalesce-events", "coalesce-events",
+          "Merge queued params-changed and metadata-changed events that are "
+          "about the same subject", FALSE,
+          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class,
+      PROP_COALESCED_PARAMS_CHANGED,
+      g_param_spec_uint64 ("coalesced-params-changed",
+          "coalesced-params-changed",
+          "The number of params-changed events that were merged", 0,
+          G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (object_class,
+      PROP_COALESCED_METADATA_CHANGED,
+      g_param_spec_uint64 ("coalesced-metadata-changed",
+          "coalesced-metadata-changed",
+          "The number of metadata-changed events that were merged", 0,
+          G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   signals[ACTION_GET_OBJECT_MANAGER] = g_signal_new_class_handler (
       "get-object-manager", G_TYPE_FROM_CLASS (klass),
       G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
@@ -483,8 +687,14 @@ wp_standard_event_source_class_init (WpStandardEventSourceClass * klass)
 WP_PLUGIN_EXPORT GObject *
 wireplumber__module_init (WpCore * core, WpSpaJson * args, GError ** error)
 {
+  gboolean coalesce_events = FALSE;
+  if (args)
+    wp_spa_json_object_get (args, "coalesce.events", "b", &coalesce_events,
+        NULL);
+
   return G_OBJECT (g_object_new (wp_standard_event_source_get_type (),
       "name", "standard-event-source",
       "core", core,
+      "coalesce-events", coalesce_events,
       NULL));
 }
@@ -83,7 +83,8 @@ end
 
 local function findProfile (device, index, name)
   for p in device:iterate_params ("EnumProfile") do
-    local profile = cutils.parseParam (p, "EnumProfile")
+    local profile = cutils.parseParam (p, "EnumProfile",
+        { "index", "name", "priority" })
     if not profile then
       goto skip_enum_profile
     end
@@ -152,7 +153,7 @@ end
 
 local function hasProfileInputRoute (device, profile_index)
   for p in device:iterate_params ("EnumRoute") do
-    local route = cutils.parseParam (p, "EnumRoute")
+    local route = cutils.parseParam (p, "EnumRoute", { "direction", "profiles" })
     if route and route.direction == "Input" and route.profiles then
       for _, v in pairs (route.profiles) do
         if v == profile_index then
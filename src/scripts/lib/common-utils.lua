@@ -13,8 +13,10 @@ function cutils.parseBool (var)
   return var and (var:lower () == "true" or var == "1")
 end
 
-function cutils.parseParam (param, id)
-  local props = param:parse ()
+-- fields is an optional list of the properties to convert; any others are
+-- left out of the returned table
+function cutils.parseParam (param, id, fields)
+  local props = param:parse (fields)
   if props.pod_type == "Object" and props.object_id == id then
     return props.properties
   else
@@ -367,7 +367,7 @@ function lutils.haveAvailableRoutes (si_props)
   -- First check "SPA_PARAM_Route" if there are any active devices
   -- in an active profile.
   for p in device:iterate_params ("Route") do
-    local route = cutils.parseParam (p, "Route")
+    local route = cutils.parseParam (p, "Route", { "device", "available" })
     if not route then
       goto skip_route
     end
@@ -388,7 +388,7 @@ function lutils.haveAvailableRoutes (si_props)
   -- Second check "SPA_PARAM_EnumRoute" if there is any route that
   -- is available if not active.
   for p in device:iterate_params ("EnumRoute") do
-    local route = cutils.parseParam (p, "EnumRoute")
+    local route = cutils.parseParam (p, "EnumRoute", { "devices", "available" })
     if not route then
       goto skip_enum_route
     end
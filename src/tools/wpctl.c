@@ -92,6 +92,12 @@ static struct {
       guint64 id;
       const char *level;
     } set_log_level;
+
+    struct {
+      guint64 id;
+      gboolean reset;
+      guint pending;
+    } hook_stats;
   };
 } cmdline;
 
@@ -1671,6 +1677,143 @@ out:
   g_main_loop_quit (self->loop);
 }
 
+/* hook-stats */
+
+static gboolean
+hook_stats_parse_positional (gint argc, gchar ** argv, GError **error)
+{
+  cmdline.hook_stats.id = SPA_ID_INVALID;
+
+  if (argc == 3) {
+    if (!spa_atou64 (argv[2], &cmdline.hook_stats.id, 10)) {
+      g_set_error (error, wpctl_error_domain_quark(), 0,
+                   "failed to parse client id");
+      return FALSE;
+    }
+  } else if (argc > 3) {
+    g_set_error (error, wpctl_error_domain_quark(), 0,
+                 "wrong number of arguments for hook-stats");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static guint64
+hook_stats_get_u64 (WpSpaJson *json, const gchar *key)
+{
+  g_autofree gchar *str = NULL;
+  if (!wp_spa_json_object_get (json, key, "s", &str, NULL))
+    return 0;
+  return g_ascii_strtoull (str, NULL, 10);
+}
+
+static void
+hook_stats_print (guint32 client_id, const gchar *value)
+{
+  g_autoptr (WpSpaJson) json = wp_spa_json_new_from_string (value);
+  g_autoptr (WpIterator) it = NULL;
+  g_auto (GValue) item = G_VALUE_INIT;
+
+  if (!json || !wp_spa_json_is_array (json)) {
+    fprintf (stderr, "Client %u replied with invalid hook stats\n", client_id);
+    return;
+  }
+
+  printf ("Client %u:\n", client_id);
+  printf (" %10s %10s %12s %10s  %s\n",
+      "RUNS", "SKIPPED", "TOTAL (us)", "MAX (us)", "HOOK");
+
+  it = wp_spa_json_new_iterator (json);
+  for (; wp_iterator_next (it, &item); g_value_unset (&item)) {
+    WpSpaJson *hook = g_value_get_boxed (&item);
+    g_autofree gchar *name = NULL;
+
+    if (!wp_spa_json_object_get (hook, "name", "s", &name, NULL))
+      continue;
+
+    printf (" %10" G_GUINT64_FORMAT " %10" G_GUINT64_FORMAT
+        " %12" G_GUINT64_FORMAT " %10" G_GUINT64_FORMAT "  %s\n",
+        hook_stats_get_u64 (hook, "runs"),
+        hook_stats_get_u64 (hook, "skipped"),
+        hook_stats_get_u64 (hook, "total-time"),
+        hook_stats_get_u64 (hook, "max-time"),
+        name);
+  }
+}
+
+static void
+on_hook_stats_changed (WpMetadata *m, guint32 subject,
+    const gchar *key, const gchar *type, const gchar *value, WpCtl * self)
+{
+  if (!spa_streq (key, "hook-stats") || !value)
+    return;
+
+  hook_stats_print (subject, value);
+  wp_metadata_set (m, subject, "hook-stats", NULL, NULL);
+
+  if (cmdline.hook_stats.pending > 0 && --cmdline.hook_stats.pending == 0)
+    g_main_loop_quit (self->loop);
+}
+
+static gboolean
+hook_stats_timeout (WpCtl * self)
+{
+  fprintf (stderr, "Timed out waiting for hook stats\n");
+  self->exit_code = 3;
+  g_main_loop_quit (self->loop);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+hook_stats_run (WpCtl * self)
+{
+  g_autoptr (WpIterator) client_it = NULL;
+  g_auto (GValue) client_val = G_VALUE_INIT;
+  g_autoptr (GSource) timeout = NULL;
+
+  g_autoptr (WpMetadata) settings = wp_object_manager_lookup (self->om, WP_TYPE_METADATA, NULL);
+  if (!settings) {
+    fprintf (stderr, "No settings metadata found\n");
+    goto out;
+  }
+
+  g_signal_connect (settings, "changed",
+      G_CALLBACK (on_hook_stats_changed), self);
+
+  if (cmdline.hook_stats.id == SPA_ID_INVALID) {
+    client_it = wp_object_manager_new_filtered_iterator (self->om, WP_TYPE_CLIENT, NULL);
+    for (; wp_iterator_next (client_it, &client_val); g_value_unset (&client_val)) {
+      WpPipewireObject *client = g_value_get_object (&client_val);
+      guint32 client_id = wp_proxy_get_bound_id (WP_PROXY (client));
+
+      if (client_id == SPA_ID_INVALID)
+        continue;
+
+      wp_metadata_set (settings, client_id, "hook-stats.dump", "",
+          cmdline.hook_stats.reset ? "reset" : "true");
+      cmdline.hook_stats.pending++;
+    }
+  } else {
+    wp_metadata_set (settings, cmdline.hook_stats.id, "hook-stats.dump", "",
+        cmdline.hook_stats.reset ? "reset" : "true");
+    cmdline.hook_stats.pending++;
+  }
+
+  if (cmdline.hook_stats.pending == 0) {
+    fprintf (stderr, "No WirePlumber daemon found\n");
+    goto out;
+  }
+
+  wp_core_timeout_add (self->core, &timeout, 5000,
+      (GSourceFunc) hook_stats_timeout, self, NULL);
+  return;
+
+out:
+  self->exit_code = 3;
+  g_main_loop_quit (self->loop);
+}
+
 #define N_ENTRIES 4
 
 static const struct subcommand {
@@ -1844,6 +1987,21 @@ static const struct subcommand {
     .parse_positional = set_log_level_parse_positional,
     .prepare = set_log_level_prepare,
     .run = set_log_level_run,
+  },
+  {
+    .name = "hook-stats",
+    .positional_args = "[ID]",
+    .summary = "Shows event hook execution statistics of a WirePlumber instance (no ID means all instances)",
+    .description = "Times are reported in microseconds",
+    .entries = {
+      { "reset", 'r', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE,
+        &cmdline.hook_stats.reset,
+        "Reset the statistics after printing them", NULL },
+      { NULL }
+    },
+    .parse_positional = hook_stats_parse_positional,
+    .prepare = set_log_level_prepare,
+    .run = hook_stats_run,
   }
 };
 
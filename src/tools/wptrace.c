@@ -0,0 +1,67 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <wp/wp.h>
+#include <stdio.h>
+#include <locale.h>
+
+enum WpExitCode
+{
+  /* based on sysexits.h */
+  WP_EXIT_OK = 0,
+  WP_EXIT_USAGE = 64,       /* command line usage error */
+  WP_EXIT_NOINPUT = 66,     /* cannot open input */
+};
+
+static gchar **files = NULL;
+
+static GOptionEntry entries[] =
+{
+  { G_OPTION_REMAINING, 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME_ARRAY,
+    &files, NULL, "FILE" },
+  { NULL }
+};
+
+gint
+main (gint argc, gchar **argv)
+{
+  g_autoptr (GOptionContext) context = NULL;
+  g_autoptr (GError) error = NULL;
+  gint exit_code = WP_EXIT_OK;
+
+  setlocale (LC_ALL, "");
+  setlocale (LC_NUMERIC, "C");
+
+  /* wp_init() is not called on purpose: with WIREPLUMBER_TRACE_FILE set in
+     the environment, it would truncate the file that we are about to read */
+
+  context = g_option_context_new ("FILE - print WirePlumber binary trace files");
+  g_option_context_set_description (context,
+      "Trace files are written by WirePlumber when the WIREPLUMBER_TRACE_FILE\n"
+      "environment variable is set to their path.");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    fprintf (stderr, "%s\n", error->message);
+    return WP_EXIT_USAGE;
+  }
+
+  if (!files || !files[0]) {
+    fprintf (stderr, "No trace file specified\n");
+    return WP_EXIT_USAGE;
+  }
+
+  for (gchar **f = files; *f; f++) {
+    if (!wp_log_trace_file_print (*f, stdout, &error)) {
+      fprintf (stderr, "%s\n", error->message);
+      g_clear_error (&error);
+      exit_code = WP_EXIT_NOINPUT;
+    }
+  }
+
+  g_strfreev (files);
+  return exit_code;
+}
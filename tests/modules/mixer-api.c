@@ -0,0 +1,401 @@
+/* WirePlumber
+ *
+ * Copyright © 2026 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../common/base-test-fixture.h"
+#include <errno.h>
+#include <spa/monitor/device.h>
+#include <spa/monitor/utils.h>
+#include <spa/param/param.h>
+
+#define N_TEST_ROUTES 2
+
+/* a device with one Route per card profile device, exported to the server
+   through the client core */
+typedef struct {
+  struct spa_device device;
+  struct spa_hook_list hooks;
+  struct spa_device_info info;
+  struct spa_param_info params[1];
+  WpProperties *props;
+  struct pw_proxy *proxy;
+  gfloat volumes[N_TEST_ROUTES];
+} TestDevice;
+
+typedef struct {
+  WpBaseTestFixture base;
+  WpPlugin *mixer;
+  GArray *changed;
+  guint n_expected;
+  TestDevice *device;
+} TestFixture;
+
+static WpSpaPod *
+test_device_build_route (TestDevice * self, gint index)
+{
+  gfloat volumes[2] = { self->volumes[index], self->volumes[index] };
+  g_autoptr (WpSpaPod) props = NULL;
+  g_autoptr (WpSpaPodBuilder) b =
+      wp_spa_pod_builder_new_object ("Spa:Pod:Object:Param:Props", "Route");
+
+  wp_spa_pod_builder_add (b,
+      "mute", "b", FALSE,
+      "channelVolumes", "a", sizeof (float), SPA_TYPE_Float, 2, volumes,
+      NULL);
+  props = wp_spa_pod_builder_end (b);
+
+  return wp_spa_pod_new_object (
+      "Spa:Pod:Object:Param:Route", "Route",
+      "index", "i", index,
+      "device", "i", index,
+      "props", "P", props,
+      NULL);
+}
+
+static int
+test_device_add_listener (void *object, struct spa_hook *listener,
+    const struct spa_device_events *events, void *data)
+{
+  TestDevice *self = object;
+  struct spa_hook_list save;
+
+  spa_hook_list_isolate (&self->hooks, &save, listener, events, data);
+  self->info.change_mask =
+      SPA_DEVICE_CHANGE_MASK_PROPS | SPA_DEVICE_CHANGE_MASK_PARAMS;
+  spa_device_emit_info (&self->hooks, &self->info);
+  self->info.change_mask = 0;
+  spa_hook_list_join (&self->hooks, &save);
+  return 0;
+}
+
+static int
+test_device_sync (void *object, int seq)
+{
+  TestDevice *self = object;
+
+  spa_device_emit_result (&self->hooks, seq, 0, 0, NULL);
+  return 0;
+}
+
+static int
+test_device_enum_params (void *object, int seq, uint32_t id, uint32_t start,
+    uint32_t num, const struct spa_pod *filter)
+{
+  TestDevice *self = object;
+  struct spa_result_device_params result = { .id = id };
+
+  if (id != SPA_PARAM_Route)
+    return 0;
+
+  for (result.index = start; result.index < N_TEST_ROUTES; result.index++) {
+    g_autoptr (WpSpaPod) route =
+        test_device_build_route (self, result.index);
+
+    result.next = result.index + 1;
+    result.param = (struct spa_pod *) wp_spa_pod_get_spa_pod (route);
+    spa_device_emit_result (&self->hooks, seq, 0,
+        SPA_RESULT_TYPE_DEVICE_PARAMS, &result);
+  }
+  return 0;
+}
+
+static int
+test_device_set_param (void *object, uint32_t id, uint32_t flags,
+    const struct spa_pod *param)
+{
+  return -ENOTSUP;
+}
+
+static const struct spa_device_methods test_device_methods = {
+  SPA_VERSION_DEVICE_METHODS,
+  .add_listener = test_device_add_listener,
+  .sync = test_device_sync,
+  .enum_params = test_device_enum_params,
+  .set_param = test_device_set_param,
+};
+
+static TestDevice *
+test_device_new (WpCore * core)
+{
+  TestDevice *self = g_new0 (TestDevice, 1);
+
+  self->device.iface = SPA_INTERFACE_INIT (SPA_TYPE_INTERFACE_Device,
+      SPA_VERSION_DEVICE, &test_device_methods, self);
+  spa_hook_list_init (&self->hooks);
+
+  self->props = wp_properties_new (
+      "device.name", "test-device",
+      "media.class", "Audio/Device",
+      NULL);
+  self->params[0] = SPA_PARAM_INFO (SPA_PARAM_Route, SPA_PARAM_INFO_READWRITE);
+  self->info = SPA_DEVICE_INFO_INIT ();
+  self->info.props = wp_properties_peek_dict (self->props);
+  self->info.params = self->params;
+  self->info.n_params = G_N_ELEMENTS (self->params);
+
+  for (guint i = 0; i < N_TEST_ROUTES; i++)
+    self->volumes[i] = 1.0f;
+
+  self->proxy = pw_core_export (wp_core_get_pw_core (core),
+      SPA_TYPE_INTERFACE_Device, wp_properties_peek_dict (self->props),
+      &self->device, 0);
+  g_assert_nonnull (self->proxy);
+  return self;
+}
+
+/* changes the volume of all routes, like a mixer control of the card would */
+static void
+test_device_set_volume (TestDevice * self, gfloat volume)
+{
+  for (guint i = 0; i < N_TEST_ROUTES; i++)
+    self->volumes[i] = volume;
+
+  self->params[0].flags ^= SPA_PARAM_INFO_SERIAL;
+  self->info.change_mask = SPA_DEVICE_CHANGE_MASK_PARAMS;
+  spa_device_emit_info (&self->hooks, &self->info);
+  self->info.change_mask = 0;
+}
+
+static void
+test_device_free (TestDevice * self)
+{
+  g_clear_pointer (&self->proxy, pw_proxy_destroy);
+  g_clear_pointer (&self->props, wp_properties_unref);
+  g_free (self);
+}
+
+static void
+on_plugin_loaded (WpCore * core, GAsyncResult * res, TestFixture *f)
+{
+  gboolean loaded;
+  GError *error = NULL;
+
+  loaded = wp_core_load_component_finish (core, res, &error);
+  g_assert_no_error (error);
+  g_assert_true (loaded);
+
+  g_main_loop_quit (f->base.loop);
+}
+
+static void
+on_mixer_changed (WpPlugin * mixer, guint id, TestFixture * f)
+{
+  g_array_append_val (f->changed, id);
+  if (f->n_expected && f->changed->len == f->n_expected)
+    g_main_loop_quit (f->base.loop);
+}
+
+static void
+test_mixer_api_setup (TestFixture * f, gconstpointer user_data)
+{
+  wp_base_test_fixture_setup (&f->base, WP_BASE_TEST_FLAG_CLIENT_CORE);
+  f->changed = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  /* load modules */
+  {
+    g_autoptr (WpTestServerLocker) lock =
+        wp_test_server_locker_new (&f->base.server);
+
+    g_assert_cmpint (pw_context_add_spa_lib (f->base.server.context,
+            "audiotestsrc", "audiotestsrc/libspa-audiotestsrc"), ==, 0);
+    if (!test_is_spa_lib_installed (&f->base, "audiotestsrc")) {
+      g_test_skip ("The pipewire audiotestsrc factory was not found");
+      return;
+    }
+    g_assert_nonnull (pw_context_load_module (f->base.server.context,
+            "libpipewire-module-spa-node-factory", NULL, NULL));
+    g_assert_nonnull (pw_context_load_module (f->base.server.context,
+            "libpipewire-module-adapter", NULL, NULL));
+    g_assert_nonnull (pw_context_load_module (f->base.server.context,
+            "libpipewire-module-client-device", NULL, NULL));
+  }
+
+  /* the client side of client-device; this may already be loaded by the
+     client configuration, in which case loading it again fails harmlessly */
+  pw_context_load_module (wp_core_get_pw_context (f->base.client_core),
+      "libpipewire-module-client-device", NULL, NULL);
+
+  wp_core_load_component (f->base.core,
+      "libwireplumber-module-mixer-api", "module", NULL, NULL, NULL,
+      (GAsyncReadyCallback) on_plugin_loaded, f);
+  g_main_loop_run (f->base.loop);
+
+  f->mixer = wp_plugin_find (f->base.core, "mixer-api");
+  g_assert_nonnull (f->mixer);
+  g_signal_connect (f->mixer, "changed", G_CALLBACK (on_mixer_changed), f);
+}
+
+static void
+test_mixer_api_teardown (TestFixture * f, gconstpointer user_data)
+{
+  if (f->mixer)
+    g_signal_handlers_disconnect_by_data (f->mixer, f);
+  g_clear_object (&f->mixer);
+  g_clear_pointer (&f->device, test_device_free);
+  g_clear_pointer (&f->changed, g_array_unref);
+  wp_base_test_fixture_teardown (&f->base);
+}
+
+/* runs until the mixer has emitted "changed" n times since the array
+   was last cleared, and checks that no more emissions follow */
+static void
+wait_changed (TestFixture * f, guint n)
+{
+  f->n_expected = n;
+  if (f->changed->len < n)
+    g_main_loop_run (f->base.loop);
+  f->n_expected = 0;
+
+  wp_core_sync (f->base.core, NULL,
+      (GAsyncReadyCallback) test_core_done_cb, f);
+  g_main_loop_run (f->base.loop);
+  g_assert_cmpuint (f->changed->len, ==, n);
+}
+
+static gboolean
+changed_contains (TestFixture * f, guint id)
+{
+  for (guint i = 0; i < f->changed->len; i++) {
+    if (g_array_index (f->changed, guint, i) == id)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static WpNode *
+create_node (TestFixture * f, const gchar * name, guint32 device_id,
+    const gchar * profile_device)
+{
+  g_autoptr (WpNode) node = NULL;
+  WpProperties *props = wp_properties_new (
+      "factory.name", "audiotestsrc",
+      "node.name", name,
+      "media.class", "Audio/Source",
+      NULL);
+
+  if (profile_device) {
+    wp_properties_setf (props, "device.id", "%u", device_id);
+    wp_properties_set (props, "card.profile.device", profile_device);
+  }
+
+  node = wp_node_new_from_factory (f->base.core, "adapter", props);
+  g_assert_nonnull (node);
+  wp_object_activate (WP_OBJECT (node), WP_OBJECT_FEATURES_ALL,
+      NULL, (GAsyncReadyCallback) test_object_activate_finish_cb, f);
+  g_main_loop_run (f->base.loop);
+
+  return g_steal_pointer (&node);
+}
+
+static void
+test_mixer_api_node_props (TestFixture * f, gconstpointer user_data)
+{
+  g_autoptr (WpNode) node_a = NULL;
+  g_autoptr (WpNode) node_b = NULL;
+  g_autoptr (GVariant) volume = NULL;
+  gboolean res = FALSE;
+  gboolean mute = FALSE;
+  guint id_a, id_b;
+
+  if (!test_is_spa_lib_installed (&f->base, "audiotestsrc")) {
+    g_test_skip ("The pipewire audiotestsrc factory was not found");
+    return;
+  }
+
+  node_a = create_node (f, "node-a", 0, NULL);
+  node_b = create_node (f, "node-b", 0, NULL);
+  id_a = wp_proxy_get_bound_id (WP_PROXY (node_a));
+  id_b = wp_proxy_get_bound_id (WP_PROXY (node_b));
+
+  /* every new node is collected once */
+  wait_changed (f, 2);
+  g_assert_true (changed_contains (f, id_a));
+  g_assert_true (changed_contains (f, id_b));
+  g_array_set_size (f->changed, 0);
+
+  /* only the node whose Props changed is collected again */
+  g_signal_emit_by_name (f->mixer, "set-volume", id_a,
+      g_variant_new_parsed ("{'mute': <true>}"), &res);
+  g_assert_true (res);
+  wait_changed (f, 1);
+  g_assert_cmpuint (g_array_index (f->changed, guint, 0), ==, id_a);
+
+  g_signal_emit_by_name (f->mixer, "get-volume", id_a, &volume);
+  g_assert_nonnull (volume);
+  g_assert_true (g_variant_lookup (volume, "mute", "b", &mute));
+  g_assert_true (mute);
+}
+
+static void
+test_mixer_api_device_route (TestFixture * f, gconstpointer user_data)
+{
+  g_autoptr (WpObjectManager) om = NULL;
+  g_autoptr (WpDevice) device = NULL;
+  g_autoptr (WpNode) node_0 = NULL;
+  g_autoptr (WpNode) node_1 = NULL;
+  g_autoptr (WpNode) node_other = NULL;
+  g_autoptr (GVariant) volume = NULL;
+  gdouble vol = 0.0;
+  guint32 device_id;
+  guint id_0, id_1;
+
+  if (!test_is_spa_lib_installed (&f->base, "audiotestsrc")) {
+    g_test_skip ("The pipewire audiotestsrc factory was not found");
+    return;
+  }
+
+  f->device = test_device_new (f->base.client_core);
+
+  om = wp_object_manager_new ();
+  wp_object_manager_add_interest (om, WP_TYPE_DEVICE,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "device.name", "=s", "test-device",
+      NULL);
+  test_ensure_object_manager_is_installed (om, f->base.core, f->base.loop);
+  device = wp_object_manager_lookup (om, WP_TYPE_DEVICE, NULL);
+  g_assert_nonnull (device);
+  device_id = wp_proxy_get_bound_id (WP_PROXY (device));
+
+  node_0 = create_node (f, "node-0", device_id, "0");
+  node_1 = create_node (f, "node-1", device_id, "1");
+  node_other = create_node (f, "node-other", 0, NULL);
+  id_0 = wp_proxy_get_bound_id (WP_PROXY (node_0));
+  id_1 = wp_proxy_get_bound_id (WP_PROXY (node_1));
+
+  wait_changed (f, 3);
+  g_array_set_size (f->changed, 0);
+
+  /* a Route change marks all the nodes of the device, and only those */
+  test_device_set_volume (f->device, 0.5f);
+  wait_changed (f, 2);
+  g_assert_true (changed_contains (f, id_0));
+  g_assert_true (changed_contains (f, id_1));
+
+  /* the volume comes from the Route of the node */
+  g_signal_emit_by_name (f->mixer, "get-volume", id_1, &volume);
+  g_assert_nonnull (volume);
+  g_assert_true (g_variant_lookup (volume, "volume", "d", &vol));
+  g_assert_cmpfloat_with_epsilon (vol, 0.5, 0.001);
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  wp_init (WP_INIT_ALL);
+
+  g_test_add ("/modules/mixer-api/node-props",
+      TestFixture, NULL,
+      test_mixer_api_setup,
+      test_mixer_api_node_props,
+      test_mixer_api_teardown);
+  g_test_add ("/modules/mixer-api/device-route",
+      TestFixture, NULL,
+      test_mixer_api_setup,
+      test_mixer_api_device_route,
+      test_mixer_api_teardown);
+
+  return g_test_run ();
+}
@@ -0,0 +1,42 @@
+-- Tests that create-item.lua configures session items from the properties of
+-- real nodes, including the values that it assigns to them from Lua.
+
+local tu = require ("test-utils")
+
+Script.async_activation = true
+
+local node = tu.createDeviceNode ("create-item-device-node", "Audio/Sink")
+
+SimpleEventHook {
+  name = "linkable-added@test-create-item",
+  after = "linkable-added@test-utils-linking",
+  interests = {
+    EventInterest {
+      Constraint { "event.type", "=", "session-item-added" },
+      Constraint { "event.session-item.interface", "=", "linkable" },
+      Constraint { "node.name", "=", "create-item-device-node" },
+    },
+  },
+  execute = function (event)
+    local lnkbl = event:get_subject ()
+    local props = lnkbl.properties
+
+    -- values that come from the node properties
+    assert (props ["item.factory.name"] == "si-audio-adapter")
+    assert (props ["media.class"] == "Audio/Sink")
+
+    -- values that create-item.lua assigns from Lua
+    assert (props ["media.type"] == "Audio")
+    assert (props ["item.node.type"] == "device")
+    assert (props ["item.node.direction"] == "input")
+    assert (props ["node.id"] == tostring (node ["bound-id"]))
+    assert (props ["item.features.monitor"] == "1")
+
+    -- the node object must reach the item in the form that it parses
+    local si_node = lnkbl:get_associated_proxy ("node")
+    assert (si_node ~= nil)
+    assert (si_node ["bound-id"] == node ["bound-id"])
+
+    Script:finish_activation ()
+  end
+}:register ()
@@ -12,7 +12,9 @@ typedef struct {
   WpBaseTestFixture base;
   GPtrArray *hooks_executed;
   GPtrArray *events;
+  GArray *records;
   WpTransition *transition;
+  gboolean reemit_params;
 } TestFixture;
 
 static void
@@ -21,6 +23,7 @@ test_events_setup (TestFixture *self, gconstpointer user_data)
   wp_base_test_fixture_setup (&self->base, 0);
   self->hooks_executed = g_ptr_array_new ();
   self->events = g_ptr_array_new ();
+  self->records = g_array_new (FALSE, FALSE, sizeof (gint64));
 }
 
 static void
@@ -28,6 +31,7 @@ test_events_teardown (TestFixture *self, gconstpointer user_data)
 {
   g_clear_pointer (&self->hooks_executed, g_ptr_array_unref);
   g_clear_pointer (&self->events, g_ptr_array_unref);
+  g_clear_pointer (&self->records, g_array_unref);
   wp_base_test_fixture_teardown (&self->base);
 }
 
@@ -424,6 +428,544 @@ test_events_glob_deps (TestFixture *self, gconstpointer user_data)
   g_assert_true (hook_quit == self->hooks_executed->pdata [4]);
 }
 
+static void
+test_events_hooks_cache (TestFixture *self, gconstpointer user_data)
+{
+  g_autoptr (WpEventDispatcher) dispatcher = NULL;
+  g_autoptr (WpEventHook) hook_any = NULL;
+  g_autoptr (WpEventHook) hook = NULL;
+  WpEvent *event1 = NULL;
+  const gchar **before, **after;
+
+  dispatcher = wp_event_dispatcher_get_instance (self->base.core);
+  g_assert_nonnull (dispatcher);
+
+  before = NULL;
+  after = NULL;
+  hook = wp_simple_event_hook_new ("hook-a", before, after,
+    g_cclosure_new ((GCallback) hook_a, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "type1", NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook);
+  g_clear_object (&hook);
+
+  before = NULL;
+  after = (const gchar *[]) { "hook-*", NULL };
+  hook = wp_simple_event_hook_new ("quit", before, after,
+    g_cclosure_new ((GCallback) hook_quit, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "c(ss)", "type1", "type2",
+    NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook);
+  g_clear_object (&hook);
+
+  /* first event run; populates the cache for type1 */
+  event1 = wp_event_new ("type1", 10, NULL, NULL, NULL);
+  wp_event_dispatcher_push_event (dispatcher, event1);
+
+  g_main_loop_run (self->base.loop);
+  g_assert_cmpint (self->hooks_executed->len, == , 2);
+  g_assert_true (hook_a == self->hooks_executed->pdata [0]);
+  g_assert_true (hook_quit == self->hooks_executed->pdata [1]);
+
+  g_ptr_array_remove_range (self->hooks_executed, 0, self->hooks_executed->len);
+  g_ptr_array_remove_range (self->events, 0, self->events->len);
+
+  /* a hook that is not restricted to any event type, registered later */
+  before = (const gchar *[]) { "hook-a", NULL };
+  after = NULL;
+  hook_any = wp_simple_event_hook_new ("hook-b", before, after,
+    g_cclosure_new ((GCallback) hook_b, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook_any),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "test.prop", "=s", "some-val", NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook_any);
+
+  /* second event run; hook-b must be picked up */
+  event1 = wp_event_new ("type1", 10,
+    wp_properties_new ("test.prop", "some-val", NULL), NULL, NULL);
+  wp_event_dispatcher_push_event (dispatcher, event1);
+
+  g_main_loop_run (self->base.loop);
+  g_assert_cmpint (self->hooks_executed->len, == , 3);
+  g_assert_true (hook_b == self->hooks_executed->pdata [0]);
+  g_assert_true (hook_a == self->hooks_executed->pdata [1]);
+  g_assert_true (hook_quit == self->hooks_executed->pdata [2]);
+
+  g_ptr_array_remove_range (self->hooks_executed, 0, self->hooks_executed->len);
+  g_ptr_array_remove_range (self->events, 0, self->events->len);
+
+  /* third event run; hook-b must be gone again */
+  wp_event_dispatcher_unregister_hook (dispatcher, hook_any);
+
+  event1 = wp_event_new ("type1", 10,
+    wp_properties_new ("test.prop", "some-val", NULL), NULL, NULL);
+  wp_event_dispatcher_push_event (dispatcher, event1);
+
+  g_main_loop_run (self->base.loop);
+  g_assert_cmpint (self->hooks_executed->len, == , 2);
+  g_assert_true (hook_a == self->hooks_executed->pdata [0]);
+  g_assert_true (hook_quit == self->hooks_executed->pdata [1]);
+}
+
+static void
+register_hook (WpEventDispatcher * dispatcher, const gchar * name,
+    const gchar ** before, const gchar ** after, GCallback func,
+    TestFixture * self, const gchar * event_type, const gchar * test_prop)
+{
+  g_autoptr (WpEventHook) hook = wp_simple_event_hook_new (name, before, after,
+      g_cclosure_new (func, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+      WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", event_type, NULL);
+  if (test_prop)
+    wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+        WP_CONSTRAINT_TYPE_PW_PROPERTY, "test.prop", "=s", test_prop, NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook);
+}
+
+static void
+test_events_before_multi_match (TestFixture *self, gconstpointer user_data)
+{
+  g_autoptr (WpEventDispatcher) dispatcher = NULL;
+
+  dispatcher = wp_event_dispatcher_get_instance (self->base.core);
+  g_assert_nonnull (dispatcher);
+
+  /* a "before" glob only applies to the first hook that it matches, so
+     these two do not depend on each other circularly: hook-a depends on
+     itself, which is ignored, and hook-b makes hook-a run after it */
+  register_hook (dispatcher, "hook-a", (const gchar *[]) { "*", NULL }, NULL,
+      (GCallback) hook_a, self, "type1", NULL);
+  register_hook (dispatcher, "hook-b", (const gchar *[]) { "*", NULL }, NULL,
+      (GCallback) hook_b, self, "type1", NULL);
+  register_hook (dispatcher, "hook-c", NULL, NULL,
+      (GCallback) hook_c, self, "type1", NULL);
+  register_hook (dispatcher, "quit", NULL,
+      (const gchar *[]) { "hook-a", "hook-b", "hook-c", NULL },
+      (GCallback) hook_quit, self, "type1", NULL);
+
+  wp_event_dispatcher_push_event (dispatcher,
+      wp_event_new ("type1", 10, NULL, NULL, NULL));
+
+  g_main_loop_run (self->base.loop);
+  g_assert_cmpint (self->hooks_executed->len, == , 4);
+  g_assert_true (hook_b == self->hooks_executed->pdata [0]);
+  g_assert_true (hook_c == self->hooks_executed->pdata [1]);
+  g_assert_true (hook_a == self->hooks_executed->pdata [2]);
+  g_assert_true (hook_quit == self->hooks_executed->pdata [3]);
+}
+
+static void
+test_events_after_multi_match (TestFixture *self, gconstpointer user_data)
+{
+  g_autoptr (WpEventDispatcher) dispatcher = NULL;
+
+  dispatcher = wp_event_dispatcher_get_instance (self->base.core);
+  g_assert_nonnull (dispatcher);
+
+  /* sorting all the candidates puts hook-x between foo-1 and foo-2, as
+     foo-1 alone satisfies its "after" glob, but foo-1 only runs for events
+     that have test.prop set */
+  register_hook (dispatcher, "foo-1", NULL, NULL,
+      (GCallback) hook_a, self, "type1", "some-val");
+  register_hook (dispatcher, "hook-x", NULL,
+      (const gchar *[]) { "foo-*", NULL },
+      (GCallback) hook_c, self, "type1", NULL);
+  register_hook (dispatcher, "foo-2", NULL,
+      (const gchar *[]) { "hook-d", NULL },
+      (GCallback) hook_b, self, "type1", NULL);
+  register_hook (dispatcher, "hook-d", NULL, NULL,
+      (GCallback) hook_d, self, "type1", NULL);
+  register_hook (dispatcher, "quit", NULL,
+      (const gchar *[]) { "hook-x", NULL },
+      (GCallback) hook_quit, self, "type1", NULL);
+
+  /* without foo-1, hook-x must run after foo-2 */
+  wp_event_dispatcher_push_event (dispatcher,
+      wp_event_new ("type1", 10, NULL, NULL, NULL));
+
+  g_main_loop_run (self->base.loop);
+  g_assert_cmpint (self->hooks_executed->len, == , 4);
+  g_assert_true (hook_d == self->hooks_executed->pdata [0]);
+  g_assert_true (hook_b == self->hooks_executed->pdata [1]);
+  g_assert_true (hook_c == self->hooks_executed->pdata [2]);
+  g_assert_true (hook_quit == self->hooks_executed->pdata [3]);
+}
+
+static void
+test_events_circular_deps (TestFixture *self, gconstpointer user_data)
+{
+  g_autoptr (WpEventDispatcher) dispatcher = NULL;
+
+  dispatcher = wp_event_dispatcher_get_instance (self->base.core);
+  g_assert_nonnull (dispatcher);
+
+  /* hook-a and hook-b depend on each other, but hook-b only runs for
+     events that have test.prop set */
+  register_hook (dispatcher, "hook-a", NULL,
+      (const gchar *[]) { "hook-b", NULL },
+      (GCallback) hook_a, self, "type1", NULL);
+  register_hook (dispatcher, "hook-b", NULL,
+      (const gchar *[]) { "hook-a", NULL },
+      (GCallback) hook_b, self, "type1", "some-val");
+  register_hook (dispatcher, "quit", NULL,
+      (const gchar *[]) { "hook-a", NULL },
+      (GCallback) hook_quit, self, "type1", NULL);
+  register_hook (dispatcher, "quit-type2", NULL, NULL,
+      (GCallback) hook_quit, self, "type2", NULL);
+
+  /* the hooks that run are not circular */
+  wp_event_dispatcher_push_event (dispatcher,
+      wp_event_new ("type1", 10, NULL, NULL, NULL));
+
+  g_main_loop_run (self->base.loop);
+  g_assert_cmpint (self->hooks_executed->len, == , 2);
+  g_assert_true (hook_a == self->hooks_executed->pdata [0]);
+  g_assert_true (hook_quit == self->hooks_executed->pdata [1]);
+
+  g_ptr_array_remove_range (self->hooks_executed, 0, self->hooks_executed->len);
+  g_ptr_array_remove_range (self->events, 0, self->events->len);
+
+  /* the hooks that run are circular; none of them runs */
+  wp_event_dispatcher_push_event (dispatcher,
+      wp_event_new ("type1", 20,
+          wp_properties_new ("test.prop", "some-val", NULL), NULL, NULL));
+  wp_event_dispatcher_push_event (dispatcher,
+      wp_event_new ("type2", 10, NULL, NULL, NULL));
+
+  g_main_loop_run (self->base.loop);
+  g_assert_cmpint (self->hooks_executed->len, == , 1);
+  g_assert_true (hook_quit == self->hooks_executed->pdata [0]);
+}
+
+static void
+test_events_properties (TestFixture *self, gconstpointer user_data)
+{
+  g_autoptr (WpEvent) event = NULL;
+  g_autoptr (WpProperties) props = NULL;
+
+  event = wp_event_new ("type1", 10,
+      wp_properties_new (
+          "test.prop", "some-val",
+          "event.type", "overridden",
+          NULL),
+      NULL, NULL);
+
+  g_assert_cmpstr (wp_event_get_property (event, "event.type"), ==, "type1");
+  g_assert_cmpstr (wp_event_get_property (event, "test.prop"), ==, "some-val");
+  g_assert_null (wp_event_get_property (event, "test.missing"));
+
+  props = wp_event_get_properties (event);
+  g_assert_cmpstr (wp_properties_get (props, "event.type"), ==, "type1");
+  g_assert_cmpstr (wp_properties_get (props, "test.prop"), ==, "some-val");
+  g_assert_cmpstr (wp_event_get_property (event, "test.prop"), ==, "some-val");
+}
+
+#define N_HEAP_EVENTS 100000
+
+static void
+hook_record (WpEvent * event, TestFixture * self)
+{
+  g_autoptr (WpProperties) props = wp_event_get_properties (event);
+  gint64 priority = wp_event_get_priority (event);
+  gint64 seq = g_ascii_strtoll (wp_properties_get (props, "test.seq"), NULL, 10);
+
+  g_array_append_val (self->records, priority);
+  g_array_append_val (self->records, seq);
+}
+
+static void
+test_events_heap_order (TestFixture *self, gconstpointer user_data)
+{
+  g_autoptr (WpEventDispatcher) dispatcher = NULL;
+  g_autoptr (WpEventHook) hook = NULL;
+
+  dispatcher = wp_event_dispatcher_get_instance (self->base.core);
+  g_assert_nonnull (dispatcher);
+
+  hook = wp_simple_event_hook_new ("hook-record", NULL, NULL,
+    g_cclosure_new ((GCallback) hook_record, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "type1", NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook);
+  g_clear_object (&hook);
+
+  hook = wp_simple_event_hook_new ("hook-quit", NULL, NULL,
+    g_cclosure_new ((GCallback) hook_quit, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "quit", NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook);
+  g_clear_object (&hook);
+
+  /* the quit event has the lowest priority, so it must run last */
+  wp_event_dispatcher_push_event (dispatcher,
+      wp_event_new ("quit", -1, NULL, NULL, NULL));
+
+  for (gint i = 0; i < N_HEAP_EVENTS; i++) {
+    g_autofree gchar *seq = g_strdup_printf ("%d", i);
+    wp_event_dispatcher_push_event (dispatcher,
+        wp_event_new ("type1", (i * 7919) % 97,
+            wp_properties_new ("test.seq", seq, NULL), NULL, NULL));
+  }
+
+  g_main_loop_run (self->base.loop);
+
+  g_assert_cmpuint (self->records->len, ==, 2 * N_HEAP_EVENTS);
+  g_assert_cmpint (self->hooks_executed->len, ==, 1);
+
+  for (guint i = 2; i < self->records->len; i += 2) {
+    gint64 prev_priority = g_array_index (self->records, gint64, i - 2);
+    gint64 prev_seq = g_array_index (self->records, gint64, i - 1);
+    gint64 priority = g_array_index (self->records, gint64, i);
+    gint64 seq = g_array_index (self->records, gint64, i + 1);
+
+    /* higher priority first, then first in, first out */
+    g_assert_cmpint (prev_priority, >=, priority);
+    if (prev_priority == priority)
+      g_assert_cmpint (prev_seq, <, seq);
+  }
+}
+
+static void
+test_events_hook_stats (TestFixture *self, gconstpointer user_data)
+{
+  g_autoptr (WpEventDispatcher) dispatcher = NULL;
+  g_autoptr (WpEventHook) hook = NULL;
+  g_autoptr (WpEventHook) hook_q = NULL;
+  WpEventHookStats stats;
+
+  dispatcher = wp_event_dispatcher_get_instance (self->base.core);
+  g_assert_nonnull (dispatcher);
+
+  hook = wp_simple_event_hook_new ("hook-a", NULL, NULL,
+    g_cclosure_new ((GCallback) hook_a, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "type1",
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "test.prop", "=s", "some-val", NULL);
+
+  g_assert_false (wp_event_dispatcher_get_hook_stats (dispatcher, hook, &stats));
+  wp_event_dispatcher_register_hook (dispatcher, hook);
+
+  hook_q = wp_simple_event_hook_new ("quit", NULL,
+    (const gchar *[]) { "hook-*", NULL },
+    g_cclosure_new ((GCallback) hook_quit, self, NULL));
+  wp_interest_event_hook_add_interest (WP_INTEREST_EVENT_HOOK (hook_q),
+    WP_CONSTRAINT_TYPE_PW_PROPERTY, "event.type", "=s", "type1", NULL);
+  wp_event_dispatcher_register_hook (dispatcher, hook_q);
+
+  wp_event_dispatcher_push_event (dispatcher, wp_event_new ("type1", 10,
+      wp_properties_new ("test.prop", "some-val", NULL), NULL, NULL));
+  g_main_loop_run (self->base.loop);
+
+  wp_event_dispatcher_push_event (dispatcher,
+      wp_event_new ("type1", 10, NULL, NULL, NULL));
+  g_main_loop_run (self->base.loop);
+
+  g_assert_true (wp_event_dispatcher_get_hook_stats (dispatcher, hook, &stats));
+  g_assert_cmpuint (stats.n_runs, ==, 1);
+  g_assert_cmpuint (stats.n_skipped, ==, 1);
+  g_assert_cmpint (stats.total_time, >=, stats.max_time);
+  g_assert_cmpint (stats.max_time, >=, 0);
+
+  g_assert_true (wp_event_dispatcher_get_hook_stats (dispatcher, hook_q, &stats));
+  g_assert_cmpuint (stats.n_runs, ==, 2);
+  g_assert_cmpuint (stats.n_skipped, ==, 0);
+
+  wp_event_dispatcher_reset_hook_stats (dispatcher);
+  g_assert_true (wp_event_dispatcher_get_hook_stats (dispatcher, hook, &stats));
+  g_assert_cmpuint (stats.n_runs, ==, 0);
+  g_assert_cmpuint (stats.n_skipped, ==, 0);
+
+  wp_event_dispatcher_unregister_hook (dispatcher, hook);
+  g_assert_false (wp_event_dispatcher_get_hook_stats (dispatcher, hook, &stats));
+  wp_event_dispatcher_unregister_hook (dispatcher, hook_q);
+}
+
+static void
+on_component_loaded (WpCore * core, GAsyncResult * res, TestFixture * self)
+{
+  g_autoptr (GError) error = NULL;
+
+  g_assert_true (wp_core_load_component_finish (core, res, &error));
+  g_assert_no_error (error);
+  g_main_loop_quit (self->base.loop);
+}
+
+/* loads the standard event source with event coalescing enabled */
+static WpPlugin *
+load_coalescing_event_source (TestFixture * self)
+{
+  g_autoptr (WpSpaJson) args =
+      wp_spa_json_new_from_string ("{ coalesce.events = true }");
+
+  wp_core_load_component (self->base.core,
+      "libwireplumber-module-standard-event-source", "module", args, NULL,
+      NULL, (GAsyncReadyCallback) on_component_loaded, self);
+  g_main_loop_run (self->base.loop);
+
+  return wp_plugin_find (self->base.core, "standard-event-source");
+}
+
+static gpointer
+lookup_object (TestFixture * self, GType type)
+{
+  g_autoptr (WpObjectManager) om = wp_object_manager_new ();
+
+  wp_object_manager_add_interest (om, type, NULL);
+  test_ensure_object_manager_is_installed (om, self->base.core,
+      self->base.loop);
+
+  /* make sure that the event source has seen the object too */
+  wp_core_sync (self->base.core, NULL,
+      (GAsyncReadyCallback) test_core_done_cb, self);
+  g_main_loop_run (self->base.loop);
+
+  return wp_object_manager_lookup (om, type, NULL);
+}
+
+static void
+hook_record_value (WpEvent * event, TestFixture * self)
+{
+  const gchar *value = wp_event_get_property (event, "event.subject.value");
+  gint64 v = value ? g_ascii_strtoll (value, NULL, 10) : -1;
+
+  g_array_append_val (self->records, v);
+}
+
+static void
+hook_record_params_changed (WpEvent * event, TestFixture * self)
+{
+  gint64 n = self->records->len;
+
+  g_array_append_val (self->records, n);
+
+  /* the event is being dispatched, so this must become a new event */
+  if (n == 0 && self->reemit_params) {
+    g_autoptr (GObject) subject = wp_event_get_subject (event);
+    g_signal_emit_by_name (subject, "params-changed", "Props");
+  }
+}
+
+static void
+push_quit_event (TestFixture * self)
+{
+  g_autoptr (WpEventDispatcher) dispatcher =
+      wp_event_dispatcher_get_instance (self->base.core);
+
+  /* lower than the priority of any event of the event source */
+  wp_event_dispatcher_push_event (dispatcher,
+      wp_event_new ("test-quit", -1000, NULL, NULL, NULL));
+}
+
+static void
+test_events_coalesce_replace (TestFixture *self, gconstpointer user_data)
+{
+  g_autoptr (WpEventDispatcher) dispatcher = NULL;
+  g_autoptr (WpPlugin) source = NULL;
+  g_autoptr (WpImplMetadata) m = NULL;
+  g_autoptr (WpMetadata) metadata = NULL;
+  guint64 n_coalesced = 0;
+
+  dispatcher = wp_event_dispatcher_get_instance (self->base.core);
+  source = load_coalescing_event_source (self);
+  g_assert_nonnull (source);
+
+  m = wp_impl_metadata_new_full (self->base.core, "test", NULL);
+  wp_object_activate (WP_OBJECT (m), WP_OBJECT_FEATURES_ALL,
+      NULL, (GAsyncReadyCallback) test_object_activate_finish_cb, self);
+  g_main_loop_run (self->base.loop);
+  metadata = lookup_object (self, WP_TYPE_METADATA);
+  g_assert_nonnull (metadata);
+
+  register_hook (dispatcher, "record", NULL, NULL,
+      (GCallback) hook_record_value, self, "metadata-changed", NULL);
+  register_hook (dispatcher, "quit", NULL, NULL,
+      (GCallback) hook_quit, self, "test-quit", NULL);
+
+  /* the hooks read the value from the event, so the last one must win */
+  wp_metadata_set (metadata, 0, "test.key", "Spa:Int", "1");
+  wp_metadata_set (metadata, 0, "test.key", "Spa:Int", "2");
+  push_quit_event (self);
+  g_main_loop_run (self->base.loop);
+
+  g_assert_cmpuint (self->records->len, ==, 1);
+  g_assert_cmpint (g_array_index (self->records, gint64, 0), ==, 2);
+  g_object_get (source, "coalesced-metadata-changed", &n_coalesced, NULL);
+  g_assert_cmpuint (n_coalesced, ==, 1);
+}
+
+static void
+test_events_coalesce_merge (TestFixture *self, gconstpointer user_data)
+{
+  g_autoptr (WpEventDispatcher) dispatcher = NULL;
+  g_autoptr (WpPlugin) source = NULL;
+  g_autoptr (WpClient) client = NULL;
+  guint64 n_coalesced = 0;
+
+  dispatcher = wp_event_dispatcher_get_instance (self->base.core);
+  source = load_coalescing_event_source (self);
+  g_assert_nonnull (source);
+  client = lookup_object (self, WP_TYPE_CLIENT);
+  g_assert_nonnull (client);
+
+  register_hook (dispatcher, "record", NULL, NULL,
+      (GCallback) hook_record_params_changed, self, "client-params-changed",
+      NULL);
+  register_hook (dispatcher, "quit", NULL, NULL,
+      (GCallback) hook_quit, self, "test-quit", NULL);
+
+  /* the hooks read the params from the subject, so one event is enough */
+  g_signal_emit_by_name (client, "params-changed", "Props");
+  g_signal_emit_by_name (client, "params-changed", "Props");
+  g_signal_emit_by_name (client, "params-changed", "Props");
+  push_quit_event (self);
+  g_main_loop_run (self->base.loop);
+
+  g_assert_cmpuint (self->records->len, ==, 1);
+  g_object_get (source, "coalesced-params-changed", &n_coalesced, NULL);
+  g_assert_cmpuint (n_coalesced, ==, 2);
+}
+
+static void
+test_events_coalesce_after_dispatch (TestFixture *self,
+    gconstpointer user_data)
+{
+  g_autoptr (WpEventDispatcher) dispatcher = NULL;
+  g_autoptr (WpPlugin) source = NULL;
+  g_autoptr (WpClient) client = NULL;
+  guint64 n_coalesced = 0;
+
+  dispatcher = wp_event_dispatcher_get_instance (self->base.core);
+  source = load_coalescing_event_source (self);
+  g_assert_nonnull (source);
+  client = lookup_object (self, WP_TYPE_CLIENT);
+  g_assert_nonnull (client);
+
+  /* the first hook that runs makes the params change again; the hook that
+     runs after it has not seen the new params, so the change must not be
+     merged into the event that is being dispatched */
+  self->reemit_params = TRUE;
+  register_hook (dispatcher, "record", NULL, NULL,
+      (GCallback) hook_record_params_changed, self, "client-params-changed",
+      NULL);
+  register_hook (dispatcher, "hook-b", NULL,
+      (const gchar *[]) { "record", NULL },
+      (GCallback) hook_b, self, "client-params-changed", NULL);
+  register_hook (dispatcher, "quit", NULL, NULL,
+      (GCallback) hook_quit, self, "test-quit", NULL);
+
+  g_signal_emit_by_name (client, "params-changed", "Props");
+  push_quit_event (self);
+  g_main_loop_run (self->base.loop);
+
+  g_assert_cmpuint (self->records->len, ==, 2);
+  g_assert_cmpuint (self->hooks_executed->len, ==, 3);
+  g_assert_true (hook_b == self->hooks_executed->pdata [0]);
+  g_assert_true (hook_b == self->hooks_executed->pdata [1]);
+  g_assert_true (hook_quit == self->hooks_executed->pdata [2]);
+  g_object_get (source, "coalesced-params-changed", &n_coalesced, NULL);
+  g_assert_cmpuint (n_coalesced, ==, 0);
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -438,6 +980,27 @@ main (gint argc, gchar *argv[])
     test_events_setup, test_events_async_hook, test_events_teardown);
   g_test_add ("/wp/events/glob_deps", TestFixture, NULL,
     test_events_setup, test_events_glob_deps, test_events_teardown);
+  g_test_add ("/wp/events/hooks_cache", TestFixture, NULL,
+    test_events_setup, test_events_hooks_cache, test_events_teardown);
+  g_test_add ("/wp/events/before_multi_match", TestFixture, NULL,
+    test_events_setup, test_events_before_multi_match, test_events_teardown);
+  g_test_add ("/wp/events/after_multi_match", TestFixture, NULL,
+    test_events_setup, test_events_after_multi_match, test_events_teardown);
+  g_test_add ("/wp/events/circular_deps", TestFixture, NULL,
+    test_events_setup, test_events_circular_deps, test_events_teardown);
+  g_test_add ("/wp/events/properties", TestFixture, NULL,
+    test_events_setup, test_events_properties, test_events_teardown);
+  g_test_add ("/wp/events/heap_order", TestFixture, NULL,
+    test_events_setup, test_events_heap_order, test_events_teardown);
+  g_test_add ("/wp/events/hook_stats", TestFixture, NULL,
+    test_events_setup, test_events_hook_stats, test_events_teardown);
+  g_test_add ("/wp/events/coalesce_replace", TestFixture, NULL,
+    test_events_setup, test_events_coalesce_replace, test_events_teardown);
+  g_test_add ("/wp/events/coalesce_merge", TestFixture, NULL,
+    test_events_setup, test_events_coalesce_merge, test_events_teardown);
+  g_test_add ("/wp/events/coalesce_after_dispatch", TestFixture, NULL,
+    test_events_setup, test_events_coalesce_after_dispatch,
+    test_events_teardown);
 
   return g_test_run ();
 }
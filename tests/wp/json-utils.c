@@ -333,6 +333,100 @@ test_match_rules (void)
   }
 }
 
+static gboolean
+count_actions_cb (gpointer data, const gchar * action, WpSpaJson * value,
+    GError ** error)
+{
+  GPtrArray *actions = data;
+  g_ptr_array_add (actions, wp_spa_json_parse_string (value));
+  return TRUE;
+}
+
+static gchar *
+match_rules_with_matcher (WpRulesMatcher *matcher, const gchar *key,
+    const gchar *value)
+{
+  g_autoptr (GPtrArray) actions = g_ptr_array_new_with_free_func (g_free);
+  g_autoptr (WpProperties) props = wp_properties_new (
+      "node.name", "alsa_output.0", "media.class", "Audio/Sink", NULL);
+  g_autoptr (GError) error = NULL;
+
+  wp_properties_set (props, key, value);
+  g_assert_true (wp_rules_matcher_match (matcher, props, count_actions_cb,
+      actions, &error));
+  g_assert_no_error (error);
+  g_ptr_array_add (actions, NULL);
+  return g_strjoinv (",", (gchar **) actions->pdata);
+}
+
+static void
+test_rules_matcher (void)
+{
+  static const gchar * const rules_json_string =
+      "["
+      "  { matches = [ { node.name = \"alsa_output.0\" } ]"
+      "    actions = { tag = exact } }"
+      "  { matches = [ { node.name = \"!alsa_output.0\" } ]"
+      "    actions = { tag = negated } }"
+      "  { matches = [ { node.name = \"~alsa_.*\" media.class = \"Audio/Sink\" } ]"
+      "    actions = { tag = regex } }"
+      "  { matches = [ { node.name = \"!~^alsa_\" } ]"
+      "    actions = { tag = negated-regex } }"
+      "  { matches = [ { node.nick = null } ]"
+      "    actions = { tag = null } }"
+      "  { matches = [ { node.nick = \"!null\" } ]"
+      "    actions = { tag = not-null } }"
+      "  { matches = [ { node.nick = \"null\" } ]"
+      "    actions = { tag = null-string } }"
+      "  { matches = [ { node.nick = \"~(\" } ]"
+      "    actions = { tag = invalid-regex } }"
+      "  { matches = [ { node.name = \"other\" } { node.nick = \"nick\" } ]"
+      "    actions = { tag = any-of } }"
+      "  { matches = [ { } ]"
+      "    actions = { tag = empty } }"
+      "  { matches = [ { node.name = \"alsa_output.0\" } ] }"
+      "]";
+
+  g_autoptr (WpSpaJson) rules = wp_spa_json_new_wrap_stringn (rules_json_string,
+      strlen (rules_json_string));
+  g_autoptr (WpRulesMatcher) matcher = wp_rules_matcher_new (rules);
+  g_assert_nonnull (matcher);
+
+  {
+    g_autofree gchar *str =
+        match_rules_with_matcher (matcher, "node.description", "foo");
+    g_assert_cmpstr (str, ==, "exact,regex,null");
+  }
+  {
+    g_autofree gchar *str =
+        match_rules_with_matcher (matcher, "node.name", "bluez_output.0");
+    g_assert_cmpstr (str, ==, "negated,negated-regex,null");
+  }
+  {
+    g_autofree gchar *str =
+        match_rules_with_matcher (matcher, "node.name", "other");
+    g_assert_cmpstr (str, ==, "negated,negated-regex,null,any-of");
+  }
+  {
+    g_autofree gchar *str =
+        match_rules_with_matcher (matcher, "node.nick", "nick");
+    g_assert_cmpstr (str, ==, "exact,regex,not-null,any-of");
+  }
+  {
+    g_autofree gchar *str =
+        match_rules_with_matcher (matcher, "node.nick", "null");
+    g_assert_cmpstr (str, ==, "exact,regex,not-null,null-string");
+  }
+
+  /* not an array */
+  {
+    g_autoptr (WpSpaJson) j = wp_spa_json_new_from_string ("{ a = b }");
+    g_autoptr (WpRulesMatcher) m = wp_rules_matcher_new (j);
+    g_autofree gchar *str = match_rules_with_matcher (m, "a", "b");
+    g_assert_cmpstr (str, ==, "");
+  }
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -342,6 +436,7 @@ main (gint argc, gchar *argv[])
   g_test_add_func ("/wp/json-utils/match_rules_update_props",
       test_match_rules_update_properties);
   g_test_add_func ("/wp/json-utils/match_rules", test_match_rules);
+  g_test_add_func ("/wp/json-utils/rules_matcher", test_rules_matcher);
 
   return g_test_run ();
 }
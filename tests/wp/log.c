@@ -0,0 +1,303 @@
+/* WirePlumber
+ *
+ * Copyright © 2024 Collabora Ltd.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "../common/test-log.h"
+#include <glib/gstdio.h>
+
+static gchar *trace_dir = NULL;
+static gchar *trace_file = NULL;
+
+static gchar *
+print_trace_file (void)
+{
+  g_autoptr (GError) error = NULL;
+  gchar *contents = NULL;
+  gsize size = 0;
+  FILE *stream = open_memstream (&contents, &size);
+
+  g_assert_nonnull (stream);
+  g_assert_true (wp_log_trace_file_print (trace_file, stream, &error));
+  g_assert_no_error (error);
+  fclose (stream);
+  return contents;
+}
+
+static void
+test_log_trace_file (void)
+{
+  g_autoptr (GObject) obj = g_object_new (G_TYPE_OBJECT, NULL);
+  g_autofree gchar *long_str = g_strnfill (300, 'x');
+  g_autofree gchar *object_msg = NULL;
+  gchar *contents;
+
+  wp_trace ("ints %d %u %" G_GINT64_FORMAT " %" G_GSIZE_FORMAT " %x %c",
+      -5, 7u, (gint64) -1234567890123, (gsize) 42, 255, 'z');
+  wp_trace ("strings '%s' '%.3s' '%-6s|'", "hello", "abcdef", "ab");
+  wp_trace ("floats %.2f %g, widths %*d|%-*d|, percent 100%%",
+      3.14159, 0.5, 5, 42, 4, 7);
+  wp_trace_object (obj, "object %p", obj);
+  wp_trace ("long %s end %d", long_str, 1);
+  wp_debug ("not a trace message");
+
+  contents = print_trace_file ();
+
+  g_assert_nonnull (strstr (contents, "ints -5 7 -1234567890123 42 ff z\n"));
+  g_assert_nonnull (strstr (contents, "strings 'hello' 'abc' 'ab    |'\n"));
+  g_assert_nonnull (strstr (contents,
+          "floats 3.14 0.5, widths    42|7   |, percent 100%\n"));
+
+  object_msg = g_strdup_printf ("<GObject:%p> object %p\n", obj, obj);
+  g_assert_nonnull (strstr (contents, object_msg));
+
+  /* the string does not fit in the record */
+  g_assert_nonnull (strstr (contents, "long %s end %d [...]\n"));
+
+  g_assert_null (strstr (contents, "not a trace message"));
+  free (contents);
+}
+
+static void
+test_log_trace_file_pod (void)
+{
+  g_autoptr (WpSpaPod) pod = wp_spa_pod_new_int (5);
+  gchar *contents;
+
+  wp_trace_boxed (WP_TYPE_SPA_POD, pod, "pod message");
+
+  /* the pod is dumped by the text output instead */
+  contents = print_trace_file ();
+  g_assert_null (strstr (contents, "pod message"));
+  free (contents);
+}
+
+static void
+test_log_trace_file_locked (void)
+{
+  gchar *contents;
+
+  if (g_test_subprocess ()) {
+    wp_trace ("trace from another process");
+    return;
+  }
+
+  wp_trace ("trace before another process");
+
+  /* this process holds the file, so the subprocess must neither clear it
+     nor write to it */
+  g_test_trap_subprocess (NULL, 0, 0);
+  g_test_trap_assert_passed ();
+  g_test_trap_assert_stderr ("*trace from another process*");
+
+  contents = print_trace_file ();
+  g_assert_nonnull (strstr (contents, "trace before another process\n"));
+  g_assert_null (strstr (contents, "trace from another process"));
+  free (contents);
+}
+
+static void
+test_log_trace_file_invalid (void)
+{
+  g_autoptr (GError) error = NULL;
+  g_autofree gchar *path = g_build_filename (trace_dir, "invalid", NULL);
+  FILE *stream = fopen ("/dev/null", "w");
+
+  g_assert_true (g_file_set_contents (path, "not a trace file", -1, NULL));
+  g_assert_false (wp_log_trace_file_print (path, stream, &error));
+  g_assert_error (error, WP_DOMAIN_LIBRARY, WP_LIBRARY_ERROR_INVALID_ARGUMENT);
+  fclose (stream);
+  g_unlink (path);
+}
+
+/* runs the current test in a subprocess that logs asynchronously; the
+   subprocess inherits the environment */
+static void
+trap_async_subprocess (void)
+{
+  g_setenv ("WIREPLUMBER_LOG_ASYNC", "1", TRUE);
+  g_unsetenv ("WIREPLUMBER_TRACE_FILE");
+  g_test_trap_subprocess (NULL, 0, 0);
+  g_unsetenv ("WIREPLUMBER_LOG_ASYNC");
+  g_setenv ("WIREPLUMBER_TRACE_FILE", trace_file, TRUE);
+}
+
+#define N_ORDERED 500 /* fewer than the slots of the queue */
+#define N_FLOOD 200000 /* many more than the queue can hold */
+#define N_BEFORE_FATAL 100
+
+static void
+test_log_async_order (void)
+{
+  const gchar *out;
+  const gchar *pos;
+
+  if (g_test_subprocess ()) {
+    for (guint i = 0; i < N_ORDERED; i++)
+      wp_notice ("ordered %u", i);
+    return;
+  }
+
+  trap_async_subprocess ();
+  g_test_trap_assert_passed ();
+
+  /* all the messages are written at exit, in the order they were logged */
+  out = g_test_trap_get_stderr ();
+  pos = out;
+  for (guint i = 0; i < N_ORDERED; i++) {
+    g_autofree gchar *line = g_strdup_printf ("ordered %u\n", i);
+    pos = strstr (pos, line);
+    g_assert_nonnull (pos);
+  }
+  g_assert_null (strstr (out, "messages were dropped"));
+}
+
+static void
+test_log_async_dropped (void)
+{
+  g_auto (GStrv) lines = NULL;
+  guint written = 0, dropped = 0;
+
+  if (g_test_subprocess ()) {
+    for (guint i = 0; i < N_FLOOD; i++)
+      wp_notice ("flood %u", i);
+    return;
+  }
+
+  trap_async_subprocess ();
+  g_test_trap_assert_passed ();
+
+  /* every message is either written or counted in a warning */
+  lines = g_strsplit (g_test_trap_get_stderr (), "\n", -1);
+  for (guint i = 0; lines[i]; i++) {
+    const gchar *msg;
+    guint n;
+
+    if (strstr (lines[i], "flood "))
+      written++;
+    else if ((msg = strstr (lines[i], " messages were dropped"))) {
+      while (msg > lines[i] && g_ascii_isdigit (msg[-1]))
+        msg--;
+      g_assert_cmpint (sscanf (msg, "%u ", &n), ==, 1);
+      dropped += n;
+    }
+  }
+
+  g_assert_cmpuint (dropped, >, 0);
+  g_assert_cmpuint (written + dropped, ==, N_FLOOD);
+}
+
+static void
+test_log_async_fatal (void)
+{
+  const gchar *out;
+  const gchar *pos;
+
+  if (g_test_subprocess ()) {
+    for (guint i = 0; i < N_BEFORE_FATAL; i++)
+      wp_notice ("queued %u", i);
+    g_error ("fatal after queued messages");
+    return;
+  }
+
+  trap_async_subprocess ();
+  g_test_trap_assert_failed ();
+
+  /* the queue is written out before the fatal message */
+  out = g_test_trap_get_stderr ();
+  pos = out;
+  for (guint i = 0; i < N_BEFORE_FATAL; i++) {
+    g_autofree gchar *line = g_strdup_printf ("queued %u\n", i);
+    pos = strstr (pos, line);
+    g_assert_nonnull (pos);
+  }
+  g_assert_nonnull (strstr (pos, "fatal after queued messages"));
+}
+
+static void
+return_if_null (gpointer p)
+{
+  g_return_if_fail (p != NULL);
+}
+
+static void
+test_log_async_fatal_critical (void)
+{
+  const gchar *out;
+  const gchar *pos;
+
+  if (g_test_subprocess ()) {
+    /* criticals are fatal in tests, like with G_DEBUG=fatal-criticals */
+    for (guint i = 0; i < N_BEFORE_FATAL; i++)
+      wp_notice ("queued %u", i);
+    return_if_null (NULL);
+    return;
+  }
+
+  trap_async_subprocess ();
+  g_test_trap_assert_failed ();
+
+  out = g_test_trap_get_stderr ();
+  pos = out;
+  for (guint i = 0; i < N_BEFORE_FATAL; i++) {
+    g_autofree gchar *line = g_strdup_printf ("queued %u\n", i);
+    pos = strstr (pos, line);
+    g_assert_nonnull (pos);
+  }
+  g_assert_nonnull (strstr (pos, "p != NULL"));
+}
+
+static void
+test_log_async_exit (void)
+{
+  if (g_test_subprocess ()) {
+    wp_notice ("before exit");
+    exit (0);
+  }
+
+  trap_async_subprocess ();
+  g_test_trap_assert_passed ();
+  g_test_trap_assert_stderr ("*before exit*");
+}
+
+gint
+main (gint argc, gchar *argv[])
+{
+  gint ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  g_setenv ("WIREPLUMBER_DEBUG", "2,tests:T", TRUE);
+
+  /* subprocesses get the environment from the test that runs them */
+  if (!g_test_subprocess ()) {
+    trace_dir = g_dir_make_tmp ("wp-test-log-XXXXXX", NULL);
+    g_assert_nonnull (trace_dir);
+    trace_file = g_build_filename (trace_dir, "trace", NULL);
+    g_setenv ("WIREPLUMBER_TRACE_FILE", trace_file, TRUE);
+  }
+  wp_init (WP_INIT_ALL);
+
+  g_test_add_func ("/wp/log/trace-file", test_log_trace_file);
+  g_test_add_func ("/wp/log/trace-file-pod", test_log_trace_file_pod);
+  g_test_add_func ("/wp/log/trace-file-locked", test_log_trace_file_locked);
+  g_test_add_func ("/wp/log/trace-file-invalid", test_log_trace_file_invalid);
+  g_test_add_func ("/wp/log/async-order", test_log_async_order);
+  g_test_add_func ("/wp/log/async-dropped", test_log_async_dropped);
+  g_test_add_func ("/wp/log/async-fatal", test_log_async_fatal);
+  g_test_add_func ("/wp/log/async-fatal-critical",
+      test_log_async_fatal_critical);
+  g_test_add_func ("/wp/log/async-exit", test_log_async_exit);
+
+  ret = g_test_run ();
+
+  if (trace_dir) {
+    g_unlink (trace_file);
+    g_free (trace_file);
+    g_rmdir (trace_dir);
+    g_free (trace_dir);
+  }
+  return ret;
+}
@@ -546,6 +546,159 @@ test_metadata_basic (TestFixture *fixture, gconstpointer data)
   g_assert_null (fixture->proxy_metadata);
 }
 
+static guint
+count_items (WpMetadata *metadata, guint32 subject)
+{
+  g_autoptr (WpIterator) it = wp_metadata_new_iterator (metadata, subject);
+  g_auto (GValue) val = G_VALUE_INIT;
+  guint n = 0;
+
+  for (; wp_iterator_next (it, &val); g_value_unset (&val))
+    n++;
+  return n;
+}
+
+static void
+test_metadata_store (TestFixture *fixture, gconstpointer data)
+{
+  g_autoptr (WpImplMetadata) m = wp_impl_metadata_new (fixture->base.core);
+  WpMetadata *metadata = WP_METADATA (m);
+  const gchar *expected[][2] = {
+    { "1", "a" }, { "2", "a" }, { "1", "b" }, { "3", "a" }, { "1", "c" },
+  };
+
+  wp_metadata_set (metadata, 1, "a", NULL, "1a");
+  wp_metadata_set (metadata, 2, "a", NULL, "2a");
+  wp_metadata_set (metadata, 1, "b", NULL, "1b");
+  wp_metadata_set (metadata, 3, "a", NULL, "3a");
+  wp_metadata_set (metadata, 1, "c", NULL, "1c");
+  /* updating a value keeps its position */
+  wp_metadata_set (metadata, 2, "a", "Spa:Int", "5");
+
+  /* iteration follows insertion order, globally and per subject */
+  {
+    g_autoptr (WpIterator) it = wp_metadata_new_iterator (metadata, PW_ID_ANY);
+    g_auto (GValue) val = G_VALUE_INIT;
+    guint i = 0;
+
+    for (; wp_iterator_next (it, &val); g_value_unset (&val), i++) {
+      WpMetadataItem *mi = g_value_get_boxed (&val);
+      g_autofree gchar *subject = g_strdup_printf ("%u",
+          wp_metadata_item_get_subject (mi));
+      g_assert_cmpuint (i, <, G_N_ELEMENTS (expected));
+      g_assert_cmpstr (subject, ==, expected[i][0]);
+      g_assert_cmpstr (wp_metadata_item_get_key (mi), ==, expected[i][1]);
+    }
+    g_assert_cmpuint (i, ==, G_N_ELEMENTS (expected));
+  }
+  {
+    g_autoptr (WpIterator) it = wp_metadata_new_iterator (metadata, 1);
+    g_auto (GValue) val = G_VALUE_INIT;
+    const gchar *keys[] = { "a", "b", "c" };
+    guint i = 0;
+
+    for (; wp_iterator_next (it, &val); g_value_unset (&val), i++) {
+      WpMetadataItem *mi = g_value_get_boxed (&val);
+      g_assert_cmpuint (wp_metadata_item_get_subject (mi), ==, 1);
+      g_assert_cmpstr (wp_metadata_item_get_key (mi), ==, keys[i]);
+    }
+    g_assert_cmpuint (i, ==, 3);
+  }
+
+  {
+    const gchar *type = NULL;
+    g_assert_cmpstr (wp_metadata_find (metadata, 2, "a", &type), ==, "5");
+    g_assert_cmpstr (type, ==, "Spa:Int");
+    g_assert_cmpstr (wp_metadata_find (metadata, 1, "b", NULL), ==, "1b");
+    g_assert_null (wp_metadata_find (metadata, 2, "b", NULL));
+    g_assert_null (wp_metadata_find (metadata, 4, "a", NULL));
+  }
+
+  /* removing items while iterating skips them */
+  {
+    g_autoptr (WpIterator) it = wp_metadata_new_iterator (metadata, PW_ID_ANY);
+    g_auto (GValue) val = G_VALUE_INIT;
+    guint n = 0;
+
+    g_assert_true (wp_iterator_next (it, &val));
+    g_value_unset (&val);
+
+    wp_metadata_set (metadata, 1, NULL, NULL, NULL);
+    wp_metadata_set (metadata, 2, "a", NULL, NULL);
+    wp_metadata_set (metadata, 4, "a", NULL, "4a");
+
+    for (; wp_iterator_next (it, &val); g_value_unset (&val)) {
+      WpMetadataItem *mi = g_value_get_boxed (&val);
+      g_assert_cmpuint (wp_metadata_item_get_subject (mi), >=, 3);
+      n++;
+    }
+    g_assert_cmpuint (n, ==, 2);
+
+    g_assert_null (wp_metadata_find (metadata, 1, "a", NULL));
+    g_assert_cmpuint (count_items (metadata, 1), ==, 0);
+  }
+
+  g_assert_cmpuint (count_items (metadata, PW_ID_ANY), ==, 2);
+  g_assert_cmpuint (count_items (metadata, 2), ==, 0);
+  g_assert_cmpuint (count_items (metadata, 4), ==, 1);
+
+  /* re-adding a key of a removed subject */
+  wp_metadata_set (metadata, 1, "b", NULL, "1b");
+  g_assert_cmpstr (wp_metadata_find (metadata, 1, "b", NULL), ==, "1b");
+  g_assert_cmpuint (count_items (metadata, 1), ==, 1);
+
+  wp_metadata_clear (metadata);
+  g_assert_cmpuint (count_items (metadata, PW_ID_ANY), ==, 0);
+}
+
+#define N_PERF_SUBJECTS 10000
+
+static void
+test_metadata_perf (TestFixture *fixture, gconstpointer data)
+{
+  g_autoptr (WpImplMetadata) m = NULL;
+  WpMetadata *metadata;
+  gdouble set_time, find_time, clear_time;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("benchmark; run with -m perf");
+    return;
+  }
+
+  m = wp_impl_metadata_new (fixture->base.core);
+  metadata = WP_METADATA (m);
+
+  /* keys similar to those of the "default" and "filters" metadata */
+  g_test_timer_start ();
+  for (guint i = 0; i < N_PERF_SUBJECTS; i++) {
+    wp_metadata_set (metadata, i, "target.object", NULL, "123");
+    wp_metadata_set (metadata, i, "filter.smart", NULL, "true");
+    wp_metadata_set (metadata, i, "filter.smart.name", NULL, "eq");
+  }
+  set_time = g_test_timer_elapsed ();
+
+  g_test_timer_start ();
+  for (guint i = 0; i < N_PERF_SUBJECTS; i++) {
+    g_assert_nonnull (wp_metadata_find (metadata, i, "filter.smart.name", NULL));
+    g_assert_null (wp_metadata_find (metadata, i, "filter.smart.target", NULL));
+  }
+  find_time = g_test_timer_elapsed ();
+
+  g_test_timer_start ();
+  for (guint i = 0; i < N_PERF_SUBJECTS; i++)
+    wp_metadata_set (metadata, i, NULL, NULL, NULL);
+  clear_time = g_test_timer_elapsed ();
+
+  g_assert_cmpuint (count_items (metadata, PW_ID_ANY), ==, 0);
+
+  g_test_message ("%u subjects: set %.3f ms, find %.3f ms, clear %.3f ms",
+      N_PERF_SUBJECTS, set_time * 1000.0, find_time * 1000.0,
+      clear_time * 1000.0);
+  g_test_minimized_result (find_time,
+      "%u subjects: %u lookups in %.3f ms", N_PERF_SUBJECTS,
+      N_PERF_SUBJECTS * 2, find_time * 1000.0);
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -554,6 +707,10 @@ main (gint argc, gchar *argv[])
 
   g_test_add ("/wp/metadata/basic", TestFixture, NULL,
       test_metadata_setup, test_metadata_basic, test_metadata_teardown);
+  g_test_add ("/wp/metadata/store", TestFixture, NULL,
+      test_metadata_setup, test_metadata_store, test_metadata_teardown);
+  g_test_add ("/wp/metadata/perf", TestFixture, NULL,
+      test_metadata_setup, test_metadata_perf, test_metadata_teardown);
 
   return g_test_run ();
 }
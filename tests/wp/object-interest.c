@@ -700,6 +700,41 @@ test_object_interest_constraint_matches (TestFixture * f, gconstpointer data)
   TEST_EXPECT_NO_MATCH (i);
 }
 
+static void
+test_object_interest_revalidate (TestFixture * f, gconstpointer data)
+{
+  g_autoptr (WpObjectInterest) i = NULL;
+  g_autoptr (GError) error = NULL;
+
+  i = wp_object_interest_new (TEST_TYPE_A,
+      WP_CONSTRAINT_TYPE_G_PROPERTY, "test-string", "#s", "to*",
+      WP_CONSTRAINT_TYPE_G_PROPERTY, "test-int", "c(iii)", -10, -20, -30,
+      WP_CONSTRAINT_TYPE_G_PROPERTY, "test-uint", "~(uu)", 40, 60,
+      NULL);
+  g_assert_true (wp_object_interest_validate (i, &error));
+  g_assert_no_error (error);
+
+  /* the compiled constraints are reused on every match */
+  for (gint n = 0; n < 3; n++)
+    g_assert_true (wp_object_interest_matches (i, f->object));
+
+  /* adding a constraint recompiles all of them on the next match */
+  wp_object_interest_add_constraint (i, WP_CONSTRAINT_TYPE_G_PROPERTY,
+      "test-string", WP_CONSTRAINT_VERB_IN_LIST,
+      g_variant_new ("(ss)", "egg", "bacon"));
+  g_assert_false (wp_object_interest_matches (i, f->object));
+
+  g_clear_pointer (&i, wp_object_interest_unref);
+
+  i = wp_object_interest_new (TEST_TYPE_A,
+      WP_CONSTRAINT_TYPE_G_PROPERTY, "test-string", "c(ss)", "egg", "toast",
+      NULL);
+  g_assert_true (wp_object_interest_matches (i, f->object));
+  wp_object_interest_add_constraint (i, WP_CONSTRAINT_TYPE_G_PROPERTY,
+      "test-string", WP_CONSTRAINT_VERB_MATCHES, g_variant_new_string ("t*"));
+  g_assert_true (wp_object_interest_matches (i, f->object));
+}
+
 static void
 test_object_interest_constraint_present_absent (TestFixture * f,
     gconstpointer data)
@@ -913,6 +948,11 @@ main (int argc, char *argv[])
       test_object_interest_constraint_matches,
       test_object_interest_teardown);
 
+  g_test_add ("/wp/object-interest/revalidate",
+      TestFixture, NULL,
+      test_object_interest_setup,
+      test_object_interest_revalidate,
+      test_object_interest_teardown);
   g_test_add ("/wp/object-interest/present-absent",
       TestFixture, NULL,
       test_object_interest_setup,
@@ -162,6 +162,215 @@ test_om_iterate_remove (TestFixture *f, gconstpointer user_data)
       WP_CONSTRAINT_TYPE_PW_PROPERTY, "property1", "=s", "1234", NULL));
 }
 
+static guint
+count_iterator (WpIterator *it)
+{
+  g_auto (GValue) value = G_VALUE_INIT;
+  guint n = 0;
+
+  for (; wp_iterator_next (it, &value); g_value_unset (&value))
+    n++;
+  return n;
+}
+
+static void
+test_om_iterate_snapshot (TestFixture *f, gconstpointer user_data)
+{
+  g_autoptr (WpObjectManager) om = NULL;
+  g_autoptr (WpIterator) it1 = NULL;
+  g_autoptr (WpIterator) it2 = NULL;
+  g_autoptr (WpIterator) it3 = NULL;
+  WpSessionItem *si = NULL;
+
+  for (gint i = 0; i < 3; i++) {
+    si = g_object_new (si_dummy_get_type (), "core", f->base.core, NULL);
+    g_assert_true (wp_session_item_configure (si, wp_properties_new (NULL)));
+    wp_session_item_register (si);
+  }
+
+  om = wp_object_manager_new ();
+  wp_object_manager_add_interest (om, si_dummy_get_type (), NULL);
+  test_ensure_object_manager_is_installed (om, f->base.core, f->base.loop);
+
+  /* both iterators share the same snapshot */
+  it1 = wp_object_manager_new_iterator (om);
+  it2 = wp_object_manager_new_iterator (om);
+
+  /* mutating the manager does not affect existing snapshots */
+  si = g_object_new (si_dummy_get_type (), "core", f->base.core, NULL);
+  g_assert_true (wp_session_item_configure (si, wp_properties_new (NULL)));
+  wp_session_item_register (si);
+  g_assert_cmpint (wp_object_manager_get_n_objects (om), ==, 4);
+
+  it3 = wp_object_manager_new_iterator (om);
+  wp_session_item_remove (si);
+  g_assert_cmpint (wp_object_manager_get_n_objects (om), ==, 3);
+
+  g_assert_cmpuint (count_iterator (it1), ==, 3);
+  g_assert_cmpuint (count_iterator (it2), ==, 3);
+
+  /* it3 still holds the generation with 4 items, but the removed item has
+     been destroyed, so do not iterate over it; new iterators see 3 items */
+  g_clear_pointer (&it3, wp_iterator_unref);
+  it3 = wp_object_manager_new_iterator (om);
+  g_assert_cmpuint (count_iterator (it3), ==, 3);
+}
+
+static guint
+count_matching (WpObjectManager *om, WpObjectInterest *interest)
+{
+  g_autoptr (WpIterator) it =
+      wp_object_manager_new_filtered_iterator_full (om, interest);
+  return count_iterator (it);
+}
+
+static WpSessionItem *
+register_si_dummy (TestFixture *f, const gchar *test_id)
+{
+  WpSessionItem *si = g_object_new (si_dummy_get_type (),
+      "core", f->base.core, NULL);
+  g_assert_true (wp_session_item_configure (si,
+      wp_properties_new ("test.id", test_id, NULL)));
+  wp_session_item_register (si);
+  return si;
+}
+
+static void
+test_om_index (TestFixture *f, gconstpointer user_data)
+{
+  g_autoptr (WpObjectManager) om = NULL;
+  WpSessionItem *si = NULL;
+  WpSessionItem *si_two = NULL;
+
+  register_si_dummy (f, "1");
+  si_two = register_si_dummy (f, "2");
+  register_si_dummy (f, "2");
+
+  om = wp_object_manager_new ();
+  wp_object_manager_add_interest (om, si_dummy_get_type (), NULL);
+  wp_object_manager_add_index (om,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "test.id");
+  test_ensure_object_manager_is_installed (om, f->base.core, f->base.loop);
+  g_assert_cmpint (wp_object_manager_get_n_objects (om), ==, 3);
+
+  /* string and integer lookups on the indexed property */
+  g_assert_cmpuint (count_matching (om, wp_object_interest_new (
+      si_dummy_get_type (), WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY,
+      "test.id", "=s", "2", NULL)), ==, 2);
+  g_assert_cmpuint (count_matching (om, wp_object_interest_new (
+      si_dummy_get_type (), WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY,
+      "test.id", "=x", G_GINT64_CONSTANT (1), NULL)), ==, 1);
+  g_assert_cmpuint (count_matching (om, wp_object_interest_new (
+      si_dummy_get_type (), WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY,
+      "test.id", "=s", "3", NULL)), ==, 0);
+
+  /* the other constraints are still checked */
+  g_assert_cmpuint (count_matching (om, wp_object_interest_new (
+      si_dummy_get_type (), WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY,
+      "test.id", "=i", 2,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "test.other", "+", NULL)), ==, 0);
+
+  /* "02" is not indexed in a form that integer lookups can use, but it
+     still matches the integer 2 */
+  si = register_si_dummy (f, "02");
+  g_assert_cmpint (wp_object_manager_get_n_objects (om), ==, 4);
+  g_assert_cmpuint (count_matching (om, wp_object_interest_new (
+      si_dummy_get_type (), WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY,
+      "test.id", "=u", 2, NULL)), ==, 3);
+  g_assert_cmpuint (count_matching (om, wp_object_interest_new (
+      si_dummy_get_type (), WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY,
+      "test.id", "=s", "2", NULL)), ==, 2);
+
+  /* removed objects are dropped from the index */
+  wp_session_item_remove (si);
+  wp_session_item_remove (si_two);
+  g_assert_cmpint (wp_object_manager_get_n_objects (om), ==, 2);
+  g_assert_cmpuint (count_matching (om, wp_object_interest_new (
+      si_dummy_get_type (), WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY,
+      "test.id", "=x", G_GINT64_CONSTANT (2), NULL)), ==, 1);
+}
+
+static WpImplMetadata *
+export_metadata (TestFixture *f, const gchar *name)
+{
+  WpImplMetadata *m = wp_impl_metadata_new_full (f->base.client_core, name,
+      NULL);
+
+  wp_object_activate (WP_OBJECT (m), WP_OBJECT_FEATURES_ALL,
+      NULL, (GAsyncReadyCallback) test_object_activate_finish_cb, f);
+  g_main_loop_run (f->base.loop);
+  return m;
+}
+
+static void
+test_om_registry_index_interest_change (TestFixture *f,
+    gconstpointer user_data)
+{
+  g_autoptr (WpObjectManager) om = NULL;
+  g_autoptr (WpImplMetadata) m1 = NULL;
+  g_autoptr (WpImplMetadata) m2 = NULL;
+  g_autoptr (WpMetadata) m = NULL;
+
+  om = wp_object_manager_new ();
+  wp_object_manager_add_interest (om, WP_TYPE_NODE, NULL);
+  test_ensure_object_manager_is_installed (om, f->base.core, f->base.loop);
+
+  /* the registry caches that no object manager wants metadata */
+  m1 = export_metadata (f, "test-1");
+  wp_core_sync (f->base.core, NULL, (GAsyncReadyCallback) test_core_done_cb, f);
+  g_main_loop_run (f->base.loop);
+  g_assert_cmpuint (wp_object_manager_get_n_objects (om), ==, 0);
+
+  /* a new interest on an installed manager invalidates that */
+  wp_object_manager_add_interest (om, WP_TYPE_METADATA, NULL);
+  g_signal_connect_swapped (om, "object-added",
+      G_CALLBACK (g_main_loop_quit), f->base.loop);
+  m2 = export_metadata (f, "test-2");
+  g_main_loop_run (f->base.loop);
+
+  m = wp_object_manager_lookup (om, WP_TYPE_METADATA,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "metadata.name", "=s", "test-2",
+      NULL);
+  g_assert_nonnull (m);
+}
+
+static void
+test_om_registry_index_destroy (TestFixture *f, gconstpointer user_data)
+{
+  g_autoptr (WpObjectManager) om = NULL;
+  g_autoptr (WpObjectManager) om_other = NULL;
+  g_autoptr (WpImplMetadata) m1 = NULL;
+  g_autoptr (WpImplMetadata) m2 = NULL;
+  g_autoptr (WpMetadata) m = NULL;
+
+  om = wp_object_manager_new ();
+  wp_object_manager_add_interest (om, WP_TYPE_METADATA, NULL);
+  g_signal_connect_swapped (om, "object-added",
+      G_CALLBACK (g_main_loop_quit), f->base.loop);
+  test_ensure_object_manager_is_installed (om, f->base.core, f->base.loop);
+
+  om_other = wp_object_manager_new ();
+  wp_object_manager_add_interest (om_other, WP_TYPE_METADATA, NULL);
+  test_ensure_object_manager_is_installed (om_other, f->base.core,
+      f->base.loop);
+
+  /* both managers are cached as interested in metadata */
+  m1 = export_metadata (f, "test-1");
+  g_main_loop_run (f->base.loop);
+  g_assert_cmpuint (wp_object_manager_get_n_objects (om), ==, 1);
+
+  /* a destroyed manager must be dropped from the cache */
+  g_clear_object (&om_other);
+  m2 = export_metadata (f, "test-2");
+  g_main_loop_run (f->base.loop);
+
+  g_assert_cmpuint (wp_object_manager_get_n_objects (om), ==, 2);
+  m = wp_object_manager_lookup (om, WP_TYPE_METADATA,
+      WP_CONSTRAINT_TYPE_PW_GLOBAL_PROPERTY, "metadata.name", "=s", "test-2",
+      NULL);
+  g_assert_nonnull (m);
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -172,6 +381,14 @@ main (gint argc, gchar *argv[])
       test_om_setup, test_om_interest_on_pw_props, test_om_teardown);
   g_test_add ("/wp/om/iterate_remove", TestFixture, NULL,
       test_om_setup, test_om_iterate_remove, test_om_teardown);
+  g_test_add ("/wp/om/iterate_snapshot", TestFixture, NULL,
+      test_om_setup, test_om_iterate_snapshot, test_om_teardown);
+  g_test_add ("/wp/om/index", TestFixture, NULL,
+      test_om_setup, test_om_index, test_om_teardown);
+  g_test_add ("/wp/om/registry_index_interest_change", TestFixture, NULL,
+      test_om_setup, test_om_registry_index_interest_change, test_om_teardown);
+  g_test_add ("/wp/om/registry_index_destroy", TestFixture, NULL,
+      test_om_setup, test_om_registry_index_destroy, test_om_teardown);
 
   return g_test_run ();
 }
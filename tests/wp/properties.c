@@ -8,6 +8,7 @@
 
 #include "../common/test-log.h"
 #include <pipewire/pipewire.h>
+#include <unistd.h>
 
 static void
 test_properties_basic (void)
@@ -167,6 +168,153 @@ test_properties_iterate (void)
   g_assert_cmpint (i, ==, 5);
 }
 
+static void
+test_properties_interned (void)
+{
+  g_autoptr (WpProperties) p = NULL;
+  g_autoptr (WpProperties) copy = NULL;
+  const struct spa_dict_item dict_items[] = {
+    { "node.name", "value1" },
+    { "test.interned.key2", "value2" },
+  };
+  const struct spa_dict dict = SPA_DICT_INIT_ARRAY(dict_items);
+  const struct spa_dict *d;
+
+  p = wp_properties_new_interned_dict (&dict);
+  g_assert_nonnull (p);
+  d = wp_properties_peek_dict (p);
+  g_assert_true (d != &dict);
+  g_assert_cmpint (wp_properties_get_count (p), ==,
+      SPA_N_ELEMENTS (dict_items));
+
+  /* well-known keys are shared, other keys are copied and not made atoms */
+  g_assert_true (d->items[0].key == g_intern_static_string ("node.name"));
+  g_assert_true (d->items[1].key != dict_items[1].key);
+  g_assert_cmpuint (g_quark_try_string ("test.interned.key2"), ==, 0);
+
+  g_assert_cmpstr (wp_properties_get (p, "node.name"), ==, "value1");
+  g_assert_cmpstr (wp_properties_get (p, "test.interned.key2"), ==, "value2");
+  g_assert_cmpstr (wp_properties_get (p, "key3"), ==, NULL);
+  g_assert_cmpstr (wp_properties_get_atom (p,
+          g_quark_from_static_string ("node.name")), ==, "value1");
+  /* keys that became atoms after the set was created are still found */
+  g_assert_cmpstr (wp_properties_get_atom (p,
+          g_quark_from_string ("test.interned.key2")), ==, "value2");
+  g_assert_cmpstr (wp_properties_get_atom (p, g_quark_from_string ("key3")),
+      ==, NULL);
+  g_assert_cmpstr (wp_properties_get_atom (p, 0), ==, NULL);
+
+  /* sets created later share the key that is now an atom */
+  copy = wp_properties_new_interned_dict (&dict);
+  g_assert_true (wp_properties_peek_dict (copy)->items[1].key ==
+      g_intern_string ("test.interned.key2"));
+  g_clear_pointer (&copy, wp_properties_unref);
+
+  /* atoms also work on sets that are not interned */
+  copy = wp_properties_copy (p);
+  g_assert_cmpstr (wp_properties_get_atom (copy,
+          g_quark_from_static_string ("node.name")), ==, "value1");
+
+  /* modifying converts the set to a normal one */
+  g_assert_cmpint (wp_properties_set (p, "node.name", "other"), ==, 1);
+  g_assert_cmpint (wp_properties_set (p, "key3", "value3"), ==, 1);
+  g_assert_cmpstr (wp_properties_get (p, "node.name"), ==, "other");
+  g_assert_cmpstr (wp_properties_get_atom (p,
+          g_quark_from_string ("test.interned.key2")), ==, "value2");
+  g_assert_cmpstr (wp_properties_get_atom (p, g_quark_from_string ("key3")),
+      ==, "value3");
+  g_assert_cmpint (wp_properties_get_count (p), ==, 3);
+}
+
+#define N_PERF_OBJECTS 10000
+#define N_PERF_KEYS 30
+#define N_PERF_LOOKUPS 20
+
+static glong
+get_rss_kb (void)
+{
+  g_autofree gchar *statm = NULL;
+  glong size = 0, resident = 0;
+
+  if (!g_file_get_contents ("/proc/self/statm", &statm, NULL, NULL) ||
+      sscanf (statm, "%ld %ld", &size, &resident) != 2)
+    return 0;
+  return resident * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+/* creates a set for each object of a synthetic graph, with keys that are
+   typical of PipeWire nodes, and looks up some of them in every set;
+   the sets are returned, so that measuring the next graph does not reuse
+   their memory */
+static GPtrArray *
+measure_graph (gboolean interned, gdouble *time, glong *rss)
+{
+  GPtrArray *objects =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) wp_properties_unref);
+  g_autoptr (GPtrArray) keys = g_ptr_array_new_with_free_func (g_free);
+  struct spa_dict_item items[N_PERF_KEYS];
+  gchar values[N_PERF_KEYS][16];
+  GQuark atoms[N_PERF_LOOKUPS];
+  glong rss_before;
+  guint found = 0;
+
+  for (guint i = 0; i < N_PERF_KEYS; i++)
+    g_ptr_array_add (keys, g_strdup_printf ("object.synthetic.key%u", i));
+  for (guint i = 0; i < N_PERF_LOOKUPS; i++)
+    atoms[i] = g_quark_from_string (keys->pdata[N_PERF_KEYS - 1 - i]);
+
+  rss_before = get_rss_kb ();
+  for (guint i = 0; i < N_PERF_OBJECTS; i++) {
+    for (guint j = 0; j < N_PERF_KEYS; j++) {
+      g_snprintf (values[j], sizeof (values[j]), "%u", i * N_PERF_KEYS + j);
+      items[j] = SPA_DICT_ITEM_INIT (keys->pdata[j], values[j]);
+    }
+    g_ptr_array_add (objects, interned ?
+        wp_properties_new_interned_dict (&SPA_DICT_INIT_ARRAY (items)) :
+        wp_properties_new_copy_dict (&SPA_DICT_INIT_ARRAY (items)));
+  }
+  *rss = get_rss_kb () - rss_before;
+
+  g_test_timer_start ();
+  for (guint i = 0; i < objects->len; i++) {
+    for (guint j = 0; j < N_PERF_LOOKUPS; j++) {
+      if (interned)
+        found += !!wp_properties_get_atom (objects->pdata[i], atoms[j]);
+      else
+        found += !!wp_properties_get (objects->pdata[i],
+            keys->pdata[N_PERF_KEYS - 1 - j]);
+    }
+  }
+  *time = g_test_timer_elapsed ();
+
+  g_assert_cmpuint (found, ==, N_PERF_OBJECTS * N_PERF_LOOKUPS);
+  return objects;
+}
+
+static void
+test_properties_interned_perf (void)
+{
+  g_autoptr (GPtrArray) copied = NULL;
+  g_autoptr (GPtrArray) interned = NULL;
+  gdouble copy_time, interned_time;
+  glong copy_rss, interned_rss;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("benchmark; run with -m perf");
+    return;
+  }
+
+  copied = measure_graph (FALSE, &copy_time, &copy_rss);
+  interned = measure_graph (TRUE, &interned_time, &interned_rss);
+
+  g_test_message ("%u objects, %u keys: copied %ld KB, %.3f ms; "
+      "interned %ld KB, %.3f ms", N_PERF_OBJECTS, N_PERF_KEYS,
+      copy_rss, copy_time * 1000.0, interned_rss, interned_time * 1000.0);
+  g_test_minimized_result (interned_time,
+      "%u lookups in %.3f ms", N_PERF_OBJECTS * N_PERF_LOOKUPS,
+      interned_time * 1000.0);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -180,6 +328,9 @@ main (int argc, char *argv[])
   g_test_add_func ("/wp/properties/take", test_properties_take);
   g_test_add_func ("/wp/properties/to_pw_props", test_properties_to_pw_props);
   g_test_add_func ("/wp/properties/iterate", test_properties_iterate);
+  g_test_add_func ("/wp/properties/interned", test_properties_interned);
+  g_test_add_func ("/wp/properties/interned-perf",
+      test_properties_interned_perf);
 
   return g_test_run ();
 }
@@ -289,6 +289,198 @@ test_enum_params_error (TestFixture *f, gconstpointer data)
   g_main_loop_run (f->base.loop);
 }
 
+static GPtrArray *
+collect_cached_params (WpPipewireObject * proxy, const gchar * id)
+{
+  GPtrArray *params =
+      g_ptr_array_new_with_free_func ((GDestroyNotify) wp_spa_pod_unref);
+  g_autoptr (WpIterator) it = wp_pipewire_object_enum_params_sync (proxy, id,
+      NULL);
+  g_auto (GValue) item = G_VALUE_INIT;
+
+  g_assert_nonnull (it);
+  for (; wp_iterator_next (it, &item); g_value_unset (&item))
+    g_ptr_array_add (params, g_value_dup_boxed (&item));
+  return params;
+}
+
+static void
+test_param_entries_changed_cb (WpPipewireObject * proxy, const gchar * id,
+    GVariant * indexes, TestFixture * f)
+{
+  GPtrArray *old_params = g_object_get_data (G_OBJECT (proxy), "old-params");
+  g_autoptr (GPtrArray) new_params = NULL;
+  g_autoptr (GArray) expected = g_array_new (FALSE, FALSE, sizeof (guint32));
+  const guint32 *changed;
+  gsize n_changed = 0;
+  guint *n_emissions = g_object_get_data (G_OBJECT (proxy), "n-emissions");
+
+  g_assert_cmpstr (id, ==, "Props");
+  (*n_emissions)++;
+
+  /* the indexes must be exactly those of the params that are different */
+  new_params = collect_cached_params (proxy, "Props");
+  for (guint32 i = 0; i < MAX (old_params->len, new_params->len); i++) {
+    if (i >= old_params->len || i >= new_params->len ||
+        !wp_spa_pod_equal (g_ptr_array_index (old_params, i),
+            g_ptr_array_index (new_params, i)))
+      g_array_append_val (expected, i);
+  }
+
+  g_assert_nonnull (indexes);
+  changed = g_variant_get_fixed_array (indexes, &n_changed, sizeof (guint32));
+  g_assert_cmpuint (expected->len, >, 0);
+  g_assert_cmpuint (n_changed, ==, expected->len);
+  for (guint i = 0; i < n_changed; i++)
+    g_assert_cmpuint (changed[i], ==, g_array_index (expected, guint32, i));
+
+  g_main_loop_quit (f->base.loop);
+}
+
+static void
+test_param_entries_changed_info_cb (WpPipewireObject * proxy,
+    GParamSpec * pspec, TestFixture * f)
+{
+  g_main_loop_quit (f->base.loop);
+}
+
+static void
+test_param_entries_changed (TestFixture *f, gconstpointer data)
+{
+  g_autoptr (WpPipewireObject) proxy = NULL;
+  g_autoptr (GPtrArray) reannounced = NULL;
+  GPtrArray *old_params;
+  guint n_emissions = 0;
+
+  /* load audiotestsrc on the server side */
+  {
+    g_autoptr (WpTestServerLocker) lock =
+        wp_test_server_locker_new (&f->base.server);
+
+    g_assert_cmpint (pw_context_add_spa_lib (f->base.server.context,
+            "audiotestsrc", "audiotestsrc/libspa-audiotestsrc"), ==, 0);
+    if (!test_is_spa_lib_installed (&f->base, "audiotestsrc")) {
+      g_test_skip ("The pipewire audiotestsrc factory was not found");
+      return;
+    }
+    g_assert_nonnull (pw_context_load_module (f->base.server.context,
+            "libpipewire-module-adapter", NULL, NULL));
+  }
+
+  proxy = WP_PIPEWIRE_OBJECT (wp_node_new_from_factory (f->base.core,
+      "adapter",
+      wp_properties_new (
+          "factory.name", "audiotestsrc",
+          "node.name", "audiotestsrc.adapter",
+          NULL)));
+  g_assert_nonnull (proxy);
+  wp_object_activate (WP_OBJECT (proxy),
+      WP_PIPEWIRE_OBJECT_FEATURES_MINIMAL |
+      WP_PIPEWIRE_OBJECT_FEATURE_PARAM_PROPS,
+      NULL, (GAsyncReadyCallback) test_object_activate_finish_cb, f);
+  g_main_loop_run (f->base.loop);
+
+  old_params = collect_cached_params (proxy, "Props");
+  g_assert_cmpuint (old_params->len, >, 0);
+  g_object_set_data_full (G_OBJECT (proxy), "old-params", old_params,
+      (GDestroyNotify) g_ptr_array_unref);
+  g_object_set_data (G_OBJECT (proxy), "n-emissions", &n_emissions);
+  g_signal_connect (proxy, "param-entries-changed",
+      G_CALLBACK (test_param_entries_changed_cb), f);
+
+  /* setting the value that is already set makes the node re-announce its
+     Props; wait for the announcement and for the enumeration that follows */
+  g_signal_connect (proxy, "notify::param-info",
+      G_CALLBACK (test_param_entries_changed_info_cb), f);
+  wp_pipewire_object_set_param (proxy, "Props", 0, wp_spa_pod_new_object (
+      "Spa:Pod:Object:Param:Props", "Props",
+      "mute", "b", FALSE,
+      NULL));
+  g_main_loop_run (f->base.loop);
+  g_signal_handlers_disconnect_by_func (proxy,
+      G_CALLBACK (test_param_entries_changed_info_cb), f);
+  wp_core_sync (f->base.core, NULL,
+      (GAsyncReadyCallback) test_core_done_cb, f);
+  g_main_loop_run (f->base.loop);
+
+  /* the params were enumerated again, so the cache holds new copies; they
+     are the same as before, so nothing must have been emitted */
+  reannounced = collect_cached_params (proxy, "Props");
+  g_assert_cmpuint (reannounced->len, ==, old_params->len);
+  g_assert_true (g_ptr_array_index (reannounced, 0) !=
+      g_ptr_array_index (old_params, 0));
+  g_assert_cmpuint (n_emissions, ==, 0);
+
+  /* an actual change is emitted */
+  wp_pipewire_object_set_param (proxy, "Props", 0, wp_spa_pod_new_object (
+      "Spa:Pod:Object:Param:Props", "Props",
+      "mute", "b", TRUE,
+      NULL));
+  g_main_loop_run (f->base.loop);
+
+  g_assert_cmpuint (n_emissions, ==, 1);
+  g_signal_handlers_disconnect_by_data (proxy, f);
+}
+
+#define N_STARTUP_GLOBALS 1000
+#define N_STARTUP_ROUNDS 10
+
+static guint n_pending_exports = 0;
+
+static void
+test_registry_startup_exported (WpObject *object, GAsyncResult *res,
+    TestFixture *f)
+{
+  g_autoptr (GError) error = NULL;
+  g_assert_true (wp_object_activate_finish (object, res, &error));
+  g_assert_no_error (error);
+
+  if (--n_pending_exports == 0)
+    g_main_loop_quit (f->base.loop);
+}
+
+static void
+test_registry_startup (TestFixture *f, gconstpointer data)
+{
+  g_autoptr (GPtrArray) exported = g_ptr_array_new_with_free_func (g_object_unref);
+  gdouble best = G_MAXDOUBLE;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("benchmark; run with -m perf");
+    return;
+  }
+
+  /* populate the registry with many globals */
+  n_pending_exports = N_STARTUP_GLOBALS;
+  for (guint i = 0; i < N_STARTUP_GLOBALS; i++) {
+    WpImplMetadata *m = wp_impl_metadata_new (f->base.core);
+    g_ptr_array_add (exported, m);
+    wp_object_activate (WP_OBJECT (m), WP_OBJECT_FEATURES_ALL, NULL,
+        (GAsyncReadyCallback) test_registry_startup_exported, f);
+  }
+  g_main_loop_run (f->base.loop);
+
+  /* measure how long a new connection takes to process the registry;
+     every global goes through the proxy type lookup */
+  for (guint round = 0; round < N_STARTUP_ROUNDS; round++) {
+    g_autoptr (WpCore) core = wp_core_clone (f->base.core);
+    gdouble elapsed;
+
+    g_test_timer_start ();
+    g_assert_true (wp_core_connect (core));
+    wp_core_sync (core, NULL, (GAsyncReadyCallback) test_core_done_cb, f);
+    g_main_loop_run (f->base.loop);
+    elapsed = g_test_timer_elapsed ();
+
+    best = MIN (best, elapsed);
+    wp_core_disconnect (core);
+  }
+
+  g_test_minimized_result (best,
+      "registry startup with %u globals: %.3f ms", N_STARTUP_GLOBALS,
+      best * 1000.0);
+}
+
 gint
 main (gint argc, gchar *argv[])
 {
@@ -303,6 +495,10 @@ main (gint argc, gchar *argv[])
       test_proxy_setup, test_link_error, test_proxy_teardown);
   g_test_add ("/wp/proxy/enum_params_error", TestFixture, NULL,
       test_proxy_setup, test_enum_params_error, test_proxy_teardown);
+  g_test_add ("/wp/proxy/param_entries_changed", TestFixture, NULL,
+      test_proxy_setup, test_param_entries_changed, test_proxy_teardown);
+  g_test_add ("/wp/proxy/registry_startup", TestFixture, NULL,
+      test_proxy_setup, test_registry_startup, test_proxy_teardown);
 
   return g_test_run ();
 }
@@ -1306,6 +1306,199 @@ test_spa_json_undefined_parser (void)
   }
 }
 
+static void
+test_spa_json_cursor (void)
+{
+  g_autoptr (WpSpaJson) json = wp_spa_json_new_wrap_string (
+      "{ key-int = 8, key-array = [ 2, 4 ], "
+      "key-object = { a = true, b = null }, \"key string\" = \"a \\\"b\\\"\" }");
+  WpSpaJsonCursor cursor, child, saved;
+  gchar buf[8];
+  gsize size;
+  gint i = 0;
+  gboolean b = FALSE;
+
+  g_assert_true (wp_spa_json_cursor_init (&cursor, json));
+
+  /* int */
+  g_assert_true (wp_spa_json_cursor_next (&cursor));
+  g_assert_true (wp_spa_json_cursor_get_string (&cursor, buf, sizeof (buf)));
+  g_assert_cmpstr (buf, ==, "key-int");
+  g_assert_true (wp_spa_json_cursor_next (&cursor));
+  g_assert_true (wp_spa_json_cursor_is_int (&cursor));
+  g_assert_true (wp_spa_json_cursor_get_int (&cursor, &i));
+  g_assert_cmpint (i, ==, 8);
+  g_assert_false (wp_spa_json_cursor_enter (&cursor, &child));
+
+  /* array */
+  g_assert_true (wp_spa_json_cursor_next (&cursor));
+  g_assert_false (wp_spa_json_cursor_get_string (&cursor, buf, sizeof (buf)));
+  {
+    g_autofree gchar *key = wp_spa_json_cursor_dup_string (&cursor);
+    g_assert_cmpstr (key, ==, "key-array");
+  }
+  g_assert_true (wp_spa_json_cursor_next (&cursor));
+  g_assert_true (wp_spa_json_cursor_is_array (&cursor));
+  g_assert_cmpmem (wp_spa_json_cursor_get_data (&cursor, &size), size,
+      "[ 2, 4 ]", 8);
+  g_assert_true (wp_spa_json_cursor_enter (&cursor, &child));
+  g_assert_true (wp_spa_json_cursor_next (&child));
+  g_assert_true (wp_spa_json_cursor_get_int (&child, &i));
+  g_assert_cmpint (i, ==, 2);
+  g_assert_true (wp_spa_json_cursor_next (&child));
+  g_assert_true (wp_spa_json_cursor_get_int (&child, &i));
+  g_assert_cmpint (i, ==, 4);
+  g_assert_false (wp_spa_json_cursor_next (&child));
+
+  /* object; remember the position to come back to it later */
+  g_assert_true (wp_spa_json_cursor_next (&cursor));
+  g_assert_true (wp_spa_json_cursor_next (&cursor));
+  g_assert_true (wp_spa_json_cursor_is_object (&cursor));
+  g_assert_true (wp_spa_json_cursor_is_container (&cursor));
+  saved = cursor;
+  g_assert_true (wp_spa_json_cursor_enter (&cursor, &child));
+  g_assert_true (wp_spa_json_cursor_next (&child));
+  g_assert_true (wp_spa_json_cursor_next (&child));
+  g_assert_true (wp_spa_json_cursor_is_boolean (&child));
+  g_assert_true (wp_spa_json_cursor_get_boolean (&child, &b));
+  g_assert_true (b);
+  g_assert_true (wp_spa_json_cursor_next (&child));
+  g_assert_true (wp_spa_json_cursor_next (&child));
+  g_assert_true (wp_spa_json_cursor_is_null (&child));
+  g_assert_false (wp_spa_json_cursor_next (&child));
+
+  /* string */
+  g_assert_true (wp_spa_json_cursor_next (&cursor));
+  g_assert_true (wp_spa_json_cursor_is_string (&cursor));
+  {
+    g_autofree gchar *key = wp_spa_json_cursor_dup_string (&cursor);
+    g_assert_cmpstr (key, ==, "key string");
+  }
+  g_assert_true (wp_spa_json_cursor_next (&cursor));
+  {
+    g_autofree gchar *value = wp_spa_json_cursor_dup_string (&cursor);
+    g_assert_cmpstr (value, ==, "a \"b\"");
+  }
+  g_assert_false (wp_spa_json_cursor_next (&cursor));
+  g_assert_null (wp_spa_json_cursor_get_data (&cursor, NULL));
+
+  /* the saved position is still valid */
+  {
+    g_autoptr (WpSpaJson) v = wp_spa_json_cursor_get_json (&saved);
+    g_autofree gchar *str = wp_spa_json_to_string (v);
+    g_assert_cmpstr (str, ==, "{ a = true, b = null }");
+  }
+
+  /* undefined */
+  {
+    g_autoptr (WpSpaJson) j = wp_spa_json_new_wrap_string ("a = 1 b = [ 2 ]");
+    g_assert_false (wp_spa_json_cursor_init (&cursor, j));
+    wp_spa_json_cursor_init_undefined (&cursor, j);
+    g_assert_true (wp_spa_json_cursor_next (&cursor));
+    g_assert_true (wp_spa_json_cursor_next (&cursor));
+    g_assert_true (wp_spa_json_cursor_next (&cursor));
+    g_assert_true (wp_spa_json_cursor_next (&cursor));
+    g_assert_true (wp_spa_json_cursor_is_array (&cursor));
+    g_assert_false (wp_spa_json_cursor_next (&cursor));
+  }
+}
+
+static guint
+walk_with_parser (WpSpaJson *json)
+{
+  g_autoptr (WpIterator) it = NULL;
+  g_auto (GValue) item = G_VALUE_INIT;
+  guint n = 1;
+
+  if (!wp_spa_json_is_container (json))
+    return n;
+
+  it = wp_spa_json_new_iterator (json);
+  for (; wp_iterator_next (it, &item); g_value_unset (&item))
+    n += walk_with_parser (g_value_get_boxed (&item));
+  return n;
+}
+
+static guint
+walk_with_cursor (const WpSpaJsonCursor *cursor)
+{
+  WpSpaJsonCursor child;
+  guint n = 1;
+
+  if (!wp_spa_json_cursor_enter (cursor, &child))
+    return n;
+
+  while (wp_spa_json_cursor_next (&child))
+    n += walk_with_cursor (&child);
+  return n;
+}
+
+#define N_PERF_ITERATIONS 100
+
+static void
+test_spa_json_cursor_perf (void)
+{
+  g_autoptr (GPtrArray) files = g_ptr_array_new_with_free_func (g_free);
+  g_autofree gchar *examples = NULL;
+  g_autoptr (GDir) dir = NULL;
+  const gchar *name;
+  gdouble parser_time = 0, cursor_time = 0;
+  guint n_parser = 0, n_cursor = 0;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("benchmark; run with -m perf");
+    return;
+  }
+
+  g_ptr_array_add (files, g_build_filename (g_getenv ("WIREPLUMBER_DATA_DIR"),
+      "config", "wireplumber.conf", NULL));
+  examples = g_build_filename (g_getenv ("WIREPLUMBER_DATA_DIR"),
+      "config", "wireplumber.conf.d.examples", NULL);
+  dir = g_dir_open (examples, 0, NULL);
+  g_assert_nonnull (dir);
+  while ((name = g_dir_read_name (dir)))
+    g_ptr_array_add (files, g_build_filename (examples, name, NULL));
+
+  for (guint i = 0; i < files->len; i++) {
+    g_autofree gchar *contents = NULL;
+    g_autoptr (WpSpaJson) json = NULL;
+    gsize size;
+
+    g_assert_true (g_file_get_contents (files->pdata[i], &contents, &size,
+        NULL));
+    json = wp_spa_json_new_wrap_stringn (contents, size);
+
+    /* the files are not enclosed in braces, so walk their top-level values */
+    g_test_timer_start ();
+    for (guint j = 0; j < N_PERF_ITERATIONS; j++) {
+      g_autoptr (WpSpaJsonParser) p = wp_spa_json_parser_new_undefined (json);
+      WpSpaJson *v;
+      while ((v = wp_spa_json_parser_get_json (p))) {
+        n_parser += walk_with_parser (v);
+        wp_spa_json_unref (v);
+      }
+    }
+    parser_time += g_test_timer_elapsed ();
+
+    g_test_timer_start ();
+    for (guint j = 0; j < N_PERF_ITERATIONS; j++) {
+      WpSpaJsonCursor cursor;
+      wp_spa_json_cursor_init_undefined (&cursor, json);
+      while (wp_spa_json_cursor_next (&cursor))
+        n_cursor += walk_with_cursor (&cursor);
+    }
+    cursor_time += g_test_timer_elapsed ();
+  }
+
+  g_assert_cmpuint (n_parser, ==, n_cursor);
+
+  g_test_message ("%u files, %u values: parser %.3f ms, cursor %.3f ms",
+      files->len, n_cursor / N_PERF_ITERATIONS, parser_time * 1000.0,
+      cursor_time * 1000.0);
+  g_test_minimized_result (cursor_time,
+      "walked %u values in %.3f ms", n_cursor, cursor_time * 1000.0);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -1325,6 +1518,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/wp/spa-json/to-string", test_spa_json_to_string);
   g_test_add_func ("/wp/spa-json/undefined-parser",
       test_spa_json_undefined_parser);
+  g_test_add_func ("/wp/spa-json/cursor", test_spa_json_cursor);
+  g_test_add_func ("/wp/spa-json/cursor-perf", test_spa_json_cursor_perf);
 
   return g_test_run ();
 }
@@ -1073,6 +1073,54 @@ test_spa_pod_port_config (void)
   g_assert_nonnull (pod);
 }
 
+#define N_PERF_ITERATIONS 10000
+
+static void
+test_spa_pod_build_by_name_perf (void)
+{
+  guint n_props = 0;
+  gdouble elapsed;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("benchmark; run with -m perf");
+    return;
+  }
+
+  /* this is what a Lua script does to set the volume of a device route */
+  g_test_timer_start ();
+  for (guint i = 0; i < N_PERF_ITERATIONS; i++) {
+    g_autoptr (WpSpaPodBuilder) b = wp_spa_pod_builder_new_object (
+        "Spa:Pod:Object:Param:Props", "Props");
+    wp_spa_pod_builder_add_property (b, "mute");
+    wp_spa_pod_builder_add_boolean (b, FALSE);
+    wp_spa_pod_builder_add_property (b, "volume");
+    wp_spa_pod_builder_add_float (b, 0.5);
+    wp_spa_pod_builder_add_property (b, "softMute");
+    wp_spa_pod_builder_add_boolean (b, FALSE);
+    wp_spa_pod_builder_add_property (b, "frequency");
+    wp_spa_pod_builder_add_int (b, 440);
+    g_autoptr (WpSpaPod) props = wp_spa_pod_builder_end (b);
+
+    g_autoptr (WpSpaPod) route = wp_spa_pod_new_object (
+        "Spa:Pod:Object:Param:Route", "Route",
+        "index",     "i", 1,
+        "device",    "i", 2,
+        "direction", "K", "Output",
+        "priority",  "i", 100,
+        "props",     "P", props,
+        "save",      "b", TRUE,
+        NULL);
+    g_assert_nonnull (route);
+    n_props += 10;
+  }
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_message ("%u Props/Route pods, %u properties by name: %.3f ms",
+      N_PERF_ITERATIONS, n_props, elapsed * 1000.0);
+  g_test_minimized_result (elapsed,
+      "built %u pods in %.3f ms", N_PERF_ITERATIONS * 2, elapsed * 1000.0);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -1088,6 +1136,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/wp/spa-pod/iterator", test_spa_pod_iterator);
   g_test_add_func ("/wp/spa-pod/unique-owner", test_spa_pod_unique_owner);
   g_test_add_func ("/wp/spa-pod/port-config", test_spa_pod_port_config);
+  g_test_add_func ("/wp/spa-pod/build-by-name-perf",
+      test_spa_pod_build_by_name_perf);
 
   return g_test_run ();
 }
@@ -7,6 +7,7 @@
  */
 
 #include "../common/test-log.h"
+#include <glib/gstdio.h>
 
 static void
 test_state_basic (void)
@@ -202,6 +203,225 @@ test_state_escaped (void)
   wp_state_clear (state);
 }
 
+static goffset
+get_file_size (const gchar *path)
+{
+  GStatBuf st;
+  g_assert_cmpint (g_stat (path, &st), ==, 0);
+  return st.st_size;
+}
+
+static void
+test_state_incremental (void)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (WpState) state = wp_state_new ("incremental");
+  const gchar *location = wp_state_get_location (state);
+  goffset size;
+
+  /* Save */
+  {
+    g_autoptr (WpProperties) props = wp_properties_new_empty ();
+    wp_properties_set (props, "key1", "value1");
+    wp_properties_set (props, "key2", "value with\nnewline");
+    g_assert_true (wp_state_save (state, props, &error));
+    g_assert_no_error (error);
+  }
+  size = get_file_size (location);
+
+  /* Saving the same properties again does not write anything */
+  {
+    g_autoptr (WpProperties) props = wp_properties_new_empty ();
+    wp_properties_set (props, "key1", "value1");
+    wp_properties_set (props, "key2", "value with\nnewline");
+    g_assert_true (wp_state_save (state, props, &error));
+    g_assert_no_error (error);
+    g_assert_cmpint (get_file_size (location), ==, size);
+  }
+
+  /* Changes are appended */
+  {
+    g_autoptr (WpProperties) props = wp_properties_new_empty ();
+    wp_properties_set (props, "key2", "value2");
+    wp_properties_set (props, "key3", "value3");
+    g_assert_true (wp_state_save (state, props, &error));
+    g_assert_no_error (error);
+    g_assert_cmpint (get_file_size (location), >, size);
+  }
+
+  /* Single keys can be updated and removed */
+  g_assert_true (wp_state_update (state, "key4", "value4", &error));
+  g_assert_no_error (error);
+  g_assert_true (wp_state_update (state, "key3", NULL, &error));
+  g_assert_no_error (error);
+
+  /* Load */
+  {
+    g_autoptr (WpProperties) props = wp_state_load (state);
+    g_assert_nonnull (props);
+    g_assert_null (wp_properties_get (props, "key1"));
+    g_assert_cmpstr (wp_properties_get (props, "key2"), ==, "value2");
+    g_assert_null (wp_properties_get (props, "key3"));
+    g_assert_cmpstr (wp_properties_get (props, "key4"), ==, "value4");
+  }
+
+  /* Many updates of the same key compact the log */
+  for (guint i = 0; i < 1000; i++) {
+    g_autofree gchar *value = g_strdup_printf ("%u", i);
+    g_assert_true (wp_state_update (state, "counter", value, &error));
+    g_assert_no_error (error);
+  }
+  g_assert_cmpint (get_file_size (location), <, 4096);
+
+  /* A new state object on the same file sees the same data */
+  {
+    g_autoptr (WpState) other = wp_state_new ("incremental");
+    g_autoptr (WpProperties) props = wp_state_load (other);
+    g_assert_cmpstr (wp_properties_get (props, "counter"), ==, "999");
+    g_assert_cmpstr (wp_properties_get (props, "key2"), ==, "value2");
+    g_assert_cmpstr (wp_properties_get (props, "key4"), ==, "value4");
+  }
+
+  wp_state_clear (state);
+}
+
+static void
+test_state_migrate (void)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (WpState) state = wp_state_new ("migrate");
+  g_autofree gchar *contents = NULL;
+  const gchar *keyfile =
+      "[migrate]\n"
+      "key\\sone=value one\n"
+      "\\o\\e\\c=v2\n";
+
+  /* A keyfile written by an older version */
+  g_assert_true (g_file_set_contents (wp_state_get_location (state), keyfile,
+      -1, &error));
+  g_assert_no_error (error);
+
+  {
+    g_autoptr (WpProperties) props = wp_state_load (state);
+    g_assert_cmpstr (wp_properties_get (props, "key one"), ==, "value one");
+    g_assert_cmpstr (wp_properties_get (props, "[=]"), ==, "v2");
+
+    /* Saving it again replaces the keyfile */
+    g_assert_true (wp_state_save (state, props, &error));
+    g_assert_no_error (error);
+  }
+
+  g_assert_true (g_file_get_contents (wp_state_get_location (state),
+      &contents, NULL, &error));
+  g_assert_no_error (error);
+  g_assert_true (g_str_has_prefix (contents, "# WirePlumber state log"));
+
+  {
+    g_autoptr (WpProperties) props = wp_state_load (state);
+    g_assert_cmpstr (wp_properties_get (props, "key one"), ==, "value one");
+    g_assert_cmpstr (wp_properties_get (props, "[=]"), ==, "v2");
+  }
+
+  wp_state_clear (state);
+}
+
+/* loads a state file the way WirePlumber versions that did not write logs
+   did, with a plain GKeyFile */
+static GKeyFile *
+load_as_plain_keyfile (WpState *state)
+{
+  g_autoptr (GKeyFile) keyfile = g_key_file_new ();
+  g_autoptr (GError) error = NULL;
+
+  g_assert_true (g_key_file_load_from_file (keyfile,
+      wp_state_get_location (state), G_KEY_FILE_NONE, &error));
+  g_assert_no_error (error);
+  return g_steal_pointer (&keyfile);
+}
+
+static void
+test_state_downgrade (void)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (WpState) state = wp_state_new ("downgrade");
+
+  {
+    g_autoptr (WpProperties) props = wp_properties_new_empty ();
+    wp_properties_set (props, "key one", "value1");
+    wp_properties_set (props, "key2", " value with\nnewline");
+    g_assert_true (wp_state_save (state, props, &error));
+    g_assert_no_error (error);
+  }
+  g_assert_true (wp_state_update (state, "key one", "value2", &error));
+  g_assert_no_error (error);
+  g_assert_true (wp_state_update (state, "[key3]", "value3", &error));
+  g_assert_no_error (error);
+
+  /* appended records are readable as a keyfile, with their last value */
+  {
+    g_autoptr (GKeyFile) keyfile = load_as_plain_keyfile (state);
+    g_autofree gchar *v1 = g_key_file_get_string (keyfile, "downgrade",
+        "key\\sone", NULL);
+    g_autofree gchar *v2 = g_key_file_get_string (keyfile, "downgrade",
+        "key2", NULL);
+    g_autofree gchar *v3 = g_key_file_get_string (keyfile, "downgrade",
+        "\\okey3\\c", NULL);
+    g_assert_cmpstr (v1, ==, "value2");
+    g_assert_cmpstr (v2, ==, " value with\nnewline");
+    g_assert_cmpstr (v3, ==, "value3");
+  }
+
+  /* removed keys are also gone for a plain keyfile reader */
+  g_assert_true (wp_state_update (state, "key2", NULL, &error));
+  g_assert_no_error (error);
+  {
+    g_autoptr (GKeyFile) keyfile = load_as_plain_keyfile (state);
+    g_assert_false (g_key_file_has_key (keyfile, "downgrade", "key2", NULL));
+    g_assert_true (g_key_file_has_key (keyfile, "downgrade", "key\\sone",
+        NULL));
+  }
+
+  wp_state_clear (state);
+}
+
+static void
+test_state_external_change (void)
+{
+  g_autoptr (GError) error = NULL;
+  g_autoptr (WpState) state = wp_state_new ("external");
+  g_autofree gchar *contents = NULL;
+  gsize size = 0;
+
+  {
+    g_autoptr (WpProperties) props = wp_properties_new_empty ();
+    wp_properties_set (props, "key1", "qqqq");
+    g_assert_true (wp_state_save (state, props, &error));
+    g_assert_no_error (error);
+  }
+
+  /* someone else replaces the file with one of the same size */
+  g_assert_true (g_file_get_contents (wp_state_get_location (state),
+      &contents, &size, &error));
+  g_assert_no_error (error);
+  g_strdelimit (contents, "q", 'z');
+  g_assert_true (g_file_set_contents (wp_state_get_location (state),
+      contents, size, &error));
+  g_assert_no_error (error);
+
+  /* the change is not appended to the foreign file; it is rewritten with
+     the state that this object knows about */
+  g_assert_true (wp_state_update (state, "key2", "value2", &error));
+  g_assert_no_error (error);
+  {
+    g_autoptr (WpState) other = wp_state_new ("external");
+    g_autoptr (WpProperties) props = wp_state_load (other);
+    g_assert_cmpstr (wp_properties_get (props, "key1"), ==, "qqqq");
+    g_assert_cmpstr (wp_properties_get (props, "key2"), ==, "value2");
+  }
+
+  wp_state_clear (state);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -212,6 +432,10 @@ main (int argc, char *argv[])
   g_test_add_func ("/wp/state/empty", test_state_empty);
   g_test_add_func ("/wp/state/spaces", test_state_spaces);
   g_test_add_func ("/wp/state/escaped", test_state_escaped);
+  g_test_add_func ("/wp/state/incremental", test_state_incremental);
+  g_test_add_func ("/wp/state/migrate", test_state_migrate);
+  g_test_add_func ("/wp/state/downgrade", test_state_downgrade);
+  g_test_add_func ("/wp/state/external_change", test_state_external_change);
 
   return g_test_run ();
 }
@@ -114,6 +114,16 @@ assert (val.properties.maxLatency == 8192)
 assert (val.properties["id-01000000"] == true)
 assert (val.properties.latencyOffsetNsec == 0)
 assert (pod:get_type_name() == "Spa:Pod:Object:Param:Props")
+val = pod:parse { "device", "minLatency", "id-01000000" }
+assert (val.pod_type == "Object")
+assert (val.object_id == "Props")
+assert (val.properties.device == "hw:Generic")
+assert (val.properties.deviceName == nil)
+assert (val.properties.minLatency == 16)
+assert (val.properties.maxLatency == nil)
+assert (val.properties["id-01000000"] == true)
+val = pod:parse {}
+assert (next (val.properties) == nil)
 
 -- Sequence
 pod = Pod.Sequence {
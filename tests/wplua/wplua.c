@@ -8,6 +8,8 @@
 
 #include "../common/test-log.h"
 #include <wplua/wplua.h>
+#include <glib/gstdio.h>
+#include <string.h>
 
 enum {
   PROP_0,
@@ -386,6 +388,77 @@ test_wplua_closure ()
   g_closure_unref (closure);
 }
 
+static gboolean
+test_gc_invoke_and_check (lua_State *L, GClosure *closure)
+{
+  gboolean collected;
+
+  g_closure_invoke (closure, NULL, 0, NULL, NULL);
+  while (g_main_context_iteration (NULL, FALSE));
+
+  lua_getglobal (L, "collected");
+  collected = lua_toboolean (L, -1);
+  lua_pop (L, 1);
+  return collected;
+}
+
+static void
+test_wplua_gc_policy ()
+{
+  GClosure *closure;
+  g_autoptr (GError) error = NULL;
+  lua_State *L = wplua_new ();
+
+  const gchar code[] =
+    "collected = false\n"
+    "function f()\n"
+    "  if not created then\n"
+    "    setmetatable({}, { __gc = function() collected = true end })\n"
+    "    created = true\n"
+    "  end\n"
+    "end\n";
+  test_load_and_call (L, code, sizeof (code) - 1, 0, 0, &error);
+  g_assert_no_error (error);
+
+  lua_getglobal (L, "f");
+  closure = wplua_function_to_closure (L, -1);
+  g_closure_ref (closure);
+  g_closure_sink (closure);
+  lua_pop (L, 1);
+
+  /* full collection after each call; garbage is gone right away */
+  wplua_set_gc_policy (L, WP_LUA_GC_MODE_INCREMENTAL, 0, 0, TRUE);
+  g_closure_invoke (closure, NULL, 0, NULL, NULL);
+  lua_getglobal (L, "collected");
+  g_assert_true (lua_toboolean (L, -1));
+  lua_pop (L, 1);
+
+  /* incremental steps from idle; garbage is gone after at most
+     two cycles, depending on the collector state at allocation time */
+  lua_pushboolean (L, FALSE);
+  lua_setglobal (L, "collected");
+  lua_pushnil (L);
+  lua_setglobal (L, "created");
+  wplua_set_gc_policy (L, WP_LUA_GC_MODE_INCREMENTAL, 1, 100, FALSE);
+  g_assert_true (test_gc_invoke_and_check (L, closure) ||
+      test_gc_invoke_and_check (L, closure) ||
+      test_gc_invoke_and_check (L, closure));
+
+#if LUA_VERSION_NUM >= 504
+  lua_pushboolean (L, FALSE);
+  lua_setglobal (L, "collected");
+  lua_pushnil (L);
+  lua_setglobal (L, "created");
+  wplua_set_gc_policy (L, WP_LUA_GC_MODE_GENERATIONAL, 0, 0, FALSE);
+  g_assert_true (test_gc_invoke_and_check (L, closure) ||
+      test_gc_invoke_and_check (L, closure) ||
+      test_gc_invoke_and_check (L, closure));
+#endif
+
+  wplua_unref (L);
+  g_closure_unref (closure);
+}
+
 static void
 test_wplua_signals ()
 {
@@ -667,6 +740,281 @@ test_wplua_convert_wp_properties ()
   wplua_unref (L);
 }
 
+static void
+test_wplua_lazy_properties ()
+{
+  g_autoptr (GError) error = NULL;
+  lua_State *L = wplua_new ();
+  WpProperties *props = wp_properties_new (
+      "key.a", "a", "key.b", "b", "key.c", "c", NULL);
+
+  wplua_pushproperties (L, wp_properties_ref (props));
+  lua_setglobal (L, "props");
+
+  const gchar code[] =
+    "assert (props['key.a'] == 'a')\n"
+    "assert (props['key.x'] == nil)\n"
+    "props['key.b'] = nil\n"
+    "props['key.c'] = 42\n"
+    "props['key.d'] = 'd'\n"
+    "assert (props['key.b'] == nil)\n"
+    "assert (props['key.c'] == 42)\n"
+    "local seen = {}\n"
+    "local n = 0\n"
+    "for k, v in pairs (props) do\n"
+    "  assert (seen[k] == nil)\n"
+    "  seen[k] = v\n"
+    "  n = n + 1\n"
+    "end\n"
+    "assert (n == 3)\n"
+    "assert (seen['key.a'] == 'a')\n"
+    "assert (seen['key.c'] == 42)\n"
+    "assert (seen['key.d'] == 'd')\n";
+  test_load_and_call (L, code, sizeof (code) - 1, 0, 0, &error);
+  g_assert_no_error (error);
+
+  /* assignments from Lua never modify the original */
+  g_assert_cmpstr (wp_properties_get (props, "key.b"), ==, "b");
+  g_assert_cmpstr (wp_properties_get (props, "key.c"), ==, "c");
+  g_assert_null (wp_properties_get (props, "key.d"));
+
+  lua_getglobal (L, "props");
+  g_assert_true (wplua_isproperties (L, -1));
+  {
+    g_autoptr (WpProperties) fromlua = wplua_table_to_properties (L, -1);
+    g_assert_cmpstr (wp_properties_get (fromlua, "key.a"), ==, "a");
+    g_assert_null (wp_properties_get (fromlua, "key.b"));
+    g_assert_cmpstr (wp_properties_get (fromlua, "key.c"), ==, "42");
+    g_assert_cmpstr (wp_properties_get (fromlua, "key.d"), ==, "d");
+  }
+  lua_pop (L, 1);
+
+  wplua_unref (L);
+  wp_properties_unref (props);
+}
+
+static void
+test_load_path_and_check_result (lua_State *L, const gchar *path,
+    const gchar *expected)
+{
+  g_autoptr (GError) error = NULL;
+
+  g_assert_true (wplua_load_path (L, path, &error));
+  g_assert_no_error (error);
+  g_assert_true (wplua_pcall (L, 0, 0, &error));
+  g_assert_no_error (error);
+
+  lua_getglobal (L, "result");
+  g_assert_cmpstr (lua_tostring (L, -1), ==, expected);
+  lua_pop (L, 1);
+}
+
+static gchar *
+test_find_file_except (const gchar *dir, const gchar *except1,
+    const gchar *except2)
+{
+  g_autoptr (GDir) d = g_dir_open (dir, 0, NULL);
+  const gchar *name;
+
+  while (d && (name = g_dir_read_name (d))) {
+    if (g_strcmp0 (name, except1) && g_strcmp0 (name, except2))
+      return g_strdup (name);
+  }
+  return NULL;
+}
+
+static void
+test_remove_dir (const gchar *dir)
+{
+  g_autoptr (GDir) d = g_dir_open (dir, 0, NULL);
+  const gchar *name;
+
+  while (d && (name = g_dir_read_name (d))) {
+    g_autofree gchar *path = g_build_filename (dir, name, NULL);
+    if (g_file_test (path, G_FILE_TEST_IS_DIR))
+      test_remove_dir (path);
+    else
+      g_remove (path);
+  }
+  g_rmdir (dir);
+}
+
+static void
+test_wplua_bytecode_cache ()
+{
+  g_autofree gchar *tmpdir = g_dir_make_tmp ("wplua-bytecode-XXXXXX", NULL);
+  g_autofree gchar *cache = g_build_filename (tmpdir, "cache", NULL);
+  g_autofree gchar *a = g_build_filename (tmpdir, "a.lua", NULL);
+  g_autofree gchar *b = g_build_filename (tmpdir, "b.lua", NULL);
+  g_autofree gchar *cache_a = NULL;
+  g_autofree gchar *cache_b = NULL;
+  g_autofree gchar *cache_a_path = NULL;
+  g_autofree gchar *cache_b_data = NULL;
+  gsize cache_b_size = 0;
+  lua_State *L = wplua_new ();
+
+  g_assert_nonnull (tmpdir);
+  g_assert_true (g_file_set_contents (a, "result = 'a'\n", -1, NULL));
+  g_assert_true (g_file_set_contents (b, "result = 'b'\n", -1, NULL));
+
+  wplua_enable_bytecode_cache (L, cache);
+
+  /* compiling from source fills the cache */
+  test_load_path_and_check_result (L, a, "a");
+  cache_a = test_find_file_except (cache, NULL, NULL);
+  g_assert_nonnull (cache_a);
+  test_load_path_and_check_result (L, b, "b");
+  cache_b = test_find_file_except (cache, cache_a, NULL);
+  g_assert_nonnull (cache_b);
+
+  /* the cached chunk is used instead of the source, as long as the first
+     line still matches the source */
+  cache_a_path = g_build_filename (cache, cache_a, NULL);
+  {
+    g_autofree gchar *cache_b_path = g_build_filename (cache, cache_b, NULL);
+    g_autofree gchar *cache_a_data = NULL;
+    g_autoptr (GByteArray) spliced = g_byte_array_new ();
+    gsize cache_a_size = 0;
+    const gchar *a_nl, *b_nl;
+
+    g_assert_true (g_file_get_contents (cache_a_path, &cache_a_data,
+        &cache_a_size, NULL));
+    g_assert_true (g_file_get_contents (cache_b_path, &cache_b_data,
+        &cache_b_size, NULL));
+    a_nl = memchr (cache_a_data, '\n', cache_a_size);
+    b_nl = memchr (cache_b_data, '\n', cache_b_size);
+    g_assert_nonnull (a_nl);
+    g_assert_nonnull (b_nl);
+
+    g_byte_array_append (spliced, (const guint8 *) cache_a_data,
+        a_nl - cache_a_data);
+    g_byte_array_append (spliced, (const guint8 *) b_nl,
+        cache_b_size - (b_nl - cache_b_data));
+    g_assert_true (g_file_set_contents (cache_a_path,
+        (const gchar *) spliced->data, spliced->len, NULL));
+  }
+  test_load_path_and_check_result (L, a, "b");
+
+  /* the entry of another version of the source is ignored and replaced */
+  g_assert_true (g_file_set_contents (cache_a_path, cache_b_data,
+      cache_b_size, NULL));
+  test_load_path_and_check_result (L, a, "a");
+  test_load_path_and_check_result (L, a, "a");
+
+  /* a broken cache entry is ignored and replaced */
+  g_assert_true (g_file_set_contents (cache_a_path, "garbage", -1, NULL));
+  test_load_path_and_check_result (L, a, "a");
+  test_load_path_and_check_result (L, a, "a");
+
+  /* modifying the source overwrites its entry instead of adding one */
+  g_assert_true (g_file_set_contents (a, "result = 'aa'\n", -1, NULL));
+  test_load_path_and_check_result (L, a, "aa");
+  g_assert_null (test_find_file_except (cache, cache_a, cache_b));
+  {
+    g_autofree gchar *cache_a_data = NULL;
+    g_assert_true (g_file_get_contents (cache_a_path, &cache_a_data, NULL,
+        NULL));
+    g_assert_false (g_str_has_prefix (cache_a_data, "garbage"));
+  }
+
+  /* entries that have not been loaded or written for a long time are
+     removed when the cache is enabled, while loading an entry keeps it */
+  {
+    g_autofree gchar *cache_b_path = g_build_filename (cache, cache_b, NULL);
+    g_autoptr (GFile) fa = g_file_new_for_path (cache_a_path);
+    g_autoptr (GFile) fb = g_file_new_for_path (cache_b_path);
+    g_autoptr (GFileInfo) info = g_file_info_new ();
+    lua_State *L2 = wplua_new ();
+
+    g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+        g_get_real_time () / G_USEC_PER_SEC - 31 * 24 * 3600);
+    g_assert_true (g_file_set_attributes_from_info (fa, info,
+        G_FILE_QUERY_INFO_NONE, NULL, NULL));
+    g_assert_true (g_file_set_attributes_from_info (fb, info,
+        G_FILE_QUERY_INFO_NONE, NULL, NULL));
+
+    /* b.lua has not changed, so this is a cache hit */
+    test_load_path_and_check_result (L, b, "b");
+
+    wplua_enable_bytecode_cache (L2, cache);
+    g_assert_false (g_file_test (cache_a_path, G_FILE_TEST_EXISTS));
+    g_assert_true (g_file_test (cache_b_path, G_FILE_TEST_EXISTS));
+    wplua_unref (L2);
+  }
+
+  wplua_unref (L);
+  test_remove_dir (tmpdir);
+}
+
+#define N_BENCH_FUNCTIONS 3000
+#define N_BENCH_ROUNDS 20
+
+static gdouble
+test_bytecode_cache_load_time (const gchar *path, const gchar *cache)
+{
+  gdouble best = G_MAXDOUBLE;
+
+  for (guint round = 0; round < N_BENCH_ROUNDS; round++) {
+    g_autoptr (GError) error = NULL;
+    lua_State *L = wplua_new ();
+    gdouble elapsed;
+
+    if (cache)
+      wplua_enable_bytecode_cache (L, cache);
+
+    g_test_timer_start ();
+    g_assert_true (wplua_load_path (L, path, &error));
+    elapsed = g_test_timer_elapsed ();
+    g_assert_no_error (error);
+
+    best = MIN (best, elapsed);
+    wplua_unref (L);
+  }
+  return best;
+}
+
+static void
+test_wplua_bytecode_cache_perf ()
+{
+  g_autofree gchar *tmpdir = NULL;
+  g_autofree gchar *cache = NULL;
+  g_autofree gchar *path = NULL;
+  g_autoptr (GString) src = g_string_new (NULL);
+  gdouble source_time, cached_time;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("benchmark; run with -m perf");
+    return;
+  }
+
+  tmpdir = g_dir_make_tmp ("wplua-bytecode-XXXXXX", NULL);
+  cache = g_build_filename (tmpdir, "cache", NULL);
+  path = g_build_filename (tmpdir, "script.lua", NULL);
+
+  /* a script roughly the size of all the default scripts together */
+  for (guint i = 0; i < N_BENCH_FUNCTIONS; i++)
+    g_string_append_printf (src,
+        "function f%u (a, b)\n"
+        "  local t = { a, b, key = 'value %u' }\n"
+        "  return t[1] + t[2] * %u\n"
+        "end\n", i, i, i);
+  g_assert_true (g_file_set_contents (path, src->str, src->len, NULL));
+
+  source_time = test_bytecode_cache_load_time (path, NULL);
+
+  /* first load fills the cache */
+  test_bytecode_cache_load_time (path, cache);
+  cached_time = test_bytecode_cache_load_time (path, cache);
+
+  g_test_message ("loading %u functions: source %.3f ms, bytecode %.3f ms",
+      N_BENCH_FUNCTIONS, source_time * 1000.0, cached_time * 1000.0);
+  g_test_minimized_result (cached_time,
+      "loading %u functions from the bytecode cache: %.3f ms",
+      N_BENCH_FUNCTIONS, cached_time * 1000.0);
+
+  test_remove_dir (tmpdir);
+}
+
 static void
 test_wplua_script_arguments ()
 {
@@ -711,6 +1059,7 @@ main (gint argc, gchar *argv[])
   g_test_add_func ("/wplua/construct", test_wplua_construct);
   g_test_add_func ("/wplua/properties", test_wplua_properties);
   g_test_add_func ("/wplua/closure", test_wplua_closure);
+  g_test_add_func ("/wplua/gc_policy", test_wplua_gc_policy);
   g_test_add_func ("/wplua/signals", test_wplua_signals);
   g_test_add_func ("/wplua/sandbox/script", test_wplua_sandbox_script);
   g_test_add_func ("/wplua/sandbox/config", test_wplua_sandbox_config);
@@ -719,6 +1068,11 @@ main (gint argc, gchar *argv[])
       test_wplua_convert_gvariant_array);
   g_test_add_func ("/wplua/convert/wp_properties",
       test_wplua_convert_wp_properties);
+  g_test_add_func ("/wplua/convert/lazy_properties",
+      test_wplua_lazy_properties);
+  g_test_add_func ("/wplua/bytecode_cache", test_wplua_bytecode_cache);
+  g_test_add_func ("/wplua/bytecode_cache_perf",
+      test_wplua_bytecode_cache_perf);
   g_test_add_func ("/wplua/script_arguments", test_wplua_script_arguments);
 
   return g_test_run ();